@@ -0,0 +1,77 @@
+#ifndef CPU_TRACE_HPP
+#define CPU_TRACE_HPP
+
+#include <main.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+
+//CPU timing zones for Chrome trace/Perfetto files
+//every thread records finished zones into its own fixed size buffer(one writer, no locks after the
+//first zone on a thread), cpuTraceWrite() merges them with GPU zones on the same clock into one file
+//the macros only exist with make TRACE=1(-DENABLE_CPU_TRACE), otherwise they compile to nothing
+//  TRACE_ZONE("createSwapChain"); //until the end of the scope
+//  TRACE_THREAD_NAME("asset loader");
+//  cpuTraceStart(); ... cpuTraceStop(); cpuTraceWrite("trace.json", &gpuProfiler.traceEvents());
+//names have to outlive the trace, string literals are the safe choice
+
+
+//one finished zone, times are microseconds on std::chrono::steady_clock
+struct TraceEvent{
+    std::string name;
+    double startUs = 0.0;
+    double durationUs = 0.0;
+    uint32_t depth = 0;
+};
+
+//steady_clock in microseconds, the time base every trace event uses
+inline double traceClockUs(std::chrono::steady_clock::time_point time){
+    return std::chrono::duration<double, std::micro>(time.time_since_epoch()).count();
+}
+
+//recording is off until cpuTraceStart(), zones outside a capture cost one relaxed load
+void cpuTraceStart();
+//zones that are still open when this is called are not recorded
+void cpuTraceStop();
+bool cpuTraceActive();
+//shows up as the track name, call once per thread(the job system names its workers)
+void cpuTraceSetThreadName(const char* name);
+//zones that didn't fit into a thread's buffer during the last capture
+uint64_t cpuTraceDropped();
+//captured CPU zones, one track per thread, plus gpuEvents(GpuProfiler::traceEvents()) on a "GPU" track
+//only call while no capture is running, throws on failure
+void cpuTraceWrite(const std::string& path, const std::vector<TraceEvent>* gpuEvents = nullptr);
+//quoted and escaped for JSON, the trace, bench results and debug report all write strings through this
+std::string traceJsonString(const std::string& text);
+
+//records the enclosing scope
+class CpuTraceZone{
+    public:
+    explicit CpuTraceZone(const char* name);
+    ~CpuTraceZone();
+    CpuTraceZone(const CpuTraceZone&) = delete;
+    CpuTraceZone& operator=(const CpuTraceZone&) = delete;
+
+    private:
+    const char* name;
+    bool recording;
+    std::chrono::steady_clock::time_point begin;
+};
+
+
+#ifdef ENABLE_CPU_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_ZONE(name) CpuTraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+#define TRACE_THREAD_NAME(name) cpuTraceSetThreadName(name)
+#else
+#define TRACE_ZONE(name) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+
+
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef DEBUG_NAMES_HPP
+#define DEBUG_NAMES_HPP
+
+#include <main.hpp>
+
+#include <string>
+
+
+//VK_EXT_debug_utils object names and command buffer labels, so validation messages, RenderDoc and Nsight
+//say "render graph: shadow map" instead of a raw handle
+//every name also goes into a registry keyed by handle, the debug callback looks handles up there
+//names given before debugNamesInit()(or on a device without the extension) only land in the registry
+//the macros compile to nothing with NDEBUG, name strings aren't even built
+//  DEBUG_NAME(device, buffer, "instance staging " + std::to_string(frame));
+//  DEBUG_LABEL(cmd, "shadows"); //until the end of the scope
+
+
+#ifndef NDEBUG
+
+//object type of a handle, for vkSetDebugUtilsObjectNameEXT
+template<typename Handle> struct DebugObjectType;
+#define DEBUG_OBJECT_TYPE(Handle, type) template<> struct DebugObjectType<Handle>{ static constexpr VkObjectType value = type; }
+DEBUG_OBJECT_TYPE(VkInstance, VK_OBJECT_TYPE_INSTANCE);
+DEBUG_OBJECT_TYPE(VkPhysicalDevice, VK_OBJECT_TYPE_PHYSICAL_DEVICE);
+DEBUG_OBJECT_TYPE(VkDevice, VK_OBJECT_TYPE_DEVICE);
+DEBUG_OBJECT_TYPE(VkQueue, VK_OBJECT_TYPE_QUEUE);
+DEBUG_OBJECT_TYPE(VkCommandPool, VK_OBJECT_TYPE_COMMAND_POOL);
+DEBUG_OBJECT_TYPE(VkCommandBuffer, VK_OBJECT_TYPE_COMMAND_BUFFER);
+DEBUG_OBJECT_TYPE(VkFence, VK_OBJECT_TYPE_FENCE);
+DEBUG_OBJECT_TYPE(VkSemaphore, VK_OBJECT_TYPE_SEMAPHORE);
+DEBUG_OBJECT_TYPE(VkDeviceMemory, VK_OBJECT_TYPE_DEVICE_MEMORY);
+DEBUG_OBJECT_TYPE(VkBuffer, VK_OBJECT_TYPE_BUFFER);
+DEBUG_OBJECT_TYPE(VkImage, VK_OBJECT_TYPE_IMAGE);
+DEBUG_OBJECT_TYPE(VkImageView, VK_OBJECT_TYPE_IMAGE_VIEW);
+DEBUG_OBJECT_TYPE(VkSampler, VK_OBJECT_TYPE_SAMPLER);
+DEBUG_OBJECT_TYPE(VkQueryPool, VK_OBJECT_TYPE_QUERY_POOL);
+DEBUG_OBJECT_TYPE(VkDescriptorPool, VK_OBJECT_TYPE_DESCRIPTOR_POOL);
+DEBUG_OBJECT_TYPE(VkDescriptorSetLayout, VK_OBJECT_TYPE_DESCRIPTOR_SET_LAYOUT);
+DEBUG_OBJECT_TYPE(VkDescriptorSet, VK_OBJECT_TYPE_DESCRIPTOR_SET);
+DEBUG_OBJECT_TYPE(VkPipelineLayout, VK_OBJECT_TYPE_PIPELINE_LAYOUT);
+DEBUG_OBJECT_TYPE(VkPipeline, VK_OBJECT_TYPE_PIPELINE);
+DEBUG_OBJECT_TYPE(VkShaderModule, VK_OBJECT_TYPE_SHADER_MODULE);
+DEBUG_OBJECT_TYPE(VkSwapchainKHR, VK_OBJECT_TYPE_SWAPCHAIN_KHR);
+#undef DEBUG_OBJECT_TYPE
+
+//loads the debug utils entry points, call after device creation with VK_EXT_debug_utils enabled on instance
+//and again with VK_NULL_HANDLEs before the device goes away, names already in the registry are applied
+void debugNamesInit(VkInstance instance, VkDevice device);
+void debugNameObject(VkDevice device, VkObjectType type, uint64_t handle, const std::string& name);
+template<typename Handle>
+void debugName(VkDevice device, Handle handle, const std::string& name){
+    debugNameObject(device, DebugObjectType<Handle>::value, (uint64_t)handle, name);
+}
+//registry name of handle, empty if it was never named
+std::string debugNameOf(uint64_t handle);
+
+void debugLabelBegin(VkCommandBuffer cmd, const char* name);
+void debugLabelEnd(VkCommandBuffer cmd);
+
+//labels a scope of a command buffer
+class DebugLabel{
+    public:
+    DebugLabel(VkCommandBuffer cmd, const char* name) : cmd(cmd){
+        debugLabelBegin(cmd, name);
+    }
+    ~DebugLabel(){
+        debugLabelEnd(cmd);
+    }
+    DebugLabel(const DebugLabel&) = delete;
+    DebugLabel& operator=(const DebugLabel&) = delete;
+
+    private:
+    VkCommandBuffer cmd;
+};
+
+#define DEBUG_LABEL_CONCAT_INNER(a, b) a##b
+#define DEBUG_LABEL_CONCAT(a, b) DEBUG_LABEL_CONCAT_INNER(a, b)
+#define DEBUG_NAMES_INIT(instance, device) debugNamesInit(instance, device)
+#define DEBUG_NAME(device, handle, name) debugName(device, handle, name)
+#define DEBUG_LABEL(cmd, name) DebugLabel DEBUG_LABEL_CONCAT(debugLabel, __LINE__)(cmd, name)
+#define DEBUG_LABEL_BEGIN(cmd, name) debugLabelBegin(cmd, name)
+#define DEBUG_LABEL_END(cmd) debugLabelEnd(cmd)
+
+#else
+
+#define DEBUG_NAMES_INIT(instance, device) ((void)0)
+#define DEBUG_NAME(device, handle, name) ((void)0)
+#define DEBUG_LABEL(cmd, name) ((void)0)
+#define DEBUG_LABEL_BEGIN(cmd, name) ((void)0)
+#define DEBUG_LABEL_END(cmd) ((void)0)
+
+#endif
+
+
+
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef DEBUG_REPORT_HPP
+#define DEBUG_REPORT_HPP
+
+#include <main.hpp>
+
+#include <mutex>
+#include <string>
+#include <tuple>
+
+
+//all messages of one kind: same type flags, severity and messageIdNumber
+struct DebugMessageBucket{
+    VkDebugUtilsMessageTypeFlagsEXT types = 0;
+    VkDebugUtilsMessageSeverityFlagBitsEXT severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT;
+    int32_t messageId = 0;
+    std::string messageIdName;
+    uint64_t count = 0;
+    //everything below is from the first occurrence
+    std::string message;
+    std::vector<std::string> objects; //"VK_OBJECT_TYPE_BUFFER 0x1234 name"
+    std::vector<std::string> stack; //one frame per entry, innermost first
+};
+
+
+//collects debug utils messages of one run, handed to the messenger through pUserData
+//  createInfo.pUserData = &report; //in the callback: static_cast<DebugReport*>(pUserData)->record(...)
+//messages are bucketed instead of printed every time, record() says whether one is the first of its bucket
+//so the console only gets each kind once, the counts and first stacks end up in summary()/writeJson()
+//stacks are raw frames(module(symbol+offset) [address]), addr2line resolves them on builds without -rdynamic
+//safe to call from any thread, drivers and layers call back from wherever the vulkan call happened
+class DebugReport{
+    public:
+    //failOnPerformance makes failed() true as soon as a PERFORMANCE message was seen(CI mode)
+    explicit DebugReport(bool failOnPerformance = false) : failOnPerformance(failOnPerformance){}
+
+    //returns true for the first message of its bucket
+    bool record(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* data);
+
+    //messages with any of types and at least minimumSeverity
+    uint64_t count(VkDebugUtilsMessageTypeFlagsEXT types, VkDebugUtilsMessageSeverityFlagBitsEXT minimumSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT) const;
+    bool failed() const;
+    //copy of every bucket, most frequent first
+    std::vector<DebugMessageBucket> buckets() const;
+    //a line per bucket "count x SEVERITY TYPE|TYPE id name", most frequent first
+    std::string summary() const;
+    //every bucket with its first message, objects and stack, throws on failure
+    void writeJson(const std::string& path) const;
+
+    private:
+    bool failOnPerformance;
+    bool performanceSeen = false;
+    mutable std::mutex mutex;
+    std::vector<DebugMessageBucket> bucketList; //first seen first
+    std::map<std::tuple<VkDebugUtilsMessageTypeFlagsEXT, VkDebugUtilsMessageSeverityFlagBitsEXT, int32_t>, size_t> bucketIndex;
+};
+
+//"VALIDATION|PERFORMANCE", every bit that is set
+std::string debugMessageTypeString(VkDebugUtilsMessageTypeFlagsEXT types);
+std::string debugSeverityString(VkDebugUtilsMessageSeverityFlagBitsEXT severity);
+//frames of the calling thread, skip drops the innermost ones
+std::vector<std::string> captureStackTrace(uint32_t skip = 0, uint32_t maxFrames = 32);
+
+
+
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef DEVICE_SELECTION_HPP
+#define DEVICE_SELECTION_HPP
+
+#include <main.hpp>
+
+#include <functional>
+#include <string>
+
+
+//environment variable that forces a device: its index in enumeration order or part of its name(case insensitive)
+//  VULKAN_DEVICE=1 ./build/main
+//  VULKAN_DEVICE=llvmpipe ./build/bench
+#define DEVICE_OVERRIDE_ENV "VULKAN_DEVICE"
+
+
+//what a device must have, one missing any of it is never picked(not even through the override)
+struct DeviceRequirements{
+    uint32_t apiVersion = VK_API_VERSION_1_0;
+    std::vector<const char*> extensions;
+    //everything else the caller needs(queues, surface support, features), returns why the device is unusable or "" if it is fine
+    //only called on devices that passed the checks above
+    std::function<std::string(VkPhysicalDevice)> check;
+};
+
+//what makes one usable device better than another, a score is the sum of the weights that apply
+struct DevicePreferences{
+    int discrete = 1000;
+    int integrated = 200; //still beats virtual GPUs and software rasterizers
+    int virtualGpu = 50;
+    int perVramGiB = 50; //biggest device local heap, counted up to maxVramGiB(discrete and virtual GPUs only, the rest report system memory)
+    uint32_t maxVramGiB = 16;
+    int directWriteHeap = 300; //resizable BAR, see findDirectWriteHeap()
+    int dedicatedTransferQueue = 100; //a family with transfer but neither graphics nor compute(copy engine)
+    int dedicatedComputeQueue = 100; //a family with compute but no graphics(async compute)
+    int perApiMinorVersion = 25; //each minor version above the required one
+    std::vector<std::pair<const char*, int>> extensions; //optional extensions and what having each is worth
+};
+
+//one device as the scorer saw it
+struct DeviceRating{
+    VkPhysicalDevice device = VK_NULL_HANDLE;
+    uint32_t index = 0; //enumeration order
+    std::string name;
+    VkPhysicalDeviceType type = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+    bool suitable = false;
+    std::string rejection; //why not, when !suitable
+    int score = 0;
+    std::string breakdown; //"discrete 1000, vram 8 GiB 400, ..."
+};
+
+//every device of instance, in enumeration order
+std::vector<DeviceRating> rateDevices(VkInstance instance, const DeviceRequirements& requirements, const DevicePreferences& preferences);
+//the highest scoring suitable device, the first one enumerated wins ties
+//DEVICE_OVERRIDE_ENV picks one instead, throws when it matches nothing or an unsuitable device
+//and when no device is suitable at all, every rating is printed to log unless it is nullptr
+DeviceRating selectPhysicalDevice(VkInstance instance, const DeviceRequirements& requirements, const DevicePreferences& preferences, std::ostream* log = nullptr);
+bool deviceSupportsExtension(VkPhysicalDevice device, const char* extensionName);
+
+
+//one queue of the logical device
+struct DeviceQueue{
+    uint32_t family = UINT32_MAX; //UINT32_MAX = not created
+    uint32_t index = 0;
+    bool exists() const{
+        return family != UINT32_MAX;
+    }
+};
+
+//which queues to create and what each one is for
+struct DeviceQueuePlan{
+    DeviceQueue graphics;
+    DeviceQueue present; //the graphics queue itself when its family can present
+    DeviceQueue asyncCompute; //a second queue that can run compute next to graphics, may not exist
+    //family and one priority per queue created in it
+    std::vector<std::pair<uint32_t, std::vector<float>>> families;
+
+    //points into families, keep the plan alive until vkCreateDevice returned
+    std::vector<VkDeviceQueueCreateInfo> createInfos() const;
+};
+
+//graphics gets priority 1.0, async compute 0.5 so the frame's critical path wins when both have work
+//async compute prefers a family without graphics(its own engine), then a second queue of the graphics family
+//presentFamily is UINT32_MAX for headless devices, asyncCompute false creates graphics and present only
+DeviceQueuePlan planDeviceQueues(VkPhysicalDevice device, uint32_t graphicsFamily, uint32_t presentFamily = UINT32_MAX, bool asyncCompute = true);
+
+
+
+
+#endif
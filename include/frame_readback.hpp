@@ -0,0 +1,77 @@
+#ifndef FRAME_READBACK_HPP
+#define FRAME_READBACK_HPP
+
+#include <main.hpp>
+#include <job_system.hpp>
+#include <image_encode.hpp>
+
+#include <functional>
+#include <string>
+
+
+//called on a worker thread with the captured pixels(always RGBA8, BGRA sources are swizzled)
+using ReadbackCallback = std::function<void(RGBAImage&& image)>;
+
+struct FrameReadbackStats{
+    uint64_t captured = 0;
+    uint64_t dropped = 0; //every slot was still in flight
+    uint32_t slotsInFlight = 0;
+};
+
+
+//asynchronous image readback for screenshots, frame dumps and visual regression tests
+//capture() records a copy into one of a ring of host visible(cached when possible) buffers, collect()
+//picks finished copies up once the frame's fence signalled, hands them to a low priority job and frees
+//the slot, nothing ever waits on the GPU
+//  readback.capture(cmd, swapchainImage, swapchainFormat, extent, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, frameIndex, "frame.qoi");
+//  ...after vkWaitForFences for frameIndex...
+//  readback.collect(frameIndex);
+class FrameReadback{
+    public:
+    //slots = captures that can be in flight at once, framesInFlight is enough to dump every frame
+    FrameReadback(VkDevice device, VkPhysicalDevice physicalDevice, JobSystem& jobs, uint32_t slots, VkExtent2D maxExtent);
+    ~FrameReadback();
+    FrameReadback(const FrameReadback&) = delete;
+    FrameReadback& operator=(const FrameReadback&) = delete;
+
+    //copies image(8 bit RGBA or BGRA in layout, left in layout afterwards) into a free slot
+    //returns false and drops the capture when every slot is still in flight
+    bool capture(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, uint32_t frameIndex, ReadbackCallback callback);
+    //same but encodes and writes path(.png or .qoi)
+    bool capture(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, uint32_t frameIndex, const std::string& path);
+    //call once frameIndex's fence signalled, everything that frame captured moves on to the jobs
+    void collect(uint32_t frameIndex);
+    //blocks until every encode job finished, slots still on the GPU are untouched
+    void waitIdle();
+
+    FrameReadbackStats stats() const;
+
+    private:
+    struct Slot{
+        std::atomic<bool> busy{false}; //from capture() until the job copied the pixels out
+        bool pending = false; //recorded, waiting for collect()
+        uint32_t frameIndex = 0;
+        VkExtent2D extent = {0, 0};
+        bool swizzle = false; //BGRA source
+        ReadbackCallback callback;
+    };
+
+    VkDevice device;
+    JobSystem& jobs;
+    VkExtent2D maxExtent;
+    VkDeviceSize slotSize;
+    VkDeviceSize nonCoherentAtomSize = 1;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    const uint8_t* mapped = nullptr;
+    bool coherent = true;
+    std::vector<Slot> slots;
+    JobCounter encodeCounter;
+    uint64_t captured = 0;
+    uint64_t dropped = 0;
+};
+
+
+
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef GPU_MEMORY_HPP
+#define GPU_MEMORY_HPP
+
+#include <main.hpp>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+
+//index of a memory type allowed by typeBits that has every required flag
+//the type with the most of the preferred flags wins, the driver's order breaks ties, throws if nothing has the required ones
+uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+uint32_t findMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+
+//biggest heap behind a DEVICE_LOCAL | HOST_VISIBLE memory type, the CPU writes straight into VRAM through it
+//resizable BAR/Smart Access Memory exposes all of VRAM like this and integrated GPUs always do, discrete cards
+//without it only have the legacy 256 MB window that the driver and other apps share
+struct DirectWriteHeap{
+    uint32_t heapIndex = UINT32_MAX; //UINT32_MAX = no such heap
+    VkDeviceSize size = 0;
+    bool large = false; //bigger than the legacy window, per frame data can skip the staging copy
+};
+DirectWriteHeap findDirectWriteHeap(VkPhysicalDevice physicalDevice);
+
+//per heap budget and current usage of this process from VK_EXT_memory_budget(the device extension has to be enabled)
+//falls back to the heap sizes and zero usage when the extension or vkGetPhysicalDeviceMemoryProperties2 is missing
+struct MemoryHeapBudget{
+    VkDeviceSize budget = 0;
+    VkDeviceSize usage = 0;
+    bool deviceLocal = false;
+};
+std::vector<MemoryHeapBudget> queryMemoryBudget(VkInstance instance, VkPhysicalDevice physicalDevice);
+//whether physicalDevice has VK_EXT_memory_budget to enable
+bool memoryBudgetSupported(VkPhysicalDevice physicalDevice);
+//what is left of the biggest device local heap
+VkDeviceSize availableDeviceLocalMemory(VkInstance instance, VkPhysicalDevice physicalDevice);
+
+
+//what an allocation is for, the tracker keeps a total per category and heap
+enum class MemoryCategory{
+    Texture,
+    Mesh, //vertex, index and instance data
+    RenderTarget, //attachments and render graph transients
+    Staging,
+    Uniform,
+    Readback,
+    Other,
+    Count
+};
+const char* memoryCategoryName(MemoryCategory category);
+
+//one heap as the tracker saw it at the last update()
+struct MemoryHeapStatus{
+    VkDeviceSize size = 0;
+    VkDeviceSize budget = 0; //from VK_EXT_memory_budget, the heap size without it
+    VkDeviceSize usage = 0; //whole process according to the driver, the tracked bytes without VK_EXT_memory_budget
+    VkDeviceSize tracked = 0; //what went through allocateMemory()
+    VkDeviceSize peakTracked = 0;
+    VkDeviceSize categories[static_cast<size_t>(MemoryCategory::Count)] = {};
+    uint32_t allocations = 0;
+    bool deviceLocal = false;
+};
+
+//heap crossed fraction of its budget, above = on the way up, false once it dropped back below
+using MemoryWatermarkCallback = std::function<void(uint32_t heap, const MemoryHeapStatus& status, bool above)>;
+
+
+//per heap and per category view of device memory with budget watermarks
+//allocateMemory()/freeMemory() report every allocation to the tracker set with setMemoryTracker(),
+//update() polls VK_EXT_memory_budget(enable it on the device, numbers fall back to the tracked bytes otherwise)
+//once per frame and fires the watermark callbacks, e.g. to let the texture streamer evict:
+//  tracker.addWatermark(0.9f, [&](uint32_t heap, const MemoryHeapStatus& status, bool above){
+//      streamer.setBudget(above ? streamer.stats().residentBytes * 3 / 4 : defaultBudget);
+//  });
+//allocated()/freed() are thread safe, callbacks run on the thread calling update() without the lock held
+class MemoryBudgetTracker{
+    public:
+    MemoryBudgetTracker(VkInstance instance, VkPhysicalDevice physicalDevice);
+    MemoryBudgetTracker(const MemoryBudgetTracker&) = delete;
+    MemoryBudgetTracker& operator=(const MemoryBudgetTracker&) = delete;
+
+    void allocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category);
+    void freed(VkDeviceMemory memory);
+    //refreshes budgets and usage, then fires watermarks that were crossed since the last call
+    void update();
+    //fraction of budget, callbacks fire on crossings only(with a little hysteresis), not every frame
+    void addWatermark(float fraction, MemoryWatermarkCallback callback, bool deviceLocalOnly = true);
+
+    std::vector<MemoryHeapStatus> heaps() const;
+    //a line per heap plus one per non empty category, for the profiler overlay or the console
+    std::string overlayText() const;
+
+    private:
+    struct Allocation{
+        uint32_t heap;
+        VkDeviceSize size;
+        MemoryCategory category;
+    };
+    struct Watermark{
+        float fraction;
+        MemoryWatermarkCallback callback;
+        bool deviceLocalOnly;
+        std::vector<bool> above; //per heap
+    };
+
+    PFN_vkGetPhysicalDeviceMemoryProperties2 getProperties2 = nullptr;
+    VkPhysicalDevice physicalDevice;
+    bool hasBudget = false;
+    std::vector<uint32_t> typeHeap; //memory type index -> heap index
+    mutable std::mutex mutex;
+    std::vector<MemoryHeapStatus> status;
+    std::unordered_map<VkDeviceMemory, Allocation> allocations;
+    std::vector<Watermark> watermarks;
+};
+
+//every module allocates through these so the tracker sees every byte, nullptr stops tracking
+void setMemoryTracker(MemoryBudgetTracker* tracker);
+MemoryBudgetTracker* memoryTracker();
+//vkAllocateMemory/vkFreeMemory plus bookkeeping
+VkResult allocateMemory(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryCategory category, VkDeviceMemory* memory);
+void freeMemory(VkDevice device, VkDeviceMemory memory);
+
+//written byte range of a mapped allocation
+struct MappedRange{
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+};
+//the ranges flushMappedRanges() hands to Vulkan, sorted by offset
+//every range is widened to nonCoherentAtomSize(clamped to allocationSize, the end of the allocation is always valid)
+//then ranges that overlap or touch after widening are merged, empty ranges are skipped
+std::vector<MappedRange> mergeMappedRanges(std::vector<MappedRange> ranges, VkDeviceSize nonCoherentAtomSize, VkDeviceSize allocationSize);
+//makes writes to non coherent memory visible with as few ranges as possible in one vkFlushMappedMemoryRanges call
+void flushMappedRanges(VkDevice device, VkDeviceMemory memory, std::vector<MappedRange> ranges, VkDeviceSize nonCoherentAtomSize, VkDeviceSize allocationSize);
+
+
+//one sub-allocation handed out by the ring
+struct RingAllocation{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0; //from the start of buffer
+    uint32_t dynamicOffset = 0; //same thing, ready for vkCmdBindDescriptorSets
+    void* data = nullptr; //mapped pointer to write the contents through
+};
+
+
+//per frame linear allocator over one persistently mapped host visible buffer
+//in device local memory when findDirectWriteHeap() found a large heap, the GPU reads VRAM instead of going over PCIe
+//the buffer holds one region per frame in flight, beginFrame() rewinds that frame's region
+//so it must only be called once the GPU is done with the frame(after its fence)
+//per draw uniforms go through allocate() and a dynamic offset, tiny per draw data should
+//stay in push constants(MeshPushConstants)
+//allocate() is lock free and can be called from every recording thread
+class UniformRing{
+    public:
+    UniformRing(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize bytesPerFrame, uint32_t framesInFlight,
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    ~UniformRing();
+    UniformRing(const UniformRing&) = delete;
+    UniformRing& operator=(const UniformRing&) = delete;
+
+    void beginFrame(uint32_t frameIndex);
+    //size bytes aligned for use as a dynamic uniform/storage buffer, throws when the frame is full
+    RingAllocation allocate(VkDeviceSize size);
+    template<typename T>
+    RingAllocation push(const T& value){
+        RingAllocation allocation = allocate(sizeof(T));
+        std::memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+    //makes this frame's writes visible to the GPU, only does anything on non coherent memory
+    void flush();
+
+    VkBuffer handle() const{
+        return buffer;
+    }
+    //descriptor for a dynamic uniform buffer, range = biggest struct read through it
+    VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const{
+        return {buffer, 0, range};
+    }
+    VkDeviceSize frameSize() const{
+        return bytesPerFrame;
+    }
+    //most bytes any frame used so far
+    VkDeviceSize peakUsage() const{
+        return peak;
+    }
+    //the ring lives in device local memory the CPU writes directly
+    bool directWrite() const{
+        return deviceLocal;
+    }
+
+    private:
+    VkDevice device;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    uint8_t* mapped = nullptr;
+    VkDeviceSize allocationSize = 0;
+    bool coherent = true;
+    bool deviceLocal = false;
+    VkDeviceSize alignment = 256;
+    VkDeviceSize nonCoherentAtomSize = 1;
+    VkDeviceSize bytesPerFrame;
+    uint32_t framesInFlight;
+    uint32_t frame = 0;
+    std::atomic<VkDeviceSize> head{0}; //offset inside the current frame's region
+    VkDeviceSize peak = 0;
+};
+
+
+
+
+#endif
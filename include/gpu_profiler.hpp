@@ -0,0 +1,170 @@
+#ifndef GPU_PROFILER_HPP
+#define GPU_PROFILER_HPP
+
+#include <main.hpp>
+#include <cpu_trace.hpp>
+
+#include <string>
+
+
+class MemoryBudgetTracker;
+
+//pipeline statistics a zone can ask for, in the order vulkan returns them
+enum GpuStatistic{
+    GPU_STAT_INPUT_VERTICES,
+    GPU_STAT_VERTEX_INVOCATIONS,
+    GPU_STAT_CLIPPING_PRIMITIVES,
+    GPU_STAT_FRAGMENT_INVOCATIONS,
+    GPU_STAT_COMPUTE_INVOCATIONS,
+    GPU_STAT_COUNT
+};
+
+//one zone of a finished frame
+struct GpuZoneResult{
+    std::string name;
+    uint32_t parent = UINT32_MAX; //index into the same frame's zones, UINT32_MAX for top level zones
+    uint32_t depth = 0;
+    double startMs = 0.0; //since the frame's first timestamp
+    double durationMs = 0.0;
+    bool hasStatistics = false;
+    uint64_t statistics[GPU_STAT_COUNT] = {};
+};
+
+//numbers of one zone path across frames, node 0 is the whole frame
+struct GpuProfileNode{
+    std::string name;
+    uint32_t depth = 0;
+    double averageMs = 0.0; //exponential moving average
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    uint64_t samples = 0;
+    bool hasStatistics = false;
+    uint64_t statistics[GPU_STAT_COUNT] = {}; //last frame's
+    std::vector<uint32_t> children; //indices into tree(), first seen first
+};
+
+
+//GPU timing zones from timestamp query pairs(vkCmdWriteTimestamp2 when synchronization2 is there)
+//plus optional pipeline statistics queries, one query range per frame in flight
+//results are read back when a slot comes around again, so nothing ever waits on the GPU
+//  profiler.beginFrame(cmd, frameIndex); //after the frame's fence, before anything is profiled
+//  profiler.beginZone(cmd, "shadows"); ... profiler.endZone(cmd);
+//or GpuZone zone(profiler, cmd, "shadows"); for a scope, RenderGraph::setProfiler() wraps every pass
+//zones nest, statistics queries don't(inner zones asking for them get none) and have to begin and end
+//in the same subpass, a queue without timestamp support turns everything into no-ops
+class GpuProfiler{
+    public:
+    //pipelineStatistics needs the pipelineStatisticsQuery device feature enabled
+    GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t framesInFlight, uint32_t maxZones = 128, bool pipelineStatistics = false);
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    //collects what frameIndex's slot still holds, then resets its queries in cmd
+    //must be recorded before any zone of the frame and outside a render pass
+    void beginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+    void beginZone(VkCommandBuffer cmd, const std::string& name, bool statistics = false);
+    void endZone(VkCommandBuffer cmd);
+    //reads back frameIndex's slot(once its fence signalled) and returns its zones
+    //empty if there was nothing new or the results aren't available yet, beginFrame() calls this itself
+    const std::vector<GpuZoneResult>& collect(uint32_t frameIndex);
+
+    bool enabled() const{
+        return timestampPool != VK_NULL_HANDLE;
+    }
+    //zones of the most recently collected frame
+    const std::vector<GpuZoneResult>& lastFrame() const{
+        return latest;
+    }
+    const std::vector<GpuProfileNode>& tree() const{
+        return nodes;
+    }
+    //the tree as indented lines "name last ms(avg, max)", for a text overlay, the console or a window title
+    //followed by the memory tracker's heaps when there is one
+    std::string overlayText() const;
+    //nullptr to leave memory out of the overlay
+    void setMemoryTracker(const MemoryBudgetTracker* tracker){
+        memoryTracker = tracker;
+    }
+    //zones over the budget were dropped
+    uint64_t droppedZones() const{
+        return dropped;
+    }
+
+    //keep every zone of the next frames collected, for traceEvents()/writeChromeTrace()
+    //GPU ticks are put on the CPU trace clock with VK_KHR/EXT_calibrated_timestamps when the device has it
+    //enabled, otherwise each capture is lined up with the CPU time its first frame was recorded at
+    //(GPU zones then show up early by the submit latency)
+    void startCapture(uint32_t frames);
+    //captured zones on the steady_clock microseconds cpuTraceWrite() uses
+    const std::vector<TraceEvent>& traceEvents() const{
+        return trace;
+    }
+    //captured zones alone as Chrome trace events(chrome://tracing, ui.perfetto.dev), throws on failure
+    void writeChromeTrace(const std::string& path) const;
+
+    private:
+    struct Zone{
+        std::string name;
+        uint32_t parent;
+        uint32_t depth;
+        uint32_t statisticsQuery; //UINT32_MAX = none
+    };
+    struct Slot{
+        std::vector<Zone> zones;
+        bool pending = false; //recorded, not collected yet
+        double recordUs = 0.0; //trace clock at beginFrame()
+    };
+
+    VkDevice device;
+    PFN_vkCmdWriteTimestamp2 cmdWriteTimestamp2 = nullptr;
+    PFN_vkGetCalibratedTimestampsKHR getCalibratedTimestamps = nullptr;
+    VkQueryPool timestampPool = VK_NULL_HANDLE;
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    double nanosecondsPerTick = 1.0;
+    uint64_t timestampMask = ~0ull;
+    uint32_t maxZones;
+    std::vector<Slot> slots;
+    uint32_t current = UINT32_MAX; //slot being recorded
+    std::vector<uint32_t> open; //zone stack, UINT32_MAX entries were dropped
+    uint32_t openStatistics = UINT32_MAX; //zone with an active statistics query
+    uint64_t dropped = 0;
+    const MemoryBudgetTracker* memoryTracker = nullptr;
+
+    std::vector<GpuZoneResult> collected;
+    std::vector<GpuZoneResult> latest;
+    std::vector<GpuProfileNode> nodes;
+
+    uint32_t captureFrames = 0;
+    bool captureStarted = false;
+    uint64_t captureBase = 0; //ticks
+    double captureBaseUs = 0.0; //captureBase on the trace clock
+    std::vector<TraceEvent> trace;
+
+    void writeTimestamp(VkCommandBuffer cmd, bool end, uint32_t query);
+    void accumulate(const std::vector<GpuZoneResult>& zones);
+    bool calibrate();
+    double traceUs(uint64_t tick) const;
+};
+
+//profiles a scope
+class GpuZone{
+    public:
+    GpuZone(GpuProfiler& profiler, VkCommandBuffer cmd, const std::string& name, bool statistics = false) : profiler(profiler), cmd(cmd){
+        profiler.beginZone(cmd, name, statistics);
+    }
+    ~GpuZone(){
+        profiler.endZone(cmd);
+    }
+    GpuZone(const GpuZone&) = delete;
+    GpuZone& operator=(const GpuZone&) = delete;
+
+    private:
+    GpuProfiler& profiler;
+    VkCommandBuffer cmd;
+};
+
+
+
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef IMAGE_ENCODE_HPP
+#define IMAGE_ENCODE_HPP
+
+#include <main.hpp>
+
+#include <string>
+
+
+//RGBA8 image in memory, rows top to bottom, no padding
+struct RGBAImage{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+//QOI(qoiformat.org), fast lossless and usually within 20% of PNG, the default for frame dumps
+std::vector<uint8_t> encodeQOI(const RGBAImage& image);
+//throws on malformed data, golden images for visual regression tests are stored as QOI
+RGBAImage decodeQOI(const std::vector<uint8_t>& data);
+//PNG with stored(uncompressed) deflate blocks, opens everywhere but is as big as the raw pixels
+std::vector<uint8_t> encodePNG(const RGBAImage& image);
+
+//picks the encoder from the extension(.png or .qoi) and writes the file, throws on failure
+void writeImage(const std::string& path, const RGBAImage& image);
+
+
+
+
+#endif
@@ -0,0 +1,186 @@
+#ifndef JOB_SYSTEM_HPP
+#define JOB_SYSTEM_HPP
+
+#include <main.hpp>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <chrono>
+
+
+//Chase-Lev work stealing deque of pointers
+//only the owning worker may push/pop(bottom end), any thread may steal(top end)
+template<typename T>
+class WorkStealingDeque{
+    public:
+    static constexpr int64_t CAPACITY = 4096; //power of 2
+
+    //returns false if the deque is full
+    bool push(T item){
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if(b - t >= CAPACITY){
+            return false;
+        }
+        buffer[b & MASK].store(item, std::memory_order_relaxed);
+        //publishes the item to thieves, they acquire bottom before reading the slot
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+    //newest item, nullptr if empty(or a thief won the race for the last one)
+    T pop(){
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        if(t > b){
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        T item = buffer[b & MASK].load(std::memory_order_relaxed);
+        if(t == b){
+            //last item, race against thieves for it
+            if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return item;
+    }
+    //oldest item, nullptr if empty or lost a race
+    T steal(){
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if(t >= b){
+            return nullptr;
+        }
+        T item = buffer[t & MASK].load(std::memory_order_relaxed);
+        if(!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)){
+            return nullptr;
+        }
+        return item;
+    }
+
+    private:
+    static constexpr int64_t MASK = CAPACITY - 1;
+    //top and bottom on separate cache lines, thieves hammer top while the owner hammers bottom
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<T> buffer[CAPACITY];
+};
+
+
+class JobSystem;
+struct Job;
+
+//dependency counter, incremented for every job scheduled against it and decremented when the job finishes
+//jobs scheduled with runAfter() start once it reaches zero
+class JobCounter{
+    public:
+    bool done() const{
+        return value.load(std::memory_order_acquire) == 0;
+    }
+
+    private:
+    friend class JobSystem;
+    std::atomic<uint32_t> value{0};
+    std::mutex mutex; //guards continuations
+    std::vector<Job*> continuations;
+};
+
+//lower priority work(streaming, decode) only runs when no frame work is available
+enum class JobPriority{
+    High,
+    Low
+};
+
+//one unit of work
+struct Job{
+    const char* name;
+    std::function<void()> function;
+    JobCounter* counter; //decremented when done, may be nullptr
+    JobPriority priority;
+};
+
+//how long one job took, times are nanoseconds since the job system started
+struct JobTiming{
+    const char* name;
+    uint32_t worker;
+    JobPriority priority;
+    uint64_t startNs;
+    uint64_t endNs;
+};
+
+
+//work stealing scheduler, worker 0 is the thread that constructed it(the frame thread)
+//it only runs jobs while it waits on a counter, and only high priority ones
+class JobSystem{
+    public:
+    //workerCount 0 = one worker per physical core(including the calling thread), never less than 2
+    explicit JobSystem(uint32_t workerCount = 0, bool pinToCores = true);
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    //schedule a job, counter is incremented now and decremented when the job finishes
+    void run(const char* name, std::function<void()> function, JobCounter* counter = nullptr, JobPriority priority = JobPriority::High);
+    //schedule a job to start once dependency reaches zero(a continuation)
+    void runAfter(JobCounter& dependency, const char* name, std::function<void()> function, JobCounter* counter = nullptr, JobPriority priority = JobPriority::High);
+    //run other high priority jobs until counter reaches zero
+    //low priority jobs(encodes, texture loads, pipeline relinks) are left to the background workers so a wait on the frame thread can't stall behind one
+    void wait(JobCounter& counter);
+    //split [begin, end) into chunks of at least grain items and wait for all of them
+    void parallelFor(const char* name, uint32_t begin, uint32_t end, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body);
+
+    //number of workers including the constructing thread
+    uint32_t workerCount() const{
+        return static_cast<uint32_t>(workers.size());
+    }
+    //timings recorded since the last call, per job
+    std::vector<JobTiming> collectTimings();
+    //turn timing collection on/off, off by default
+    void setTimingEnabled(bool enabled){
+        timingEnabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    private:
+    struct alignas(64) Worker{
+        WorkStealingDeque<Job*> queues[2]; //indexed by JobPriority
+        std::thread thread;
+        std::mutex timingMutex; //only contended while collectTimings() runs
+        std::vector<JobTiming> timings;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    //jobs pushed from threads that aren't workers(or overflowed a full deque)
+    std::mutex injectedMutex;
+    std::deque<Job*> injected[2];
+    //number of queued jobs, workers sleep on it when it is 0
+    std::atomic<uint32_t> pendingJobs{0};
+    std::atomic<bool> running{true};
+    std::atomic<bool> timingEnabled{false};
+    std::chrono::steady_clock::time_point startTime;
+
+    void workerLoop(uint32_t index);
+    void push(Job* job);
+    //find a job for this worker: own deque, steal, injected queue, high priority before low
+    //lowest is the lowest priority it may return
+    Job* findJob(uint32_t index, JobPriority lowest = JobPriority::Low);
+    void execute(Job* job, uint32_t index);
+    uint32_t currentWorkerIndex() const;
+};
+
+//one logical cpu id per physical core, hyperthread siblings skipped
+std::vector<uint32_t> physicalCoreCpus();
+//pin the calling thread to one logical cpu, returns false if the OS refused
+bool pinCurrentThread(uint32_t cpu);
+
+
+
+
+#endif
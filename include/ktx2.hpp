@@ -0,0 +1,39 @@
+#ifndef KTX2_HPP
+#define KTX2_HPP
+
+#include <main.hpp>
+#include <texture_compress.hpp>
+
+#include <string>
+
+
+//KTX2 supercompression schemes this reader/writer knows
+enum class Ktx2Supercompression : uint32_t{
+    None = 0,
+    Zstd = 2 //needs the build to define ENABLE_ZSTD(make ZSTD=1)
+};
+
+//a 2D texture as stored in a KTX2 file, no arrays, cube maps or 3D textures
+//mips[0] is the full resolution level, data is the raw block data Vulkan copies from
+struct Ktx2Texture{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    std::vector<TextureMip> mips;
+};
+
+//readKtx2 rejects anything wider or taller, every desktop GPU's maxImageDimension2D is at least this
+//and it caps how much an untrusted header can make the reader allocate
+static constexpr uint32_t KTX2_MAX_EXTENT = 16384;
+
+//whether this build can read and write zstd supercompressed files
+bool ktx2ZstdSupported();
+
+//throws if the file can't be written or the format has no data format descriptor
+//(uncompressed 8 bit RGBA, BC1/BC5/BC7 and ASTC LDR are supported)
+void writeKtx2(const std::string& path, const Ktx2Texture& texture, Ktx2Supercompression supercompression = Ktx2Supercompression::None);
+//throws on anything malformed or unsupported, the returned mips are already inflated
+Ktx2Texture readKtx2(const std::string& path);
+
+
+
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MIP_GENERATOR_HPP
+#define MIP_GENERATOR_HPP
+
+#include <main.hpp>
+#include <object_cache.hpp>
+#include <resource_state.hpp>
+
+#include <memory>
+
+
+//an image prepared for mip generation, views of every mip and the descriptor set pointing at them
+struct MipChain{
+    VkImage image = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    uint32_t mipLevels = 0;
+    VkImageView sourceView = VK_NULL_HANDLE; //mip 0 in the image's own format
+    std::vector<VkImageView> storageViews; //mips 1.., UNORM
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    uint32_t counterSlot = 0;
+};
+
+
+//generates full mip chains with src/shaders/downsample.comp, one dispatch per image instead of
+//one blit and one barrier per level
+//RGBA8 images only(UNORM or sRGB) up to 4096x4096, they need SAMPLED and STORAGE usage and
+//sRGB ones MUTABLE_FORMAT as well since storage writes go through a UNORM view
+//the shader picks the mip's storage image with a dynamic index, the device needs the
+//shaderStorageImageArrayDynamicIndexing feature enabled
+class MipGenerator{
+    public:
+    static constexpr uint32_t MAX_MIPS = 13;
+    static constexpr uint32_t MAX_EXTENT = 1u << (MAX_MIPS - 1);
+    static constexpr uint32_t TILE_SIZE = 64; //mip 0 texels per workgroup and axis
+
+    //downsampleShader = shaders/downsample.spv(SPIR-V 1.3, needs a Vulkan 1.1 device), maxChains = how many images can be prepared at once
+    //subgroupQuad = supportsSubgroupQuad()
+    MipGenerator(VkDevice device, VkPhysicalDevice physicalDevice, ObjectCache& cache, VkShaderModule downsampleShader, uint32_t maxChains, bool subgroupQuad);
+    ~MipGenerator();
+    MipGenerator(const MipGenerator&) = delete;
+    MipGenerator& operator=(const MipGenerator&) = delete;
+
+    //subgroup quad ops in compute shaders, the shader falls back to shared memory without them
+    static bool supportsSubgroupQuad(VkInstance instance, VkPhysicalDevice physicalDevice);
+
+    MipChain* createChain(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mipLevels);
+    void destroyChain(MipChain* chain);
+    //fills mips 1.. from mip 0, tracker moves mip 0 to a sampled read and the rest to storage writes
+    //transition the image for its next use through the same tracker afterwards
+    void generate(VkCommandBuffer cmd, MipChain& chain, ImageStateTracker& tracker);
+
+    private:
+    struct PushConstants{
+        int32_t width;
+        int32_t height;
+        uint32_t mipCount;
+        uint32_t groupCount;
+    };
+
+    VkDevice device;
+    ObjectCache& cache;
+    uint32_t maxChains;
+    PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2 = nullptr;
+    VkSampler sampler = VK_NULL_HANDLE;
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline linearPipeline = VK_NULL_HANDLE;
+    VkPipeline srgbPipeline = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    //one zeroed uint per chain, the shader resets it after every dispatch
+    VkBuffer counterBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory counterMemory = VK_NULL_HANDLE;
+    VkDeviceSize counterStride = 0;
+    std::vector<std::unique_ptr<MipChain>> chains;
+    std::vector<uint32_t> freeSlots;
+};
+
+
+
+
+#endif
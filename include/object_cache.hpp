@@ -0,0 +1,148 @@
+#ifndef OBJECT_CACHE_HPP
+#define OBJECT_CACHE_HPP
+
+#include <main.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+
+//canonical bytes of create infos, pointed to arrays and known pNext structs included
+//(unknown pNext structs throw, keying on their pointer would hand out stale objects)
+//shader modules, layouts and samplers inside are written as handles
+//two create infos have the same key exactly when every field the cache looks at matches,
+//so unlike a bare hash a key can never hand out another create info's object
+using CreateInfoKey = std::string;
+CreateInfoKey createInfoKey(const VkSamplerCreateInfo& info);
+CreateInfoKey createInfoKey(const VkDescriptorSetLayoutCreateInfo& info);
+CreateInfoKey createInfoKey(const VkPipelineLayoutCreateInfo& info);
+CreateInfoKey createInfoKey(const VkGraphicsPipelineCreateInfo& info);
+CreateInfoKey createInfoKey(const VkComputePipelineCreateInfo& info);
+//short id for logs
+inline uint64_t hashCreateInfoKey(const CreateInfoKey& key){
+    return std::hash<CreateInfoKey>{}(key);
+}
+
+//concurrent map from create info keys to objects, 8 buckets each behind its own shared lock
+//lookups only take a shared lock on one bucket, recording threads rarely contend
+template<typename Value>
+class CreateInfoMap{
+    public:
+    //true and value filled in if key is there
+    bool find(const CreateInfoKey& key, Value& value) const{
+        const Bucket& bucket = bucketOf(key);
+        std::shared_lock lock(bucket.mutex);
+        auto found = bucket.map.find(key);
+        if(found == bucket.map.end()){
+            return false;
+        }
+        value = found->second;
+        return true;
+    }
+    //false if key was already there, the existing value stays
+    bool insert(const CreateInfoKey& key, const Value& value){
+        Bucket& bucket = bucketOf(key);
+        std::unique_lock lock(bucket.mutex);
+        return bucket.map.emplace(key, value).second;
+    }
+    //true and value filled in if key was there and got removed
+    bool pop(const CreateInfoKey& key, Value& value){
+        Bucket& bucket = bucketOf(key);
+        std::unique_lock lock(bucket.mutex);
+        auto found = bucket.map.find(key);
+        if(found == bucket.map.end()){
+            return false;
+        }
+        value = found->second;
+        bucket.map.erase(found);
+        return true;
+    }
+    std::vector<Value> values() const{
+        std::vector<Value> result;
+        for(const Bucket& bucket : buckets){
+            std::shared_lock lock(bucket.mutex);
+            for(const auto& entry : bucket.map){
+                result.push_back(entry.second);
+            }
+        }
+        return result;
+    }
+    size_t size() const{
+        size_t result = 0;
+        for(const Bucket& bucket : buckets){
+            std::shared_lock lock(bucket.mutex);
+            result += bucket.map.size();
+        }
+        return result;
+    }
+
+    private:
+    struct Bucket{
+        mutable std::shared_mutex mutex;
+        std::unordered_map<CreateInfoKey, Value> map;
+    };
+    std::array<Bucket, 8> buckets;
+
+    Bucket& bucketOf(const CreateInfoKey& key){
+        return buckets[hashCreateInfoKey(key) % buckets.size()];
+    }
+    const Bucket& bucketOf(const CreateInfoKey& key) const{
+        return buckets[hashCreateInfoKey(key) % buckets.size()];
+    }
+};
+
+struct ObjectCacheStats{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t samplers = 0;
+    uint64_t descriptorSetLayouts = 0;
+    uint64_t pipelineLayouts = 0;
+    uint64_t pipelines = 0;
+};
+
+
+//deduplicating get-or-create caches for samplers, layouts and pipelines
+//safe to call from any number of recording threads, lookups only take a shared lock on one bucket
+//every object is owned by the cache and destroyed with it
+//shader modules referenced by cached pipelines must stay alive as long as the cache,
+//a recycled module handle would otherwise hit an old pipeline
+class ObjectCache{
+    public:
+    explicit ObjectCache(VkDevice device, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    ~ObjectCache();
+    ObjectCache(const ObjectCache&) = delete;
+    ObjectCache& operator=(const ObjectCache&) = delete;
+
+    VkSampler sampler(const VkSamplerCreateInfo& info);
+    VkDescriptorSetLayout descriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info);
+    VkPipelineLayout pipelineLayout(const VkPipelineLayoutCreateInfo& info);
+    VkPipeline graphicsPipeline(const VkGraphicsPipelineCreateInfo& info);
+    VkPipeline computePipeline(const VkComputePipelineCreateInfo& info);
+
+    //lookup without creating, VK_NULL_HANDLE if the pipeline isn't there(yet)
+    VkPipeline findPipeline(const CreateInfoKey& key) const;
+    //hand a pipeline created elsewhere(async compile) to the cache, returns whichever pipeline ended up cached
+    VkPipeline insertPipeline(const CreateInfoKey& key, VkPipeline pipeline);
+
+    ObjectCacheStats stats() const;
+    void printStats() const;
+
+    private:
+    VkDevice device;
+    VkPipelineCache pipelineCache;
+    CreateInfoMap<VkSampler> samplers;
+    CreateInfoMap<VkDescriptorSetLayout> descriptorSetLayouts;
+    CreateInfoMap<VkPipelineLayout> pipelineLayouts;
+    CreateInfoMap<VkPipeline> pipelines;
+    mutable std::atomic<uint64_t> hits{0};
+    mutable std::atomic<uint64_t> misses{0};
+};
+
+
+
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef PIPELINE_COMPILER_HPP
+#define PIPELINE_COMPILER_HPP
+
+#include <main.hpp>
+#include <object_cache.hpp>
+#include <job_system.hpp>
+
+#include <memory>
+
+
+//deep copy of a VkGraphicsPipelineCreateInfo so it can outlive the caller's stack(compile jobs run later)
+//only VkPipelineRenderingCreateInfo is kept from the pNext chain
+class GraphicsPipelineDesc{
+    public:
+    explicit GraphicsPipelineDesc(const VkGraphicsPipelineCreateInfo& info);
+    GraphicsPipelineDesc(const GraphicsPipelineDesc&) = delete;
+    GraphicsPipelineDesc& operator=(const GraphicsPipelineDesc&) = delete;
+
+    //points into this object, valid as long as it lives
+    const VkGraphicsPipelineCreateInfo& createInfo() const{
+        return info;
+    }
+
+    private:
+    VkGraphicsPipelineCreateInfo info{};
+    std::vector<VkPipelineShaderStageCreateInfo> stages;
+    std::vector<std::string> entryPoints;
+    std::vector<VkSpecializationInfo> specializations;
+    std::vector<std::vector<VkSpecializationMapEntry>> specializationEntries;
+    std::vector<std::vector<uint8_t>> specializationData;
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkPipelineTessellationStateCreateInfo tessellation{};
+    VkPipelineViewportStateCreateInfo viewport{};
+    std::vector<VkViewport> viewports;
+    std::vector<VkRect2D> scissors;
+    VkPipelineRasterizationStateCreateInfo rasterization{};
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    std::vector<VkSampleMask> sampleMask;
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+    VkPipelineDynamicStateCreateInfo dynamic{};
+    std::vector<VkDynamicState> dynamicStates;
+    VkPipelineRenderingCreateInfo rendering{};
+    std::vector<VkFormat> colorFormats;
+};
+
+struct PipelineCompilerStats{
+    uint64_t requests = 0;
+    uint64_t fallbacks = 0; //requests answered with the fallback(or nothing) because the pipeline wasn't ready
+    uint64_t compiled = 0; //full pipelines
+    uint64_t fastLinked = 0; //pipelines linked from libraries, later replaced by an optimized link
+    uint64_t compileNs = 0; //total time spent compiling full pipelines
+};
+
+
+//compiles graphics pipelines on the job system instead of the render thread
+//request() never blocks, the first time a pipeline is seen it schedules a compile and hands back the
+//fallback(an uber shader, or VK_NULL_HANDLE to skip the draw) until the pipeline is ready
+//with VK_EXT_graphics_pipeline_library the pipeline is split into vertex input, pre-rasterization,
+//fragment shader and fragment output libraries(shared between pipelines through the object cache),
+//fast linked right away and relinked with link time optimization at low priority
+class PipelineCompiler{
+    public:
+    //graphicsPipelineLibrary needs the extension and its feature enabled on device
+    PipelineCompiler(VkDevice device, ObjectCache& cache, JobSystem& jobs, bool graphicsPipelineLibrary = false);
+    ~PipelineCompiler();
+    PipelineCompiler(const PipelineCompiler&) = delete;
+    PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+    //best pipeline available right now for info
+    VkPipeline request(const VkGraphicsPipelineCreateInfo& info, VkPipeline fallback = VK_NULL_HANDLE);
+    //wait for every scheduled compile(loading screens, shutdown)
+    void waitIdle();
+
+    PipelineCompilerStats stats() const;
+    void printStats() const;
+
+    private:
+    VkDevice device;
+    ObjectCache& cache;
+    JobSystem& jobs;
+    bool useLibraries;
+    JobCounter inFlight;
+    //create infos that already have a compile scheduled
+    CreateInfoMap<bool> scheduled;
+    //fast linked pipelines, used until the optimized one lands in the cache
+    CreateInfoMap<VkPipeline> fastLinked;
+    std::mutex retiredMutex;
+    std::vector<VkPipeline> retired; //fast linked pipelines that were superseded, freed with the compiler
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> fallbacks{0};
+    std::atomic<uint64_t> compiled{0};
+    std::atomic<uint64_t> linked{0};
+    std::atomic<uint64_t> compileNs{0};
+
+    void compile(const CreateInfoKey& key, const GraphicsPipelineDesc& desc);
+    void compileWithLibraries(const CreateInfoKey& key, std::shared_ptr<GraphicsPipelineDesc> desc);
+    VkPipeline link(const VkGraphicsPipelineCreateInfo& info, const VkPipeline* libraries, bool optimize);
+};
+
+//true if the device exposes VK_EXT_graphics_pipeline_library
+bool supportsGraphicsPipelineLibrary(VkPhysicalDevice physicalDevice);
+
+
+
+
+#endif
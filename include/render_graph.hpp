@@ -0,0 +1,290 @@
+#ifndef RENDER_GRAPH_HPP
+#define RENDER_GRAPH_HPP
+
+#include <main.hpp>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+
+//how a pass touches a resource, decides pipeline stage, access mask and image layout
+enum class ResourceUsage{
+    ColorAttachment, //write
+    DepthAttachment, //write
+    DepthRead, //read only depth test
+    SampledFragment, //read
+    SampledCompute, //read
+    StorageReadCompute, //read
+    StorageWriteCompute, //write
+    TransferSrc, //read
+    TransferDst, //write
+    VertexBuffer, //read
+    IndexBuffer, //read
+    IndirectBuffer, //read
+    UniformBuffer, //read
+    Present //read, only valid as the final use of an imported swapchain image
+};
+
+//synchronization scope of one usage
+struct ResourceAccess{
+    VkPipelineStageFlags2 stage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 access = VK_ACCESS_2_NONE;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bool write = false;
+};
+ResourceAccess resourceAccess(ResourceUsage usage);
+
+struct RenderGraphImageDesc{
+    VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+    VkExtent3D extent = {1, 1, 1};
+    uint32_t mipLevels = 1;
+    uint32_t arrayLayers = 1;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+};
+struct RenderGraphBufferDesc{
+    VkDeviceSize size = 0;
+};
+
+//handle to a graph resource
+using RenderGraphResource = uint32_t;
+
+class RenderGraph;
+class GpuProfiler;
+//what a pass records, gets the command buffer and the graph to look up physical resources
+using RenderGraphExecute = std::function<void(VkCommandBuffer, const RenderGraph&)>;
+
+//one node of the graph, filled in with the builder methods returned by addPass()
+class RenderGraphPass{
+    public:
+    RenderGraphPass& read(RenderGraphResource resource, ResourceUsage usage);
+    RenderGraphPass& write(RenderGraphResource resource, ResourceUsage usage);
+    //keep the pass even if nothing reads what it writes(readbacks, queries, ...)
+    RenderGraphPass& sideEffects(){
+        hasSideEffects = true;
+        return *this;
+    }
+    //run on the async compute queue(culling, post processing, particles) next to the graphics passes around it
+    //compute and transfer usages only, runs on graphics like any other pass when the graph has no async queue
+    RenderGraphPass& asyncCompute(){
+        onAsyncCompute = true;
+        return *this;
+    }
+
+    private:
+    friend class RenderGraph;
+    struct Use{
+        RenderGraphResource resource;
+        ResourceUsage usage;
+    };
+    std::string name;
+    RenderGraphExecute execute;
+    std::vector<Use> uses;
+    bool hasSideEffects = false;
+    bool onAsyncCompute = false;
+    bool culled = false;
+};
+
+//numbers from the last compile()
+struct RenderGraphStats{
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barrierBatches = 0; //vkCmdPipelineBarrier2 calls per execute()
+    uint32_t imageBarriers = 0;
+    uint32_t memoryBarriers = 0;
+    VkDeviceSize transientBytes = 0; //sum of all transient resources as if each had its own memory
+    VkDeviceSize allocatedBytes = 0; //what was actually allocated after aliasing
+    uint32_t submissions = 0; //batches per submit(), 1 when everything runs on graphics
+    uint32_t asyncSubmissions = 0; //of those on the async compute queue
+    uint32_t queueWaits = 0; //timeline waits between the two queues
+};
+
+//queues submit() uses, set with RenderGraph::setQueues()
+struct RenderGraphQueues{
+    VkQueue graphics = VK_NULL_HANDLE;
+    uint32_t graphicsFamily = 0;
+    //VK_NULL_HANDLE or graphics itself runs asyncCompute() passes on graphics
+    VkQueue compute = VK_NULL_HANDLE;
+    uint32_t computeFamily = 0;
+    uint32_t framesInFlight = 2;
+};
+
+//what the frame around the graph waits on and signals, all of it on the graphics queue
+struct RenderGraphFrameSync{
+    std::vector<VkSemaphoreSubmitInfo> waits; //before the first pass(swapchain image acquired)
+    std::vector<VkSemaphoreSubmitInfo> signals; //after the final transitions(ready to present)
+    VkFence fence = VK_NULL_HANDLE; //signals once both queues are done with the frame
+};
+
+
+//declarative frame graph
+//passes declare what they read and write, compile() culls unused passes, works out the barriers
+//(batched into one vkCmdPipelineBarrier2 per pass) and places transient resources with
+//non overlapping lifetimes in the same memory
+//needs a device with synchronization2(Vulkan 1.3 or VK_KHR_synchronization2)
+//with an async compute queue set, asyncCompute() passes go to it and overlap with the graphics passes
+//around them, the queues only wait on each other(timeline semaphores) where a resource crosses over
+class RenderGraph{
+    public:
+    //device may be VK_NULL_HANDLE to compile without allocating anything(sizes are estimated)
+    RenderGraph(VkDevice device = VK_NULL_HANDLE, VkPhysicalDevice physicalDevice = VK_NULL_HANDLE);
+    ~RenderGraph();
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    //transient resources, created and aliased by the graph, contents undefined at first use
+    RenderGraphResource createImage(const std::string& name, const RenderGraphImageDesc& desc);
+    RenderGraphResource createBuffer(const std::string& name, const RenderGraphBufferDesc& desc);
+    //resources owned by someone else(swapchain images, persistent buffers)
+    //initial is how the previous user left it, the graph transitions it to finalUsage at the end
+    RenderGraphResource importImage(const std::string& name, VkImage image, VkImageView view, const RenderGraphImageDesc& desc, ResourceAccess initial, ResourceUsage finalUsage);
+    RenderGraphResource importBuffer(const std::string& name, VkBuffer buffer, const RenderGraphBufferDesc& desc, ResourceAccess initial);
+
+    //passes run in the order they are added
+    //the returned pass stays put while more passes are added, it is valid until reset()
+    RenderGraphPass& addPass(const std::string& name, RenderGraphExecute execute);
+
+    //cull, compute lifetimes, alias memory and build barrier batches
+    void compile();
+    //record every pass into cmd, for a single queue
+    //async compute passes run in order with the rest, where they would have waited on the other queue
+    //a full memory barrier stands in for the semaphore
+    void execute(VkCommandBuffer cmd) const;
+
+    //creates command pools per frame and queue and one timeline semaphore per queue for submit()
+    //call before compile(), needs the timelineSemaphore feature(core in 1.2, VK_KHR_timeline_semaphore before)
+    //resources used on both queues must be VK_SHARING_MODE_CONCURRENT when the families differ,
+    //the graph creates its transient ones that way, imported ones are the caller's business
+    void setQueues(const RenderGraphQueues& graphQueues);
+    //true when asyncCompute() passes really get their own queue
+    bool hasAsyncCompute() const{
+        return queues.compute != VK_NULL_HANDLE && queues.compute != queues.graphics;
+    }
+    //records and submits the whole graph, consecutive passes on one queue share a batch
+    //resets frameIndex's command pools, the fence frameIndex last passed in must have signalled
+    //with a profiler set it calls beginFrame(frameIndex) itself and only times graphics passes
+    void submit(uint32_t frameIndex, const RenderGraphFrameSync& sync);
+    //destroy transient resources and forget all passes so the graph can be rebuilt
+    void reset();
+
+    //physical resources, valid after compile()
+    VkImage image(RenderGraphResource resource) const;
+    VkImageView imageView(RenderGraphResource resource) const;
+    VkBuffer buffer(RenderGraphResource resource) const;
+    const RenderGraphImageDesc& imageDesc(RenderGraphResource resource) const;
+
+    const RenderGraphStats& stats() const{
+        return statistics;
+    }
+    void printStats() const;
+    //wrap every pass execute() records in a GPU profiler zone named after it, nullptr turns it off
+    void setProfiler(GpuProfiler* gpuProfiler){
+        profiler = gpuProfiler;
+    }
+
+    private:
+    //tests/render_graph_test.cpp looks at the barriers and submissions compile() built
+    friend struct RenderGraphTest;
+    struct Resource{
+        std::string name;
+        bool isImage = true;
+        bool imported = false;
+        RenderGraphImageDesc imageDesc;
+        RenderGraphBufferDesc bufferDesc;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        ResourceAccess initial; //state before the first pass
+        bool hasFinalUsage = false;
+        ResourceUsage finalUsage = ResourceUsage::Present;
+        //filled by compile()
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        uint32_t queueMask = 0; //bit per queue that uses it
+        VkMemoryRequirements requirements{};
+        uint32_t memoryBlock = UINT32_MAX;
+        VkDeviceSize memoryOffset = 0;
+        //resources that used the same memory before us, we must wait for their last use
+        std::vector<RenderGraphResource> aliasPredecessors;
+    };
+    //one memory allocation shared by aliased resources
+    struct MemoryBlock{
+        uint32_t memoryTypeBits = 0;
+        VkDeviceSize size = 0;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+    //barriers recorded right before a pass
+    struct BarrierBatch{
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        VkMemoryBarrier2 memoryBarrier{};
+        bool hasMemoryBarrier = false;
+        bool empty() const{
+            return imageBarriers.empty() && !hasMemoryBarrier;
+        }
+    };
+    static constexpr uint32_t GRAPHICS_QUEUE = 0;
+    static constexpr uint32_t COMPUTE_QUEUE = 1;
+    static constexpr uint32_t QUEUE_COUNT = 2;
+    //consecutive passes on one queue, submitted as one batch that signals the queue's timeline
+    //the first and the last submission are always on graphics, they carry the frame's waits and signals
+    struct Submission{
+        uint32_t queue = GRAPHICS_QUEUE;
+        uint32_t ordinal = 0; //1 based among this frame's submissions to the same queue
+        std::vector<uint32_t> passes;
+        //per queue: ordinal of its submission that has to finish first(0 = none) and the stages that wait for it
+        uint32_t waitOrdinal[QUEUE_COUNT] = {};
+        VkPipelineStageFlags2 waitStage[QUEUE_COUNT] = {};
+        bool waitsOnOtherQueue() const{
+            return waitOrdinal[GRAPHICS_QUEUE] != 0 || waitOrdinal[COMPUTE_QUEUE] != 0;
+        }
+    };
+    //command buffers of one frame for one queue
+    struct FrameCommands{
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+    };
+    //running state of a resource on one queue while barriers are being built
+    struct TrackedState{
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags2 writeStage = VK_PIPELINE_STAGE_2_NONE;
+        VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+        VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; //readers since the last write
+        VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+    };
+
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2 = nullptr;
+    PFN_vkQueueSubmit2 queueSubmit2 = nullptr;
+    std::vector<Resource> resources;
+    std::deque<RenderGraphPass> passes; //deque so addPass() references survive later addPass() calls
+    std::vector<MemoryBlock> memoryBlocks;
+    std::vector<BarrierBatch> passBarriers; //one per pass
+    BarrierBatch finalBarriers; //transitions imported images to their final usage, end of the last submission
+    std::vector<Submission> submissions;
+    RenderGraphQueues queues;
+    std::vector<FrameCommands> frameCommands; //framesInFlight * QUEUE_COUNT
+    VkSemaphore timelines[QUEUE_COUNT] = {};
+    uint64_t timelineValues[QUEUE_COUNT] = {}; //last value signalled on each queue
+    RenderGraphStats statistics;
+    GpuProfiler* profiler = nullptr;
+
+    void cullPasses();
+    void buildSubmissions();
+    void computeLifetimes();
+    void createTransientResources();
+    void aliasMemory();
+    void buildBarriers();
+    void destroyTransientResources();
+    //adds the barrier needed to go from state to usage, updates state
+    //semaphoreStage is where a wait on the other queue blocked, layout transitions have to chain off it
+    void addTransition(BarrierBatch& batch, RenderGraphResource resource, TrackedState& state, const ResourceAccess& next, VkPipelineStageFlags2 semaphoreStage = VK_PIPELINE_STAGE_2_NONE);
+    void recordBatch(VkCommandBuffer cmd, const BarrierBatch& batch) const;
+    void recordSubmission(VkCommandBuffer cmd, size_t submission, bool profiled) const;
+    void destroyQueueObjects();
+};
+
+
+
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef RESOURCE_STATE_HPP
+#define RESOURCE_STATE_HPP
+
+#include <main.hpp>
+#include <render_graph.hpp>
+
+#include <vulkan/utility/vk_sparse_range_map.hpp>
+
+
+//last known state of one subresource(or byte range of a buffer)
+struct SubresourceState{
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED; //owner, IGNORED until someone claims it
+    VkPipelineStageFlags2 writeStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+    VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE; //readers since the last write
+    VkAccessFlags2 readAccess = VK_ACCESS_2_NONE;
+
+    bool operator==(const SubresourceState& other) const = default;
+};
+
+
+//per subresource layout/access/ownership tracking for one image
+//subresources are stored in a range map indexed by (plane, layer, mip) with mips innermost,
+//so neighbouring mips and layers in the same state collapse into a single entry and a single barrier
+//barriers that change queue family are an ownership transfer, record them on both the old(release)
+//and the new(acquire) queue
+class ImageStateTracker{
+    public:
+    ImageStateTracker(VkImage image, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    //append the barriers needed before range is accessed as next on queueFamily(IGNORED = whoever owns it)
+    //throws if range is empty or reaches past the image, same rules as the Vulkan valid usage
+    void transition(const VkImageSubresourceRange& range, const ResourceAccess& next, std::vector<VkImageMemoryBarrier2>& barriers, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+    //the whole image
+    void transition(const ResourceAccess& next, std::vector<VkImageMemoryBarrier2>& barriers, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    const SubresourceState& state(VkImageAspectFlags aspect, uint32_t mip, uint32_t layer) const;
+    //number of distinct state runs, 1 when the whole image is in one state
+    size_t runCount() const{
+        return states.size();
+    }
+    VkImage handle() const{
+        return image;
+    }
+
+    private:
+    using StateMap = vku::sparse::range_map<uint32_t, SubresourceState>;
+
+    VkImage image;
+    VkFormat format;
+    uint32_t mipLevels;
+    uint32_t arrayLayers;
+    StateMap states;
+
+    uint32_t planeIndex(VkImageAspectFlagBits aspect) const;
+    uint32_t subresourceIndex(uint32_t plane, uint32_t layer, uint32_t mip) const{
+        return (plane * arrayLayers + layer) * mipLevels + mip;
+    }
+};
+
+//same thing for byte ranges of a buffer, no layouts
+class BufferStateTracker{
+    public:
+    BufferStateTracker(VkBuffer buffer, VkDeviceSize size, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    //size may be VK_WHOLE_SIZE, throws if the range is empty or reaches past the buffer
+    void transition(VkDeviceSize offset, VkDeviceSize size, const ResourceAccess& next, std::vector<VkBufferMemoryBarrier2>& barriers, uint32_t queueFamily = VK_QUEUE_FAMILY_IGNORED);
+
+    const SubresourceState& state(VkDeviceSize offset) const;
+    size_t runCount() const{
+        return states.size();
+    }
+    VkBuffer handle() const{
+        return buffer;
+    }
+
+    private:
+    using StateMap = vku::sparse::range_map<VkDeviceSize, SubresourceState>;
+
+    VkBuffer buffer;
+    VkDeviceSize size;
+    StateMap states;
+};
+
+//record the barriers with one vkCmdPipelineBarrier2, does nothing if both are empty
+void recordBarriers(VkCommandBuffer cmd, PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers = {});
+
+
+
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <main.hpp>
+#include <transform_batch.hpp>
+
+#include <array>
+#include <functional>
+
+
+//flattened transform hierarchy
+//nodes live in plain arrays sorted by depth, so a parent always comes before its children
+//and every level is one contiguous range that can be processed in parallel
+class SceneGraph{
+    public:
+    //stable node id, array indices change when the hierarchy gets re-sorted
+    using NodeHandle = uint32_t;
+    static constexpr NodeHandle INVALID_NODE = UINT32_MAX;
+
+    //runs body over [begin, end) split into chunks however the caller likes(threads, jobs, ...)
+    using RangeBody = std::function<void(uint32_t begin, uint32_t end)>;
+    using ParallelFor = std::function<void(uint32_t begin, uint32_t end, const RangeBody& body)>;
+
+    //create a node, parent must already exist(or be INVALID_NODE for a root)
+    NodeHandle createNode(NodeHandle parent = INVALID_NODE, glm::vec3 position = glm::vec3(0.0f), glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f));
+    //change the local transform, the world matrices of the whole subtree get recomputed on the next update()
+    void setLocalTransform(NodeHandle node, glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+    void setPosition(NodeHandle node, glm::vec3 position);
+    void setRotation(NodeHandle node, glm::quat rotation);
+
+    //recompute local matrices of changed nodes and world matrices of dirty subtrees
+    //levels big enough to be worth it are handed to parallelFor, nullptr runs everything on this thread
+    void update(const ParallelFor& parallelFor = nullptr);
+
+    //number of nodes, also the number of instances
+    uint32_t size() const{
+        return static_cast<uint32_t>(parentIndex.size());
+    }
+    //world matrix of a node as of the last update()
+    const glm::mat4& worldMatrix(NodeHandle node) const{
+        return world[nodeIndex(node)];
+    }
+    //index of the node's matrix in the instance buffer, changes when nodes are added
+    uint32_t instanceIndex(NodeHandle node) const{
+        return nodeIndex(node);
+    }
+    //all world matrices in instance order, ready to be copied into the instance SSBO
+    const glm::mat4* worldMatrices() const{
+        return world.data();
+    }
+    //instance range [changedBegin, changedEnd) whose world matrices changed during the last update()
+    uint32_t changedBegin() const{
+        return changedFirst;
+    }
+    uint32_t changedEnd() const{
+        return changedLast;
+    }
+    //most instance buffers writeInstances() keeps apart, one per frame in flight
+    static constexpr uint32_t MAX_INSTANCE_BUFFERS = 4;
+    //bring the mapped instance buffer of slot(the frame in flight it belongs to) up to date, it holds size() matrices
+    //every slot remembers what changed since it was last written, so a buffer that skipped some updates still catches up
+    //written with non-temporal stores(streamingCopy()), the buffer is expected to be write-combined and never read back
+    void writeInstances(void* mappedInstanceBuffer, uint32_t slot = 0);
+
+    private:
+    //array index of a handle, throws for handles this graph never created
+    uint32_t nodeIndex(NodeHandle node) const;
+    //per node flags
+    enum : uint8_t{
+        LOCAL_DIRTY = 1, //TRS changed, local matrix must be rebuilt
+        WORLD_DIRTY = 2 //world matrix must be rebuilt(own or ancestor's transform changed)
+    };
+    //nodes smaller than this per level aren't worth splitting across threads
+    static constexpr uint32_t PARALLEL_GRAIN = 1024;
+
+    //everything below is indexed by sorted position
+    std::vector<uint32_t> parentIndex; //UINT32_MAX for roots
+    std::vector<uint32_t> depth;
+    std::vector<NodeHandle> indexToHandle;
+    TransformSoA local; //local translation/rotation/scale
+    std::vector<glm::mat4> localMatrix;
+    std::vector<glm::mat4> world;
+    std::vector<uint8_t> flags;
+    //first index of each depth level, plus one past the end
+    std::vector<uint32_t> levelOffsets;
+
+    std::vector<uint32_t> handleToIndex;
+    bool needsSort = false;
+    uint32_t changedFirst = 0;
+    uint32_t changedLast = 0;
+    //per instance buffer slot, instances changed since writeInstances() last wrote that slot, begin >= end when clean
+    std::array<std::pair<uint32_t, uint32_t>, MAX_INSTANCE_BUFFERS> pendingInstances{};
+
+    //restore depth order after nodes were appended out of order, rebuilds levelOffsets
+    void sortByDepth();
+};
+
+
+
+
+#endif
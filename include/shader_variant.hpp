@@ -0,0 +1,162 @@
+#ifndef SHADER_VARIANT_HPP
+#define SHADER_VARIANT_HPP
+
+#include <main.hpp>
+#include <pipeline_compiler.hpp>
+
+#include <array>
+#include <type_traits>
+
+
+//one feature of a shader, ConstantId matches layout(constant_id = N) in the GLSL
+//Bits wide field in the variant key, bools are 1 bit, small enums/counts a few more
+template<uint32_t ConstantId, uint32_t Bits = 1>
+struct ShaderFeature{
+    static_assert(Bits >= 1 && Bits <= 32, "shader feature must be 1 to 32 bits wide!");
+    static constexpr uint32_t constantId = ConstantId;
+    static constexpr uint32_t bits = Bits;
+};
+
+
+//packed set of feature values that picks one specialized pipeline out of a shader
+//the specialization map entries are built at compile time, one uint32 slot per feature
+//(bool specialization constants are 32 bit in SPIR-V too), only the values change per key
+//  struct Skinning : ShaderFeature<0>{};
+//  struct LightCount : ShaderFeature<1, 3>{};
+//  using MeshVariant = ShaderVariantKey<Skinning, LightCount>;
+//  MeshVariant key; key.set<LightCount>(4);
+template<typename... Features>
+class ShaderVariantKey{
+    public:
+    static constexpr uint32_t FEATURE_COUNT = sizeof...(Features);
+    static constexpr uint32_t TOTAL_BITS = (0 + ... + Features::bits);
+    static_assert(FEATURE_COUNT > 0, "variant key needs at least one feature!");
+    static_assert(TOTAL_BITS <= 64, "variant key doesn't fit in 64 bits!");
+
+    template<typename Feature>
+    constexpr ShaderVariantKey& set(uint32_t value){
+        constexpr uint32_t shift = bitOffset<Feature>();
+        constexpr uint64_t mask = fieldMask<Feature>();
+        key = (key & ~(mask << shift)) | ((static_cast<uint64_t>(value) & mask) << shift);
+        return *this;
+    }
+    template<typename Feature>
+    constexpr uint32_t get() const{
+        return static_cast<uint32_t>((key >> bitOffset<Feature>()) & fieldMask<Feature>());
+    }
+    constexpr uint64_t bits() const{
+        return key;
+    }
+    static constexpr ShaderVariantKey fromBits(uint64_t bits){
+        ShaderVariantKey result;
+        result.key = bits;
+        return result;
+    }
+    constexpr bool operator==(const ShaderVariantKey& other) const = default;
+
+    //same for every key of this type
+    static constexpr std::array<VkSpecializationMapEntry, FEATURE_COUNT> MAP_ENTRIES = [](){
+        std::array<VkSpecializationMapEntry, FEATURE_COUNT> entries{};
+        uint32_t ids[] = {Features::constantId...};
+        for(uint32_t i = 0; i < FEATURE_COUNT; i++){
+            entries[i] = {ids[i], i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t)};
+        }
+        return entries;
+    }();
+
+    //constant values in MAP_ENTRIES order
+    constexpr std::array<uint32_t, FEATURE_COUNT> constants() const{
+        return {get<Features>()...};
+    }
+    //points at data, which has to outlive the returned info
+    static VkSpecializationInfo specializationInfo(const std::array<uint32_t, FEATURE_COUNT>& data){
+        return {FEATURE_COUNT, MAP_ENTRIES.data(), sizeof(data), data.data()};
+    }
+
+    private:
+    uint64_t key = 0;
+
+    template<typename Feature>
+    static constexpr uint32_t index(){
+        constexpr bool matches[] = {std::is_same_v<Feature, Features>...};
+        for(uint32_t i = 0; i < FEATURE_COUNT; i++){
+            if(matches[i]){
+                return i;
+            }
+        }
+        return FEATURE_COUNT;
+    }
+    template<typename Feature>
+    static constexpr uint32_t bitOffset(){
+        static_assert(index<Feature>() < FEATURE_COUNT, "feature is not part of this variant key!");
+        constexpr uint32_t widths[] = {Features::bits...};
+        uint32_t offset = 0;
+        for(uint32_t i = 0; i < index<Feature>(); i++){
+            offset += widths[i];
+        }
+        return offset;
+    }
+    template<typename Feature>
+    static constexpr uint64_t fieldMask(){
+        return (1ull << Feature::bits) - 1;
+    }
+    static constexpr bool uniqueConstantIds(){
+        constexpr uint32_t ids[] = {Features::constantId...};
+        for(uint32_t i = 0; i < FEATURE_COUNT; i++){
+            for(uint32_t j = i + 1; j < FEATURE_COUNT; j++){
+                if(ids[i] == ids[j]){
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    static_assert(uniqueConstantIds(), "two features share a constant_id!");
+};
+
+
+//specialized pipelines of one base pipeline, built on demand through the async compiler
+//the specialization data is part of the pipeline's CreateInfoKey, so every distinct key is its own cache entry
+//and compiled variants are cached like any other pipeline
+template<typename Key>
+class ShaderVariantPipelines{
+    public:
+    //specializedStages = stages that get the key's constants
+    ShaderVariantPipelines(PipelineCompiler& compiler, const VkGraphicsPipelineCreateInfo& base, VkShaderStageFlags specializedStages = VK_SHADER_STAGE_FRAGMENT_BIT)
+        : compiler(compiler), base(base), specializedStages(specializedStages){
+
+    }
+
+    //pipeline for key, fallback until it finished compiling
+    VkPipeline get(const Key& key, VkPipeline fallback = VK_NULL_HANDLE){
+        std::array<uint32_t, Key::FEATURE_COUNT> data = key.constants();
+        VkSpecializationInfo specialization = Key::specializationInfo(data);
+
+        VkGraphicsPipelineCreateInfo info = base.createInfo();
+        std::array<VkPipelineShaderStageCreateInfo, 5> stages;
+        for(uint32_t i = 0; i < info.stageCount && i < stages.size(); i++){
+            stages[i] = info.pStages[i];
+            if(stages[i].stage & specializedStages){
+                stages[i].pSpecializationInfo = &specialization;
+            }
+        }
+        info.pStages = stages.data();
+        return compiler.request(info, fallback);
+    }
+
+    private:
+    PipelineCompiler& compiler;
+    GraphicsPipelineDesc base;
+    VkShaderStageFlags specializedStages;
+};
+
+
+//features of src/shaders/shader.frag, ids match its constant_id declarations
+struct ShadingModelFeature : ShaderFeature<0, 2>{}; //0 unlit, 1 lambert, 2 half lambert
+struct UVTintFeature : ShaderFeature<1>{};
+using MeshShaderVariant = ShaderVariantKey<ShadingModelFeature, UVTintFeature>;
+
+
+
+
+#endif
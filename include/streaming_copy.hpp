@@ -0,0 +1,34 @@
+#ifndef STREAMING_COPY_HPP
+#define STREAMING_COPY_HPP
+
+#include <main.hpp>
+
+#include <cstddef>
+
+
+//available implementations of streamingCopy()
+enum class CopyKernel{
+    Memcpy, //plain std::memcpy, regular stores through the cache
+    SSE2, //16 byte non-temporal stores
+    AVX2 //32 byte non-temporal stores, needs AVX2 at runtime
+};
+
+//fastest kernel the CPU we are running on supports
+CopyKernel selectCopyKernel();
+//printable kernel name
+const char* copyKernelName(CopyKernel kernel);
+
+//copy for mapped host visible memory that isn't HOST_CACHED(write-combined on most drivers)
+//regular stores there are uncached partial writes and reads of the destination are even slower,
+//non-temporal stores fill whole 64 byte lines in the write-combining buffers and go out as one burst
+//also skips the read-for-ownership on cached memory, so big copies into normal memory win too
+//dst is never read, copies below a few cache lines just use memcpy
+//ends with a store fence, the data is visible to the GPU(after a flush on non coherent memory) once it returns
+void streamingCopy(void* dst, const void* src, size_t size, CopyKernel kernel);
+//same thing with the best kernel for this CPU
+void streamingCopy(void* dst, const void* src, size_t size);
+
+
+
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef TEXTURE_COMPRESS_HPP
+#define TEXTURE_COMPRESS_HPP
+
+#include <main.hpp>
+
+
+//one mip of an image, data is tightly packed(rows of blocks for compressed formats)
+struct TextureMip{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> data;
+};
+
+//full mip chain of an RGBA8 image down to 1x1, 2x2 box filter
+//srgb averages in linear space so mips don't get darker
+std::vector<TextureMip> generateMips(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb);
+
+
+//CPU block encoders, rgba is width*height*4 bytes, edge blocks repeat the last row/column
+//quality is "good enough for an offline builder", not a match for dedicated encoders
+
+//BC1 without alpha, 8 bytes per block
+std::vector<uint8_t> compressBC1(const uint8_t* rgba, uint32_t width, uint32_t height);
+//BC5 from the red and green channels(normal maps, two channel masks), 16 bytes per block
+std::vector<uint8_t> compressBC5(const uint8_t* rgba, uint32_t width, uint32_t height);
+//BC7 mode 6 only(one subset, RGBA endpoints, 4 bit indices), 16 bytes per block
+std::vector<uint8_t> compressBC7(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+//compresses an RGBA8 mip into format(BC1/BC5/BC7 UNORM or SRGB, or R8G8B8A8 as a plain copy)
+std::vector<uint8_t> compressMip(VkFormat format, const TextureMip& mip);
+//back to RGBA8 for devices without support for format, throws for what compressMip can't produce
+//(BC7 blocks from other encoders that use modes besides 6 too)
+std::vector<uint8_t> decompressMip(VkFormat format, const TextureMip& mip);
+
+
+
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef TEXTURE_STREAMING_HPP
+#define TEXTURE_STREAMING_HPP
+
+#include <main.hpp>
+#include <job_system.hpp>
+
+#include <functional>
+#include <string>
+
+
+//what the streamer needs to know about one texture
+struct StreamedTextureDesc{
+    std::string name;
+    std::vector<VkDeviceSize> mipBytes; //size of every mip, [0] = full resolution
+};
+
+//how the renderer actually moves mips, the streamer only decides which and when
+struct TextureStreamingCallbacks{
+    //make mips [firstMip, endMip) resident(decode, upload, rebind/update minLod), runs on a low priority job
+    std::function<void(uint32_t texture, uint32_t firstMip, uint32_t endMip)> load;
+    //drop every mip below residentMip, runs on the frame thread inside update()
+    //frames still in flight may sample the dropped mips, so free their memory deferred
+    std::function<void(uint32_t texture, uint32_t residentMip)> evict;
+};
+
+struct TextureStreamingStats{
+    uint32_t textures = 0;
+    uint32_t loadsInFlight = 0;
+    uint64_t mipsLoaded = 0;
+    uint64_t mipsEvicted = 0;
+    VkDeviceSize residentBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+};
+
+
+//feedback driven mip streaming
+//textures start with only their mip tail(every mip up to TAIL_BYTES) resident, shaders write the finest mip
+//they wanted per texture into feedbackBuffer()(see src/shaders/streaming_feedback.glsl), the buffer is copied
+//to the host every frame and read back framesInFlight frames later in update(), which then loads finer mips
+//one level at a time and evicts the least recently wanted mips when over budget
+class TextureStreamer{
+    public:
+    //mips at or below this size stay resident forever
+    static constexpr VkDeviceSize TAIL_BYTES = 64 * 1024;
+    //never more than this many load jobs at once, keeps the low priority queue from flooding
+    static constexpr uint32_t MAX_LOADS_IN_FLIGHT = 8;
+    //feedback value meaning "not sampled this frame"
+    static constexpr uint32_t NOT_REQUESTED = 0xFFFFFFFF;
+
+    TextureStreamer(VkDevice device, VkPhysicalDevice physicalDevice, JobSystem& jobs, TextureStreamingCallbacks callbacks, uint32_t maxTextures, uint32_t framesInFlight, VkDeviceSize budgetBytes);
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    //registers a texture and loads its mip tail right away on the calling thread, returns the index shaders use
+    uint32_t addTexture(const StreamedTextureDesc& desc);
+    //storage buffer with one uint per texture, bind it to the feedback binding
+    VkBuffer feedbackBuffer() const{
+        return feedback;
+    }
+    //record at the end of the frame: copy this frame's feedback to the host and clear it for the next one
+    void recordFeedback(VkCommandBuffer cmd, uint32_t frameIndex);
+    //call after waiting on frameIndex's fence, reads its feedback and schedules loads/evictions
+    void update(uint32_t frameIndex);
+    //budget can follow VK_EXT_memory_budget(availableDeviceLocalMemory) as it changes
+    void setBudget(VkDeviceSize budgetBytes){
+        budget = budgetBytes;
+    }
+
+    //finest mip that can be sampled right now, use as minLod
+    uint32_t residentMip(uint32_t texture) const{
+        return textures[texture].residentMip;
+    }
+    TextureStreamingStats stats() const;
+    void printStats() const;
+
+    private:
+    struct Texture{
+        std::string name;
+        std::vector<VkDeviceSize> mipBytes;
+        uint32_t tailMip = 0; //first mip of the always resident tail
+        uint32_t residentMip = 0;
+        uint32_t wantedMip = 0;
+        uint64_t lastWantedFrame = 0;
+        bool loading = false;
+    };
+    struct FinishedLoad{
+        uint32_t texture;
+        uint32_t mip;
+    };
+
+    VkDevice device;
+    JobSystem& jobs;
+    TextureStreamingCallbacks callbacks;
+    uint32_t maxTextures;
+    uint32_t framesInFlight;
+    VkDeviceSize budget;
+
+    VkBuffer feedback = VK_NULL_HANDLE;
+    VkDeviceMemory feedbackMemory = VK_NULL_HANDLE;
+    VkBuffer readback = VK_NULL_HANDLE; //framesInFlight copies of feedback
+    VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+    const uint32_t* readbackData = nullptr;
+    bool readbackCoherent = true;
+    bool primed = false; //feedback starts undefined, the first frame only clears it
+    std::vector<bool> slotValid;
+
+    std::vector<Texture> textures;
+    VkDeviceSize residentBytes = 0;
+    uint64_t frameCounter = 0;
+    uint32_t loadsInFlight = 0;
+    uint64_t mipsLoaded = 0;
+    uint64_t mipsEvicted = 0;
+    JobCounter loadCounter;
+    std::mutex finishedMutex;
+    std::vector<FinishedLoad> finished; //filled by load jobs, applied by update()
+
+    VkDeviceSize mipRangeBytes(const Texture& texture, uint32_t firstMip, uint32_t endMip) const;
+    bool evictOne(uint64_t olderThan);
+};
+
+
+
+
+#endif
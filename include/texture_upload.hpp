@@ -0,0 +1,33 @@
+#ifndef TEXTURE_UPLOAD_HPP
+#define TEXTURE_UPLOAD_HPP
+
+#include <main.hpp>
+#include <ktx2.hpp>
+
+
+//sampled image created from a KTX2 texture, staging has to stay alive until the upload command buffer finished
+struct UploadedTexture{
+    VkImage image = VK_NULL_HANDLE;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t mipLevels = 0;
+    VkBuffer staging = VK_NULL_HANDLE;
+    VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+};
+
+//whether the device can sample format with optimal tiling and copy into it
+bool textureFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format);
+//format the texture ends up in on this device: its own when supported(block copy), RGBA8 otherwise(CPU transcode, BC only)
+VkFormat pickTextureFormat(VkPhysicalDevice physicalDevice, VkFormat fileFormat);
+
+//creates the image and view, fills a staging buffer and records the copies of every mip into cmd
+//the image is left in SHADER_READ_ONLY_OPTIMAL for fragment shaders, name shows up in debug tools
+UploadedTexture uploadTexture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandBuffer cmd, const Ktx2Texture& texture, const std::string& name = "texture");
+void destroyStaging(VkDevice device, UploadedTexture& texture);
+void destroyTexture(VkDevice device, UploadedTexture& texture);
+
+
+
+
+#endif
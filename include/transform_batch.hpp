@@ -0,0 +1,46 @@
+#ifndef TRANSFORM_BATCH_HPP
+#define TRANSFORM_BATCH_HPP
+
+#include <main.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <cstdint>
+
+
+//structure of arrays transforms, one entry per instance
+//kept as separate float streams so the SIMD kernels can load 4/8 instances per register
+struct TransformSoA{
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW; //unit quaternions
+    std::vector<float> scaleX, scaleY, scaleZ;
+
+    size_t size() const{
+        return positionX.size();
+    }
+    void resize(size_t count);
+    void set(size_t index, glm::vec3 position, glm::quat rotation, glm::vec3 scale);
+};
+
+//available implementations of the batch kernels
+enum class TransformKernel{
+    Scalar, //plain C++, works everywhere
+    SSE2, //4 instances at a time, uses the glm/simd 4x4 transpose
+    AVX2 //8 instances at a time, needs AVX2 + FMA at runtime
+};
+
+//fastest kernel the CPU we are running on supports
+TransformKernel selectTransformKernel();
+//printable kernel name
+const char* transformKernelName(TransformKernel kernel);
+
+//builds model = T * R * S for transforms [first, first + count)
+//normals is optional(nullptr to skip) and receives the inverse transpose of the upper 3x3, padded to a mat4 for std430
+void composeModelMatrices(const TransformSoA& transforms, size_t first, size_t count, glm::mat4* models, glm::mat4* normals, TransformKernel kernel);
+//same thing with the best kernel for this CPU
+void composeModelMatrices(const TransformSoA& transforms, size_t first, size_t count, glm::mat4* models, glm::mat4* normals = nullptr);
+
+
+
+
+#endif
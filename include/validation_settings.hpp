@@ -0,0 +1,48 @@
+#ifndef VALIDATION_SETTINGS_HPP
+#define VALIDATION_SETTINGS_HPP
+
+#include <main.hpp>
+
+#include <string>
+
+
+//what the Khronos validation layer checks, picked per run(--validation=<preset>)
+enum class ValidationPreset{
+    Off, //no layer at all, for profiling
+    Full, //the layer's defaults
+    Sync, //defaults plus synchronization validation(hazards between commands, queues and submits)
+    Perf, //best practices only, the expensive checks and thread safety off so timings stay meaningful
+    Gpu //defaults plus GPU-assisted validation(descriptor indexing, buffer device address, out of bounds), slow
+};
+
+//"off", "full", "sync", "perf" or "gpu", throws on anything else
+ValidationPreset parseValidationPreset(const std::string& name);
+const char* validationPresetName(ValidationPreset preset);
+
+
+//layer settings of a preset chained into VkInstanceCreateInfo
+//uses VK_EXT_layer_settings when the layer exposes it, VkValidationFeaturesEXT on older layers
+//has to stay alive until vkCreateInstance returned
+class ValidationSettings{
+    public:
+    explicit ValidationSettings(ValidationPreset preset) : preset(preset){}
+    ValidationSettings(const ValidationSettings&) = delete;
+    ValidationSettings& operator=(const ValidationSettings&) = delete;
+
+    //prepends the settings to createInfo.pNext and adds the extension they need to extensions
+    //call before createInfo takes the extension list, does nothing for Off and Full
+    void chain(VkInstanceCreateInfo& createInfo, std::vector<const char*>& extensions);
+
+    private:
+    ValidationPreset preset;
+    std::vector<VkLayerSettingEXT> settings;
+    VkLayerSettingsCreateInfoEXT layerSettings{};
+    std::vector<VkValidationFeatureEnableEXT> enables;
+    std::vector<VkValidationFeatureDisableEXT> disables;
+    VkValidationFeaturesEXT features{};
+};
+
+
+
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <main.hpp>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_precision.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+
+//full precision vertex as it comes out of an asset loader, never uploaded to the GPU
+struct Vertex{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec4 tangent; //xyz = tangent direction, w = bitangent sign(+1 or -1)
+    glm::vec2 uv;
+};
+
+//axis aligned box the quantized positions are relative to
+struct MeshBounds{
+    glm::vec3 min{0.0f};
+    glm::vec3 extent{0.0f}; //max - min, can be 0 on flat axes
+};
+
+//compressed vertex as stored in the vertex buffer, 20 bytes instead of 48
+struct PackedVertex{
+    glm::u16vec4 position; //unorm16 xyz relative to MeshBounds, w = bitangent sign(0 is -1, 65535 is +1)
+    glm::i16vec2 normal; //octahedral encoded unit vector, snorm16
+    glm::i16vec2 tangent; //octahedral encoded unit vector, snorm16
+    glm::u16vec2 uv; //half floats
+
+    //binding description for the compressed stream
+    static VkVertexInputBindingDescription getBindingDescription(){
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(PackedVertex);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescription;
+    }
+    //attribute descriptions, the fixed function vertex fetch expands unorm/snorm/half to float for free
+    static std::array<VkVertexInputAttributeDescription, 4> getAttributeDescriptions(){
+        std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions{};
+        attributeDescriptions[0] = {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position)};
+        attributeDescriptions[1] = {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal)};
+        attributeDescriptions[2] = {2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, tangent)};
+        attributeDescriptions[3] = {3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv)};
+        return attributeDescriptions;
+    }
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+
+//push constants the vertex shader needs to decode positions, must match shader.vert
+struct MeshPushConstants{
+    glm::mat4 mvp;
+    glm::vec4 boundsMin; //xyz = MeshBounds::min
+    glm::vec4 boundsExtent; //xyz = MeshBounds::extent
+};
+
+//largest difference between a source mesh and its decoded packed version
+struct VertexEncodingError{
+    float position = 0.0f; //world units
+    float normalAngle = 0.0f; //radians
+    float tangentAngle = 0.0f; //radians
+    float uv = 0.0f; //uv units
+};
+
+
+//octahedral mapping of a unit vector to [-1, 1]^2, the zero vector maps to +Z
+glm::vec2 octahedralEncode(glm::vec3 n);
+//inverse of octahedralEncode, result is normalized
+glm::vec3 octahedralDecode(glm::vec2 e);
+
+//bounding box of all vertex positions
+MeshBounds computeMeshBounds(const Vertex* vertices, size_t count);
+//quantize one vertex against the mesh bounds
+PackedVertex packVertex(const Vertex& vertex, const MeshBounds& bounds);
+//expand a packed vertex the same way the vertex shader does
+Vertex unpackVertex(const PackedVertex& packed, const MeshBounds& bounds);
+//quantize a whole mesh, writes count vertices to out
+void packVertices(const Vertex* vertices, size_t count, const MeshBounds& bounds, PackedVertex* out);
+//convenience overload, computes the bounds too
+std::vector<PackedVertex> packMesh(const std::vector<Vertex>& vertices, MeshBounds& bounds);
+
+//worst case quantization error allowed by the format for these bounds and uvs up to maxUVMagnitude
+VertexEncodingError vertexEncodingErrorBound(const MeshBounds& bounds, float maxUVMagnitude = 1.0f);
+//actual worst quantization error of an encoded mesh
+VertexEncodingError measureVertexEncodingError(const Vertex* vertices, const PackedVertex* packed, size_t count, const MeshBounds& bounds);
+
+
+
+
+#endif
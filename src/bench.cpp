@@ -0,0 +1,1227 @@
+#include <main.hpp>
+#include <vertex_format.hpp>
+#include <transform_batch.hpp>
+#include <scene_graph.hpp>
+#include <job_system.hpp>
+#include <render_graph.hpp>
+#include <gpu_memory.hpp>
+#include <frame_readback.hpp>
+#include <gpu_profiler.hpp>
+#include <cpu_trace.hpp>
+#include <streaming_copy.hpp>
+#include <device_selection.hpp>
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+//benchmark harness, runs a seeded scene along a fixed camera path for a fixed number of frames
+//  bench [--frames 300] [--warmup 30] [--nodes 20000] [--seed 1] [--size 1280x720] [--out bench.json]
+//        [--compare baseline.json] [--threshold 10] [--dump 0] [--dump-dir .] [--trace trace.json] [--cpu-only] [--staging]
+//        [--async-compute]
+//renders offscreen without a window or surface, so it runs on whatever ICD is installed(lavapipe on CI machines)
+//and falls back to the CPU side only when there is no usable device
+//results are CPU frame time percentiles, per phase CPU times, GPU pass times from the GpuProfiler and the
+//vertex packing/transform batch microbenchmarks, written as JSON
+//the GPU passes are the instance upload and a clear of the target, no scene is drawn, so gpu_pass_overhead_ms
+//is copy/clear/barrier cost per pass and not comparable to frame times of the renderer
+//--compare reads a previous result and exits with 1 when anything got worse by more than threshold percent
+//--dump N writes every Nth frame through FrameReadback(bench_<frame>.qoi) for eyeballing or golden images
+//--trace writes the measured frames' CPU zones(needs make TRACE=1) and GPU zones as one Chrome trace
+//--staging copies instances through a staging buffer even when the device could take them directly(resizable BAR)
+//--async-compute moves the instance upload to the async compute queue, next to the clear on graphics,
+//and submits through RenderGraph::submit()(not together with --dump)
+//the device is picked by selectPhysicalDevice(), VULKAN_DEVICE=<index or name> forces one(e.g. lavapipe on a GPU machine)
+
+
+static constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+//nodes animated per frame = nodes / ANIMATE_STRIDE
+static constexpr uint32_t ANIMATE_STRIDE = 16;
+
+struct BenchOptions{
+    uint32_t frames = 300;
+    uint32_t warmup = 30;
+    uint32_t nodes = 20000;
+    uint64_t seed = 1;
+    VkExtent2D extent = {1280, 720};
+    std::string out = "bench.json";
+    std::string compare;
+    double threshold = 10.0; //percent
+    uint32_t dumpEvery = 0;
+    std::string dumpDir = ".";
+    std::string trace;
+    bool cpuOnly = false;
+    bool staging = false;
+    bool asyncCompute = false;
+};
+
+
+//splitmix64, std distributions differ between standard libraries and the content has to be the same everywhere
+struct BenchRandom{
+    uint64_t state;
+
+    uint64_t next(){
+        state += 0x9E3779B97F4A7C15ull;
+        uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    float uniform(float low, float high){
+        return low + (high - low) * static_cast<float>(next() >> 40) / static_cast<float>(1u << 24);
+    }
+    //[0, n)
+    uint32_t below(uint32_t n){
+        return static_cast<uint32_t>(((next() >> 32) * n) >> 32);
+    }
+};
+
+
+using BenchClock = std::chrono::steady_clock;
+
+static double millisecondsSince(BenchClock::time_point start){
+    return std::chrono::duration<double, std::milli>(BenchClock::now() - start).count();
+}
+
+struct Summary{
+    double mean = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+//nearest rank percentiles
+static Summary summarize(std::vector<double> samples){
+    Summary summary;
+    if(samples.empty()){
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p){
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+        return samples[std::max<size_t>(rank, 1) - 1];
+    };
+    double sum = 0.0;
+    for(double sample : samples){
+        sum += sample;
+    }
+    summary.mean = sum / samples.size();
+    summary.p50 = percentile(50.0);
+    summary.p90 = percentile(90.0);
+    summary.p99 = percentile(99.0);
+    summary.max = samples.back();
+    return summary;
+}
+
+
+//CPU phases of one frame, in order
+enum BenchPhase{
+    PHASE_WAIT, //fence of the frame that used this slot last, GPU bound time shows up here
+    PHASE_ANIMATE,
+    PHASE_TRANSFORMS,
+    PHASE_CULL,
+    PHASE_UPLOAD,
+    PHASE_RECORD,
+    PHASE_SUBMIT,
+    PHASE_COUNT
+};
+static const char* phaseNames[PHASE_COUNT] = {"wait", "animate", "transforms", "cull", "upload", "record", "submit"};
+
+struct BenchResults{
+    std::string device = "none";
+    std::string uploadMode = "none"; //"direct" or "staging"
+    std::string queues = "none"; //"graphics" or "async compute"
+    uint32_t workers = 0;
+    std::vector<double> frameTimes;
+    std::vector<double> phaseTimes[PHASE_COUNT];
+    std::vector<std::pair<std::string, std::vector<double>>> passTimes; //per profiler zone, first seen first, upload and clear only
+    uint64_t visibleInstances = 0; //summed over measured frames
+    uint64_t dumpedFrames = 0;
+    std::vector<std::pair<std::string, double>> microbench;
+    std::vector<MemoryHeapStatus> memoryHeaps; //tracker state at the end of the measured frames
+};
+
+
+//microbenchmarks
+static volatile float benchSink;
+
+//best of repeats runs, in ms
+template<typename F>
+static double bestOf(uint32_t repeats, F&& function){
+    double best = std::numeric_limits<double>::max();
+    for(uint32_t i = 0; i < repeats; i++){
+        auto start = BenchClock::now();
+        function();
+        best = std::min(best, millisecondsSince(start));
+    }
+    return best;
+}
+
+static void vertexPackBench(BenchRandom& random, BenchResults& results){
+    constexpr size_t count = 1 << 20;
+    std::vector<Vertex> vertices(count);
+    for(Vertex& vertex : vertices){
+        vertex.position = glm::vec3(random.uniform(-10.0f, 10.0f), random.uniform(-10.0f, 10.0f), random.uniform(-10.0f, 10.0f));
+        vertex.normal = glm::normalize(glm::vec3(random.uniform(-1.0f, 1.0f), random.uniform(-1.0f, 1.0f), random.uniform(0.1f, 1.0f)));
+        glm::vec3 tangent = glm::normalize(glm::cross(vertex.normal, glm::vec3(0.0f, 0.0f, 1.0f) + glm::vec3(0.3f, 0.0f, 0.0f)));
+        vertex.tangent = glm::vec4(tangent, (random.next() & 1) ? 1.0f : -1.0f);
+        vertex.uv = glm::vec2(random.uniform(0.0f, 1.0f), random.uniform(0.0f, 1.0f));
+    }
+    MeshBounds bounds = computeMeshBounds(vertices.data(), count);
+    std::vector<PackedVertex> packed(count);
+    double ms = bestOf(5, [&](){
+        packVertices(vertices.data(), count, bounds, packed.data());
+    });
+    benchSink = packed[count / 2].position.x;
+    results.microbench.push_back({"vertex_pack_mverts_per_s", count / (ms * 1000.0)});
+}
+
+//SoA kernels against the glm::translate/rotate/scale chain they replace
+static void transformBench(BenchRandom& random, BenchResults& results){
+    constexpr size_t count = 1 << 16;
+    TransformSoA transforms;
+    transforms.resize(count);
+    for(size_t i = 0; i < count; i++){
+        glm::vec3 axis = glm::normalize(glm::vec3(random.uniform(-1.0f, 1.0f), 1.0f, random.uniform(-1.0f, 1.0f)));
+        transforms.set(i, glm::vec3(random.uniform(-100.0f, 100.0f), random.uniform(-100.0f, 100.0f), random.uniform(-100.0f, 100.0f)),
+            glm::angleAxis(random.uniform(0.0f, 6.2831853f), axis), glm::vec3(random.uniform(0.5f, 2.0f)));
+    }
+    std::vector<glm::mat4> models(count);
+    std::vector<glm::mat4> normals(count);
+
+    TransformKernel best = selectTransformKernel();
+    for(TransformKernel kernel : {TransformKernel::Scalar, TransformKernel::SSE2, TransformKernel::AVX2}){
+        if(kernel > best){
+            break;
+        }
+        double ms = bestOf(10, [&](){
+            composeModelMatrices(transforms, 0, count, models.data(), normals.data(), kernel);
+        });
+        std::string name = transformKernelName(kernel);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){
+            return static_cast<char>(std::tolower(c));
+        });
+        results.microbench.push_back({"transform_" + name + "_ns_per_instance", ms * 1e6 / count});
+    }
+
+    double ms = bestOf(10, [&](){
+        for(size_t i = 0; i < count; i++){
+            glm::vec3 position(transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i]);
+            glm::quat rotation(transforms.rotationW[i], transforms.rotationX[i], transforms.rotationY[i], transforms.rotationZ[i]);
+            glm::vec3 scale(transforms.scaleX[i], transforms.scaleY[i], transforms.scaleZ[i]);
+            models[i] = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+            normals[i] = glm::mat4(glm::transpose(glm::inverse(glm::mat3(models[i]))));
+        }
+    });
+    benchSink = models[count / 2][3][0] + normals[count / 2][0][0];
+    results.microbench.push_back({"transform_glm_ns_per_instance", ms * 1e6 / count});
+}
+
+//upload sized copies, into ordinary cached memory since there is no mapped device memory on the CPU path
+//the non-temporal kernels still win there by skipping the read-for-ownership, on write-combined memory the gap is far bigger
+static void copyBench(BenchRandom& random, BenchResults& results){
+    constexpr size_t size = 32 << 20;
+    std::vector<uint8_t> source(size);
+    for(uint8_t& byte : source){
+        byte = static_cast<uint8_t>(random.next());
+    }
+    //touched once so page faults aren't part of the first run
+    std::vector<uint8_t> destination(size, 0);
+
+    CopyKernel best = selectCopyKernel();
+    for(CopyKernel kernel : {CopyKernel::Memcpy, CopyKernel::SSE2, CopyKernel::AVX2}){
+        if(kernel > best){
+            break;
+        }
+        double ms = bestOf(5, [&](){
+            streamingCopy(destination.data(), source.data(), size, kernel);
+        });
+        benchSink = destination[size / 2];
+        std::string name = copyKernelName(kernel);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){
+            return static_cast<char>(std::tolower(c));
+        });
+        results.microbench.push_back({"copy_" + name + "_gb_per_s", size / (ms * 1e6)});
+    }
+}
+
+
+//headless vulkan, no surface and no extensions besides synchronization2 on devices older than 1.3, timeline_semaphore
+//on ones older than 1.2 and memory_budget
+struct BenchDevice{
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkDevice device = VK_NULL_HANDLE;
+    VkQueue queue = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VkQueue computeQueue = VK_NULL_HANDLE; //second queue that can compute, if the device has one
+    uint32_t computeFamily = 0;
+    bool timelineSemaphores = false;
+    std::string name;
+};
+
+static BenchDevice createBenchDevice(){
+    BenchDevice bench;
+    uint32_t instanceVersion = VK_API_VERSION_1_0;
+    vkEnumerateInstanceVersion(&instanceVersion);
+    if(instanceVersion < VK_API_VERSION_1_1){
+        throw std::runtime_error("bench needs a Vulkan 1.1 loader!");
+    }
+    uint32_t apiVersion = std::min<uint32_t>(instanceVersion, VK_API_VERSION_1_3);
+
+    VkApplicationInfo appInfo{};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "bench";
+    appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.pEngineName = "No Engine";
+    appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
+    appInfo.apiVersion = apiVersion;
+    VkInstanceCreateInfo instanceInfo{};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    if(vkCreateInstance(&instanceInfo, nullptr, &bench.instance) != VK_SUCCESS){
+        throw std::runtime_error("failed to create instance!");
+    }
+
+    //synchronization2 is core from 1.3, an extension before
+    auto sync2Core = [&](VkPhysicalDevice candidate){
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(candidate, &properties);
+        return std::min(apiVersion, properties.apiVersion) >= VK_API_VERSION_1_3;
+    };
+    auto graphicsFamily = [](VkPhysicalDevice candidate){
+        uint32_t familyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+        uint32_t family = 0;
+        while(family < familyCount && !(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)){
+            family++;
+        }
+        return family < familyCount ? family : UINT32_MAX;
+    };
+    DeviceRequirements requirements;
+    requirements.apiVersion = VK_API_VERSION_1_1;
+    requirements.check = [&](VkPhysicalDevice candidate) -> std::string{
+        if(!sync2Core(candidate) && !deviceSupportsExtension(candidate, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)){
+            return "no synchronization2";
+        }
+        VkPhysicalDeviceSynchronization2Features sync2{};
+        sync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &sync2;
+        vkGetPhysicalDeviceFeatures2(candidate, &features);
+        if(!sync2.synchronization2){
+            return "synchronization2 feature missing";
+        }
+        if(graphicsFamily(candidate) == UINT32_MAX){
+            return "no graphics queue";
+        }
+        return "";
+    };
+    DevicePreferences preferences;
+    preferences.extensions = {{VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, 50}};
+    DeviceRating selected;
+    try{
+        selected = selectPhysicalDevice(bench.instance, requirements, preferences, &std::cout);
+    }
+    catch(const std::exception&){
+        vkDestroyInstance(bench.instance, nullptr);
+        throw;
+    }
+    bench.physicalDevice = selected.device;
+    bench.queueFamily = graphicsFamily(selected.device);
+    bench.name = selected.name;
+    bool needsExtension = !sync2Core(selected.device);
+
+    //timeline semaphores are only needed for --async-compute, core from 1.2
+    VkPhysicalDeviceProperties selectedProperties;
+    vkGetPhysicalDeviceProperties(bench.physicalDevice, &selectedProperties);
+    bool timelineCore = std::min(apiVersion, selectedProperties.apiVersion) >= VK_API_VERSION_1_2;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timeline{};
+    timeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    if(timelineCore || deviceSupportsExtension(bench.physicalDevice, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)){
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &timeline;
+        vkGetPhysicalDeviceFeatures2(bench.physicalDevice, &features);
+    }
+    bench.timelineSemaphores = timeline.timelineSemaphore;
+
+    DeviceQueuePlan queuePlan = planDeviceQueues(bench.physicalDevice, bench.queueFamily);
+    std::vector<VkDeviceQueueCreateInfo> queueInfos = queuePlan.createInfos();
+    VkPhysicalDeviceSynchronization2Features sync2{};
+    sync2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+    sync2.synchronization2 = VK_TRUE;
+    if(bench.timelineSemaphores){
+        timeline.pNext = nullptr;
+        sync2.pNext = &timeline;
+    }
+    std::vector<const char*> extensions;
+    if(needsExtension){
+        extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    }
+    if(bench.timelineSemaphores && !timelineCore){
+        extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+    if(memoryBudgetSupported(bench.physicalDevice)){
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    VkDeviceCreateInfo deviceInfo{};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = &sync2;
+    deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+    deviceInfo.pQueueCreateInfos = queueInfos.data();
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    deviceInfo.ppEnabledExtensionNames = extensions.empty() ? nullptr : extensions.data();
+    if(vkCreateDevice(bench.physicalDevice, &deviceInfo, nullptr, &bench.device) != VK_SUCCESS){
+        vkDestroyInstance(bench.instance, nullptr);
+        throw std::runtime_error("failed to create logical device!");
+    }
+    vkGetDeviceQueue(bench.device, queuePlan.graphics.family, queuePlan.graphics.index, &bench.queue);
+    if(queuePlan.asyncCompute.exists()){
+        bench.computeFamily = queuePlan.asyncCompute.family;
+        vkGetDeviceQueue(bench.device, queuePlan.asyncCompute.family, queuePlan.asyncCompute.index, &bench.computeQueue);
+    }
+    return bench;
+}
+
+
+//the scripted scene, everything derived from the seed and the frame number
+class BenchScene{
+    public:
+    BenchScene(const BenchOptions& options, JobSystem& jobs) : jobs(jobs){
+        BenchRandom random{options.seed};
+        uint32_t rootCount = std::max(1u, options.nodes / 64);
+        handles.reserve(options.nodes);
+        axes.reserve(options.nodes);
+        for(uint32_t i = 0; i < options.nodes; i++){
+            SceneGraph::NodeHandle parent = SceneGraph::INVALID_NODE;
+            glm::vec3 position;
+            if(i < rootCount){
+                position = glm::vec3(random.uniform(-100.0f, 100.0f), 0.0f, random.uniform(-100.0f, 100.0f));
+            }
+            else{
+                parent = handles[random.below(i)];
+                position = glm::vec3(random.uniform(-4.0f, 4.0f), random.uniform(-4.0f, 4.0f), random.uniform(-4.0f, 4.0f));
+            }
+            glm::vec3 axis = glm::normalize(glm::vec3(random.uniform(-1.0f, 1.0f), 1.0f, random.uniform(-1.0f, 1.0f)));
+            glm::quat rotation = glm::angleAxis(random.uniform(0.0f, 6.2831853f), axis);
+            handles.push_back(scene.createNode(parent, position, rotation, glm::vec3(random.uniform(0.5f, 1.0f))));
+            axes.push_back(axis);
+        }
+        aspect = static_cast<float>(options.extent.width) / options.extent.height;
+        pathFrames = options.warmup + options.frames;
+        visibleFlags.resize(options.nodes);
+        visible.reserve(options.nodes);
+    }
+
+    //spin a fixed 1/ANIMATE_STRIDE of the nodes
+    void animate(uint32_t frame){
+        TRACE_ZONE("animate");
+        for(uint32_t node = frame % ANIMATE_STRIDE; node < handles.size(); node += ANIMATE_STRIDE){
+            scene.setRotation(handles[node], glm::angleAxis(frame * 0.05f + node, axes[node]));
+        }
+    }
+    void updateTransforms(){
+        TRACE_ZONE("transforms");
+        scene.update([this](uint32_t begin, uint32_t end, const SceneGraph::RangeBody& body){
+            jobs.parallelFor("scene transforms", begin, end, 256, body);
+        });
+    }
+    //one orbit around the scene over the whole run, bobbing up and down twice
+    glm::mat4 viewProjection(uint32_t frame) const{
+        float t = 6.2831853f * frame / pathFrames;
+        glm::vec3 eye(120.0f * std::cos(t), 30.0f + 20.0f * std::sin(2.0f * t), 120.0f * std::sin(t));
+        glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 500.0f);
+        projection[1][1] *= -1.0f;
+        return projection * view;
+    }
+    //instance origins against the frustum with some slack for their size, fills visible()
+    void cull(uint32_t frame){
+        TRACE_ZONE("cull");
+        glm::mat4 viewProj = viewProjection(frame);
+        const glm::mat4* world = scene.worldMatrices();
+        jobs.parallelFor("bench cull", 0, scene.size(), 4096, [&](uint32_t begin, uint32_t end){
+            for(uint32_t i = begin; i < end; i++){
+                glm::vec4 clip = viewProj * world[i][3];
+                float slack = clip.w + 4.0f;
+                visibleFlags[i] = clip.w > 0.1f && std::abs(clip.x) <= slack && std::abs(clip.y) <= slack && clip.z <= clip.w;
+            }
+        });
+        visible.clear();
+        for(uint32_t i = 0; i < scene.size(); i++){
+            if(visibleFlags[i]){
+                visible.push_back(i);
+            }
+        }
+    }
+    //world matrices of the visible instances, packed
+    void upload(glm::mat4* destination) const{
+        TRACE_ZONE("upload");
+        const glm::mat4* world = scene.worldMatrices();
+        for(size_t i = 0; i < visible.size(); i++){
+            destination[i] = world[visible[i]];
+        }
+    }
+    uint32_t visibleCount() const{
+        return static_cast<uint32_t>(visible.size());
+    }
+    //background color that moves with the camera so dumped frames differ
+    VkClearColorValue clearColor(uint32_t frame) const{
+        float t = static_cast<float>(frame) / pathFrames;
+        return {{0.1f + 0.8f * t, 0.2f, 0.9f - 0.8f * t, 1.0f}};
+    }
+
+    private:
+    JobSystem& jobs;
+    SceneGraph scene;
+    std::vector<SceneGraph::NodeHandle> handles;
+    std::vector<glm::vec3> axes;
+    float aspect = 1.0f;
+    uint32_t pathFrames = 1;
+    std::vector<uint8_t> visibleFlags;
+    std::vector<uint32_t> visible;
+};
+
+
+static void runCpuOnly(const BenchOptions& options, BenchScene& scene, BenchResults& results){
+    std::vector<glm::mat4> staging(options.nodes);
+    for(uint32_t frame = 0; frame < options.warmup + options.frames; frame++){
+        bool measured = frame >= options.warmup;
+        if(frame == options.warmup && !options.trace.empty()){
+            cpuTraceStart();
+        }
+        TRACE_ZONE("frame");
+        auto frameStart = BenchClock::now();
+        double phases[PHASE_COUNT] = {};
+
+        auto start = BenchClock::now();
+        scene.animate(frame);
+        phases[PHASE_ANIMATE] = millisecondsSince(start);
+        start = BenchClock::now();
+        scene.updateTransforms();
+        phases[PHASE_TRANSFORMS] = millisecondsSince(start);
+        start = BenchClock::now();
+        scene.cull(frame);
+        phases[PHASE_CULL] = millisecondsSince(start);
+        start = BenchClock::now();
+        scene.upload(staging.data());
+        phases[PHASE_UPLOAD] = millisecondsSince(start);
+
+        if(measured){
+            results.frameTimes.push_back(millisecondsSince(frameStart));
+            for(uint32_t phase : {PHASE_ANIMATE, PHASE_TRANSFORMS, PHASE_CULL, PHASE_UPLOAD}){
+                results.phaseTimes[phase].push_back(phases[phase]);
+            }
+            results.visibleInstances += scene.visibleCount();
+        }
+    }
+    if(!options.trace.empty()){
+        cpuTraceStop();
+        cpuTraceWrite(options.trace);
+        std::cout << "trace written to " << options.trace << "\n";
+    }
+}
+
+static void runGpu(const BenchOptions& options, const BenchDevice& bench, JobSystem& jobs, BenchScene& scene, BenchResults& results){
+    VkDevice device = bench.device;
+    VkPhysicalDevice physicalDevice = bench.physicalDevice;
+    MemoryBudgetTracker memoryBudget(bench.instance, physicalDevice);
+    setMemoryTracker(&memoryBudget);
+
+    //offscreen color target, stays in TRANSFER_SRC_OPTIMAL between frames
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageInfo.extent = {options.extent.width, options.extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImage target;
+    if(vkCreateImage(device, &imageInfo, nullptr, &target) != VK_SUCCESS){
+        throw std::runtime_error("failed to create offscreen image!");
+    }
+    VkMemoryRequirements imageRequirements;
+    vkGetImageMemoryRequirements(device, target, &imageRequirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = imageRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, imageRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkDeviceMemory targetMemory;
+    if(allocateMemory(device, allocInfo, MemoryCategory::RenderTarget, &targetMemory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate offscreen image memory!");
+    }
+    vkBindImageMemory(device, target, targetMemory, 0);
+
+    //one host visible region per frame in flight that the scene writes its instances into
+    //on resizable BAR that is the device local buffer the GPU reads, otherwise a staging buffer copied into a device local one
+    //only a request, findMemoryType() may still settle on a type that isn't device local
+    bool wantDirectWrite = findDirectWriteHeap(physicalDevice).large && !options.staging;
+    if(options.asyncCompute && (bench.computeQueue == VK_NULL_HANDLE || !bench.timelineSemaphores)){
+        throw std::runtime_error("--async-compute needs a second compute queue and timeline semaphores!");
+    }
+    results.queues = options.asyncCompute ? "async compute" : "graphics";
+    VkDeviceSize instanceBytes = static_cast<VkDeviceSize>(std::max(options.nodes, 1u)) * sizeof(glm::mat4);
+    auto createBuffer = [&](VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred,
+        MemoryCategory category, VkDeviceMemory& memory){
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        VkBuffer buffer;
+        if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
+            throw std::runtime_error("failed to create bench buffer!");
+        }
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, buffer, &requirements);
+        VkMemoryAllocateInfo bufferAllocInfo{};
+        bufferAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        bufferAllocInfo.allocationSize = requirements.size;
+        bufferAllocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, required, preferred);
+        if(allocateMemory(device, bufferAllocInfo, category, &memory) != VK_SUCCESS){
+            throw std::runtime_error("failed to allocate bench buffer memory!");
+        }
+        vkBindBufferMemory(device, buffer, memory, 0);
+        return buffer;
+    };
+    VkMemoryPropertyFlags stagingPreferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | (wantDirectWrite ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : 0);
+    VkDeviceMemory stagingMemory;
+    VkBuffer staging = createBuffer(instanceBytes * FRAMES_IN_FLIGHT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | (wantDirectWrite ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : 0),
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, stagingPreferred, wantDirectWrite ? MemoryCategory::Mesh : MemoryCategory::Staging, stagingMemory);
+    void* stagingData;
+    if(vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, &stagingData) != VK_SUCCESS){
+        throw std::runtime_error("failed to map staging memory!");
+    }
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    VkMemoryRequirements stagingRequirements;
+    vkGetBufferMemoryRequirements(device, staging, &stagingRequirements);
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    VkMemoryPropertyFlags stagingFlags = memoryProperties.memoryTypes[findMemoryType(physicalDevice, stagingRequirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, stagingPreferred)].propertyFlags;
+    bool stagingCoherent = stagingFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    //decided by the memory we actually got, like UniformRing::directWrite(), the GPU would read anything else over PCIe
+    bool directWrite = wantDirectWrite && (stagingFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    results.uploadMode = directWrite ? "direct" : "staging";
+    VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+    VkBuffer instanceBuffer = VK_NULL_HANDLE;
+    if(!directWrite){
+        instanceBuffer = createBuffer(instanceBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, MemoryCategory::Mesh, instanceMemory);
+    }
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = bench.queueFamily;
+    VkCommandPool commandPool;
+    if(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS){
+        throw std::runtime_error("failed to create command pool!");
+    }
+    VkCommandBuffer commandBuffers[FRAMES_IN_FLIGHT];
+    VkCommandBufferAllocateInfo commandInfo{};
+    commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandInfo.commandPool = commandPool;
+    commandInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandInfo.commandBufferCount = FRAMES_IN_FLIGHT;
+    if(vkAllocateCommandBuffers(device, &commandInfo, commandBuffers) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate command buffers!");
+    }
+    VkFence fences[FRAMES_IN_FLIGHT];
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    for(VkFence& fence : fences){
+        if(vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS){
+            throw std::runtime_error("failed to create fence!");
+        }
+    }
+    GpuProfiler profiler(device, physicalDevice, bench.queueFamily, FRAMES_IN_FLIGHT);
+    if(!profiler.enabled()){
+        std::cout << "no timestamp support, GPU pass times will be missing\n";
+    }
+    profiler.setMemoryTracker(&memoryBudget);
+
+    //target into the layout every frame starts and ends in
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkResetFences(device, 1, &fences[0]);
+    vkBeginCommandBuffer(commandBuffers[0], &beginInfo);
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = target;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffers[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkEndCommandBuffer(commandBuffers[0]);
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffers[0];
+    if(vkQueueSubmit(bench.queue, 1, &submitInfo, fences[0]) != VK_SUCCESS){
+        throw std::runtime_error("failed to submit command buffer!");
+    }
+    vkWaitForFences(device, 1, &fences[0], VK_TRUE, UINT64_MAX);
+
+    //built once, the passes read the current slot and visible count when they record
+    uint32_t slot = 0;
+    uint32_t frame = 0;
+    uint32_t visibleCount = 0;
+    RenderGraph graph(device, physicalDevice);
+    graph.setProfiler(&profiler);
+    if(options.asyncCompute){
+        graph.setQueues({bench.queue, bench.queueFamily, bench.computeQueue, bench.computeFamily, FRAMES_IN_FLIGHT});
+    }
+    RenderGraphImageDesc targetDesc;
+    targetDesc.format = imageInfo.format;
+    targetDesc.extent = imageInfo.extent;
+    RenderGraphResource color = graph.importImage("offscreen", target, VK_NULL_HANDLE, targetDesc,
+        resourceAccess(ResourceUsage::TransferSrc), ResourceUsage::TransferSrc);
+    //direct writes are visible to the GPU at submit, no copy and no pass
+    if(!directWrite){
+        RenderGraphBufferDesc instanceDesc;
+        instanceDesc.size = instanceBytes;
+        RenderGraphResource instances = graph.importBuffer("instances", instanceBuffer, instanceDesc, resourceAccess(ResourceUsage::TransferDst));
+        RenderGraphPass& upload = graph.addPass("instance upload", [&, instances](VkCommandBuffer cmd, const RenderGraph& renderGraph){
+            if(visibleCount > 0){
+                VkBufferCopy region{slot * instanceBytes, 0, visibleCount * sizeof(glm::mat4)};
+                vkCmdCopyBuffer(cmd, staging, renderGraph.buffer(instances), 1, &region);
+            }
+        }).write(instances, ResourceUsage::TransferDst).sideEffects();
+        //nothing reads the exclusive instance buffer on another family, so it needs no ownership transfer
+        if(options.asyncCompute){
+            upload.asyncCompute();
+        }
+    }
+    graph.addPass("clear", [&](VkCommandBuffer cmd, const RenderGraph& renderGraph){
+        VkClearColorValue clear = scene.clearColor(frame);
+        VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(cmd, renderGraph.image(color), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear, 1, &range);
+    }).write(color, ResourceUsage::TransferDst);
+    graph.compile();
+
+    std::unique_ptr<FrameReadback> readback;
+    if(options.dumpEvery > 0){
+        readback = std::make_unique<FrameReadback>(device, physicalDevice, jobs, FRAMES_IN_FLIGHT, options.extent);
+    }
+
+    //frame each slot was last used for, UINT32_MAX = nothing to read back
+    uint32_t slotFrame[FRAMES_IN_FLIGHT];
+    std::fill(std::begin(slotFrame), std::end(slotFrame), UINT32_MAX);
+    auto collectSlot = [&](uint32_t index){
+        uint32_t finished = slotFrame[index];
+        if(finished == UINT32_MAX){
+            return;
+        }
+        if(finished == options.warmup && !options.trace.empty()){
+            profiler.startCapture(options.frames);
+        }
+        const std::vector<GpuZoneResult>& zones = profiler.collect(index);
+        if(finished >= options.warmup){
+            for(const GpuZoneResult& zone : zones){
+                auto times = std::find_if(results.passTimes.begin(), results.passTimes.end(), [&](const auto& pass){
+                    return pass.first == zone.name;
+                });
+                if(times == results.passTimes.end()){
+                    results.passTimes.push_back({zone.name, {}});
+                    times = results.passTimes.end() - 1;
+                }
+                times->second.push_back(zone.durationMs);
+            }
+        }
+        if(readback){
+            readback->collect(index);
+        }
+        slotFrame[index] = UINT32_MAX;
+    };
+
+    for(frame = 0; frame < options.warmup + options.frames; frame++){
+        bool measured = frame >= options.warmup;
+        slot = frame % FRAMES_IN_FLIGHT;
+        if(frame == options.warmup && !options.trace.empty()){
+            cpuTraceStart();
+        }
+        TRACE_ZONE("frame");
+        auto frameStart = BenchClock::now();
+        double phases[PHASE_COUNT] = {};
+
+        auto start = BenchClock::now();
+        {
+            TRACE_ZONE("wait");
+            vkWaitForFences(device, 1, &fences[slot], VK_TRUE, UINT64_MAX);
+            collectSlot(slot);
+        }
+        phases[PHASE_WAIT] = millisecondsSince(start);
+
+        start = BenchClock::now();
+        scene.animate(frame);
+        phases[PHASE_ANIMATE] = millisecondsSince(start);
+        start = BenchClock::now();
+        scene.updateTransforms();
+        phases[PHASE_TRANSFORMS] = millisecondsSince(start);
+        start = BenchClock::now();
+        scene.cull(frame);
+        visibleCount = scene.visibleCount();
+        phases[PHASE_CULL] = millisecondsSince(start);
+
+        start = BenchClock::now();
+        scene.upload(reinterpret_cast<glm::mat4*>(static_cast<uint8_t*>(stagingData) + slot * instanceBytes));
+        if(!stagingCoherent){
+            //just what this frame wrote, not the other slots the GPU may still be reading
+            flushMappedRanges(device, stagingMemory, {{slot * instanceBytes, visibleCount * sizeof(glm::mat4)}},
+                deviceProperties.limits.nonCoherentAtomSize, stagingRequirements.size);
+        }
+        phases[PHASE_UPLOAD] = millisecondsSince(start);
+
+        start = BenchClock::now();
+        TRACE_ZONE("record and submit");
+        if(options.asyncCompute){
+            //the graph records and submits each queue's part itself, all of it counts as submit
+            vkResetFences(device, 1, &fences[slot]);
+            RenderGraphFrameSync sync;
+            sync.fence = fences[slot];
+            graph.submit(slot, sync);
+        }
+        else{
+            VkCommandBuffer cmd = commandBuffers[slot];
+            vkResetCommandBuffer(cmd, 0);
+            vkBeginCommandBuffer(cmd, &beginInfo);
+            profiler.beginFrame(cmd, slot);
+            graph.execute(cmd);
+            if(readback && frame % options.dumpEvery == 0){
+                std::string path = options.dumpDir + "/bench_" + std::to_string(frame) + ".qoi";
+                if(readback->capture(cmd, target, imageInfo.format, options.extent, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot, path)){
+                    results.dumpedFrames++;
+                }
+            }
+            vkEndCommandBuffer(cmd);
+            phases[PHASE_RECORD] = millisecondsSince(start);
+
+            start = BenchClock::now();
+            vkResetFences(device, 1, &fences[slot]);
+            submitInfo.pCommandBuffers = &cmd;
+            if(vkQueueSubmit(bench.queue, 1, &submitInfo, fences[slot]) != VK_SUCCESS){
+                throw std::runtime_error("failed to submit command buffer!");
+            }
+        }
+        slotFrame[slot] = frame;
+        phases[PHASE_SUBMIT] = millisecondsSince(start);
+        memoryBudget.update();
+
+        if(measured){
+            results.frameTimes.push_back(millisecondsSince(frameStart));
+            for(uint32_t phase = 0; phase < PHASE_COUNT; phase++){
+                results.phaseTimes[phase].push_back(phases[phase]);
+            }
+            results.visibleInstances += visibleCount;
+        }
+    }
+
+    vkDeviceWaitIdle(device);
+    for(uint32_t index = 0; index < FRAMES_IN_FLIGHT; index++){
+        collectSlot(index);
+    }
+    memoryBudget.update();
+    results.memoryHeaps = memoryBudget.heaps();
+    if(readback){
+        readback->waitIdle();
+        readback.reset();
+    }
+    if(profiler.enabled()){
+        std::cout << profiler.overlayText();
+    }
+    else{
+        std::cout << memoryBudget.overlayText();
+    }
+    if(!options.trace.empty()){
+        cpuTraceStop();
+        cpuTraceWrite(options.trace, &profiler.traceEvents());
+        std::cout << "trace written to " << options.trace << "\n";
+    }
+
+    graph.reset();
+    for(VkFence fence : fences){
+        vkDestroyFence(device, fence, nullptr);
+    }
+    vkDestroyCommandPool(device, commandPool, nullptr);
+    vkUnmapMemory(device, stagingMemory);
+    vkDestroyBuffer(device, staging, nullptr);
+    freeMemory(device, stagingMemory);
+    if(instanceBuffer != VK_NULL_HANDLE){
+        vkDestroyBuffer(device, instanceBuffer, nullptr);
+        freeMemory(device, instanceMemory);
+    }
+    vkDestroyImage(device, target, nullptr);
+    freeMemory(device, targetMemory);
+    setMemoryTracker(nullptr);
+}
+
+
+//JSON
+static void writeSummary(std::ostream& out, const Summary& summary){
+    out << "{\"mean\": " << summary.mean << ", \"p50\": " << summary.p50 << ", \"p90\": " << summary.p90
+        << ", \"p99\": " << summary.p99 << ", \"max\": " << summary.max << "}";
+}
+
+static std::string resultsJson(const BenchOptions& options, const BenchResults& results){
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(4);
+    out << "{\n";
+    out << "  \"device\": " << traceJsonString(results.device) << ",\n";
+    out << "  \"upload_mode\": " << traceJsonString(results.uploadMode) << ",\n";
+    out << "  \"queues\": " << traceJsonString(results.queues) << ",\n";
+    out << "  \"frames\": " << options.frames << ",\n";
+    out << "  \"warmup\": " << options.warmup << ",\n";
+    out << "  \"nodes\": " << options.nodes << ",\n";
+    out << "  \"seed\": " << options.seed << ",\n";
+    out << "  \"width\": " << options.extent.width << ",\n";
+    out << "  \"height\": " << options.extent.height << ",\n";
+    out << "  \"workers\": " << results.workers << ",\n";
+    out << "  \"visible_instances\": " << (results.frameTimes.empty() ? 0.0 : static_cast<double>(results.visibleInstances) / results.frameTimes.size()) << ",\n";
+    out << "  \"frame_ms\": ";
+    writeSummary(out, summarize(results.frameTimes));
+    out << ",\n  \"cpu_phases_ms\": {";
+    bool first = true;
+    for(uint32_t phase = 0; phase < PHASE_COUNT; phase++){
+        if(results.phaseTimes[phase].empty()){
+            continue;
+        }
+        out << (first ? "\n" : ",\n") << "    " << traceJsonString(phaseNames[phase]) << ": ";
+        writeSummary(out, summarize(results.phaseTimes[phase]));
+        first = false;
+    }
+    out << (first ? "}" : "\n  }") << ",\n  \"gpu_pass_overhead_ms\": {";
+    first = true;
+    for(const auto& [name, times] : results.passTimes){
+        out << (first ? "\n" : ",\n") << "    " << traceJsonString(name) << ": ";
+        writeSummary(out, summarize(times));
+        first = false;
+    }
+    out << (first ? "}" : "\n  }") << ",\n  \"microbench\": {";
+    for(size_t i = 0; i < results.microbench.size(); i++){
+        out << (i == 0 ? "\n" : ",\n") << "    " << traceJsonString(results.microbench[i].first) << ": " << results.microbench[i].second;
+    }
+    out << (results.microbench.empty() ? "}" : "\n  }");
+
+    //live bytes per category over all heaps, then per heap what the driver reports
+    if(!results.memoryHeaps.empty()){
+        constexpr double MB = 1024.0 * 1024.0;
+        out << ",\n  \"memory_mb\": {";
+        for(size_t category = 0; category < static_cast<size_t>(MemoryCategory::Count); category++){
+            VkDeviceSize bytes = 0;
+            for(const MemoryHeapStatus& heap : results.memoryHeaps){
+                bytes += heap.categories[category];
+            }
+            out << "\n    " << traceJsonString(memoryCategoryName(static_cast<MemoryCategory>(category))) << ": " << bytes / MB << ",";
+        }
+        out << "\n    \"heaps\": {";
+        for(size_t i = 0; i < results.memoryHeaps.size(); i++){
+            const MemoryHeapStatus& heap = results.memoryHeaps[i];
+            out << (i == 0 ? "\n" : ",\n") << "      \"" << i << "\": {\"device_local\": " << (heap.deviceLocal ? 1 : 0)
+                << ", \"budget\": " << heap.budget / MB << ", \"usage\": " << heap.usage / MB << ", \"tracked_peak\": " << heap.peakTracked / MB << "}";
+        }
+        out << "\n    }\n  }";
+    }
+    out << "\n}\n";
+    return out.str();
+}
+
+//just enough JSON to read back what resultsJson() writes: nested objects of numbers and strings,
+//flattened to "a.b.c" keys
+struct FlatJson{
+    std::map<std::string, double> numbers;
+    std::map<std::string, std::string> strings;
+};
+
+class FlatJsonParser{
+    public:
+    explicit FlatJsonParser(const std::string& text) : text(text){}
+
+    FlatJson parse(){
+        FlatJson json;
+        parseValue("", json);
+        skipSpace();
+        if(position != text.size()){
+            fail();
+        }
+        return json;
+    }
+
+    private:
+    const std::string& text;
+    size_t position = 0;
+
+    [[noreturn]] void fail(){
+        throw std::runtime_error("malformed benchmark JSON at offset " + std::to_string(position) + "!");
+    }
+    void skipSpace(){
+        while(position < text.size() && std::isspace(static_cast<unsigned char>(text[position]))){
+            position++;
+        }
+    }
+    void expect(char c){
+        skipSpace();
+        if(position >= text.size() || text[position] != c){
+            fail();
+        }
+        position++;
+    }
+    std::string parseString(){
+        expect('"');
+        std::string value;
+        while(position < text.size() && text[position] != '"'){
+            if(text[position] == '\\'){
+                position++;
+            }
+            if(position < text.size()){
+                value += text[position++];
+            }
+        }
+        expect('"');
+        return value;
+    }
+    void parseValue(const std::string& key, FlatJson& json){
+        skipSpace();
+        if(position >= text.size()){
+            fail();
+        }
+        if(text[position] == '{'){
+            position++;
+            skipSpace();
+            if(position < text.size() && text[position] == '}'){
+                position++;
+                return;
+            }
+            while(true){
+                std::string name = parseString();
+                expect(':');
+                parseValue(key.empty() ? name : key + "." + name, json);
+                skipSpace();
+                if(position >= text.size() || text[position] != ','){
+                    break;
+                }
+                position++;
+            }
+            expect('}');
+        }
+        else if(text[position] == '"'){
+            json.strings[key] = parseString();
+        }
+        else{
+            const char* begin = text.c_str() + position;
+            char* end;
+            double value = std::strtod(begin, &end);
+            if(end == begin){
+                fail();
+            }
+            position += end - begin;
+            json.numbers[key] = value;
+        }
+    }
+};
+
+//prints every metric next to the baseline, returns the number of regressions
+static uint32_t compareResults(const FlatJson& baseline, const FlatJson& current, double threshold){
+    for(const char* key : {"device", "upload_mode", "queues", "frames", "nodes", "seed", "width", "height", "workers"}){
+        auto baseString = baseline.strings.find(key);
+        auto currentString = current.strings.find(key);
+        auto baseNumber = baseline.numbers.find(key);
+        auto currentNumber = current.numbers.find(key);
+        bool differs = (baseString != baseline.strings.end() && (currentString == current.strings.end() || baseString->second != currentString->second)) ||
+            (baseNumber != baseline.numbers.end() && (currentNumber == current.numbers.end() || baseNumber->second != currentNumber->second));
+        if(differs){
+            std::cout << "warning: " << key << " differs from the baseline, numbers may not be comparable\n";
+        }
+    }
+
+    uint32_t regressions = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for(const auto& [key, base] : baseline.numbers){
+        bool metric = key.starts_with("frame_ms.") || key.starts_with("cpu_phases_ms.") || key.starts_with("gpu_pass_overhead_ms.") || key.starts_with("microbench.") ||
+            (key.starts_with("memory_mb.") && !key.starts_with("memory_mb.heaps."));
+        //a single outlier frame says nothing
+        if(!metric || key.ends_with(".max")){
+            continue;
+        }
+        auto found = current.numbers.find(key);
+        if(found == current.numbers.end()){
+            std::cout << "\t" << key << ": missing from this run\n";
+            continue;
+        }
+        double value = found->second;
+        double change = base != 0.0 ? (value - base) / base * 100.0 : 0.0;
+        double worse = key.ends_with("_per_s") ? -change : change;
+        const char* verdict = "";
+        if(worse > threshold){
+            verdict = "  REGRESSION";
+            regressions++;
+        }
+        else if(worse < -threshold){
+            verdict = "  improved";
+        }
+        std::cout << "\t" << key << ": " << base << " -> " << value << " (" << std::showpos << change << std::noshowpos << "%)" << verdict << "\n";
+    }
+    std::cout << std::defaultfloat;
+    return regressions;
+}
+
+
+static BenchOptions parseOptions(int argc, char** argv){
+    BenchOptions options;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg == "--frames" && hasValue){
+            options.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--warmup" && hasValue){
+            options.warmup = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--nodes" && hasValue){
+            options.nodes = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--seed" && hasValue){
+            options.seed = std::stoull(argv[++i]);
+        }
+        else if(arg == "--size" && hasValue){
+            std::string size = argv[++i];
+            size_t x = size.find('x');
+            if(x == std::string::npos){
+                throw std::runtime_error("--size takes WIDTHxHEIGHT!");
+            }
+            options.extent.width = static_cast<uint32_t>(std::stoul(size.substr(0, x)));
+            options.extent.height = static_cast<uint32_t>(std::stoul(size.substr(x + 1)));
+        }
+        else if(arg == "--out" && hasValue){
+            options.out = argv[++i];
+        }
+        else if(arg == "--compare" && hasValue){
+            options.compare = argv[++i];
+        }
+        else if(arg == "--threshold" && hasValue){
+            options.threshold = std::stod(argv[++i]);
+        }
+        else if(arg == "--dump" && hasValue){
+            options.dumpEvery = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if(arg == "--dump-dir" && hasValue){
+            options.dumpDir = argv[++i];
+        }
+        else if(arg == "--trace" && hasValue){
+            options.trace = argv[++i];
+        }
+        else if(arg == "--cpu-only"){
+            options.cpuOnly = true;
+        }
+        else if(arg == "--staging"){
+            options.staging = true;
+        }
+        else if(arg == "--async-compute"){
+            options.asyncCompute = true;
+        }
+        else{
+            throw std::runtime_error("unknown argument " + arg + "!");
+        }
+    }
+    if(options.frames == 0 || options.nodes == 0 || options.extent.width == 0 || options.extent.height == 0){
+        throw std::runtime_error("frames, nodes and size have to be non zero!");
+    }
+    if(options.asyncCompute && options.dumpEvery > 0){
+        //the readback is recorded after the graph into the frame's one command buffer, submit() has none
+        throw std::runtime_error("--dump doesn't work with --async-compute!");
+    }
+    #ifndef ENABLE_CPU_TRACE
+        if(!options.trace.empty()){
+            std::cerr << "built without TRACE=1, the trace only gets GPU zones\n";
+        }
+    #endif
+    return options;
+}
+
+int main(int argc, char** argv){
+    try{
+        BenchOptions options = parseOptions(argc, argv);
+        BenchResults results;
+
+        BenchRandom random{options.seed};
+        vertexPackBench(random, results);
+        transformBench(random, results);
+        copyBench(random, results);
+
+        JobSystem jobs;
+        results.workers = jobs.workerCount();
+        BenchScene scene(options, jobs);
+        BenchDevice bench;
+        if(!options.cpuOnly){
+            try{
+                bench = createBenchDevice();
+            }
+            catch(const std::exception& e){
+                std::cerr << "no usable Vulkan device(" << e.what() << "), running the CPU side only\n";
+            }
+        }
+        if(bench.device != VK_NULL_HANDLE){
+            results.device = bench.name;
+            std::cout << "Benchmarking on " << bench.name << "\n";
+            runGpu(options, bench, jobs, scene, results);
+            vkDestroyDevice(bench.device, nullptr);
+            vkDestroyInstance(bench.instance, nullptr);
+        }
+        else{
+            runCpuOnly(options, scene, results);
+        }
+
+        std::string json = resultsJson(options, results);
+        std::ofstream file(options.out);
+        if(!file.is_open()){
+            throw std::runtime_error("failed to open " + options.out + " for writing!");
+        }
+        file << json;
+        std::cout << json;
+        if(results.dumpedFrames > 0){
+            std::cout << results.dumpedFrames << " frames dumped to " << options.dumpDir << "\n";
+        }
+
+        if(!options.compare.empty()){
+            std::ifstream baselineFile(options.compare);
+            if(!baselineFile.is_open()){
+                throw std::runtime_error("failed to open baseline " + options.compare + "!");
+            }
+            std::stringstream baselineText;
+            baselineText << baselineFile.rdbuf();
+            std::cout << "Compared to " << options.compare << ":\n";
+            uint32_t regressions = compareResults(FlatJsonParser(baselineText.str()).parse(), FlatJsonParser(json).parse(), options.threshold);
+            if(regressions > 0){
+                std::cout << regressions << " metric" << (regressions > 1 ? "s" : "") << " regressed by more than " << options.threshold << "%\n";
+                return EXIT_FAILURE;
+            }
+            std::cout << "no regressions over " << options.threshold << "%\n";
+        }
+    }
+    catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
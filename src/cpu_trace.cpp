@@ -0,0 +1,177 @@
+#include <cpu_trace.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+
+//zones one thread can record per capture, 24 bytes each
+static constexpr uint32_t THREAD_CAPACITY = 1 << 16;
+
+struct CpuTraceRecord{
+    const char* name;
+    std::chrono::steady_clock::time_point begin;
+    std::chrono::steady_clock::time_point end;
+};
+
+//written by its own thread only, read by cpuTraceWrite() after the capture stopped
+struct CpuTraceBuffer{
+    std::unique_ptr<CpuTraceRecord[]> records{new CpuTraceRecord[THREAD_CAPACITY]};
+    std::atomic<uint32_t> count{0};
+    std::atomic<uint64_t> dropped{0};
+    uint32_t id = 0;
+    std::string threadName; //guarded by buffersMutex
+};
+
+static std::atomic<bool> traceRecording{false};
+static std::mutex buffersMutex;
+//never freed, a thread can exit before its zones are written
+static std::vector<CpuTraceBuffer*> buffers;
+static thread_local CpuTraceBuffer* threadBuffer = nullptr;
+
+static CpuTraceBuffer& currentBuffer(){
+    if(threadBuffer == nullptr){
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        threadBuffer = new CpuTraceBuffer();
+        threadBuffer->id = static_cast<uint32_t>(buffers.size());
+        threadBuffer->threadName = "thread " + std::to_string(threadBuffer->id);
+        buffers.push_back(threadBuffer);
+    }
+    return *threadBuffer;
+}
+
+
+void cpuTraceStart(){
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for(CpuTraceBuffer* buffer : buffers){
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->dropped.store(0, std::memory_order_relaxed);
+    }
+    traceRecording.store(true, std::memory_order_release);
+}
+void cpuTraceStop(){
+    traceRecording.store(false, std::memory_order_release);
+}
+bool cpuTraceActive(){
+    return traceRecording.load(std::memory_order_relaxed);
+}
+
+void cpuTraceSetThreadName(const char* name){
+    CpuTraceBuffer& buffer = currentBuffer();
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffer.threadName = name;
+}
+
+uint64_t cpuTraceDropped(){
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    uint64_t dropped = 0;
+    for(CpuTraceBuffer* buffer : buffers){
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+
+CpuTraceZone::CpuTraceZone(const char* name) : name(name), recording(traceRecording.load(std::memory_order_relaxed)){
+    if(recording){
+        currentBuffer();
+        begin = std::chrono::steady_clock::now();
+    }
+}
+CpuTraceZone::~CpuTraceZone(){
+    if(!recording){
+        return;
+    }
+    auto end = std::chrono::steady_clock::now();
+    CpuTraceBuffer& buffer = *threadBuffer;
+    if(!traceRecording.load(std::memory_order_relaxed)){
+        return;
+    }
+    //only this thread writes, the release store publishes the record to cpuTraceWrite()
+    uint32_t index = buffer.count.load(std::memory_order_relaxed);
+    if(index == THREAD_CAPACITY){
+        buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer.records[index] = {name, begin, end};
+    buffer.count.store(index + 1, std::memory_order_release);
+}
+
+
+std::string traceJsonString(const std::string& text){
+    static const char HEX[] = "0123456789abcdef";
+    std::string quoted = "\"";
+    for(unsigned char c : text){
+        if(c == '"' || c == '\\'){
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        }
+        else if(c == '\n'){
+            quoted += "\\n";
+        }
+        else if(c < 0x20){
+            //JSON forbids raw control characters inside strings
+            quoted += "\\u00";
+            quoted += HEX[c >> 4];
+            quoted += HEX[c & 0xf];
+        }
+        else{
+            quoted += static_cast<char>(c);
+        }
+    }
+    return quoted + "\"";
+}
+
+void cpuTraceWrite(const std::string& path, const std::vector<TraceEvent>* gpuEvents){
+    if(cpuTraceActive()){
+        throw std::runtime_error("cpu trace: stop the capture before writing it!");
+    }
+    std::ofstream file(path);
+    if(!file.is_open()){
+        throw std::runtime_error("failed to open trace file for writing!");
+    }
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    //everything relative to the earliest event so the numbers stay readable
+    double base = std::numeric_limits<double>::max();
+    for(CpuTraceBuffer* buffer : buffers){
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < count; i++){
+            base = std::min(base, traceClockUs(buffer->records[i].begin));
+        }
+    }
+    if(gpuEvents != nullptr){
+        for(const TraceEvent& event : *gpuEvents){
+            base = std::min(base, event.startUs);
+        }
+    }
+
+    //pid 1 holds one track per CPU thread, pid 2 the GPU queue
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"CPU\"}},\n";
+    file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 2, \"args\": {\"name\": \"GPU\"}},\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 2, \"tid\": 1, \"args\": {\"name\": \"queue\"}}";
+    for(CpuTraceBuffer* buffer : buffers){
+        file << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->id
+            << ", \"args\": {\"name\": " << traceJsonString(buffer->threadName) << "}}";
+        uint32_t count = buffer->count.load(std::memory_order_acquire);
+        for(uint32_t i = 0; i < count; i++){
+            const CpuTraceRecord& record = buffer->records[i];
+            double start = traceClockUs(record.begin);
+            file << ",\n{\"name\": " << traceJsonString(record.name) << ", \"cat\": \"cpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->id
+                << ", \"ts\": " << start - base << ", \"dur\": " << traceClockUs(record.end) - start << "}";
+        }
+    }
+    if(gpuEvents != nullptr){
+        for(const TraceEvent& event : *gpuEvents){
+            file << ",\n{\"name\": " << traceJsonString(event.name) << ", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 2, \"tid\": 1, \"ts\": "
+                << event.startUs - base << ", \"dur\": " << event.durationUs << "}";
+        }
+    }
+    file << "\n]}\n";
+    if(!file){
+        throw std::runtime_error("failed to write trace file!");
+    }
+}
@@ -0,0 +1,107 @@
+#include <debug_names.hpp>
+
+#ifndef NDEBUG
+
+#include <functional>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+
+struct DebugNameEntry{
+    VkObjectType type;
+    std::string name;
+};
+
+static std::mutex registryMutex;
+//handles get reused after destruction, naming the new object overwrites the stale entry
+static std::unordered_map<uint64_t, DebugNameEntry> registry;
+static VkDevice namedDevice = VK_NULL_HANDLE;
+static PFN_vkSetDebugUtilsObjectNameEXT setObjectName = nullptr;
+static PFN_vkCmdBeginDebugUtilsLabelEXT cmdBeginLabel = nullptr;
+static PFN_vkCmdEndDebugUtilsLabelEXT cmdEndLabel = nullptr;
+
+//called without registryMutex held, the validation layer may call back into debugNameOf() from inside
+static void applyName(PFN_vkSetDebugUtilsObjectNameEXT setName, VkDevice device, VkObjectType type, uint64_t handle, const std::string& name){
+    VkDebugUtilsObjectNameInfoEXT nameInfo{};
+    nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+    nameInfo.objectType = type;
+    nameInfo.objectHandle = handle;
+    nameInfo.pObjectName = name.c_str();
+    setName(device, &nameInfo);
+}
+
+
+void debugNamesInit(VkInstance instance, VkDevice device){
+    std::vector<std::pair<uint64_t, DebugNameEntry>> replay;
+    PFN_vkSetDebugUtilsObjectNameEXT setName;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        namedDevice = device;
+        setObjectName = nullptr;
+        cmdBeginLabel = nullptr;
+        cmdEndLabel = nullptr;
+        if(instance == VK_NULL_HANDLE || device == VK_NULL_HANDLE){
+            registry.clear();
+            return;
+        }
+        //null when VK_EXT_debug_utils isn't enabled on the instance
+        setObjectName = (PFN_vkSetDebugUtilsObjectNameEXT) vkGetInstanceProcAddr(instance, "vkSetDebugUtilsObjectNameEXT");
+        cmdBeginLabel = (PFN_vkCmdBeginDebugUtilsLabelEXT) vkGetInstanceProcAddr(instance, "vkCmdBeginDebugUtilsLabelEXT");
+        cmdEndLabel = (PFN_vkCmdEndDebugUtilsLabelEXT) vkGetInstanceProcAddr(instance, "vkCmdEndDebugUtilsLabelEXT");
+        setName = setObjectName;
+        if(setName == nullptr){
+            return;
+        }
+        replay.assign(registry.begin(), registry.end());
+    }
+    for(const auto& [handle, entry] : replay){
+        applyName(setName, device, entry.type, handle, entry.name);
+    }
+}
+
+void debugNameObject(VkDevice device, VkObjectType type, uint64_t handle, const std::string& name){
+    if(handle == 0){
+        return;
+    }
+    PFN_vkSetDebugUtilsObjectNameEXT setName;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry[handle] = {type, name};
+        setName = (device == namedDevice) ? setObjectName : nullptr;
+    }
+    if(setName != nullptr){
+        applyName(setName, device, type, handle, name);
+    }
+}
+
+std::string debugNameOf(uint64_t handle){
+    std::lock_guard<std::mutex> lock(registryMutex);
+    auto entry = registry.find(handle);
+    return entry == registry.end() ? std::string() : entry->second.name;
+}
+
+
+void debugLabelBegin(VkCommandBuffer cmd, const char* name){
+    if(cmdBeginLabel == nullptr){
+        return;
+    }
+    //stable color per name so the same pass looks the same in every capture
+    size_t hash = std::hash<std::string_view>{}(name);
+    VkDebugUtilsLabelEXT label{};
+    label.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT;
+    label.pLabelName = name;
+    label.color[0] = 0.4f + 0.6f * ((hash & 0xff) / 255.0f);
+    label.color[1] = 0.4f + 0.6f * (((hash >> 8) & 0xff) / 255.0f);
+    label.color[2] = 0.4f + 0.6f * (((hash >> 16) & 0xff) / 255.0f);
+    label.color[3] = 1.0f;
+    cmdBeginLabel(cmd, &label);
+}
+void debugLabelEnd(VkCommandBuffer cmd){
+    if(cmdEndLabel != nullptr){
+        cmdEndLabel(cmd);
+    }
+}
+
+#endif
@@ -0,0 +1,200 @@
+#include <debug_report.hpp>
+#include <debug_names.hpp>
+#include <cpu_trace.hpp>
+
+#include <vulkan/vk_enum_string_helper.h>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <execinfo.h>
+#endif
+
+
+std::string debugMessageTypeString(VkDebugUtilsMessageTypeFlagsEXT types){
+    static const std::pair<VkDebugUtilsMessageTypeFlagBitsEXT, const char*> names[] = {
+        {VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT, "GENERAL"},
+        {VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT, "VALIDATION"},
+        {VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT, "PERFORMANCE"},
+        {VK_DEBUG_UTILS_MESSAGE_TYPE_DEVICE_ADDRESS_BINDING_BIT_EXT, "DEVICE_ADDRESS_BINDING"}
+    };
+    std::string result;
+    for(const auto& [bit, name] : names){
+        if(types & bit){
+            result += (result.empty() ? "" : "|") + std::string(name);
+            types &= ~bit;
+        }
+    }
+    //bits newer than this code
+    if(types != 0 || result.empty()){
+        std::ostringstream unknown;
+        unknown << "0x" << std::hex << types;
+        result += (result.empty() ? "" : "|") + unknown.str();
+    }
+    return result;
+}
+
+std::string debugSeverityString(VkDebugUtilsMessageSeverityFlagBitsEXT severity){
+    switch(severity){
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT:
+            return "VERBOSE";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT:
+            return "INFO";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT:
+            return "WARNING";
+        case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
+            return "ERROR";
+        default:
+            return "UNKNOWN";
+    }
+}
+
+std::vector<std::string> captureStackTrace(uint32_t skip, uint32_t maxFrames){
+    std::vector<void*> frames(maxFrames + skip + 1);
+    std::vector<std::string> result;
+    //+1 for this function
+    #ifdef _WIN32
+        uint32_t count = CaptureStackBackTrace(0, static_cast<DWORD>(frames.size()), frames.data(), nullptr);
+        for(uint32_t i = skip + 1; i < count; i++){
+            std::ostringstream frame;
+            frame << frames[i];
+            result.push_back(frame.str());
+        }
+    #else
+        int count = backtrace(frames.data(), static_cast<int>(frames.size()));
+        char** symbols = backtrace_symbols(frames.data(), count);
+        for(int i = static_cast<int>(skip) + 1; i < count; i++){
+            if(symbols != nullptr){
+                result.push_back(symbols[i]);
+            }
+            else{
+                std::ostringstream frame;
+                frame << frames[i];
+                result.push_back(frame.str());
+            }
+        }
+        free(symbols);
+    #endif
+    return result;
+}
+
+
+bool DebugReport::record(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* data){
+    std::lock_guard<std::mutex> lock(mutex);
+    if(types & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT){
+        performanceSeen = true;
+    }
+    auto key = std::make_tuple(types, severity, data->messageIdNumber);
+    auto found = bucketIndex.find(key);
+    if(found != bucketIndex.end()){
+        bucketList[found->second].count++;
+        return false;
+    }
+
+    DebugMessageBucket bucket;
+    bucket.types = types;
+    bucket.severity = severity;
+    bucket.messageId = data->messageIdNumber;
+    bucket.messageIdName = (data->pMessageIdName != nullptr) ? data->pMessageIdName : "";
+    bucket.count = 1;
+    bucket.message = (data->pMessage != nullptr) ? data->pMessage : "";
+    for(uint32_t i = 0; i < data->objectCount; i++){
+        const VkDebugUtilsObjectNameInfoEXT& object = data->pObjects[i];
+        std::ostringstream line;
+        line << string_VkObjectType(object.objectType) << " 0x" << std::hex << object.objectHandle;
+        if(object.pObjectName != nullptr){
+            line << " " << object.pObjectName;
+        }
+        #ifndef NDEBUG
+            else if(std::string name = debugNameOf(object.objectHandle); !name.empty()){
+                line << " " << name;
+            }
+        #endif
+        bucket.objects.push_back(line.str());
+    }
+    //skips record() and the messenger callback, the first frame left is inside the layer
+    bucket.stack = captureStackTrace(2);
+    bucketIndex[key] = bucketList.size();
+    bucketList.push_back(std::move(bucket));
+    return true;
+}
+
+uint64_t DebugReport::count(VkDebugUtilsMessageTypeFlagsEXT types, VkDebugUtilsMessageSeverityFlagBitsEXT minimumSeverity) const{
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t total = 0;
+    for(const DebugMessageBucket& bucket : bucketList){
+        if((bucket.types & types) && bucket.severity >= minimumSeverity){
+            total += bucket.count;
+        }
+    }
+    return total;
+}
+
+bool DebugReport::failed() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return failOnPerformance && performanceSeen;
+}
+
+std::vector<DebugMessageBucket> DebugReport::buckets() const{
+    std::vector<DebugMessageBucket> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        sorted = bucketList;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const DebugMessageBucket& a, const DebugMessageBucket& b){
+        return a.count > b.count;
+    });
+    return sorted;
+}
+
+std::string DebugReport::summary() const{
+    std::ostringstream out;
+    for(const DebugMessageBucket& bucket : buckets()){
+        out << bucket.count << " x " << debugSeverityString(bucket.severity) << " " << debugMessageTypeString(bucket.types)
+            << " " << bucket.messageId << " " << bucket.messageIdName << "\n";
+    }
+    return out.str();
+}
+
+
+static void writeStringArray(std::ostream& out, const std::vector<std::string>& strings){
+    out << "[";
+    for(size_t i = 0; i < strings.size(); i++){
+        out << (i == 0 ? "" : ", ") << traceJsonString(strings[i]);
+    }
+    out << "]";
+}
+
+void DebugReport::writeJson(const std::string& path) const{
+    std::ofstream file(path);
+    if(!file.is_open()){
+        throw std::runtime_error("failed to open debug report for writing!");
+    }
+    std::vector<DebugMessageBucket> sorted = buckets();
+    file << "{\n  \"failed\": " << (failed() ? "true" : "false") << ",\n  \"messages\": [";
+    for(size_t i = 0; i < sorted.size(); i++){
+        const DebugMessageBucket& bucket = sorted[i];
+        file << (i == 0 ? "\n" : ",\n") << "    {\n";
+        file << "      \"severity\": " << traceJsonString(debugSeverityString(bucket.severity)) << ",\n";
+        file << "      \"types\": " << traceJsonString(debugMessageTypeString(bucket.types)) << ",\n";
+        file << "      \"message_id\": " << bucket.messageId << ",\n";
+        file << "      \"message_id_name\": " << traceJsonString(bucket.messageIdName) << ",\n";
+        file << "      \"count\": " << bucket.count << ",\n";
+        file << "      \"first_message\": " << traceJsonString(bucket.message) << ",\n";
+        file << "      \"objects\": ";
+        writeStringArray(file, bucket.objects);
+        file << ",\n      \"first_stack\": ";
+        writeStringArray(file, bucket.stack);
+        file << "\n    }";
+    }
+    file << (sorted.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    if(!file){
+        throw std::runtime_error("failed to write debug report!");
+    }
+}
@@ -0,0 +1,255 @@
+#include <device_selection.hpp>
+#include <gpu_memory.hpp>
+
+#include <cctype>
+#include <charconv>
+
+
+bool deviceSupportsExtension(VkPhysicalDevice device, const char* extensionName){
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &count, extensions.data());
+    for(const auto& extension : extensions){
+        if(strcmp(extension.extensionName, extensionName) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string lowercase(std::string text){
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){
+        return static_cast<char>(std::tolower(c));
+    });
+    return text;
+}
+
+static std::string versionString(uint32_t version){
+    return std::to_string(VK_API_VERSION_MAJOR(version)) + "." + std::to_string(VK_API_VERSION_MINOR(version));
+}
+
+static DeviceRating rateDevice(VkPhysicalDevice device, uint32_t index, const DeviceRequirements& requirements, const DevicePreferences& preferences){
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    DeviceRating rating;
+    rating.device = device;
+    rating.index = index;
+    rating.name = properties.deviceName;
+    rating.type = properties.deviceType;
+
+    //requirements first, an unsuitable device gets no score
+    if(properties.apiVersion < requirements.apiVersion){
+        rating.rejection = "Vulkan " + versionString(properties.apiVersion) + ", needs " + versionString(requirements.apiVersion);
+        return rating;
+    }
+    for(const char* extension : requirements.extensions){
+        if(!deviceSupportsExtension(device, extension)){
+            rating.rejection = std::string("no ") + extension;
+            return rating;
+        }
+    }
+    if(requirements.check){
+        rating.rejection = requirements.check(device);
+        if(!rating.rejection.empty()){
+            return rating;
+        }
+    }
+    rating.suitable = true;
+
+    auto add = [&](const std::string& what, int weight){
+        if(weight == 0){
+            return;
+        }
+        rating.score += weight;
+        rating.breakdown += (rating.breakdown.empty() ? "" : ", ") + what + " " + std::to_string(weight);
+    };
+    switch(properties.deviceType){
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+            add("discrete", preferences.discrete);
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+            add("integrated", preferences.integrated);
+            break;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+            add("virtual", preferences.virtualGpu);
+            break;
+        default:
+            break;
+    }
+
+    //integrated GPUs and CPU implementations report system memory as device local(and host visible), neither counts there
+    if(properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU){
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(device, &memoryProperties);
+        VkDeviceSize vram = 0;
+        for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++){
+            if(memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT){
+                vram = std::max(vram, memoryProperties.memoryHeaps[i].size);
+            }
+        }
+        uint32_t vramGiB = std::min(static_cast<uint32_t>(vram >> 30), preferences.maxVramGiB);
+        add("vram " + std::to_string(vramGiB) + " GiB", static_cast<int>(vramGiB) * preferences.perVramGiB);
+        if(findDirectWriteHeap(device).large){
+            add("direct write heap", preferences.directWriteHeap);
+        }
+    }
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+    bool dedicatedTransfer = false;
+    bool dedicatedCompute = false;
+    for(const auto& family : families){
+        dedicatedTransfer |= (family.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
+        dedicatedCompute |= (family.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT);
+    }
+    if(dedicatedTransfer){
+        add("transfer queue", preferences.dedicatedTransferQueue);
+    }
+    if(dedicatedCompute){
+        add("compute queue", preferences.dedicatedComputeQueue);
+    }
+
+    //the requirement already guarantees the major version is at least the required one
+    if(VK_API_VERSION_MAJOR(properties.apiVersion) == VK_API_VERSION_MAJOR(requirements.apiVersion)){
+        int minorVersions = static_cast<int>(VK_API_VERSION_MINOR(properties.apiVersion)) - static_cast<int>(VK_API_VERSION_MINOR(requirements.apiVersion));
+        add("Vulkan " + versionString(properties.apiVersion), minorVersions * preferences.perApiMinorVersion);
+    }
+    for(const auto& [extension, weight] : preferences.extensions){
+        if(deviceSupportsExtension(device, extension)){
+            add(extension, weight);
+        }
+    }
+    return rating;
+}
+
+std::vector<DeviceRating> rateDevices(VkInstance instance, const DeviceRequirements& requirements, const DevicePreferences& preferences){
+    uint32_t deviceCount = 0;
+    vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    std::vector<DeviceRating> ratings;
+    for(uint32_t i = 0; i < deviceCount; i++){
+        ratings.push_back(rateDevice(devices[i], i, requirements, preferences));
+    }
+    return ratings;
+}
+
+DeviceRating selectPhysicalDevice(VkInstance instance, const DeviceRequirements& requirements, const DevicePreferences& preferences, std::ostream* log){
+    std::vector<DeviceRating> ratings = rateDevices(instance, requirements, preferences);
+    if(log != nullptr){
+        for(const DeviceRating& rating : ratings){
+            *log << "\t[" << rating.index << "] " << rating.name;
+            if(rating.suitable){
+                *log << " | score: " << rating.score << " (" << rating.breakdown << ")\n";
+            }
+            else{
+                *log << " | unsuitable: " << rating.rejection << "\n";
+            }
+        }
+    }
+
+    const char* forced = std::getenv(DEVICE_OVERRIDE_ENV);
+    if(forced != nullptr && forced[0] != '\0'){
+        std::string wanted = forced;
+        bool isIndex = std::all_of(wanted.begin(), wanted.end(), [](unsigned char c){
+            return std::isdigit(c);
+        });
+        //parsed once, an index too big for uint32_t can't be any device's
+        uint32_t wantedIndex = 0;
+        if(isIndex && std::from_chars(wanted.data(), wanted.data() + wanted.size(), wantedIndex).ec != std::errc()){
+            throw std::runtime_error(DEVICE_OVERRIDE_ENV "=" + wanted + " matches no device!");
+        }
+        for(const DeviceRating& rating : ratings){
+            bool matches = isIndex ? rating.index == wantedIndex : lowercase(rating.name).find(lowercase(wanted)) != std::string::npos;
+            if(!matches){
+                continue;
+            }
+            if(!rating.suitable){
+                throw std::runtime_error(DEVICE_OVERRIDE_ENV "=" + wanted + " picks " + rating.name + ", which is unsuitable: " + rating.rejection + "!");
+            }
+            if(log != nullptr){
+                *log << "\t" DEVICE_OVERRIDE_ENV " forces [" << rating.index << "]\n";
+            }
+            return rating;
+        }
+        throw std::runtime_error(DEVICE_OVERRIDE_ENV "=" + wanted + " matches no device!");
+    }
+
+    const DeviceRating* best = nullptr;
+    for(const DeviceRating& rating : ratings){
+        if(rating.suitable && (best == nullptr || rating.score > best->score)){
+            best = &rating;
+        }
+    }
+    if(best == nullptr){
+        throw std::runtime_error("failed to find a suitable GPU!");
+    }
+    return *best;
+}
+
+
+std::vector<VkDeviceQueueCreateInfo> DeviceQueuePlan::createInfos() const{
+    std::vector<VkDeviceQueueCreateInfo> infos;
+    for(const auto& [family, priorities] : families){
+        VkDeviceQueueCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        info.queueFamilyIndex = family;
+        info.queueCount = static_cast<uint32_t>(priorities.size());
+        info.pQueuePriorities = priorities.data();
+        infos.push_back(info);
+    }
+    return infos;
+}
+
+DeviceQueuePlan planDeviceQueues(VkPhysicalDevice device, uint32_t graphicsFamily, uint32_t presentFamily, bool asyncCompute){
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &familyCount, families.data());
+
+    DeviceQueuePlan plan;
+    //next queue of family with priority, or its last one again when the family has no more
+    auto request = [&](uint32_t family, float priority) -> DeviceQueue{
+        auto planned = std::find_if(plan.families.begin(), plan.families.end(), [&](const auto& entry){
+            return entry.first == family;
+        });
+        if(planned == plan.families.end()){
+            plan.families.push_back({family, {priority}});
+            return {family, 0};
+        }
+        if(planned->second.size() < families[family].queueCount){
+            planned->second.push_back(priority);
+        }
+        return {family, static_cast<uint32_t>(planned->second.size() - 1)};
+    };
+
+    plan.graphics = request(graphicsFamily, 1.0f);
+
+    uint32_t computeFamily = UINT32_MAX;
+    for(uint32_t family = 0; asyncCompute && family < familyCount; family++){
+        if((families[family].queueFlags & VK_QUEUE_COMPUTE_BIT) && !(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)){
+            computeFamily = family;
+            break;
+        }
+    }
+    if(computeFamily != UINT32_MAX){
+        plan.asyncCompute = request(computeFamily, 0.5f);
+    }
+    else if(asyncCompute && families[graphicsFamily].queueCount > 1){
+        plan.asyncCompute = request(graphicsFamily, 0.5f);
+    }
+
+    if(presentFamily == UINT32_MAX || presentFamily == graphicsFamily){
+        plan.present = (presentFamily == UINT32_MAX) ? DeviceQueue{} : plan.graphics;
+    }
+    else if(presentFamily == plan.asyncCompute.family){
+        plan.present = plan.asyncCompute;
+    }
+    else{
+        plan.present = request(presentFamily, 1.0f);
+    }
+    return plan;
+}
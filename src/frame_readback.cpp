@@ -0,0 +1,196 @@
+#include <frame_readback.hpp>
+#include <gpu_memory.hpp>
+#include <cpu_trace.hpp>
+#include <debug_names.hpp>
+
+
+FrameReadback::FrameReadback(VkDevice device, VkPhysicalDevice physicalDevice, JobSystem& jobs, uint32_t slotCount, VkExtent2D maxExtent)
+    : device(device), jobs(jobs), maxExtent(maxExtent), slots(slotCount){
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+    //slots start atom aligned so each one can be invalidated on its own
+    slotSize = static_cast<VkDeviceSize>(maxExtent.width) * maxExtent.height * 4;
+    slotSize = (slotSize + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = slotSize * slotCount;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
+        throw std::runtime_error("failed to create readback buffer!");
+    }
+    DEBUG_NAME(device, buffer, "frame readback");
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    //uncached reads of a whole frame are painfully slow
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    if(allocateMemory(device, allocInfo, MemoryCategory::Readback, &memory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate readback memory!");
+    }
+    DEBUG_NAME(device, memory, "frame readback");
+    vkBindBufferMemory(device, buffer, memory, 0);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    coherent = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    void* data;
+    if(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS){
+        throw std::runtime_error("failed to map readback memory!");
+    }
+    mapped = static_cast<const uint8_t*>(data);
+}
+FrameReadback::~FrameReadback(){
+    //jobs read straight from the mapping
+    jobs.wait(encodeCounter);
+    vkUnmapMemory(device, memory);
+    vkDestroyBuffer(device, buffer, nullptr);
+    freeMemory(device, memory);
+}
+
+
+bool FrameReadback::capture(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, uint32_t frameIndex, ReadbackCallback callback){
+    bool swizzle;
+    switch(format){
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            swizzle = false;
+            break;
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+            swizzle = true;
+            break;
+        default:
+            throw std::runtime_error("readback only supports 8 bit RGBA/BGRA images!");
+    }
+    if(extent.width > maxExtent.width || extent.height > maxExtent.height){
+        throw std::runtime_error("readback image is bigger than the readback slots!");
+    }
+    if(layout == VK_IMAGE_LAYOUT_UNDEFINED){
+        throw std::runtime_error("readback image has no defined contents!");
+    }
+
+    uint32_t index = 0;
+    while(index < slots.size() && slots[index].busy.load(std::memory_order_acquire)){
+        index++;
+    }
+    if(index == slots.size()){
+        dropped++;
+        return false;
+    }
+    Slot& slot = slots[index];
+    slot.busy.store(true, std::memory_order_relaxed);
+    slot.pending = true;
+    slot.frameIndex = frameIndex;
+    slot.extent = extent;
+    slot.swizzle = swizzle;
+    slot.callback = std::move(callback);
+
+    //whatever wrote the image before, the copy waits for all of it
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = layout;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = index * slotSize;
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent = {extent.width, extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+    //image back to where it was(present, sampling...), buffer to the host
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = layout;
+    VkBufferMemoryBarrier bufferBarrier{};
+    bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bufferBarrier.buffer = buffer;
+    bufferBarrier.offset = region.bufferOffset;
+    bufferBarrier.size = slotSize;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 1, &bufferBarrier, 1, &barrier);
+    return true;
+}
+
+bool FrameReadback::capture(VkCommandBuffer cmd, VkImage image, VkFormat format, VkExtent2D extent, VkImageLayout layout, uint32_t frameIndex, const std::string& path){
+    return capture(cmd, image, format, extent, layout, frameIndex, [path](RGBAImage&& pixels){
+        try{
+            writeImage(path, pixels);
+        }
+        catch(const std::exception& e){
+            //nobody to rethrow to on a worker
+            std::cerr << "failed to save " << path << ": " << e.what() << "\n";
+        }
+    });
+}
+
+
+void FrameReadback::collect(uint32_t frameIndex){
+    TRACE_ZONE("FrameReadback::collect");
+    for(uint32_t index = 0; index < slots.size(); index++){
+        Slot& slot = slots[index];
+        if(!slot.pending || slot.frameIndex != frameIndex){
+            continue;
+        }
+        slot.pending = false;
+        captured++;
+        if(!coherent){
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = memory;
+            range.offset = index * slotSize;
+            range.size = slotSize;
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+        //the job copies the pixels out and frees the slot before the slow part(encoding, disk)
+        jobs.run("readback encode", [this, index](){
+            Slot& slot = slots[index];
+            RGBAImage image;
+            image.width = slot.extent.width;
+            image.height = slot.extent.height;
+            const uint8_t* source = mapped + index * slotSize;
+            image.pixels.assign(source, source + static_cast<size_t>(image.width) * image.height * 4);
+            ReadbackCallback callback = std::move(slot.callback);
+            bool swizzle = slot.swizzle;
+            slot.busy.store(false, std::memory_order_release);
+
+            if(swizzle){
+                for(size_t i = 0; i < image.pixels.size(); i += 4){
+                    std::swap(image.pixels[i], image.pixels[i + 2]);
+                }
+            }
+            callback(std::move(image));
+        }, &encodeCounter, JobPriority::Low);
+    }
+}
+
+void FrameReadback::waitIdle(){
+    jobs.wait(encodeCounter);
+}
+
+FrameReadbackStats FrameReadback::stats() const{
+    FrameReadbackStats s;
+    s.captured = captured;
+    s.dropped = dropped;
+    for(const Slot& slot : slots){
+        s.slotsInFlight += slot.pending ? 1 : 0;
+    }
+    return s;
+}
@@ -0,0 +1,428 @@
+#include <gpu_memory.hpp>
+#include <debug_names.hpp>
+
+#include <bit>
+#include <iomanip>
+#include <sstream>
+
+
+uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    return findMemoryType(memoryProperties, typeBits, required, preferred);
+}
+
+uint32_t findMemoryType(const VkPhysicalDeviceMemoryProperties& memoryProperties, uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred){
+    //a type with only some of the preferred flags(HOST_COHERENT without DEVICE_LOCAL) still beats one with none
+    uint32_t best = UINT32_MAX;
+    int bestScore = -1;
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++){
+        VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if(!(typeBits & (1u << i)) || (flags & required) != required){
+            continue;
+        }
+        int score = std::popcount(flags & preferred);
+        if(score > bestScore){
+            best = i;
+            bestScore = score;
+        }
+    }
+    if(best == UINT32_MAX){
+        throw std::runtime_error("failed to find a suitable memory type!");
+    }
+    return best;
+}
+
+//the legacy BAR window, anything bigger means resizable BAR or shared memory
+static constexpr VkDeviceSize LEGACY_BAR_SIZE = 256ull << 20;
+
+DirectWriteHeap findDirectWriteHeap(VkPhysicalDevice physicalDevice){
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    constexpr VkMemoryPropertyFlags direct = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    DirectWriteHeap result;
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++){
+        const VkMemoryType& type = memoryProperties.memoryTypes[i];
+        if((type.propertyFlags & direct) == direct && memoryProperties.memoryHeaps[type.heapIndex].size > result.size){
+            result.heapIndex = type.heapIndex;
+            result.size = memoryProperties.memoryHeaps[type.heapIndex].size;
+        }
+    }
+    result.large = result.size > LEGACY_BAR_SIZE;
+    return result;
+}
+
+static PFN_vkGetPhysicalDeviceMemoryProperties2 loadMemoryProperties2(VkInstance instance){
+    //core in 1.1, the instance may be 1.0 with VK_KHR_get_physical_device_properties2
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2");
+    if(getProperties2 == nullptr){
+        getProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+    }
+    return getProperties2;
+}
+
+bool memoryBudgetSupported(VkPhysicalDevice physicalDevice){
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    for(const auto& extension : extensions){
+        if(strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+//properties receives the plain memory properties when not null
+static std::vector<MemoryHeapBudget> readMemoryBudget(PFN_vkGetPhysicalDeviceMemoryProperties2 getProperties2, VkPhysicalDevice physicalDevice, bool hasBudget,
+    VkPhysicalDeviceMemoryProperties* properties = nullptr){
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    properties2.pNext = (hasBudget && getProperties2) ? &budgetProperties : nullptr;
+    if(getProperties2){
+        getProperties2(physicalDevice, &properties2);
+    }
+    else{
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &properties2.memoryProperties);
+    }
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = properties2.memoryProperties;
+    std::vector<MemoryHeapBudget> heaps(memoryProperties.memoryHeapCount);
+    for(uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++){
+        heaps[i].deviceLocal = memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        if(properties2.pNext){
+            heaps[i].budget = budgetProperties.heapBudget[i];
+            heaps[i].usage = budgetProperties.heapUsage[i];
+        }
+        else{
+            heaps[i].budget = memoryProperties.memoryHeaps[i].size;
+        }
+    }
+    if(properties != nullptr){
+        *properties = memoryProperties;
+    }
+    return heaps;
+}
+
+std::vector<MemoryHeapBudget> queryMemoryBudget(VkInstance instance, VkPhysicalDevice physicalDevice){
+    return readMemoryBudget(loadMemoryProperties2(instance), physicalDevice, memoryBudgetSupported(physicalDevice));
+}
+
+VkDeviceSize availableDeviceLocalMemory(VkInstance instance, VkPhysicalDevice physicalDevice){
+    VkDeviceSize best = 0;
+    VkDeviceSize available = 0;
+    for(const auto& heap : queryMemoryBudget(instance, physicalDevice)){
+        if(heap.deviceLocal && heap.budget > best){
+            best = heap.budget;
+            available = (heap.budget > heap.usage) ? heap.budget - heap.usage : 0;
+        }
+    }
+    return available;
+}
+
+
+const char* memoryCategoryName(MemoryCategory category){
+    switch(category){
+        case MemoryCategory::Texture:
+            return "texture";
+        case MemoryCategory::Mesh:
+            return "mesh";
+        case MemoryCategory::RenderTarget:
+            return "render_target";
+        case MemoryCategory::Staging:
+            return "staging";
+        case MemoryCategory::Uniform:
+            return "uniform";
+        case MemoryCategory::Readback:
+            return "readback";
+        default:
+            return "other";
+    }
+}
+
+//a watermark that fired only re-arms once usage is this far below it, stops flapping right at the line
+static constexpr float WATERMARK_HYSTERESIS = 0.02f;
+
+MemoryBudgetTracker::MemoryBudgetTracker(VkInstance instance, VkPhysicalDevice physicalDevice)
+    : getProperties2(loadMemoryProperties2(instance)), physicalDevice(physicalDevice), hasBudget(memoryBudgetSupported(physicalDevice)){
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    std::vector<MemoryHeapBudget> budgets = readMemoryBudget(getProperties2, physicalDevice, hasBudget, &memoryProperties);
+    for(uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++){
+        typeHeap.push_back(memoryProperties.memoryTypes[i].heapIndex);
+    }
+    status.resize(budgets.size());
+    for(size_t i = 0; i < budgets.size(); i++){
+        status[i].size = memoryProperties.memoryHeaps[i].size;
+        status[i].budget = budgets[i].budget;
+        status[i].usage = budgets[i].usage;
+        status[i].deviceLocal = budgets[i].deviceLocal;
+    }
+}
+
+void MemoryBudgetTracker::allocated(VkDeviceMemory memory, uint32_t memoryTypeIndex, VkDeviceSize size, MemoryCategory category){
+    std::lock_guard<std::mutex> lock(mutex);
+    uint32_t heap = typeHeap.at(memoryTypeIndex);
+    allocations[memory] = {heap, size, category};
+    MemoryHeapStatus& heapStatus = status[heap];
+    heapStatus.tracked += size;
+    heapStatus.peakTracked = std::max(heapStatus.peakTracked, heapStatus.tracked);
+    heapStatus.categories[static_cast<size_t>(category)] += size;
+    heapStatus.allocations++;
+}
+
+void MemoryBudgetTracker::freed(VkDeviceMemory memory){
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = allocations.find(memory);
+    if(found == allocations.end()){
+        return;
+    }
+    const Allocation& allocation = found->second;
+    MemoryHeapStatus& heapStatus = status[allocation.heap];
+    heapStatus.tracked -= allocation.size;
+    heapStatus.categories[static_cast<size_t>(allocation.category)] -= allocation.size;
+    heapStatus.allocations--;
+    allocations.erase(found);
+}
+
+void MemoryBudgetTracker::update(){
+    //one driver call, VK_EXT_memory_budget is specified to be cheap enough for every frame
+    std::vector<MemoryHeapBudget> budgets = readMemoryBudget(getProperties2, physicalDevice, hasBudget);
+
+    struct Crossing{
+        MemoryWatermarkCallback callback; //copied, a callback may add watermarks
+        uint32_t heap;
+        MemoryHeapStatus status;
+        bool above;
+    };
+    std::vector<Crossing> crossings;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for(size_t i = 0; i < budgets.size(); i++){
+            status[i].budget = budgets[i].budget;
+            //the driver's number also counts what isn't tracked(swapchain images, driver internals)
+            status[i].usage = hasBudget ? budgets[i].usage : status[i].tracked;
+        }
+        for(Watermark& watermark : watermarks){
+            for(uint32_t heap = 0; heap < status.size(); heap++){
+                const MemoryHeapStatus& heapStatus = status[heap];
+                if((watermark.deviceLocalOnly && !heapStatus.deviceLocal) || heapStatus.budget == 0){
+                    continue;
+                }
+                float used = static_cast<float>(static_cast<double>(heapStatus.usage) / heapStatus.budget);
+                if(!watermark.above[heap] && used >= watermark.fraction){
+                    watermark.above[heap] = true;
+                    crossings.push_back({watermark.callback, heap, heapStatus, true});
+                }
+                else if(watermark.above[heap] && used < watermark.fraction - WATERMARK_HYSTERESIS){
+                    watermark.above[heap] = false;
+                    crossings.push_back({watermark.callback, heap, heapStatus, false});
+                }
+            }
+        }
+    }
+    //outside the lock, callbacks usually free memory
+    for(const Crossing& crossing : crossings){
+        crossing.callback(crossing.heap, crossing.status, crossing.above);
+    }
+}
+
+void MemoryBudgetTracker::addWatermark(float fraction, MemoryWatermarkCallback callback, bool deviceLocalOnly){
+    std::lock_guard<std::mutex> lock(mutex);
+    watermarks.push_back({fraction, std::move(callback), deviceLocalOnly, std::vector<bool>(status.size(), false)});
+}
+
+std::vector<MemoryHeapStatus> MemoryBudgetTracker::heaps() const{
+    std::lock_guard<std::mutex> lock(mutex);
+    return status;
+}
+
+std::string MemoryBudgetTracker::overlayText() const{
+    std::vector<MemoryHeapStatus> snapshot = heaps();
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    auto megabytes = [](VkDeviceSize bytes){
+        return static_cast<double>(bytes) / (1024.0 * 1024.0);
+    };
+    for(size_t heap = 0; heap < snapshot.size(); heap++){
+        const MemoryHeapStatus& heapStatus = snapshot[heap];
+        //host heaps nobody allocated from are noise
+        if(!heapStatus.deviceLocal && heapStatus.tracked == 0){
+            continue;
+        }
+        out << "heap " << heap << (heapStatus.deviceLocal ? "(device local)" : "(host)") << ": " << megabytes(heapStatus.usage)
+            << "/" << megabytes(heapStatus.budget) << " MB, tracked " << megabytes(heapStatus.tracked)
+            << " MB(peak " << megabytes(heapStatus.peakTracked) << ") in " << heapStatus.allocations << " allocations\n";
+        for(size_t category = 0; category < static_cast<size_t>(MemoryCategory::Count); category++){
+            if(heapStatus.categories[category] > 0){
+                out << "  " << memoryCategoryName(static_cast<MemoryCategory>(category)) << " " << megabytes(heapStatus.categories[category]) << " MB\n";
+            }
+        }
+    }
+    return out.str();
+}
+
+
+static std::atomic<MemoryBudgetTracker*> currentTracker{nullptr};
+
+void setMemoryTracker(MemoryBudgetTracker* tracker){
+    currentTracker.store(tracker, std::memory_order_release);
+}
+MemoryBudgetTracker* memoryTracker(){
+    return currentTracker.load(std::memory_order_acquire);
+}
+
+VkResult allocateMemory(VkDevice device, const VkMemoryAllocateInfo& allocInfo, MemoryCategory category, VkDeviceMemory* memory){
+    VkResult result = vkAllocateMemory(device, &allocInfo, nullptr, memory);
+    MemoryBudgetTracker* tracker = memoryTracker();
+    if(result == VK_SUCCESS && tracker != nullptr){
+        tracker->allocated(*memory, allocInfo.memoryTypeIndex, allocInfo.allocationSize, category);
+    }
+    return result;
+}
+
+void freeMemory(VkDevice device, VkDeviceMemory memory){
+    if(memory == VK_NULL_HANDLE){
+        return;
+    }
+    MemoryBudgetTracker* tracker = memoryTracker();
+    if(tracker != nullptr){
+        tracker->freed(memory);
+    }
+    vkFreeMemory(device, memory, nullptr);
+}
+
+
+std::vector<MappedRange> mergeMappedRanges(std::vector<MappedRange> ranges, VkDeviceSize nonCoherentAtomSize, VkDeviceSize allocationSize){
+    for(MappedRange& range : ranges){
+        //empty before widening stays empty, the atom around it wasn't written
+        if(range.size == 0 || range.offset >= allocationSize){
+            range.size = 0;
+            continue;
+        }
+        //size may be VK_WHOLE_SIZE, compared against what's left so offset + size can't wrap
+        VkDeviceSize end = (range.size > allocationSize - range.offset) ? allocationSize : range.offset + range.size;
+        range.offset = range.offset / nonCoherentAtomSize * nonCoherentAtomSize;
+        range.size = std::min((end + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, allocationSize) - range.offset;
+    }
+    std::sort(ranges.begin(), ranges.end(), [](const MappedRange& a, const MappedRange& b){
+        return a.offset < b.offset;
+    });
+    std::vector<MappedRange> merged;
+    for(const MappedRange& range : ranges){
+        if(range.size == 0){
+            continue;
+        }
+        if(!merged.empty() && range.offset <= merged.back().offset + merged.back().size){
+            MappedRange& last = merged.back();
+            last.size = std::max(last.offset + last.size, range.offset + range.size) - last.offset;
+            continue;
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+void flushMappedRanges(VkDevice device, VkDeviceMemory memory, std::vector<MappedRange> ranges, VkDeviceSize nonCoherentAtomSize, VkDeviceSize allocationSize){
+    std::vector<VkMappedMemoryRange> flushes;
+    for(const MappedRange& range : mergeMappedRanges(std::move(ranges), nonCoherentAtomSize, allocationSize)){
+        VkMappedMemoryRange flush{};
+        flush.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        flush.memory = memory;
+        flush.offset = range.offset;
+        flush.size = range.size;
+        flushes.push_back(flush);
+    }
+    if(!flushes.empty()){
+        vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(flushes.size()), flushes.data());
+    }
+}
+
+
+UniformRing::UniformRing(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize bytesPerFrame, uint32_t framesInFlight, VkBufferUsageFlags usage) : device(device), framesInFlight(framesInFlight){
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    alignment = std::max(properties.limits.minUniformBufferOffsetAlignment, properties.limits.minStorageBufferOffsetAlignment);
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+    //every frame region starts aligned for both offsets and flushes
+    VkDeviceSize regionAlignment = std::max(alignment, nonCoherentAtomSize);
+    this->bytesPerFrame = (bytesPerFrame + regionAlignment - 1) / regionAlignment * regionAlignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = this->bytesPerFrame * framesInFlight;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
+        throw std::runtime_error("failed to create uniform ring buffer!");
+    }
+    DEBUG_NAME(device, buffer, "uniform ring");
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    VkMemoryPropertyFlags preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if(findDirectWriteHeap(physicalDevice).large){
+        preferred |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    }
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, preferred);
+    if(allocateMemory(device, allocInfo, MemoryCategory::Uniform, &memory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate uniform ring memory!");
+    }
+    DEBUG_NAME(device, memory, "uniform ring");
+    vkBindBufferMemory(device, buffer, memory, 0);
+    allocationSize = allocInfo.allocationSize;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    coherent = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    deviceLocal = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    //mapped once for the whole lifetime
+    void* data;
+    if(vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS){
+        throw std::runtime_error("failed to map uniform ring memory!");
+    }
+    mapped = static_cast<uint8_t*>(data);
+}
+UniformRing::~UniformRing(){
+    vkUnmapMemory(device, memory);
+    vkDestroyBuffer(device, buffer, nullptr);
+    freeMemory(device, memory);
+}
+
+void UniformRing::beginFrame(uint32_t frameIndex){
+    peak = std::max(peak, head.load(std::memory_order_relaxed));
+    frame = frameIndex % framesInFlight;
+    head.store(0, std::memory_order_relaxed);
+}
+
+RingAllocation UniformRing::allocate(VkDeviceSize size){
+    //rounding every size keeps every offset aligned without a CAS loop
+    VkDeviceSize alignedSize = (size + alignment - 1) / alignment * alignment;
+    VkDeviceSize offset = head.fetch_add(alignedSize, std::memory_order_relaxed);
+    if(offset + alignedSize > bytesPerFrame){
+        throw std::runtime_error("uniform ring is out of space for this frame!");
+    }
+    RingAllocation allocation;
+    allocation.buffer = buffer;
+    allocation.offset = frame * bytesPerFrame + offset;
+    allocation.dynamicOffset = static_cast<uint32_t>(allocation.offset);
+    allocation.data = mapped + allocation.offset;
+    return allocation;
+}
+
+void UniformRing::flush(){
+    if(coherent){
+        return;
+    }
+    VkDeviceSize used = std::min(head.load(std::memory_order_relaxed), bytesPerFrame);
+    if(used == 0){
+        return;
+    }
+    flushMappedRanges(device, memory, {{frame * bytesPerFrame, used}}, nonCoherentAtomSize, allocationSize);
+}
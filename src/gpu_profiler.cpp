@@ -0,0 +1,351 @@
+#include <gpu_profiler.hpp>
+#include <debug_names.hpp>
+#include <gpu_memory.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+
+//weight of the newest frame in the running averages
+static constexpr double AVERAGE_WEIGHT = 0.1;
+
+GpuProfiler::GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamily, uint32_t framesInFlight, uint32_t maxZones, bool pipelineStatistics)
+    : device(device), maxZones(maxZones), slots(framesInFlight){
+    GpuProfileNode root;
+    root.name = "frame";
+    nodes.push_back(root);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+    uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if(validBits == 0){
+        std::cout << "GPU profiler: queue family " << queueFamily << " can't write timestamps, profiling disabled\n";
+        return;
+    }
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nanosecondsPerTick = properties.limits.timestampPeriod;
+
+    //core in 1.3, the KHR name with VK_KHR_synchronization2, vkCmdWriteTimestamp otherwise
+    cmdWriteTimestamp2 = (PFN_vkCmdWriteTimestamp2) vkGetDeviceProcAddr(device, "vkCmdWriteTimestamp2");
+    if(cmdWriteTimestamp2 == nullptr){
+        cmdWriteTimestamp2 = (PFN_vkCmdWriteTimestamp2) vkGetDeviceProcAddr(device, "vkCmdWriteTimestamp2KHR");
+    }
+    //only there when the device was created with one of the calibrated timestamps extensions
+    getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsKHR) vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsKHR");
+    if(getCalibratedTimestamps == nullptr){
+        getCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsKHR) vkGetDeviceProcAddr(device, "vkGetCalibratedTimestampsEXT");
+    }
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = framesInFlight * maxZones * 2;
+    if(vkCreateQueryPool(device, &poolInfo, nullptr, &timestampPool) != VK_SUCCESS){
+        throw std::runtime_error("failed to create timestamp query pool!");
+    }
+    DEBUG_NAME(device, timestampPool, "gpu profiler timestamps");
+    if(pipelineStatistics){
+        poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        poolInfo.queryCount = framesInFlight * maxZones;
+        //bit order matches GpuStatistic
+        poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+            VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+        if(vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsPool) != VK_SUCCESS){
+            throw std::runtime_error("failed to create pipeline statistics query pool!");
+        }
+        DEBUG_NAME(device, statisticsPool, "gpu profiler pipeline statistics");
+    }
+}
+GpuProfiler::~GpuProfiler(){
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkDestroyQueryPool(device, statisticsPool, nullptr);
+    }
+    if(timestampPool != VK_NULL_HANDLE){
+        vkDestroyQueryPool(device, timestampPool, nullptr);
+    }
+}
+
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmd, uint32_t frameIndex){
+    if(!enabled()){
+        return;
+    }
+    if(!open.empty()){
+        throw std::runtime_error("gpu profiler: zone left open at the end of a frame!");
+    }
+    //whatever couldn't be collected by now is lost, the queries get reused
+    collect(frameIndex);
+    Slot& slot = slots[frameIndex];
+    slot.zones.clear();
+    slot.pending = false;
+    vkCmdResetQueryPool(cmd, timestampPool, frameIndex * maxZones * 2, maxZones * 2);
+    if(statisticsPool != VK_NULL_HANDLE){
+        vkCmdResetQueryPool(cmd, statisticsPool, frameIndex * maxZones, maxZones);
+    }
+    slot.recordUs = traceClockUs(std::chrono::steady_clock::now());
+    current = frameIndex;
+    openStatistics = UINT32_MAX;
+}
+
+void GpuProfiler::writeTimestamp(VkCommandBuffer cmd, bool end, uint32_t query){
+    //begin as soon as the commands before it start, end once they all finished
+    if(cmdWriteTimestamp2 != nullptr){
+        cmdWriteTimestamp2(cmd, end ? VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, timestampPool, query);
+    }
+    else{
+        vkCmdWriteTimestamp(cmd, end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, query);
+    }
+}
+
+void GpuProfiler::beginZone(VkCommandBuffer cmd, const std::string& name, bool statistics){
+    if(!enabled()){
+        return;
+    }
+    if(current == UINT32_MAX){
+        throw std::runtime_error("gpu profiler: beginZone() before beginFrame()!");
+    }
+    Slot& slot = slots[current];
+    if(slot.zones.size() == maxZones){
+        dropped++;
+        open.push_back(UINT32_MAX);
+        return;
+    }
+    uint32_t index = static_cast<uint32_t>(slot.zones.size());
+    Zone zone{name, open.empty() ? UINT32_MAX : open.back(), static_cast<uint32_t>(open.size()), UINT32_MAX};
+    if(statistics && statisticsPool != VK_NULL_HANDLE && openStatistics == UINT32_MAX){
+        zone.statisticsQuery = current * maxZones + index;
+        vkCmdBeginQuery(cmd, statisticsPool, zone.statisticsQuery, 0);
+        openStatistics = index;
+    }
+    slot.zones.push_back(zone);
+    slot.pending = true;
+    writeTimestamp(cmd, false, (current * maxZones + index) * 2);
+    open.push_back(index);
+}
+
+void GpuProfiler::endZone(VkCommandBuffer cmd){
+    if(!enabled()){
+        return;
+    }
+    if(open.empty()){
+        throw std::runtime_error("gpu profiler: endZone() without beginZone()!");
+    }
+    uint32_t index = open.back();
+    open.pop_back();
+    if(index == UINT32_MAX){
+        return;
+    }
+    if(openStatistics == index){
+        vkCmdEndQuery(cmd, statisticsPool, slots[current].zones[index].statisticsQuery);
+        openStatistics = UINT32_MAX;
+    }
+    writeTimestamp(cmd, true, (current * maxZones + index) * 2 + 1);
+}
+
+
+const std::vector<GpuZoneResult>& GpuProfiler::collect(uint32_t frameIndex){
+    collected.clear();
+    Slot& slot = slots[frameIndex];
+    if(!enabled() || !slot.pending){
+        return collected;
+    }
+    uint32_t count = static_cast<uint32_t>(slot.zones.size());
+
+    //value + availability per query, a frame that isn't done yet stays pending
+    std::vector<uint64_t> ticks(count * 2 * 2);
+    VkResult result = vkGetQueryPoolResults(device, timestampPool, frameIndex * maxZones * 2, count * 2, ticks.size() * sizeof(uint64_t), ticks.data(),
+        2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if(result != VK_SUCCESS){
+        return collected;
+    }
+    slot.pending = false;
+
+    uint64_t first = ticks[0];
+    for(uint32_t i = 0; i < count; i++){
+        const Zone& zone = slot.zones[i];
+        uint64_t begin = ticks[i * 4];
+        uint64_t end = ticks[i * 4 + 2];
+        GpuZoneResult zoneResult;
+        zoneResult.name = zone.name;
+        zoneResult.parent = zone.parent;
+        zoneResult.depth = zone.depth;
+        zoneResult.startMs = ((begin - first) & timestampMask) * nanosecondsPerTick / 1e6;
+        zoneResult.durationMs = ((end - begin) & timestampMask) * nanosecondsPerTick / 1e6;
+        if(zone.statisticsQuery != UINT32_MAX){
+            uint64_t statistics[GPU_STAT_COUNT + 1];
+            if(vkGetQueryPoolResults(device, statisticsPool, zone.statisticsQuery, 1, sizeof(statistics), statistics, sizeof(statistics),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT) == VK_SUCCESS){
+                zoneResult.hasStatistics = true;
+                std::copy(statistics, statistics + GPU_STAT_COUNT, zoneResult.statistics);
+            }
+        }
+        collected.push_back(zoneResult);
+    }
+
+    if(captureFrames > 0){
+        if(!captureStarted && !calibrate()){
+            captureBase = first;
+            captureBaseUs = slot.recordUs;
+        }
+        captureStarted = true;
+        double frameStartUs = traceUs(first);
+        for(const GpuZoneResult& zone : collected){
+            trace.push_back({zone.name, frameStartUs + zone.startMs * 1e3, zone.durationMs * 1e3, zone.depth});
+        }
+        captureFrames--;
+    }
+
+    accumulate(collected);
+    latest = collected;
+    return collected;
+}
+
+void GpuProfiler::accumulate(const std::vector<GpuZoneResult>& zones){
+    //zones map to tree nodes by their path, repeats under the same parent add up
+    std::vector<uint32_t> nodeOf(zones.size());
+    std::vector<double> frameMs(nodes.size(), -1.0);
+    std::vector<uint64_t> frameStatistics(nodes.size() * GPU_STAT_COUNT, 0);
+    std::vector<bool> frameHasStatistics(nodes.size(), false);
+    double frameEnd = 0.0;
+    for(size_t i = 0; i < zones.size(); i++){
+        const GpuZoneResult& zone = zones[i];
+        uint32_t parent = zone.parent == UINT32_MAX ? 0 : nodeOf[zone.parent];
+        uint32_t node = UINT32_MAX;
+        for(uint32_t child : nodes[parent].children){
+            if(nodes[child].name == zone.name){
+                node = child;
+                break;
+            }
+        }
+        if(node == UINT32_MAX){
+            node = static_cast<uint32_t>(nodes.size());
+            GpuProfileNode created;
+            created.name = zone.name;
+            created.depth = nodes[parent].depth + 1;
+            nodes.push_back(created);
+            nodes[parent].children.push_back(node);
+            frameMs.push_back(-1.0);
+            frameStatistics.resize(nodes.size() * GPU_STAT_COUNT, 0);
+            frameHasStatistics.push_back(false);
+        }
+        nodeOf[i] = node;
+        frameMs[node] = std::max(frameMs[node], 0.0) + zone.durationMs;
+        if(zone.hasStatistics){
+            frameHasStatistics[node] = true;
+            for(uint32_t s = 0; s < GPU_STAT_COUNT; s++){
+                frameStatistics[node * GPU_STAT_COUNT + s] += zone.statistics[s];
+            }
+        }
+        if(zone.depth == 0){
+            frameEnd = std::max(frameEnd, zone.startMs + zone.durationMs);
+        }
+    }
+    frameMs[0] = frameEnd;
+
+    for(size_t n = 0; n < nodes.size(); n++){
+        if(frameMs[n] < 0.0){
+            continue;
+        }
+        GpuProfileNode& node = nodes[n];
+        node.lastMs = frameMs[n];
+        node.averageMs = node.samples == 0 ? frameMs[n] : node.averageMs + (frameMs[n] - node.averageMs) * AVERAGE_WEIGHT;
+        node.maxMs = std::max(node.maxMs, frameMs[n]);
+        node.samples++;
+        node.hasStatistics = frameHasStatistics[n];
+        std::copy(&frameStatistics[n * GPU_STAT_COUNT], &frameStatistics[n * GPU_STAT_COUNT] + GPU_STAT_COUNT, node.statistics);
+    }
+}
+
+
+std::string GpuProfiler::overlayText() const{
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(3);
+    //depth first, children in the order they were first seen
+    std::vector<uint32_t> stack = {0};
+    while(!stack.empty()){
+        const GpuProfileNode& node = nodes[stack.back()];
+        stack.pop_back();
+        if(node.samples == 0){
+            continue;
+        }
+        text << std::string(node.depth * 2, ' ') << node.name << " " << node.lastMs << " ms(avg " << node.averageMs << ", max " << node.maxMs << ")";
+        if(node.hasStatistics){
+            text << " vs " << node.statistics[GPU_STAT_VERTEX_INVOCATIONS] << " prims " << node.statistics[GPU_STAT_CLIPPING_PRIMITIVES]
+                << " fs " << node.statistics[GPU_STAT_FRAGMENT_INVOCATIONS] << " cs " << node.statistics[GPU_STAT_COMPUTE_INVOCATIONS];
+        }
+        text << "\n";
+        for(size_t c = node.children.size(); c-- > 0;){
+            stack.push_back(node.children[c]);
+        }
+    }
+    if(memoryTracker != nullptr){
+        text << memoryTracker->overlayText();
+    }
+    return text.str();
+}
+
+
+//one device tick and the CLOCK_MONOTONIC time(what steady_clock counts on linux) it happened at
+bool GpuProfiler::calibrate(){
+#ifdef __linux__
+    if(getCalibratedTimestamps == nullptr){
+        return false;
+    }
+    VkCalibratedTimestampInfoKHR infos[2]{};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_KHR;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+    infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_KHR;
+    uint64_t timestamps[2];
+    uint64_t maxDeviation;
+    if(getCalibratedTimestamps(device, 2, infos, timestamps, &maxDeviation) != VK_SUCCESS){
+        return false;
+    }
+    captureBase = timestamps[0];
+    captureBaseUs = timestamps[1] / 1e3;
+    return true;
+#else
+    return false;
+#endif
+}
+
+//ticks before captureBase come out negative, the difference wraps at timestampValidBits
+double GpuProfiler::traceUs(uint64_t tick) const{
+    uint64_t difference = (tick - captureBase) & timestampMask;
+    int64_t signedDifference = difference > timestampMask / 2 ? -static_cast<int64_t>(timestampMask - difference + 1) : static_cast<int64_t>(difference);
+    return captureBaseUs + signedDifference * nanosecondsPerTick / 1e3;
+}
+
+void GpuProfiler::startCapture(uint32_t frames){
+    captureFrames = frames;
+    captureStarted = false;
+    trace.clear();
+}
+
+void GpuProfiler::writeChromeTrace(const std::string& path) const{
+    std::ofstream file(path);
+    if(!file.is_open()){
+        throw std::runtime_error("failed to open GPU trace file for writing!");
+    }
+    //complete events on one track, the viewer nests them by time
+    double base = trace.empty() ? 0.0 : trace.front().startUs;
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\": [\n";
+    file << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"GPU\"}}";
+    for(const TraceEvent& event : trace){
+        file << ",\n{\"name\": " << traceJsonString(event.name) << ", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": 1, \"tid\": 1, \"ts\": "
+            << event.startUs - base << ", \"dur\": " << event.durationUs << ", \"args\": {\"depth\": " << event.depth << "}}";
+    }
+    file << "\n]}\n";
+    if(!file){
+        throw std::runtime_error("failed to write GPU trace file!");
+    }
+}
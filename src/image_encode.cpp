@@ -0,0 +1,250 @@
+#include <image_encode.hpp>
+
+#include <array>
+#include <fstream>
+
+
+static void appendBigEndian(std::vector<uint8_t>& bytes, uint32_t value){
+    bytes.push_back(static_cast<uint8_t>(value >> 24));
+    bytes.push_back(static_cast<uint8_t>(value >> 16));
+    bytes.push_back(static_cast<uint8_t>(value >> 8));
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+static uint32_t readBigEndian(const std::vector<uint8_t>& bytes, size_t offset){
+    return (static_cast<uint32_t>(bytes[offset]) << 24) | (static_cast<uint32_t>(bytes[offset + 1]) << 16) |
+        (static_cast<uint32_t>(bytes[offset + 2]) << 8) | bytes[offset + 3];
+}
+
+
+//QOI
+static constexpr uint8_t QOI_OP_INDEX = 0x00;
+static constexpr uint8_t QOI_OP_DIFF = 0x40;
+static constexpr uint8_t QOI_OP_LUMA = 0x80;
+static constexpr uint8_t QOI_OP_RUN = 0xC0;
+static constexpr uint8_t QOI_OP_RGB = 0xFE;
+static constexpr uint8_t QOI_OP_RGBA = 0xFF;
+static constexpr uint8_t QOI_MASK = 0xC0;
+static constexpr uint8_t QOI_END[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+static uint32_t qoiHash(const uint8_t pixel[4]){
+    return (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+}
+
+std::vector<uint8_t> encodeQOI(const RGBAImage& image){
+    std::vector<uint8_t> out;
+    out.reserve(14 + image.pixels.size() / 2);
+    out.insert(out.end(), {'q', 'o', 'i', 'f'});
+    appendBigEndian(out, image.width);
+    appendBigEndian(out, image.height);
+    out.push_back(4); //channels
+    out.push_back(0); //sRGB with linear alpha
+
+    uint8_t index[64][4] = {};
+    uint8_t previous[4] = {0, 0, 0, 255};
+    uint32_t run = 0;
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    for(size_t i = 0; i < pixelCount; i++){
+        const uint8_t* pixel = &image.pixels[i * 4];
+        if(std::memcmp(pixel, previous, 4) == 0){
+            run++;
+            if(run == 62 || i == pixelCount - 1){
+                out.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+                run = 0;
+            }
+            continue;
+        }
+        if(run > 0){
+            out.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+            run = 0;
+        }
+
+        uint32_t hash = qoiHash(pixel);
+        if(std::memcmp(index[hash], pixel, 4) == 0){
+            out.push_back(static_cast<uint8_t>(QOI_OP_INDEX | hash));
+        }
+        else{
+            std::memcpy(index[hash], pixel, 4);
+            if(pixel[3] == previous[3]){
+                int8_t dr = static_cast<int8_t>(pixel[0] - previous[0]);
+                int8_t dg = static_cast<int8_t>(pixel[1] - previous[1]);
+                int8_t db = static_cast<int8_t>(pixel[2] - previous[2]);
+                int8_t drg = static_cast<int8_t>(dr - dg);
+                int8_t dbg = static_cast<int8_t>(db - dg);
+                if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1){
+                    out.push_back(static_cast<uint8_t>(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+                }
+                else if(dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7){
+                    out.push_back(static_cast<uint8_t>(QOI_OP_LUMA | (dg + 32)));
+                    out.push_back(static_cast<uint8_t>(((drg + 8) << 4) | (dbg + 8)));
+                }
+                else{
+                    out.insert(out.end(), {QOI_OP_RGB, pixel[0], pixel[1], pixel[2]});
+                }
+            }
+            else{
+                out.insert(out.end(), {QOI_OP_RGBA, pixel[0], pixel[1], pixel[2], pixel[3]});
+            }
+        }
+        std::memcpy(previous, pixel, 4);
+    }
+    out.insert(out.end(), QOI_END, QOI_END + 8);
+    return out;
+}
+
+RGBAImage decodeQOI(const std::vector<uint8_t>& data){
+    if(data.size() < 14 + 8 || std::memcmp(data.data(), "qoif", 4) != 0){
+        throw std::runtime_error("not a QOI image!");
+    }
+    RGBAImage image;
+    image.width = readBigEndian(data, 4);
+    image.height = readBigEndian(data, 8);
+    size_t pixelCount = static_cast<size_t>(image.width) * image.height;
+    //every op makes at least one pixel, runs up to 62
+    if(pixelCount > (data.size() - 14) * 62){
+        throw std::runtime_error("QOI image is truncated!");
+    }
+    image.pixels.resize(pixelCount * 4);
+
+    uint8_t index[64][4] = {};
+    uint8_t pixel[4] = {0, 0, 0, 255};
+    size_t position = 14;
+    size_t end = data.size() - 8;
+    uint32_t run = 0;
+    for(size_t i = 0; i < pixelCount; i++){
+        if(run > 0){
+            run--;
+        }
+        else{
+            if(position >= end){
+                throw std::runtime_error("QOI image is truncated!");
+            }
+            uint8_t op = data[position++];
+            if(op == QOI_OP_RGB || op == QOI_OP_RGBA){
+                uint32_t channels = (op == QOI_OP_RGB) ? 3 : 4;
+                if(position + channels > end){
+                    throw std::runtime_error("QOI image is truncated!");
+                }
+                std::memcpy(pixel, &data[position], channels);
+                position += channels;
+            }
+            else if((op & QOI_MASK) == QOI_OP_INDEX){
+                std::memcpy(pixel, index[op], 4);
+            }
+            else if((op & QOI_MASK) == QOI_OP_DIFF){
+                pixel[0] += ((op >> 4) & 3) - 2;
+                pixel[1] += ((op >> 2) & 3) - 2;
+                pixel[2] += (op & 3) - 2;
+            }
+            else if((op & QOI_MASK) == QOI_OP_LUMA){
+                if(position >= end){
+                    throw std::runtime_error("QOI image is truncated!");
+                }
+                uint8_t next = data[position++];
+                int32_t dg = (op & 0x3F) - 32;
+                pixel[0] += dg - 8 + ((next >> 4) & 0x0F);
+                pixel[1] += dg;
+                pixel[2] += dg - 8 + (next & 0x0F);
+            }
+            else{
+                run = op & 0x3F;
+            }
+            std::memcpy(index[qoiHash(pixel)], pixel, 4);
+        }
+        std::memcpy(&image.pixels[i * 4], pixel, 4);
+    }
+    return image;
+}
+
+
+//PNG
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0){
+    static const auto table = [](){
+        std::array<uint32_t, 256> entries;
+        for(uint32_t i = 0; i < 256; i++){
+            uint32_t c = i;
+            for(uint32_t bit = 0; bit < 8; bit++){
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+            }
+            entries[i] = c;
+        }
+        return entries;
+    }();
+    crc = ~crc;
+    for(size_t i = 0; i < size; i++){
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void appendChunk(std::vector<uint8_t>& png, const char type[4], const std::vector<uint8_t>& data){
+    appendBigEndian(png, static_cast<uint32_t>(data.size()));
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    appendBigEndian(png, crc32(&png[start], png.size() - start));
+}
+
+std::vector<uint8_t> encodePNG(const RGBAImage& image){
+    //filter type 0 in front of every row
+    size_t rowBytes = static_cast<size_t>(image.width) * 4;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * image.height);
+    for(uint32_t y = 0; y < image.height; y++){
+        raw.push_back(0);
+        raw.insert(raw.end(), image.pixels.begin() + y * rowBytes, image.pixels.begin() + (y + 1) * rowBytes);
+    }
+
+    //zlib stream made of stored deflate blocks
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    size_t offset = 0;
+    do{
+        size_t size = std::min<size_t>(raw.size() - offset, 65535);
+        bool last = offset + size == raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(size));
+        zlib.push_back(static_cast<uint8_t>(size >> 8));
+        zlib.push_back(static_cast<uint8_t>(~size));
+        zlib.push_back(static_cast<uint8_t>(~size >> 8));
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        offset += size;
+    }while(offset < raw.size());
+    uint32_t a = 1, b = 0;
+    for(uint8_t byte : raw){
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, image.width);
+    appendBigEndian(header, image.height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); //8 bit RGBA, deflate, no interlace
+
+    std::vector<uint8_t> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", {});
+    return png;
+}
+
+
+void writeImage(const std::string& path, const RGBAImage& image){
+    std::vector<uint8_t> encoded;
+    if(path.ends_with(".png")){
+        encoded = encodePNG(image);
+    }
+    else if(path.ends_with(".qoi")){
+        encoded = encodeQOI(image);
+    }
+    else{
+        throw std::runtime_error("image path has to end in .png or .qoi!");
+    }
+    std::ofstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("failed to open image file for writing!");
+    }
+    file.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+    if(!file){
+        throw std::runtime_error("failed to write image file!");
+    }
+}
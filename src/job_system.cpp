@@ -0,0 +1,303 @@
+#include <job_system.hpp>
+#include <cpu_trace.hpp>
+
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+//which worker the current thread is, UINT32_MAX for threads outside the pool
+static thread_local uint32_t currentWorker = UINT32_MAX;
+static thread_local const JobSystem* currentSystem = nullptr;
+
+
+std::vector<uint32_t> physicalCoreCpus(){
+    std::vector<uint32_t> cpus;
+    uint32_t logicalCount = std::max(1u, std::thread::hardware_concurrency());
+    #ifdef _WIN32
+        //one entry per physical core, its mask has every hyperthread of that core set
+        DWORD length = 0;
+        GetLogicalProcessorInformation(nullptr, &length);
+        std::vector<SYSTEM_LOGICAL_PROCESSOR_INFORMATION> info(length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION));
+        if(!info.empty() && GetLogicalProcessorInformation(info.data(), &length)){
+            for(const auto& entry : info){
+                if(entry.Relationship == RelationProcessorCore && entry.ProcessorMask != 0){
+                    uint32_t cpu = 0;
+                    while(!(entry.ProcessorMask & (ULONG_PTR(1) << cpu))){
+                        cpu++;
+                    }
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    #else
+        //keep the first logical cpu of every (package, core) pair
+        std::set<std::pair<int, int>> seenCores;
+        for(uint32_t cpu = 0; cpu < logicalCount; cpu++){
+            std::string topology = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            std::ifstream coreFile(topology + "core_id");
+            std::ifstream packageFile(topology + "physical_package_id");
+            int core = -1, package = -1;
+            if(!(coreFile >> core) || !(packageFile >> package)){
+                //no topology info(containers, odd kernels), treat every cpu as a core
+                cpus.clear();
+                break;
+            }
+            if(seenCores.insert({package, core}).second){
+                cpus.push_back(cpu);
+            }
+        }
+    #endif
+    if(cpus.empty()){
+        for(uint32_t cpu = 0; cpu < logicalCount; cpu++){
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+bool pinCurrentThread(uint32_t cpu){
+    #ifdef _WIN32
+        if(cpu >= sizeof(DWORD_PTR) * 8){
+            return false;
+        }
+        return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+    #else
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+    #endif
+}
+
+
+JobSystem::JobSystem(uint32_t workerCount, bool pinToCores){
+    startTime = std::chrono::steady_clock::now();
+    std::vector<uint32_t> cores = physicalCoreCpus();
+    if(workerCount == 0){
+        workerCount = static_cast<uint32_t>(cores.size());
+    }
+    //always at least one background thread, the frame thread only runs jobs while it waits
+    //and jobs pushed from other threads(streaming, decode) would otherwise never start
+    workerCount = std::max(workerCount, 2u);
+
+    for(uint32_t i = 0; i < workerCount; i++){
+        workers.push_back(std::make_unique<Worker>());
+    }
+    //the constructing thread is worker 0, left unpinned so the OS can keep it near the window system/driver threads
+    currentWorker = 0;
+    currentSystem = this;
+    TRACE_THREAD_NAME("main");
+    for(uint32_t i = 1; i < workerCount; i++){
+        workers[i]->thread = std::thread([this, i, pinToCores, cores](){
+            if(pinToCores && i < cores.size()){
+                pinCurrentThread(cores[i]);
+            }
+            TRACE_THREAD_NAME(("job worker " + std::to_string(i)).c_str());
+            workerLoop(i);
+        });
+    }
+    std::cout << "Job system started with " << workerCount << " worker" << ((workerCount > 1) ? "s" : "") << " on " << cores.size() << " physical cores\n";
+}
+JobSystem::~JobSystem(){
+    running.store(false);
+    //wake everyone up so they notice
+    pendingJobs.fetch_add(1);
+    pendingJobs.notify_all();
+    for(auto& worker : workers){
+        if(worker->thread.joinable()){
+            worker->thread.join();
+        }
+    }
+    //drop whatever never ran
+    for(auto& worker : workers){
+        for(auto& queue : worker->queues){
+            while(Job* job = queue.pop()){
+                delete job;
+            }
+        }
+    }
+    for(auto& queue : injected){
+        for(Job* job : queue){
+            delete job;
+        }
+    }
+    if(currentSystem == this){
+        currentWorker = UINT32_MAX;
+        currentSystem = nullptr;
+    }
+}
+
+uint32_t JobSystem::currentWorkerIndex() const{
+    return (currentSystem == this) ? currentWorker : UINT32_MAX;
+}
+
+void JobSystem::run(const char* name, std::function<void()> function, JobCounter* counter, JobPriority priority){
+    if(counter){
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+    push(new Job{name, std::move(function), counter, priority});
+}
+void JobSystem::runAfter(JobCounter& dependency, const char* name, std::function<void()> function, JobCounter* counter, JobPriority priority){
+    if(counter){
+        counter->value.fetch_add(1, std::memory_order_relaxed);
+    }
+    Job* job = new Job{name, std::move(function), counter, priority};
+    {
+        //checked under the lock so we can't miss the dependency reaching zero
+        std::lock_guard<std::mutex> lock(dependency.mutex);
+        if(!dependency.done()){
+            dependency.continuations.push_back(job);
+            return;
+        }
+    }
+    push(job);
+}
+
+void JobSystem::push(Job* job){
+    uint32_t index = currentWorkerIndex();
+    int queue = static_cast<int>(job->priority);
+    //counted before it becomes visible so a thief can't take it and underflow the count
+    pendingJobs.fetch_add(1, std::memory_order_release);
+    if(index == UINT32_MAX || !workers[index]->queues[queue].push(job)){
+        std::lock_guard<std::mutex> lock(injectedMutex);
+        injected[queue].push_back(job);
+    }
+    pendingJobs.notify_one();
+}
+
+Job* JobSystem::findJob(uint32_t index, JobPriority lowest){
+    uint32_t count = workerCount();
+    for(int queue = 0; queue <= static_cast<int>(lowest); queue++){
+        //own work first, newest first for cache locality
+        if(Job* job = workers[index]->queues[queue].pop()){
+            return job;
+        }
+        //steal the oldest job from someone else, start next to us so thieves spread out
+        for(uint32_t offset = 1; offset < count; offset++){
+            if(Job* job = workers[(index + offset) % count]->queues[queue].steal()){
+                return job;
+            }
+        }
+        std::lock_guard<std::mutex> lock(injectedMutex);
+        if(!injected[queue].empty()){
+            Job* job = injected[queue].front();
+            injected[queue].pop_front();
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+void JobSystem::execute(Job* job, uint32_t index){
+    pendingJobs.fetch_sub(1, std::memory_order_relaxed);
+    bool timed = timingEnabled.load(std::memory_order_relaxed);
+    auto start = std::chrono::steady_clock::now();
+
+    {
+        TRACE_ZONE(job->name);
+        job->function();
+    }
+
+    if(timed){
+        auto end = std::chrono::steady_clock::now();
+        JobTiming timing{job->name, index, job->priority,
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(start - startTime).count()),
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - startTime).count())};
+        std::lock_guard<std::mutex> lock(workers[index]->timingMutex);
+        workers[index]->timings.push_back(timing);
+    }
+
+    //last job of the counter releases its continuations
+    //the decrement happens under the lock so wait() can't free the counter while we still touch it
+    if(job->counter){
+        std::vector<Job*> ready;
+        {
+            std::lock_guard<std::mutex> lock(job->counter->mutex);
+            if(job->counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                ready.swap(job->counter->continuations);
+            }
+        }
+        for(Job* continuation : ready){
+            push(continuation);
+        }
+    }
+    delete job;
+}
+
+void JobSystem::workerLoop(uint32_t index){
+    currentWorker = index;
+    currentSystem = this;
+    uint32_t idleSpins = 0;
+    while(running.load(std::memory_order_relaxed)){
+        if(Job* job = findJob(index)){
+            execute(job, index);
+            idleSpins = 0;
+            continue;
+        }
+        //spin a little before going to sleep, frames push bursts of small jobs
+        if(++idleSpins < 64){
+            std::this_thread::yield();
+            continue;
+        }
+        pendingJobs.wait(0, std::memory_order_acquire);
+    }
+}
+
+void JobSystem::wait(JobCounter& counter){
+    uint32_t index = currentWorkerIndex();
+    while(!counter.done()){
+        Job* job = (index != UINT32_MAX) ? findJob(index, JobPriority::High) : nullptr;
+        if(job){
+            execute(job, index);
+        }
+        else{
+            std::this_thread::yield();
+        }
+    }
+    //the job that hit zero may still be inside its critical section, let it leave before the caller frees the counter
+    std::lock_guard<std::mutex> lock(counter.mutex);
+}
+
+void JobSystem::parallelFor(const char* name, uint32_t begin, uint32_t end, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& body){
+    if(begin >= end){
+        return;
+    }
+    uint32_t items = end - begin;
+    grain = std::max(grain, 1u);
+    //a few chunks per worker so stealing can even out uneven chunks
+    uint32_t chunks = std::min((items + grain - 1) / grain, workerCount() * 4);
+    if(chunks <= 1){
+        body(begin, end);
+        return;
+    }
+    uint32_t chunkSize = (items + chunks - 1) / chunks;
+    JobCounter counter;
+    for(uint32_t chunkBegin = begin; chunkBegin < end; chunkBegin += chunkSize){
+        uint32_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+        run(name, [&body, chunkBegin, chunkEnd](){
+            body(chunkBegin, chunkEnd);
+        }, &counter);
+    }
+    wait(counter);
+}
+
+std::vector<JobTiming> JobSystem::collectTimings(){
+    std::vector<JobTiming> all;
+    for(auto& worker : workers){
+        std::lock_guard<std::mutex> lock(worker->timingMutex);
+        all.insert(all.end(), worker->timings.begin(), worker->timings.end());
+        worker->timings.clear();
+    }
+    std::sort(all.begin(), all.end(), [](const JobTiming& a, const JobTiming& b){
+        return a.startNs < b.startNs;
+    });
+    return all;
+}
@@ -0,0 +1,296 @@
+#include <ktx2.hpp>
+#include <cpu_trace.hpp>
+
+#include <vulkan/utility/vk_format_utils.h>
+#include <bit>
+#include <fstream>
+#include <numeric>
+#ifdef ENABLE_ZSTD
+#include <zstd.h>
+#endif
+
+
+static constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+//identifier + 9 header words + dfd/kvd/sgd index
+static constexpr uint32_t KTX2_LEVEL_INDEX_OFFSET = 12 + 9 * 4 + 4 * 4 + 2 * 8;
+
+//Khronos data format descriptor values
+static constexpr uint32_t KHR_DF_MODEL_RGBSDA = 1;
+static constexpr uint32_t KHR_DF_MODEL_BC1A = 128;
+static constexpr uint32_t KHR_DF_MODEL_BC5 = 132;
+static constexpr uint32_t KHR_DF_MODEL_BC7 = 134;
+static constexpr uint32_t KHR_DF_MODEL_ASTC = 162;
+static constexpr uint32_t KHR_DF_PRIMARIES_BT709 = 1;
+static constexpr uint32_t KHR_DF_TRANSFER_LINEAR = 1;
+static constexpr uint32_t KHR_DF_TRANSFER_SRGB = 2;
+static constexpr uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+
+bool ktx2ZstdSupported(){
+#ifdef ENABLE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+static void appendU32(std::vector<uint8_t>& bytes, uint32_t value){
+    uint8_t raw[4];
+    std::memcpy(raw, &value, 4);
+    bytes.insert(bytes.end(), raw, raw + 4);
+}
+static void appendU64(std::vector<uint8_t>& bytes, uint64_t value){
+    uint8_t raw[8];
+    std::memcpy(raw, &value, 8);
+    bytes.insert(bytes.end(), raw, raw + 8);
+}
+static void patchU64(std::vector<uint8_t>& bytes, size_t offset, uint64_t value){
+    std::memcpy(&bytes[offset], &value, 8);
+}
+template<typename T>
+static T readValue(const std::vector<uint8_t>& bytes, size_t offset){
+    if(offset + sizeof(T) > bytes.size()){
+        throw std::runtime_error("KTX2 file is truncated!");
+    }
+    T value;
+    std::memcpy(&value, &bytes[offset], sizeof(T));
+    return value;
+}
+
+//one basic descriptor block, the only kind non BasisLZ files need
+static std::vector<uint8_t> buildDataFormatDescriptor(VkFormat format){
+    struct Sample{
+        uint32_t bitOffset;
+        uint32_t bitLength;
+        uint32_t channelType;
+        uint32_t upper;
+    };
+    uint32_t model;
+    std::vector<Sample> samples;
+    switch(format){
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            model = KHR_DF_MODEL_RGBSDA;
+            //alpha stays linear in sRGB formats
+            samples = {{0, 8, 0, 255}, {8, 8, 1, 255}, {16, 8, 2, 255},
+                {24, 8, 15 | (vkuFormatIsSRGB(format) ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0), 255}};
+            break;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            model = KHR_DF_MODEL_BC1A;
+            samples = {{0, 64, 0, 0xFFFFFFFF}};
+            break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            model = KHR_DF_MODEL_BC5;
+            samples = {{0, 64, 0, 0xFFFFFFFF}, {64, 64, 1, 0xFFFFFFFF}};
+            break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            model = KHR_DF_MODEL_BC7;
+            samples = {{0, 128, 0, 0xFFFFFFFF}};
+            break;
+        default:
+            if(!vkuFormatIsCompressed_ASTC_LDR(format)){
+                throw std::runtime_error("no KTX2 data format descriptor for this format!");
+            }
+            model = KHR_DF_MODEL_ASTC;
+            samples = {{0, 128, 0, 0xFFFFFFFF}};
+            break;
+    }
+    VkExtent3D blockExtent = vkuFormatTexelBlockExtent(format);
+    uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+    std::vector<uint8_t> dfd;
+    appendU32(dfd, 4 + blockSize); //dfdTotalSize
+    appendU32(dfd, 0); //vendorId khronos, descriptorType basic
+    appendU32(dfd, 2 | (blockSize << 16)); //versionNumber 1.3
+    uint32_t transfer = vkuFormatIsSRGB(format) ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    appendU32(dfd, model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    appendU32(dfd, (blockExtent.width - 1) | ((blockExtent.height - 1) << 8) | ((blockExtent.depth - 1) << 16));
+    appendU32(dfd, vkuFormatTexelBlockSize(format)); //bytesPlane0
+    appendU32(dfd, 0);
+    for(const Sample& sample : samples){
+        appendU32(dfd, sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channelType << 24));
+        appendU32(dfd, 0); //sample position
+        appendU32(dfd, 0); //lower
+        appendU32(dfd, sample.upper);
+    }
+    return dfd;
+}
+
+//bytes a mip needs in format, rounded up to whole blocks
+static size_t mipByteSize(VkFormat format, uint32_t width, uint32_t height){
+    VkExtent3D blockExtent = vkuFormatTexelBlockExtent(format);
+    size_t blocksX = (width + blockExtent.width - 1) / blockExtent.width;
+    size_t blocksY = (height + blockExtent.height - 1) / blockExtent.height;
+    return blocksX * blocksY * vkuFormatTexelBlockSize(format);
+}
+
+
+void writeKtx2(const std::string& path, const Ktx2Texture& texture, Ktx2Supercompression supercompression){
+    if(texture.mips.empty()){
+        throw std::runtime_error("KTX2 texture has no mips!");
+    }
+    if(supercompression == Ktx2Supercompression::Zstd && !ktx2ZstdSupported()){
+        throw std::runtime_error("zstd supercompression isn't available in this build!");
+    }
+    for(const TextureMip& mip : texture.mips){
+        if(mip.data.size() != mipByteSize(texture.format, mip.width, mip.height)){
+            throw std::runtime_error("KTX2 mip size doesn't match its format and extent!");
+        }
+    }
+    uint32_t levelCount = static_cast<uint32_t>(texture.mips.size());
+    std::vector<uint8_t> dfd = buildDataFormatDescriptor(texture.format);
+    //one key/value pair, padded to 4 bytes
+    const char writerKey[] = "KTXwriter\0vulkan-test texbuild";
+    std::vector<uint8_t> kvd;
+    appendU32(kvd, sizeof(writerKey));
+    kvd.insert(kvd.end(), writerKey, writerKey + sizeof(writerKey));
+    kvd.resize((kvd.size() + 3) / 4 * 4, 0);
+
+    std::vector<uint8_t> file(KTX2_IDENTIFIER, KTX2_IDENTIFIER + 12);
+    appendU32(file, texture.format);
+    appendU32(file, 1); //typeSize, 1 for block compressed and 8 bit formats
+    appendU32(file, texture.mips[0].width);
+    appendU32(file, texture.mips[0].height);
+    appendU32(file, 0); //pixelDepth
+    appendU32(file, 0); //layerCount, 0 = not an array
+    appendU32(file, 1); //faceCount
+    appendU32(file, levelCount);
+    appendU32(file, static_cast<uint32_t>(supercompression));
+
+    uint32_t dfdOffset = KTX2_LEVEL_INDEX_OFFSET + levelCount * 24;
+    appendU32(file, dfdOffset);
+    appendU32(file, static_cast<uint32_t>(dfd.size()));
+    appendU32(file, dfdOffset + static_cast<uint32_t>(dfd.size()));
+    appendU32(file, static_cast<uint32_t>(kvd.size()));
+    appendU64(file, 0); //no supercompression global data
+    appendU64(file, 0);
+    //level index, filled in once the offsets are known
+    file.resize(file.size() + levelCount * 24, 0);
+    file.insert(file.end(), dfd.begin(), dfd.end());
+    file.insert(file.end(), kvd.begin(), kvd.end());
+
+    //smallest mip first, so a partial read already gets the tail
+    size_t alignment = (supercompression == Ktx2Supercompression::None) ? std::lcm<size_t>(vkuFormatTexelBlockSize(texture.format), 4) : 1;
+    for(uint32_t level = levelCount; level-- > 0;){
+        const std::vector<uint8_t>& data = texture.mips[level].data;
+        file.resize((file.size() + alignment - 1) / alignment * alignment, 0);
+        size_t offset = file.size();
+        if(supercompression == Ktx2Supercompression::Zstd){
+#ifdef ENABLE_ZSTD
+            std::vector<uint8_t> compressed(ZSTD_compressBound(data.size()));
+            size_t size = ZSTD_compress(compressed.data(), compressed.size(), data.data(), data.size(), 19);
+            if(ZSTD_isError(size)){
+                throw std::runtime_error("failed to zstd compress a KTX2 level!");
+            }
+            file.insert(file.end(), compressed.begin(), compressed.begin() + size);
+#endif
+        }
+        else{
+            file.insert(file.end(), data.begin(), data.end());
+        }
+        size_t entry = KTX2_LEVEL_INDEX_OFFSET + level * 24;
+        patchU64(file, entry, offset);
+        patchU64(file, entry + 8, file.size() - offset);
+        patchU64(file, entry + 16, data.size());
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if(!out.is_open()){
+        throw std::runtime_error("failed to open KTX2 file for writing!");
+    }
+    out.write(reinterpret_cast<const char*>(file.data()), file.size());
+    if(!out){
+        throw std::runtime_error("failed to write KTX2 file!");
+    }
+}
+
+
+Ktx2Texture readKtx2(const std::string& path){
+    TRACE_ZONE("readKtx2");
+    std::ifstream in(path, std::ios::ate | std::ios::binary);
+    if(!in.is_open()){
+        throw std::runtime_error("failed to open KTX2 file!");
+    }
+    std::vector<uint8_t> file(static_cast<size_t>(in.tellg()));
+    in.seekg(0);
+    in.read(reinterpret_cast<char*>(file.data()), file.size());
+
+    if(file.size() < KTX2_LEVEL_INDEX_OFFSET || std::memcmp(file.data(), KTX2_IDENTIFIER, 12) != 0){
+        throw std::runtime_error("not a KTX2 file!");
+    }
+    Ktx2Texture texture;
+    texture.format = static_cast<VkFormat>(readValue<uint32_t>(file, 12));
+    uint32_t width = readValue<uint32_t>(file, 20);
+    uint32_t height = readValue<uint32_t>(file, 24);
+    uint32_t depth = readValue<uint32_t>(file, 28);
+    uint32_t layers = readValue<uint32_t>(file, 32);
+    uint32_t faces = readValue<uint32_t>(file, 36);
+    uint32_t levelCount = std::max(readValue<uint32_t>(file, 40), 1u);
+    auto supercompression = static_cast<Ktx2Supercompression>(readValue<uint32_t>(file, 44));
+
+    if(texture.format == VK_FORMAT_UNDEFINED){
+        throw std::runtime_error("KTX2 files without a Vulkan format(Basis Universal) aren't supported!");
+    }
+    if(width == 0 || height == 0 || depth > 1 || layers > 1 || faces != 1){
+        throw std::runtime_error("only 2D KTX2 textures are supported!");
+    }
+    if(width > KTX2_MAX_EXTENT || height > KTX2_MAX_EXTENT){
+        throw std::runtime_error("KTX2 texture is larger than the reader allows!");
+    }
+    if(vkuFormatTexelBlockSize(texture.format) == 0){
+        throw std::runtime_error("KTX2 texture has an unknown format!");
+    }
+    if(supercompression != Ktx2Supercompression::None && !(supercompression == Ktx2Supercompression::Zstd && ktx2ZstdSupported())){
+        throw std::runtime_error("unsupported KTX2 supercompression scheme!");
+    }
+    //a full chain ends at 1x1, more levels than that would shift the extent by 32 or more
+    if(levelCount > static_cast<uint32_t>(std::bit_width(std::max(width, height)))){
+        throw std::runtime_error("KTX2 texture has more levels than its extent allows!");
+    }
+
+    for(uint32_t level = 0; level < levelCount; level++){
+        size_t entry = KTX2_LEVEL_INDEX_OFFSET + level * 24;
+        uint64_t offset = readValue<uint64_t>(file, entry);
+        uint64_t length = readValue<uint64_t>(file, entry + 8);
+        uint64_t uncompressedLength = readValue<uint64_t>(file, entry + 16);
+        if(offset > file.size() || length > file.size() - offset){
+            throw std::runtime_error("KTX2 level is out of bounds!");
+        }
+        if(supercompression == Ktx2Supercompression::None && uncompressedLength != length){
+            throw std::runtime_error("KTX2 level index is inconsistent!");
+        }
+
+        TextureMip mip;
+        mip.width = std::max(width >> level, 1u);
+        mip.height = std::max(height >> level, 1u);
+        size_t expected = mipByteSize(texture.format, mip.width, mip.height);
+        if(supercompression == Ktx2Supercompression::Zstd){
+#ifdef ENABLE_ZSTD
+            //the index is untrusted, don't let it pick how much we allocate
+            //expected is bounded by KTX2_MAX_EXTENT, and the frame has to agree with it before we inflate
+            if(uncompressedLength != expected){
+                throw std::runtime_error("KTX2 level size doesn't match its format and extent!");
+            }
+            if(ZSTD_getFrameContentSize(&file[offset], length) != uncompressedLength){
+                throw std::runtime_error("KTX2 level's zstd frame doesn't match its index!");
+            }
+            mip.data.resize(uncompressedLength);
+            size_t size = ZSTD_decompress(mip.data.data(), mip.data.size(), &file[offset], length);
+            if(ZSTD_isError(size) || size != uncompressedLength){
+                throw std::runtime_error("failed to inflate a KTX2 level!");
+            }
+#endif
+        }
+        else{
+            mip.data.assign(file.begin() + offset, file.begin() + offset + length);
+        }
+        if(mip.data.size() != expected){
+            throw std::runtime_error("KTX2 level size doesn't match its format and extent!");
+        }
+        texture.mips.push_back(std::move(mip));
+    }
+    return texture;
+}
@@ -1,4 +1,14 @@
 #include <main.hpp>
+#include <scene_graph.hpp>
+#include <job_system.hpp>
+#include <cpu_trace.hpp>
+#include <debug_names.hpp>
+#include <debug_report.hpp>
+#include <validation_settings.hpp>
+#include <gpu_memory.hpp>
+#include <device_selection.hpp>
+
+#include <vulkan/vk_enum_string_helper.h>
 
 //creates VkDebugUtilsMessengerEXT object
 VkResult CreateDebugUtilsMessengerEXT(VkInstance instance, const VkDebugUtilsMessengerCreateInfoEXT* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkDebugUtilsMessengerEXT* pDebugMessenger){
@@ -21,33 +31,79 @@ void DestroyDebugUtilsMessengerEXT(VkInstance instance, VkDebugUtilsMessengerEXT
 
 
 
+//command line options
+//  main [--validation=off|full|sync|perf|gpu] [--fail-on-perf-warning] [--debug-report debug_report.json]
+struct AppOptions{
+    //validation layer preset, debug builds default to everything the layer checks, release builds to no layer
+    #ifdef NDEBUG
+        ValidationPreset validation = ValidationPreset::Off;
+    #else
+        ValidationPreset validation = ValidationPreset::Full;
+    #endif
+    bool failOnPerfWarning = false; //exit with a failure when the layers reported any PERFORMANCE message(CI)
+    std::string debugReport = "debug_report.json"; //written on exit when validation is enabled
+};
+
+//throws on unknown arguments
+AppOptions parseAppOptions(int argc, char** argv){
+    AppOptions options;
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(arg.starts_with("--validation=")){
+            options.validation = parseValidationPreset(arg.substr(std::string("--validation=").size()));
+        }
+        else if(arg == "--fail-on-perf-warning"){
+            options.failOnPerfWarning = true;
+        }
+        else if(arg == "--debug-report" && hasValue){
+            options.debugReport = argv[++i];
+        }
+        else{
+            throw std::runtime_error("unknown argument " + arg + "!");
+        }
+    }
+    return options;
+}
 
 
 class HelloTriangleApplication{
     public:
+    explicit HelloTriangleApplication(const AppOptions& options)
+        : options(options), enableValidationLayers(options.validation != ValidationPreset::Off), debugReport(options.failOnPerfWarning){}
+
     void run(){
         std::cout << "Application started:\n";
+        #ifdef ENABLE_CPU_TRACE
+            cpuTraceStart();
+        #endif
         initWindow();
         initVulkan();
         mainLoop();
         cleanup();
+        #ifdef ENABLE_CPU_TRACE
+            cpuTraceStop();
+            cpuTraceWrite("trace.json");
+            std::cout << "CPU trace written to trace.json\n";
+        #endif
+        if(enableValidationLayers){
+            reportDebugMessages();
+        }
         std::cout << "The End.\n";
     }
 
     private:
 
+    AppOptions options;
+
     //GLFW window information
     GLFWwindow* window;
     const uint32_t GLFW_WINDOW_WIDTH = 800;
     const uint32_t GLFW_WINDOW_HEIGHT = 600;
     const char* GLFW_WINDOW_TITLE = "vulkan test nuck";
 
-    //enable validation layers unless NO DEBUG
-    #ifdef NDEBUG
-        const bool enableValidationLayers = false;
-    #else
-        const bool enableValidationLayers = true;
-    #endif
+    //enable validation layers unless --validation=off(the default with NDEBUG)
+    const bool enableValidationLayers;
 
     //validation layers used
     const std::vector<const char*> validationLayers = {
@@ -67,6 +123,8 @@ class HelloTriangleApplication{
     VkInstance instance;
     //handle for debug callback function
     VkDebugUtilsMessengerEXT debugMessenger;
+    //every message the debug callback got this run, the callback reaches it through pUserData
+    DebugReport debugReport;
     //handle for physical device
     VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
     //struct to store all queue families we need
@@ -102,6 +160,16 @@ class HelloTriangleApplication{
         std::vector<VkPresentModeKHR> presentModes; //avilable presentation modes
     };
 
+    //per heap/category view of device memory, every allocation reports to it
+    std::optional<MemoryBudgetTracker> memoryBudget;
+
+    //work stealing job pool, this thread is worker 0
+    JobSystem jobs;
+
+    //scene
+    //flattened transform hierarchy, its world matrices are the per instance data
+    SceneGraph scene;
+
 
 
 
@@ -132,6 +200,7 @@ class HelloTriangleApplication{
     }
     //creates vulkan instance
     void createInstance(){
+        TRACE_ZONE("createInstance");
         //check if validation layers are supported
         if(enableValidationLayers && !checkValidationLayerSupport()){
             throw std::runtime_error("Validation layers requested, but not available!");
@@ -164,10 +233,7 @@ class HelloTriangleApplication{
 
         //get required extensions
         auto extensions = getRequiredExtensions(); //list of required extension names
-        //add to create info
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-        createInfo.ppEnabledExtensionNames = extensions.data();
-        
+
         //debug messenger create info
         VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
         //if validation layers enabled, add validation layer info to create info
@@ -185,6 +251,13 @@ class HelloTriangleApplication{
 
             createInfo.pNext = nullptr; //do not point to debug messenger info
         }
+        //which checks the layer runs, chained in front of the debug messenger info
+        ValidationSettings validationSettings(options.validation);
+        validationSettings.chain(createInfo, extensions);
+        std::cout << "Validation preset: " << validationPresetName(options.validation) << "\n";
+        //add to create info
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
 
         //create vulkan instance using the create info
         if(vkCreateInstance(&createInfo, nullptr, &instance) != VK_SUCCESS){
@@ -272,36 +345,37 @@ class HelloTriangleApplication{
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData){
         /*
             pCallbackData->pMessage: null terminated error message
-            pCallbackData->pObjects:
+            pCallbackData->pObjects: objects the message is about
+            pUserData: the app's DebugReport
         */
-        if(messageSeverity >= minimumDebugMessageSeverity){
-            std::cerr << "\tValidation layer: ";
-            switch(messageType){
-                case VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT:
-                    std::cerr << "GENERAL";
-                    break;
-                case VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT:
-                    std::cerr << "VALIDATION";
-                    break;
-                case VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT:
-                    std::cerr << "PERFORMANCE";
-                    break;
-                default:
-                    std::cerr << "Unrecognized message type";
-                    break;
-            };
+        //every message is counted in the report, the console only gets the first one of each kind
+        DebugReport* report = static_cast<DebugReport*>(pUserData);
+        bool first = report->record(messageSeverity, messageType, pCallbackData);
+        if(first && messageSeverity >= minimumDebugMessageSeverity){
+            //type is a bitmask, one message can be VALIDATION|PERFORMANCE
+            std::cerr << "\tValidation layer: " << debugMessageTypeString(messageType) << " " << debugSeverityString(messageSeverity);
             std::cerr << "\n\t\t";
             std::cerr << pCallbackData->pMessage << "\n";
             std::cerr << "\t\tRelated num of objs: " << pCallbackData->objectCount << "\n";
-        }
-        else{
-            std::cout << "$\n";
+            //the layer only knows names that reached the driver, the registry also has the ones given before
+            for(uint32_t i = 0; i < pCallbackData->objectCount; i++){
+                const VkDebugUtilsObjectNameInfoEXT& object = pCallbackData->pObjects[i];
+                std::string name = (object.pObjectName != nullptr) ? object.pObjectName : "";
+                #ifndef NDEBUG
+                    if(name.empty()){
+                        name = debugNameOf(object.objectHandle);
+                    }
+                #endif
+                std::cerr << "\t\t\t" << string_VkObjectType(object.objectType) << " 0x" << std::hex << object.objectHandle << std::dec
+                    << " " << (name.empty() ? "(unnamed)" : name) << "\n";
+            }
         }
 
         return VK_FALSE;
     }
     //sets up debug messenger by binding the callback function to vulkan
     void setupDebugMessenger(){
+        TRACE_ZONE("setupDebugMessenger");
         if(!enableValidationLayers){
             return;
         }
@@ -333,10 +407,11 @@ class HelloTriangleApplication{
         //pointer to callback function
         createInfo.pfnUserCallback = debugCallback;
         //whatever this pointer is will be passed to callback function
-        createInfo.pUserData = nullptr; // Optional
+        createInfo.pUserData = &debugReport;
     }
     //selects a viable physical graphics card
     void pickPhysicalDevice(){
+        TRACE_ZONE("pickPhysicalDevice");
         //query number of devices by passing nullptr
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
@@ -345,28 +420,28 @@ class HelloTriangleApplication{
         if(deviceCount == 0){
             throw std::runtime_error("Failed to find GPUs with Vulkan support!");
         }
-        
-        //actually get the devices information
-        std::vector<VkPhysicalDevice> devices(deviceCount);
-        vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
-
-        std::cout << "Selecting GPU based on score: \n";
-        //use ordered map to sort candidates by increasing score
-        std::multimap<int, VkPhysicalDevice> candidates;
-        //get devices scores and add to map
-        for(const auto& device : devices){
-            int score = rateDeviceSuitability(device);
-            candidates.insert(std::make_pair(score, device));
-
-            //check if best candidate is even supported
-            //if supported, set physicalDevice to the best device's handle
-            if(candidates.rbegin()->first > 0){
-                physicalDevice = candidates.rbegin()->second;
+
+        //what the app can't run without, nothing here uses geometry shaders or cares about texture size limits
+        DeviceRequirements requirements;
+        requirements.extensions = deviceExtensions;
+        requirements.check = [this](VkPhysicalDevice device) -> std::string{
+            //graphics and present queues
+            if(!findQueueFamilies(device).isComplete()){
+                return "no graphics or present queue";
             }
-            else{
-                throw std::runtime_error("failed to find a suitable GPU!");
+            //right now we require one format and one present mode
+            SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
+            if(swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()){
+                return "no surface format or present mode";
             }
-        }
+            return "";
+        };
+        //what makes a device better, defaults plus the extensions used when present
+        DevicePreferences preferences;
+        preferences.extensions = {{VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, 50}};
+
+        std::cout << "Selecting GPU based on score(" DEVICE_OVERRIDE_ENV "=<index or name> forces one): \n";
+        physicalDevice = selectPhysicalDevice(instance, requirements, preferences, &std::cout).device;
         //print the selected device
         //query the device for basic device properties
         VkPhysicalDeviceProperties deviceProperties;
@@ -386,60 +461,9 @@ class HelloTriangleApplication{
             std::cout << "(" "???" ")";
         }
         std::cout << "\n";
+        std::cout << "Per frame buffers: " << (findDirectWriteHeap(physicalDevice).large ? "written directly into VRAM(resizable BAR or shared memory)" : "staged") << "\n";
 
     }
-    //check if device is competent as well as how good the device is, 0 means unsupported, higher score is better
-    int rateDeviceSuitability(VkPhysicalDevice device){
-        //query the device for basic device properties
-        VkPhysicalDeviceProperties deviceProperties;
-        vkGetPhysicalDeviceProperties(device, &deviceProperties);
-        //for optional features like texture compression, 64 bit floats, and multi viewport rendering, query device features
-        VkPhysicalDeviceFeatures deviceFeatures;
-        vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-        int score = 0;
-    
-        //Discrete GPUs have a significant performance advantage
-        if(deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU){
-            score += 1000;
-        }
-    
-        //Maximum possible size of textures affects graphics quality
-        score += deviceProperties.limits.maxImageDimension2D;
-    
-        //Application can't function without geometry shaders
-        if(!deviceFeatures.geometryShader){
-            return 0;
-        }
-
-        //Check device queue capability
-        QueueFamilyIndices indices = findQueueFamilies(device); 
-        //Application can't function without graphics command queue
-        if(!indices.isComplete()){
-            return 0;
-        }
-
-        //Check if device supports all extensions
-        bool extensionsSupported = checkDeviceExtensionSupport(device);
-        if(!extensionsSupported){
-            return 0;
-        }
-
-        //Check if device supports swap chain
-        bool swapChainAdequate = false;
-        SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
-        //Adequate if formats and present modes are not empty
-        //right now we require one format and one present mode
-        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
-        if(!swapChainAdequate){
-            return 0;
-        }
-
-
-        std::cout << "\t" << deviceProperties.deviceName << " | score: " << score << "\n";
-
-        return score;
-    }
     //find the device's queue family that supports sending graphics commands
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device){
         QueueFamilyIndices indices;
@@ -479,22 +503,11 @@ class HelloTriangleApplication{
     }
     //set up logical device from physical device
     void createLogicalDevice(){
+        TRACE_ZONE("createLogicalDevice");
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
-        //create info for queues we are using
-        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-        //queue families indices
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-        //assign priority to queue(0.0f - 1.0f)
-        float queuePriority = 1.0f;
-        //fill in the create infos
-        for(uint32_t queueFamily : uniqueQueueFamilies){
-            VkDeviceQueueCreateInfo queueCreateInfo{};
-            queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO; //type
-            queueCreateInfo.queueFamilyIndex = queueFamily; //index
-            queueCreateInfo.queueCount = 1; //number of queues
-            queueCreateInfo.pQueuePriorities = &queuePriority; //point to priority
-            queueCreateInfos.push_back(queueCreateInfo); //add it to the vector
-        }
+        //queues we are using, graphics and present only, nothing submits to an async compute queue yet
+        DeviceQueuePlan queuePlan = planDeviceQueues(physicalDevice, indices.graphicsFamily.value(), indices.presentFamily.value(), false);
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos = queuePlan.createInfos();
         
         //create info for logical device
         VkDeviceCreateInfo createInfo{};
@@ -506,8 +519,13 @@ class HelloTriangleApplication{
         createInfo.pEnabledFeatures = &deviceFeatures;  //used device features
 
         //device features enabled
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size()); //number of device extensions
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data(); //point to the vector
+        //required extensions plus VK_EXT_memory_budget when the device has it, the memory tracker reads real usage through it
+        std::vector<const char*> enabledExtensions = deviceExtensions;
+        if(memoryBudgetSupported(physicalDevice)){
+            enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size()); //number of device extensions
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data(); //point to the vector
 
         //enabledLayerCount and ppEnabledLayerNames are ignored in newer vulkan implementations
         //because vulkan made instance and device specific layers the same
@@ -528,13 +546,32 @@ class HelloTriangleApplication{
             std::cout << "Created logical device!\n";
         }
 
-        //retrieve handles for each queue family
-        vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
-        vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+        //retrieve handles for each queue
+        vkGetDeviceQueue(device, queuePlan.graphics.family, queuePlan.graphics.index, &graphicsQueue);
+        vkGetDeviceQueue(device, queuePlan.present.family, queuePlan.present.index, &presentQueue);
+
+        //from here on objects named with DEBUG_NAME show up by name in validation messages and captures
+        if(enableValidationLayers){
+            DEBUG_NAMES_INIT(instance, device);
+        }
+        DEBUG_NAME(device, device, "main device");
+        DEBUG_NAME(device, graphicsQueue, (graphicsQueue == presentQueue) ? "graphics/present queue" : "graphics queue");
+        if(presentQueue != graphicsQueue){
+            DEBUG_NAME(device, presentQueue, "present queue");
+        }
 
+        //warns before out of memory instead of after, streaming hooks its evictions in here too
+        memoryBudget.emplace(instance, physicalDevice);
+        setMemoryTracker(&*memoryBudget);
+        memoryBudget->addWatermark(0.9f, [this](uint32_t heap, const MemoryHeapStatus&, bool above){
+            if(above){
+                std::cerr << "device memory heap " << heap << " is over 90% of its budget:\n" << memoryBudget->overlayText();
+            }
+        });
     }
     //create surface using GLFW
     void createSurface(){
+        TRACE_ZONE("createSurface");
         //create surface using GLFW call
         if(glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS){
             throw std::runtime_error("failed to create window surface!");
@@ -544,31 +581,6 @@ class HelloTriangleApplication{
         }
 
 
-    }
-    //check if physical device supports required extensions
-    bool checkDeviceExtensionSupport(VkPhysicalDevice device){
-        //get extensions of the physical device
-        //first get the count
-        uint32_t extensionCount;
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-        //then store properties into a vector
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
-        //convert deviceExtensions to a set of strings, which is the list of required extensions
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-
-        //loop availableExtensions and remove from required list
-        for(const auto& extension : availableExtensions){
-            requiredExtensions.erase(extension.extensionName);
-
-            //optimization: if it is empty already return true
-            if(requiredExtensions.empty()){
-                return true;
-            }
-        }
-
-        //if the required list is empty then return true
-        return requiredExtensions.empty();
     }
     //populates the SwapChainSupportDetails struct
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device){
@@ -686,6 +698,7 @@ class HelloTriangleApplication{
     }
     //create swap chain
     void createSwapChain(){
+        TRACE_ZONE("createSwapChain");
         ///query swap chain support(it's a struct)
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
         //best of surface format, present mode, extent
@@ -713,6 +726,7 @@ class HelloTriangleApplication{
 
 
     void initVulkan(){
+        TRACE_ZONE("initVulkan");
         std::cout << ((enableValidationLayers) ? "Validation Layers Enabled\n" : "Validation Layers Disabled\n");
         createInstance();
         setupDebugMessenger();
@@ -724,13 +738,40 @@ class HelloTriangleApplication{
     }
     void mainLoop(){
         while(!glfwWindowShouldClose(window)){
-            glfwPollEvents();
+            TRACE_ZONE("frame");
+            {
+                TRACE_ZONE("poll events");
+                glfwPollEvents();
+            }
+            //only dirty subtrees get recomputed, big levels fan out over the job system
+            {
+                TRACE_ZONE("scene update");
+                scene.update([this](uint32_t begin, uint32_t end, const SceneGraph::RangeBody& body){
+                    jobs.parallelFor("scene transforms", begin, end, 256, body);
+                });
+            }
+            memoryBudget->update();
+        }
+    }
+    //summary on the console, details(first message, objects, stack of each kind) in the report file
+    void reportDebugMessages(){
+        std::string summary = debugReport.summary();
+        std::cout << "Debug messages this run:\n" << (summary.empty() ? "none\n" : summary);
+        debugReport.writeJson(options.debugReport);
+        std::cout << "Debug report written to " << options.debugReport << "\n";
+        if(debugReport.failed()){
+            throw std::runtime_error("performance warnings reported with --fail-on-perf-warning!");
         }
     }
     void cleanup(){
+        TRACE_ZONE("cleanup");
         std::cout << "Cleaning up...\n";
         
         //clean up logical device
+        std::cout << "Device memory at exit:\n" << memoryBudget->overlayText();
+        setMemoryTracker(nullptr);
+        memoryBudget.reset();
+        DEBUG_NAMES_INIT(VK_NULL_HANDLE, VK_NULL_HANDLE);
         vkDestroyDevice(device, nullptr);
         
         //clean up window surface
@@ -752,7 +793,7 @@ class HelloTriangleApplication{
     
 };
 
-int main(){
+int main(int argc, char** argv){
     //detect if we are running on windows or linux
     #ifdef _WIN32
         std::cout << "RUNNING ON WINDOWS\n";
@@ -760,10 +801,9 @@ int main(){
         std::cout << "RUNNING ON LINUX\n";
     #endif
 
-    //run vulkan app
-    HelloTriangleApplication app;
-
     try{
+        //run vulkan app
+        HelloTriangleApplication app(parseAppOptions(argc, argv));
         app.run();
     }
     catch(const std::exception& e){
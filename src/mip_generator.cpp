@@ -0,0 +1,253 @@
+#include <mip_generator.hpp>
+#include <gpu_memory.hpp>
+#include <debug_names.hpp>
+
+
+MipGenerator::MipGenerator(VkDevice device, VkPhysicalDevice physicalDevice, ObjectCache& cache, VkShaderModule downsampleShader, uint32_t maxChains, bool subgroupQuad)
+    : device(device), cache(cache), maxChains(maxChains){
+    cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2) vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2");
+    if(cmdPipelineBarrier2 == nullptr){
+        cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2) vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+    }
+    if(cmdPipelineBarrier2 == nullptr){
+        throw std::runtime_error("mip generator: device does not support synchronization2!");
+    }
+
+    //mips[mip - 1] in the shader
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    if(!features.shaderStorageImageArrayDynamicIndexing){
+        throw std::runtime_error("mip generator: device does not support shaderStorageImageArrayDynamicIndexing!");
+    }
+
+    //only texelFetch is used, the sampler just has to exist
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler = cache.sampler(samplerInfo);
+
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    bindings[0] = {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    bindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_MIPS - 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    bindings[2] = {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    VkDescriptorSetLayoutCreateInfo setLayoutInfo{};
+    setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    setLayoutInfo.bindingCount = 3;
+    setLayoutInfo.pBindings = bindings;
+    setLayout = cache.descriptorSetLayout(setLayoutInfo);
+
+    VkPushConstantRange pushRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants)};
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    pipelineLayout = cache.pipelineLayout(layoutInfo);
+
+    //SRGB and USE_SUBGROUP_QUAD specialization constants
+    VkSpecializationMapEntry entries[2] = {{0, 0, sizeof(VkBool32)}, {1, sizeof(VkBool32), sizeof(VkBool32)}};
+    for(VkBool32 srgb : {VK_FALSE, VK_TRUE}){
+        VkBool32 constants[2] = {srgb, subgroupQuad ? VK_TRUE : VK_FALSE};
+        VkSpecializationInfo specialization{2, entries, sizeof(constants), constants};
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = downsampleShader;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = &specialization;
+        pipelineInfo.layout = pipelineLayout;
+        (srgb ? srgbPipeline : linearPipeline) = cache.computePipeline(pipelineInfo);
+    }
+
+    VkDescriptorPoolSize poolSizes[3] = {
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxChains},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, maxChains * (MAX_MIPS - 1)},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, maxChains}
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.maxSets = maxChains;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    if(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS){
+        throw std::runtime_error("failed to create mip generator descriptor pool!");
+    }
+    DEBUG_NAME(device, descriptorPool, "mip generator");
+
+    //counters are tiny, host visible memory keeps the zero initialization trivial
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    counterStride = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = counterStride * maxChains;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &counterBuffer) != VK_SUCCESS){
+        throw std::runtime_error("failed to create mip generator counter buffer!");
+    }
+    DEBUG_NAME(device, counterBuffer, "mip generator counters");
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, counterBuffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if(allocateMemory(device, allocInfo, MemoryCategory::Other, &counterMemory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate mip generator counter memory!");
+    }
+    DEBUG_NAME(device, counterMemory, "mip generator counters");
+    vkBindBufferMemory(device, counterBuffer, counterMemory, 0);
+    void* data;
+    if(vkMapMemory(device, counterMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS){
+        throw std::runtime_error("failed to map mip generator counter memory!");
+    }
+    std::memset(data, 0, requirements.size);
+    vkUnmapMemory(device, counterMemory);
+
+    chains.resize(maxChains);
+    for(uint32_t slot = maxChains; slot-- > 0;){
+        freeSlots.push_back(slot);
+    }
+}
+MipGenerator::~MipGenerator(){
+    for(auto& chain : chains){
+        if(chain){
+            destroyChain(chain.get());
+        }
+    }
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyBuffer(device, counterBuffer, nullptr);
+    freeMemory(device, counterMemory);
+}
+
+
+bool MipGenerator::supportsSubgroupQuad(VkInstance instance, VkPhysicalDevice physicalDevice){
+    auto getProperties2 = (PFN_vkGetPhysicalDeviceProperties2) vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2");
+    if(getProperties2 == nullptr){
+        return false;
+    }
+    VkPhysicalDeviceSubgroupProperties subgroup{};
+    subgroup.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &subgroup;
+    getProperties2(physicalDevice, &properties);
+    return (subgroup.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) && (subgroup.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) && subgroup.subgroupSize >= 4;
+}
+
+
+MipChain* MipGenerator::createChain(VkImage image, VkFormat format, VkExtent2D extent, uint32_t mipLevels){
+    if(format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB){
+        throw std::runtime_error("mip generator only supports RGBA8 images!");
+    }
+    if(extent.width == 0 || extent.height == 0 || extent.width > MAX_EXTENT || extent.height > MAX_EXTENT){
+        throw std::runtime_error("mip generator only supports images up to 4096x4096!");
+    }
+    if(mipLevels < 2 || mipLevels > MAX_MIPS){
+        throw std::runtime_error("mip generator needs 2 to 13 mip levels!");
+    }
+    if(freeSlots.empty()){
+        throw std::runtime_error("mip generator is out of chains!");
+    }
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    chains[slot] = std::make_unique<MipChain>();
+    MipChain& chain = *chains[slot];
+    chain.image = image;
+    chain.format = format;
+    chain.extent = extent;
+    chain.mipLevels = mipLevels;
+    chain.counterSlot = slot;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    if(vkCreateImageView(device, &viewInfo, nullptr, &chain.sourceView) != VK_SUCCESS){
+        throw std::runtime_error("failed to create mip source view!");
+    }
+    DEBUG_NAME(device, chain.sourceView, "mip source");
+    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+    for(uint32_t mip = 1; mip < mipLevels; mip++){
+        viewInfo.subresourceRange.baseMipLevel = mip;
+        VkImageView view;
+        if(vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS){
+            throw std::runtime_error("failed to create mip storage view!");
+        }
+        DEBUG_NAME(device, view, "mip " + std::to_string(mip) + " storage");
+        chain.storageViews.push_back(view);
+    }
+
+    VkDescriptorSetAllocateInfo setInfo{};
+    setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    setInfo.descriptorPool = descriptorPool;
+    setInfo.descriptorSetCount = 1;
+    setInfo.pSetLayouts = &setLayout;
+    if(vkAllocateDescriptorSets(device, &setInfo, &chain.set) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate mip generator descriptor set!");
+    }
+
+    VkDescriptorImageInfo sourceInfo{sampler, chain.sourceView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    //unused array elements repeat the last mip, the shader never touches them
+    VkDescriptorImageInfo storageInfos[MAX_MIPS - 1];
+    for(uint32_t i = 0; i < MAX_MIPS - 1; i++){
+        storageInfos[i] = {VK_NULL_HANDLE, chain.storageViews[std::min<size_t>(i, chain.storageViews.size() - 1)], VK_IMAGE_LAYOUT_GENERAL};
+    }
+    VkDescriptorBufferInfo counterInfo{counterBuffer, slot * counterStride, sizeof(uint32_t)};
+    VkWriteDescriptorSet writes[3]{};
+    for(uint32_t i = 0; i < 3; i++){
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = chain.set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &sourceInfo;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].descriptorCount = MAX_MIPS - 1;
+    writes[1].pImageInfo = storageInfos;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &counterInfo;
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+    return &chain;
+}
+
+void MipGenerator::destroyChain(MipChain* chain){
+    uint32_t slot = chain->counterSlot;
+    vkFreeDescriptorSets(device, descriptorPool, 1, &chain->set);
+    vkDestroyImageView(device, chain->sourceView, nullptr);
+    for(VkImageView view : chain->storageViews){
+        vkDestroyImageView(device, view, nullptr);
+    }
+    chains[slot].reset();
+    freeSlots.push_back(slot);
+}
+
+
+void MipGenerator::generate(VkCommandBuffer cmd, MipChain& chain, ImageStateTracker& tracker){
+    //the last workgroup reads mip 6 back, so the storage mips are read and written
+    ResourceAccess storageAccess{VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+    std::vector<VkImageMemoryBarrier2> barriers;
+    tracker.transition({VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}, resourceAccess(ResourceUsage::SampledCompute), barriers);
+    tracker.transition({VK_IMAGE_ASPECT_COLOR_BIT, 1, chain.mipLevels - 1, 0, 1}, storageAccess, barriers);
+    recordBarriers(cmd, cmdPipelineBarrier2, barriers);
+
+    uint32_t groupsX = (chain.extent.width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t groupsY = (chain.extent.height + TILE_SIZE - 1) / TILE_SIZE;
+    PushConstants constants{static_cast<int32_t>(chain.extent.width), static_cast<int32_t>(chain.extent.height), chain.mipLevels, groupsX * groupsY};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, (chain.format == VK_FORMAT_R8G8B8A8_SRGB) ? srgbPipeline : linearPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &chain.set, 0, nullptr);
+    vkCmdPushConstants(cmd, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+}
@@ -0,0 +1,371 @@
+#include <object_cache.hpp>
+#include <debug_names.hpp>
+
+#include <bit>
+#include <cstring>
+
+
+//every value takes 8 bytes so neighbouring fields can never run into each other
+static inline void writeValue(CreateInfoKey& key, uint64_t value){
+    key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+template<typename T>
+static inline uint64_t keyable(const T& value){
+    if constexpr(std::is_floating_point_v<T>){
+        return std::bit_cast<uint32_t>(static_cast<float>(value));
+    }
+    else if constexpr(std::is_pointer_v<T>){
+        return reinterpret_cast<uintptr_t>(value);
+    }
+    else{
+        return static_cast<uint64_t>(value);
+    }
+}
+//field by field, struct padding never gets into the key
+template<typename... Values>
+static inline void writeValues(CreateInfoKey& key, const Values&... values){
+    (writeValue(key, keyable(values)), ...);
+}
+//length first so a blob and whatever follows it stay apart
+static inline void writeBytes(CreateInfoKey& key, const void* data, size_t size){
+    size = data ? size : 0;
+    writeValue(key, size);
+    key.append(static_cast<const char*>(data), size);
+}
+//arrays of plain values(handles, enums, flags), count included so {} and nullptr agree
+template<typename T>
+static inline void writeArray(CreateInfoKey& key, const T* values, uint32_t count){
+    writeValue(key, count);
+    for(uint32_t i = 0; values && i < count; i++){
+        writeValue(key, keyable(values[i]));
+    }
+}
+
+//every struct in a pNext chain, only the ones we know the layout of
+static void writeChain(CreateInfoKey& key, const void* pNext){
+    for(auto* next = static_cast<const VkBaseInStructure*>(pNext); next != nullptr; next = next->pNext){
+        writeValues(key, next->sType);
+        switch(next->sType){
+            case VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO:{
+                auto* info = reinterpret_cast<const VkSamplerReductionModeCreateInfo*>(next);
+                writeValues(key, info->reductionMode);
+                break;
+            }
+            case VK_STRUCTURE_TYPE_SAMPLER_CUSTOM_BORDER_COLOR_CREATE_INFO_EXT:{
+                auto* info = reinterpret_cast<const VkSamplerCustomBorderColorCreateInfoEXT*>(next);
+                writeBytes(key, &info->customBorderColor, sizeof(info->customBorderColor));
+                writeValues(key, info->format);
+                break;
+            }
+            case VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO:{
+                auto* info = reinterpret_cast<const VkDescriptorSetLayoutBindingFlagsCreateInfo*>(next);
+                writeArray(key, info->pBindingFlags, info->bindingCount);
+                break;
+            }
+            case VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO:{
+                auto* info = reinterpret_cast<const VkPipelineRenderingCreateInfo*>(next);
+                writeValues(key, info->viewMask, info->depthAttachmentFormat, info->stencilAttachmentFormat);
+                writeArray(key, info->pColorAttachmentFormats, info->colorAttachmentCount);
+                break;
+            }
+            case VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT:{
+                auto* info = reinterpret_cast<const VkGraphicsPipelineLibraryCreateInfoEXT*>(next);
+                writeValues(key, info->flags);
+                break;
+            }
+            case VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR:{
+                auto* info = reinterpret_cast<const VkPipelineLibraryCreateInfoKHR*>(next);
+                writeArray(key, info->pLibraries, info->libraryCount);
+                break;
+            }
+            default:
+                throw std::runtime_error("object cache: can't key pNext struct of type " + std::to_string(next->sType) + "!");
+        }
+    }
+}
+
+static void writeShaderStage(CreateInfoKey& key, const VkPipelineShaderStageCreateInfo& stage){
+    writeChain(key, stage.pNext);
+    writeValues(key, stage.flags, stage.stage, stage.module);
+    writeBytes(key, stage.pName, stage.pName ? strlen(stage.pName) : 0);
+    writeValues(key, stage.pSpecializationInfo != nullptr);
+    if(const VkSpecializationInfo* specialization = stage.pSpecializationInfo){
+        writeValues(key, specialization->mapEntryCount);
+        for(uint32_t i = 0; i < specialization->mapEntryCount; i++){
+            const VkSpecializationMapEntry& entry = specialization->pMapEntries[i];
+            writeValues(key, entry.constantID, entry.offset, entry.size);
+        }
+        writeBytes(key, specialization->pData, specialization->dataSize);
+    }
+}
+
+
+CreateInfoKey createInfoKey(const VkSamplerCreateInfo& info){
+    CreateInfoKey key;
+    writeChain(key, info.pNext);
+    writeValues(key, info.flags, info.magFilter, info.minFilter, info.mipmapMode,
+        info.addressModeU, info.addressModeV, info.addressModeW, info.mipLodBias,
+        info.anisotropyEnable, info.maxAnisotropy, info.compareEnable, info.compareOp,
+        info.minLod, info.maxLod, info.borderColor, info.unnormalizedCoordinates);
+    return key;
+}
+
+CreateInfoKey createInfoKey(const VkDescriptorSetLayoutCreateInfo& info){
+    CreateInfoKey key;
+    writeChain(key, info.pNext);
+    writeValues(key, info.flags, info.bindingCount);
+    for(uint32_t i = 0; i < info.bindingCount; i++){
+        const VkDescriptorSetLayoutBinding& binding = info.pBindings[i];
+        writeValues(key, binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags);
+        //immutable samplers come from this cache too so their handles are stable
+        writeArray(key, binding.pImmutableSamplers, binding.pImmutableSamplers ? binding.descriptorCount : 0);
+    }
+    return key;
+}
+
+CreateInfoKey createInfoKey(const VkPipelineLayoutCreateInfo& info){
+    CreateInfoKey key;
+    writeChain(key, info.pNext);
+    writeValues(key, info.flags);
+    writeArray(key, info.pSetLayouts, info.setLayoutCount);
+    writeValues(key, info.pushConstantRangeCount);
+    for(uint32_t i = 0; i < info.pushConstantRangeCount; i++){
+        const VkPushConstantRange& range = info.pPushConstantRanges[i];
+        writeValues(key, range.stageFlags, range.offset, range.size);
+    }
+    return key;
+}
+
+CreateInfoKey createInfoKey(const VkGraphicsPipelineCreateInfo& info){
+    CreateInfoKey key;
+    writeChain(key, info.pNext);
+    writeValues(key, info.flags, info.layout, info.renderPass, info.subpass, info.stageCount);
+    for(uint32_t i = 0; i < info.stageCount; i++){
+        writeShaderStage(key, info.pStages[i]);
+    }
+
+    //a missing state block keys differently from any present one
+    writeValues(key, info.pVertexInputState != nullptr);
+    if(const auto* state = info.pVertexInputState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->vertexBindingDescriptionCount, state->vertexAttributeDescriptionCount);
+        for(uint32_t i = 0; i < state->vertexBindingDescriptionCount; i++){
+            const auto& binding = state->pVertexBindingDescriptions[i];
+            writeValues(key, binding.binding, binding.stride, binding.inputRate);
+        }
+        for(uint32_t i = 0; i < state->vertexAttributeDescriptionCount; i++){
+            const auto& attribute = state->pVertexAttributeDescriptions[i];
+            writeValues(key, attribute.location, attribute.binding, attribute.format, attribute.offset);
+        }
+    }
+    writeValues(key, info.pInputAssemblyState != nullptr);
+    if(const auto* state = info.pInputAssemblyState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->topology, state->primitiveRestartEnable);
+    }
+    writeValues(key, info.pTessellationState != nullptr);
+    if(const auto* state = info.pTessellationState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->patchControlPoints);
+    }
+    writeValues(key, info.pViewportState != nullptr);
+    if(const auto* state = info.pViewportState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->viewportCount, state->scissorCount);
+        //null when viewports/scissors are dynamic
+        for(uint32_t i = 0; state->pViewports && i < state->viewportCount; i++){
+            const VkViewport& viewport = state->pViewports[i];
+            writeValues(key, viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth);
+        }
+        for(uint32_t i = 0; state->pScissors && i < state->scissorCount; i++){
+            const VkRect2D& scissor = state->pScissors[i];
+            writeValues(key, scissor.offset.x, scissor.offset.y, scissor.extent.width, scissor.extent.height);
+        }
+    }
+    writeValues(key, info.pRasterizationState != nullptr);
+    if(const auto* state = info.pRasterizationState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->depthClampEnable, state->rasterizerDiscardEnable, state->polygonMode,
+            state->cullMode, state->frontFace, state->depthBiasEnable, state->depthBiasConstantFactor,
+            state->depthBiasClamp, state->depthBiasSlopeFactor, state->lineWidth);
+    }
+    writeValues(key, info.pMultisampleState != nullptr);
+    if(const auto* state = info.pMultisampleState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->rasterizationSamples, state->sampleShadingEnable, state->minSampleShading,
+            state->alphaToCoverageEnable, state->alphaToOneEnable);
+        writeArray(key, state->pSampleMask, state->pSampleMask ? (state->rasterizationSamples + 31) / 32 : 0);
+    }
+    writeValues(key, info.pDepthStencilState != nullptr);
+    if(const auto* state = info.pDepthStencilState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->depthTestEnable, state->depthWriteEnable, state->depthCompareOp,
+            state->depthBoundsTestEnable, state->stencilTestEnable, state->minDepthBounds, state->maxDepthBounds);
+        for(const VkStencilOpState& op : {state->front, state->back}){
+            writeValues(key, op.failOp, op.passOp, op.depthFailOp, op.compareOp, op.compareMask, op.writeMask, op.reference);
+        }
+    }
+    writeValues(key, info.pColorBlendState != nullptr);
+    if(const auto* state = info.pColorBlendState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags, state->logicOpEnable, state->logicOp, state->attachmentCount,
+            state->blendConstants[0], state->blendConstants[1], state->blendConstants[2], state->blendConstants[3]);
+        for(uint32_t i = 0; i < state->attachmentCount; i++){
+            const VkPipelineColorBlendAttachmentState& blend = state->pAttachments[i];
+            writeValues(key, blend.blendEnable, blend.srcColorBlendFactor, blend.dstColorBlendFactor, blend.colorBlendOp,
+                blend.srcAlphaBlendFactor, blend.dstAlphaBlendFactor, blend.alphaBlendOp, blend.colorWriteMask);
+        }
+    }
+    writeValues(key, info.pDynamicState != nullptr);
+    if(const auto* state = info.pDynamicState){
+        writeChain(key, state->pNext);
+        writeValues(key, state->flags);
+        writeArray(key, state->pDynamicStates, state->dynamicStateCount);
+    }
+    return key;
+}
+
+CreateInfoKey createInfoKey(const VkComputePipelineCreateInfo& info){
+    CreateInfoKey key;
+    writeChain(key, info.pNext);
+    writeValues(key, info.flags, info.layout);
+    writeShaderStage(key, info.stage);
+    return key;
+}
+
+
+//look up key, create on a miss
+//two threads missing at the same time both create, the loser destroys its copy and takes the winner's
+template<typename Handle, typename Create, typename Destroy>
+static Handle getOrCreate(CreateInfoMap<Handle>& map, const CreateInfoKey& key, std::atomic<uint64_t>& hits, std::atomic<uint64_t>& misses, Create create, Destroy destroy){
+    Handle handle;
+    if(map.find(key, handle)){
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return handle;
+    }
+    misses.fetch_add(1, std::memory_order_relaxed);
+    handle = create();
+    if(!map.insert(key, handle)){
+        destroy(handle);
+        map.find(key, handle);
+    }
+    return handle;
+}
+
+
+ObjectCache::ObjectCache(VkDevice device, VkPipelineCache pipelineCache) : device(device), pipelineCache(pipelineCache){
+
+}
+ObjectCache::~ObjectCache(){
+    //pipelines first, they reference the layouts
+    for(VkPipeline pipeline : pipelines.values()){
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    for(VkPipelineLayout layout : pipelineLayouts.values()){
+        vkDestroyPipelineLayout(device, layout, nullptr);
+    }
+    for(VkDescriptorSetLayout layout : descriptorSetLayouts.values()){
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+    for(VkSampler sampler : samplers.values()){
+        vkDestroySampler(device, sampler, nullptr);
+    }
+}
+
+VkSampler ObjectCache::sampler(const VkSamplerCreateInfo& info){
+    return getOrCreate(samplers, createInfoKey(info), hits, misses, [&](){
+        VkSampler sampler;
+        if(vkCreateSampler(device, &info, nullptr, &sampler) != VK_SUCCESS){
+            throw std::runtime_error("failed to create sampler!");
+        }
+        DEBUG_NAME(device, sampler, "cached sampler");
+        return sampler;
+    }, [&](VkSampler sampler){
+        vkDestroySampler(device, sampler, nullptr);
+    });
+}
+
+VkDescriptorSetLayout ObjectCache::descriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& info){
+    return getOrCreate(descriptorSetLayouts, createInfoKey(info), hits, misses, [&](){
+        VkDescriptorSetLayout layout;
+        if(vkCreateDescriptorSetLayout(device, &info, nullptr, &layout) != VK_SUCCESS){
+            throw std::runtime_error("failed to create descriptor set layout!");
+        }
+        DEBUG_NAME(device, layout, "cached descriptor set layout");
+        return layout;
+    }, [&](VkDescriptorSetLayout layout){
+        vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    });
+}
+
+VkPipelineLayout ObjectCache::pipelineLayout(const VkPipelineLayoutCreateInfo& info){
+    return getOrCreate(pipelineLayouts, createInfoKey(info), hits, misses, [&](){
+        VkPipelineLayout layout;
+        if(vkCreatePipelineLayout(device, &info, nullptr, &layout) != VK_SUCCESS){
+            throw std::runtime_error("failed to create pipeline layout!");
+        }
+        DEBUG_NAME(device, layout, "cached pipeline layout");
+        return layout;
+    }, [&](VkPipelineLayout layout){
+        vkDestroyPipelineLayout(device, layout, nullptr);
+    });
+}
+
+VkPipeline ObjectCache::graphicsPipeline(const VkGraphicsPipelineCreateInfo& info){
+    return getOrCreate(pipelines, createInfoKey(info), hits, misses, [&](){
+        VkPipeline pipeline;
+        if(vkCreateGraphicsPipelines(device, pipelineCache, 1, &info, nullptr, &pipeline) != VK_SUCCESS){
+            throw std::runtime_error("failed to create graphics pipeline!");
+        }
+        DEBUG_NAME(device, pipeline, "cached graphics pipeline");
+        return pipeline;
+    }, [&](VkPipeline pipeline){
+        vkDestroyPipeline(device, pipeline, nullptr);
+    });
+}
+
+VkPipeline ObjectCache::computePipeline(const VkComputePipelineCreateInfo& info){
+    return getOrCreate(pipelines, createInfoKey(info), hits, misses, [&](){
+        VkPipeline pipeline;
+        if(vkCreateComputePipelines(device, pipelineCache, 1, &info, nullptr, &pipeline) != VK_SUCCESS){
+            throw std::runtime_error("failed to create compute pipeline!");
+        }
+        DEBUG_NAME(device, pipeline, "cached compute pipeline");
+        return pipeline;
+    }, [&](VkPipeline pipeline){
+        vkDestroyPipeline(device, pipeline, nullptr);
+    });
+}
+
+VkPipeline ObjectCache::findPipeline(const CreateInfoKey& key) const{
+    VkPipeline pipeline;
+    if(pipelines.find(key, pipeline)){
+        hits.fetch_add(1, std::memory_order_relaxed);
+        return pipeline;
+    }
+    return VK_NULL_HANDLE;
+}
+VkPipeline ObjectCache::insertPipeline(const CreateInfoKey& key, VkPipeline pipeline){
+    if(!pipelines.insert(key, pipeline)){
+        vkDestroyPipeline(device, pipeline, nullptr);
+        pipelines.find(key, pipeline);
+    }
+    return pipeline;
+}
+
+ObjectCacheStats ObjectCache::stats() const{
+    ObjectCacheStats result;
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    result.samplers = samplers.size();
+    result.descriptorSetLayouts = descriptorSetLayouts.size();
+    result.pipelineLayouts = pipelineLayouts.size();
+    result.pipelines = pipelines.size();
+    return result;
+}
+void ObjectCache::printStats() const{
+    ObjectCacheStats s = stats();
+    std::cout << "Object cache: " << s.hits << " hits, " << s.misses << " misses\n";
+    std::cout << "\t" << s.samplers << " samplers, " << s.descriptorSetLayouts << " descriptor set layouts, "
+        << s.pipelineLayouts << " pipeline layouts, " << s.pipelines << " pipelines\n";
+}
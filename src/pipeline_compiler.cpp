@@ -0,0 +1,319 @@
+#include <pipeline_compiler.hpp>
+#include <debug_names.hpp>
+
+
+GraphicsPipelineDesc::GraphicsPipelineDesc(const VkGraphicsPipelineCreateInfo& source) : info(source){
+    info.pNext = nullptr;
+    info.basePipelineHandle = VK_NULL_HANDLE;
+    info.basePipelineIndex = -1;
+    for(auto* next = static_cast<const VkBaseInStructure*>(source.pNext); next != nullptr; next = next->pNext){
+        if(next->sType == VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO){
+            rendering = *reinterpret_cast<const VkPipelineRenderingCreateInfo*>(next);
+            rendering.pNext = nullptr;
+            colorFormats.assign(rendering.pColorAttachmentFormats, rendering.pColorAttachmentFormats + rendering.colorAttachmentCount);
+            rendering.pColorAttachmentFormats = colorFormats.data();
+            info.pNext = &rendering;
+        }
+        else{
+            throw std::runtime_error("pipeline compiler: unsupported pNext struct in graphics pipeline create info!");
+        }
+    }
+
+    //sized up front, the create infos point into these
+    stages.assign(source.pStages, source.pStages + source.stageCount);
+    entryPoints.resize(source.stageCount);
+    specializations.resize(source.stageCount);
+    specializationEntries.resize(source.stageCount);
+    specializationData.resize(source.stageCount);
+    for(uint32_t i = 0; i < source.stageCount; i++){
+        entryPoints[i] = stages[i].pName ? stages[i].pName : "main";
+        stages[i].pName = entryPoints[i].c_str();
+        if(const VkSpecializationInfo* specialization = stages[i].pSpecializationInfo){
+            specializationEntries[i].assign(specialization->pMapEntries, specialization->pMapEntries + specialization->mapEntryCount);
+            const uint8_t* data = static_cast<const uint8_t*>(specialization->pData);
+            specializationData[i].assign(data, data + specialization->dataSize);
+            specializations[i] = {specialization->mapEntryCount, specializationEntries[i].data(), specialization->dataSize, specializationData[i].data()};
+            stages[i].pSpecializationInfo = &specializations[i];
+        }
+    }
+    info.pStages = stages.data();
+
+    if(source.pVertexInputState){
+        vertexInput = *source.pVertexInputState;
+        vertexBindings.assign(vertexInput.pVertexBindingDescriptions, vertexInput.pVertexBindingDescriptions + vertexInput.vertexBindingDescriptionCount);
+        vertexAttributes.assign(vertexInput.pVertexAttributeDescriptions, vertexInput.pVertexAttributeDescriptions + vertexInput.vertexAttributeDescriptionCount);
+        vertexInput.pVertexBindingDescriptions = vertexBindings.data();
+        vertexInput.pVertexAttributeDescriptions = vertexAttributes.data();
+        info.pVertexInputState = &vertexInput;
+    }
+    if(source.pInputAssemblyState){
+        inputAssembly = *source.pInputAssemblyState;
+        info.pInputAssemblyState = &inputAssembly;
+    }
+    if(source.pTessellationState){
+        tessellation = *source.pTessellationState;
+        info.pTessellationState = &tessellation;
+    }
+    if(source.pViewportState){
+        viewport = *source.pViewportState;
+        if(viewport.pViewports){
+            viewports.assign(viewport.pViewports, viewport.pViewports + viewport.viewportCount);
+            viewport.pViewports = viewports.data();
+        }
+        if(viewport.pScissors){
+            scissors.assign(viewport.pScissors, viewport.pScissors + viewport.scissorCount);
+            viewport.pScissors = scissors.data();
+        }
+        info.pViewportState = &viewport;
+    }
+    if(source.pRasterizationState){
+        rasterization = *source.pRasterizationState;
+        info.pRasterizationState = &rasterization;
+    }
+    if(source.pMultisampleState){
+        multisample = *source.pMultisampleState;
+        if(multisample.pSampleMask){
+            sampleMask.assign(multisample.pSampleMask, multisample.pSampleMask + (multisample.rasterizationSamples + 31) / 32);
+            multisample.pSampleMask = sampleMask.data();
+        }
+        info.pMultisampleState = &multisample;
+    }
+    if(source.pDepthStencilState){
+        depthStencil = *source.pDepthStencilState;
+        info.pDepthStencilState = &depthStencil;
+    }
+    if(source.pColorBlendState){
+        colorBlend = *source.pColorBlendState;
+        blendAttachments.assign(colorBlend.pAttachments, colorBlend.pAttachments + colorBlend.attachmentCount);
+        colorBlend.pAttachments = blendAttachments.data();
+        info.pColorBlendState = &colorBlend;
+    }
+    if(source.pDynamicState){
+        dynamic = *source.pDynamicState;
+        dynamicStates.assign(dynamic.pDynamicStates, dynamic.pDynamicStates + dynamic.dynamicStateCount);
+        dynamic.pDynamicStates = dynamicStates.data();
+        info.pDynamicState = &dynamic;
+    }
+}
+
+
+bool supportsGraphicsPipelineLibrary(VkPhysicalDevice physicalDevice){
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+    for(const auto& extension : extensions){
+        if(strcmp(extension.extensionName, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+
+PipelineCompiler::PipelineCompiler(VkDevice device, ObjectCache& cache, JobSystem& jobs, bool graphicsPipelineLibrary) : device(device), cache(cache), jobs(jobs), useLibraries(graphicsPipelineLibrary){
+    std::cout << "Pipeline compiler using " << (useLibraries ? "graphics pipeline libraries" : "full background compiles") << "\n";
+}
+PipelineCompiler::~PipelineCompiler(){
+    waitIdle();
+    //optimized pipelines belong to the object cache, only the fast linked ones are ours
+    for(VkPipeline pipeline : fastLinked.values()){
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    for(VkPipeline pipeline : retired){
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+}
+
+void PipelineCompiler::waitIdle(){
+    jobs.wait(inFlight);
+}
+
+VkPipeline PipelineCompiler::request(const VkGraphicsPipelineCreateInfo& info, VkPipeline fallback){
+    requests.fetch_add(1, std::memory_order_relaxed);
+    CreateInfoKey key = createInfoKey(info);
+    if(VkPipeline pipeline = cache.findPipeline(key)){
+        return pipeline;
+    }
+    VkPipeline fast;
+    if(fastLinked.find(key, fast)){
+        return fast;
+    }
+
+    fallbacks.fetch_add(1, std::memory_order_relaxed);
+    //only the first request for a create info schedules anything
+    if(scheduled.insert(key, true)){
+        //the caller's create info dies with its stack frame, the job gets its own copy
+        auto desc = std::make_shared<GraphicsPipelineDesc>(info);
+        if(useLibraries){
+            jobs.run("pipeline link", [this, key, desc](){
+                compileWithLibraries(key, desc);
+            }, &inFlight, JobPriority::High);
+        }
+        else{
+            jobs.run("pipeline compile", [this, key, desc](){
+                compile(key, *desc);
+            }, &inFlight, JobPriority::Low);
+        }
+    }
+    return fallback;
+}
+
+void PipelineCompiler::compile(const CreateInfoKey& key, const GraphicsPipelineDesc& desc){
+    auto start = std::chrono::steady_clock::now();
+    try{
+        //the cache creates it under the same key request() looks up
+        cache.graphicsPipeline(desc.createInfo());
+    }
+    catch(const std::exception& e){
+        //stays scheduled so a broken pipeline isn't retried every frame
+        std::cout << "Pipeline " << std::hex << hashCreateInfoKey(key) << std::dec << " failed to compile: " << e.what() << "\n";
+        return;
+    }
+    compileNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    compiled.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PipelineCompiler::compileWithLibraries(const CreateInfoKey& key, std::shared_ptr<GraphicsPipelineDesc> desc){
+    const VkGraphicsPipelineCreateInfo& full = desc->createInfo();
+    std::vector<VkPipelineShaderStageCreateInfo> preRasterStages, fragmentStages;
+    for(uint32_t i = 0; i < full.stageCount; i++){
+        if(full.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT){
+            fragmentStages.push_back(full.pStages[i]);
+        }
+        else{
+            preRasterStages.push_back(full.pStages[i]);
+        }
+    }
+
+    //one library per interface, each only gets the state the spec assigns to it
+    //libraries are ordinary cached pipelines so materials sharing a vertex format or blend state share them
+    VkPipeline libraries[4];
+    try{
+        const VkGraphicsPipelineLibraryFlagsEXT parts[4] = {
+            VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+            VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+            VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+            VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+        };
+        for(int i = 0; i < 4; i++){
+            VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+            libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+            libraryInfo.pNext = full.pNext; //dynamic rendering formats, if any
+            libraryInfo.flags = parts[i];
+
+            VkGraphicsPipelineCreateInfo part{};
+            part.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            part.pNext = &libraryInfo;
+            part.flags = full.flags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+            part.pDynamicState = full.pDynamicState;
+            part.basePipelineIndex = -1;
+            switch(parts[i]){
+                case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+                    part.pVertexInputState = full.pVertexInputState;
+                    part.pInputAssemblyState = full.pInputAssemblyState;
+                    break;
+                case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+                    part.stageCount = static_cast<uint32_t>(preRasterStages.size());
+                    part.pStages = preRasterStages.data();
+                    part.pViewportState = full.pViewportState;
+                    part.pRasterizationState = full.pRasterizationState;
+                    part.pTessellationState = full.pTessellationState;
+                    part.layout = full.layout;
+                    part.renderPass = full.renderPass;
+                    part.subpass = full.subpass;
+                    break;
+                case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+                    part.stageCount = static_cast<uint32_t>(fragmentStages.size());
+                    part.pStages = fragmentStages.data();
+                    part.pDepthStencilState = full.pDepthStencilState;
+                    part.pMultisampleState = full.pMultisampleState;
+                    part.layout = full.layout;
+                    part.renderPass = full.renderPass;
+                    part.subpass = full.subpass;
+                    break;
+                default:
+                    part.pColorBlendState = full.pColorBlendState;
+                    part.pMultisampleState = full.pMultisampleState;
+                    part.renderPass = full.renderPass;
+                    part.subpass = full.subpass;
+                    break;
+            }
+            libraries[i] = cache.graphicsPipeline(part);
+        }
+
+        VkPipeline fast = link(full, libraries, false);
+        if(!fastLinked.insert(key, fast)){
+            vkDestroyPipeline(device, fast, nullptr);
+        }
+        linked.fetch_add(1, std::memory_order_relaxed);
+    }
+    catch(const std::exception& e){
+        std::cout << "Pipeline " << std::hex << hashCreateInfoKey(key) << std::dec << " failed to link: " << e.what() << "\n";
+        return;
+    }
+
+    //the fast link is usable now, the optimized one replaces it whenever a worker gets to it
+    std::vector<VkPipeline> libraryList(libraries, libraries + 4);
+    jobs.run("pipeline optimize", [this, key, desc, libraryList](){
+        auto start = std::chrono::steady_clock::now();
+        VkPipeline optimized;
+        try{
+            optimized = link(desc->createInfo(), libraryList.data(), true);
+        }
+        catch(const std::exception& e){
+            //not fatal, we keep drawing with the fast link
+            std::cout << "Pipeline " << std::hex << hashCreateInfoKey(key) << std::dec << " failed to optimize: " << e.what() << "\n";
+            return;
+        }
+        cache.insertPipeline(key, optimized);
+        compileNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+        compiled.fetch_add(1, std::memory_order_relaxed);
+        //frames in flight may still use the fast link, keep it until we are destroyed
+        VkPipeline fast;
+        if(fastLinked.pop(key, fast)){
+            std::lock_guard<std::mutex> lock(retiredMutex);
+            retired.push_back(fast);
+        }
+    }, &inFlight, JobPriority::Low);
+}
+
+VkPipeline PipelineCompiler::link(const VkGraphicsPipelineCreateInfo& info, const VkPipeline* libraries, bool optimize){
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = 4;
+    libraryInfo.pLibraries = libraries;
+
+    VkGraphicsPipelineCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.pNext = &libraryInfo;
+    createInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    createInfo.layout = info.layout;
+    createInfo.basePipelineIndex = -1;
+
+    VkPipeline pipeline;
+    if(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pipeline) != VK_SUCCESS){
+        throw std::runtime_error("failed to link graphics pipeline libraries!");
+    }
+    DEBUG_NAME(device, pipeline, optimize ? "linked pipeline(optimized)" : "linked pipeline(fast link)");
+    return pipeline;
+}
+
+PipelineCompilerStats PipelineCompiler::stats() const{
+    PipelineCompilerStats result;
+    result.requests = requests.load(std::memory_order_relaxed);
+    result.fallbacks = fallbacks.load(std::memory_order_relaxed);
+    result.compiled = compiled.load(std::memory_order_relaxed);
+    result.fastLinked = linked.load(std::memory_order_relaxed);
+    result.compileNs = compileNs.load(std::memory_order_relaxed);
+    return result;
+}
+void PipelineCompiler::printStats() const{
+    PipelineCompilerStats s = stats();
+    std::cout << "Pipeline compiler: " << s.requests << " requests, " << s.fallbacks << " fallbacks, "
+        << s.compiled << " compiled, " << s.fastLinked << " fast linked";
+    if(s.compiled > 0){
+        std::cout << ", " << (s.compileNs / s.compiled) / 1000 << " us per compile";
+    }
+    std::cout << "\n";
+}
@@ -0,0 +1,1041 @@
+#include <render_graph.hpp>
+#include <gpu_memory.hpp>
+#include <gpu_profiler.hpp>
+#include <debug_names.hpp>
+
+#include <vulkan/utility/vk_format_utils.h>
+
+#include <array>
+
+
+ResourceAccess resourceAccess(ResourceUsage usage){
+    switch(usage){
+        case ResourceUsage::ColorAttachment:
+            return {VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+        case ResourceUsage::DepthAttachment:
+            return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+        case ResourceUsage::DepthRead:
+            return {VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+        case ResourceUsage::SampledFragment:
+            return {VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case ResourceUsage::SampledCompute:
+            return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+        case ResourceUsage::StorageReadCompute:
+            return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+        case ResourceUsage::StorageWriteCompute:
+            return {VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+        case ResourceUsage::TransferSrc:
+            return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+        case ResourceUsage::TransferDst:
+            return {VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+        case ResourceUsage::VertexBuffer:
+            return {VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case ResourceUsage::IndexBuffer:
+            return {VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case ResourceUsage::IndirectBuffer:
+            return {VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case ResourceUsage::UniformBuffer:
+            return {VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+        case ResourceUsage::Present:
+            //presentation engine waits on a semaphore, nothing to wait for inside the queue
+            return {VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+    }
+    return {};
+}
+
+//creation usage flags a resource needs for all the ways passes use it
+static VkImageUsageFlags imageUsageFlags(ResourceUsage usage){
+    switch(usage){
+        case ResourceUsage::ColorAttachment:
+            return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        case ResourceUsage::DepthAttachment:
+        case ResourceUsage::DepthRead:
+            return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        case ResourceUsage::SampledFragment:
+        case ResourceUsage::SampledCompute:
+            return VK_IMAGE_USAGE_SAMPLED_BIT;
+        case ResourceUsage::StorageReadCompute:
+        case ResourceUsage::StorageWriteCompute:
+            return VK_IMAGE_USAGE_STORAGE_BIT;
+        case ResourceUsage::TransferSrc:
+            return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        case ResourceUsage::TransferDst:
+            return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        default:
+            return 0;
+    }
+}
+static VkBufferUsageFlags bufferUsageFlags(ResourceUsage usage){
+    switch(usage){
+        case ResourceUsage::StorageReadCompute:
+        case ResourceUsage::StorageWriteCompute:
+            return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        case ResourceUsage::TransferSrc:
+            return VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        case ResourceUsage::TransferDst:
+            return VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        case ResourceUsage::VertexBuffer:
+            return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        case ResourceUsage::IndexBuffer:
+            return VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+        case ResourceUsage::IndirectBuffer:
+            return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+        case ResourceUsage::UniformBuffer:
+            return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        default:
+            return 0;
+    }
+}
+//stages a queue without graphics can execute, what async compute passes are limited to
+static constexpr VkPipelineStageFlags2 COMPUTE_QUEUE_STAGES = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+
+static VkImageAspectFlags imageAspect(VkFormat format){
+    VkImageAspectFlags aspect = 0;
+    if(vkuFormatHasDepth(format)){
+        aspect |= VK_IMAGE_ASPECT_DEPTH_BIT;
+    }
+    if(vkuFormatHasStencil(format)){
+        aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return aspect ? aspect : static_cast<VkImageAspectFlags>(VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+
+RenderGraphPass& RenderGraphPass::read(RenderGraphResource resource, ResourceUsage usage){
+    uses.push_back({resource, usage});
+    return *this;
+}
+RenderGraphPass& RenderGraphPass::write(RenderGraphResource resource, ResourceUsage usage){
+    if(!resourceAccess(usage).write){
+        throw std::runtime_error("render graph: pass '" + name + "' writes with a read only usage!");
+    }
+    uses.push_back({resource, usage});
+    return *this;
+}
+
+
+RenderGraph::RenderGraph(VkDevice device, VkPhysicalDevice physicalDevice) : device(device), physicalDevice(physicalDevice){
+    if(device != VK_NULL_HANDLE){
+        //core in 1.3, the KHR name works on 1.1/1.2 devices with the extension enabled
+        cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2) vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2");
+        if(cmdPipelineBarrier2 == nullptr){
+            cmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2) vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+        }
+        if(cmdPipelineBarrier2 == nullptr){
+            throw std::runtime_error("render graph: device does not support synchronization2!");
+        }
+        queueSubmit2 = (PFN_vkQueueSubmit2) vkGetDeviceProcAddr(device, "vkQueueSubmit2");
+        if(queueSubmit2 == nullptr){
+            queueSubmit2 = (PFN_vkQueueSubmit2) vkGetDeviceProcAddr(device, "vkQueueSubmit2KHR");
+        }
+    }
+}
+RenderGraph::~RenderGraph(){
+    destroyTransientResources();
+    destroyQueueObjects();
+}
+
+RenderGraphResource RenderGraph::createImage(const std::string& name, const RenderGraphImageDesc& desc){
+    Resource resource;
+    resource.name = name;
+    resource.imageDesc = desc;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+RenderGraphResource RenderGraph::createBuffer(const std::string& name, const RenderGraphBufferDesc& desc){
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.bufferDesc = desc;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+RenderGraphResource RenderGraph::importImage(const std::string& name, VkImage image, VkImageView view, const RenderGraphImageDesc& desc, ResourceAccess initial, ResourceUsage finalUsage){
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.imageDesc = desc;
+    resource.image = image;
+    resource.view = view;
+    resource.initial = initial;
+    resource.hasFinalUsage = true;
+    resource.finalUsage = finalUsage;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+RenderGraphResource RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, const RenderGraphBufferDesc& desc, ResourceAccess initial){
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = true;
+    resource.bufferDesc = desc;
+    resource.buffer = buffer;
+    resource.initial = initial;
+    resources.push_back(resource);
+    return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+RenderGraphPass& RenderGraph::addPass(const std::string& name, RenderGraphExecute execute){
+    RenderGraphPass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    passes.push_back(std::move(pass));
+    return passes.back();
+}
+
+VkImage RenderGraph::image(RenderGraphResource resource) const{
+    return resources[resource].image;
+}
+VkImageView RenderGraph::imageView(RenderGraphResource resource) const{
+    return resources[resource].view;
+}
+VkBuffer RenderGraph::buffer(RenderGraphResource resource) const{
+    return resources[resource].buffer;
+}
+const RenderGraphImageDesc& RenderGraph::imageDesc(RenderGraphResource resource) const{
+    return resources[resource].imageDesc;
+}
+
+
+void RenderGraph::compile(){
+    destroyTransientResources();
+    statistics = {};
+    statistics.passes = static_cast<uint32_t>(passes.size());
+
+    cullPasses();
+    buildSubmissions();
+    computeLifetimes();
+    createTransientResources();
+    aliasMemory();
+    buildBarriers();
+}
+
+void RenderGraph::cullPasses(){
+    //walk backwards, a pass survives if it has side effects, writes something imported,
+    //or writes something a surviving pass reads
+    std::vector<bool> needed(resources.size(), false);
+    for(size_t i = 0; i < resources.size(); i++){
+        needed[i] = resources[i].imported;
+    }
+    for(size_t p = passes.size(); p-- > 0;){
+        RenderGraphPass& pass = passes[p];
+        bool keep = pass.hasSideEffects;
+        for(const auto& use : pass.uses){
+            if(resourceAccess(use.usage).write && needed[use.resource]){
+                keep = true;
+            }
+        }
+        pass.culled = !keep;
+        if(!keep){
+            statistics.culledPasses++;
+            continue;
+        }
+        for(const auto& use : pass.uses){
+            if(!resourceAccess(use.usage).write){
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::buildSubmissions(){
+    submissions.clear();
+    uint32_t ordinals[QUEUE_COUNT] = {};
+    auto open = [&](uint32_t queue){
+        Submission submission;
+        submission.queue = queue;
+        submission.ordinal = ++ordinals[queue];
+        submissions.push_back(submission);
+    };
+    //graphics first, the frame's waits(acquire) go there and whatever used imported resources before
+    //the graph counts as part of it, with an async queue it stays empty so compute only waits for the frame
+    //to start and not for the graphics passes in front of it
+    open(GRAPHICS_QUEUE);
+    for(uint32_t p = 0; p < passes.size(); p++){
+        const RenderGraphPass& pass = passes[p];
+        if(pass.culled){
+            continue;
+        }
+        if(pass.onAsyncCompute){
+            for(const auto& use : pass.uses){
+                if((resourceAccess(use.usage).stage & COMPUTE_QUEUE_STAGES) == 0){
+                    throw std::runtime_error("render graph: async compute pass '" + pass.name + "' has a graphics only usage!");
+                }
+            }
+        }
+        uint32_t queue = (pass.onAsyncCompute && hasAsyncCompute()) ? COMPUTE_QUEUE : GRAPHICS_QUEUE;
+        if(submissions.back().queue != queue || (hasAsyncCompute() && submissions.size() == 1)){
+            open(queue);
+        }
+        submissions.back().passes.push_back(p);
+    }
+    //and last, the final transitions, the frame's signals and its fence
+    if(submissions.back().queue != GRAPHICS_QUEUE){
+        open(GRAPHICS_QUEUE);
+    }
+
+    statistics.submissions = static_cast<uint32_t>(submissions.size());
+    statistics.asyncSubmissions = ordinals[COMPUTE_QUEUE];
+}
+
+void RenderGraph::computeLifetimes(){
+    for(auto& resource : resources){
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.queueMask = 0;
+        resource.memoryBlock = UINT32_MAX;
+        resource.aliasPredecessors.clear();
+    }
+    for(const Submission& submission : submissions){
+        for(uint32_t p : submission.passes){
+            for(const auto& use : passes[p].uses){
+                Resource& resource = resources[use.resource];
+                resource.firstPass = std::min(resource.firstPass, p);
+                resource.lastPass = std::max(resource.lastPass, p);
+                resource.queueMask |= 1u << submission.queue;
+            }
+        }
+    }
+}
+
+void RenderGraph::createTransientResources(){
+    //resources both queues touch are shared without ownership transfers, that needs concurrent sharing
+    //unless both queues are in the same family
+    uint32_t families[] = {queues.graphicsFamily, queues.computeFamily};
+    bool concurrent = hasAsyncCompute() && queues.graphicsFamily != queues.computeFamily;
+    for(RenderGraphResource r = 0; r < resources.size(); r++){
+        Resource& resource = resources[r];
+        if(resource.imported || resource.firstPass == UINT32_MAX){
+            continue;
+        }
+        //gather every usage so one image/buffer serves all passes
+        VkImageUsageFlags imageUsage = 0;
+        VkBufferUsageFlags bufferUsage = 0;
+        for(const auto& pass : passes){
+            if(pass.culled){
+                continue;
+            }
+            for(const auto& use : pass.uses){
+                if(use.resource == r){
+                    imageUsage |= imageUsageFlags(use.usage);
+                    bufferUsage |= bufferUsageFlags(use.usage);
+                }
+            }
+        }
+
+        if(device == VK_NULL_HANDLE){
+            //dry run, estimate what the driver would ask for
+            if(resource.isImage){
+                const RenderGraphImageDesc& desc = resource.imageDesc;
+                VkExtent3D block = vkuFormatTexelBlockExtent(desc.format);
+                VkDeviceSize size = 0;
+                for(uint32_t mip = 0; mip < desc.mipLevels; mip++){
+                    VkDeviceSize w = (std::max(desc.extent.width >> mip, 1u) + block.width - 1) / block.width;
+                    VkDeviceSize h = (std::max(desc.extent.height >> mip, 1u) + block.height - 1) / block.height;
+                    VkDeviceSize d = (std::max(desc.extent.depth >> mip, 1u) + block.depth - 1) / block.depth;
+                    size += w * h * d * vkuFormatTexelBlockSize(desc.format);
+                }
+                resource.requirements.size = size * desc.arrayLayers * desc.samples;
+                resource.requirements.alignment = 65536;
+            }
+            else{
+                resource.requirements.size = resource.bufferDesc.size;
+                resource.requirements.alignment = 256;
+            }
+            resource.requirements.memoryTypeBits = ~0u;
+            continue;
+        }
+
+        if(resource.isImage){
+            const RenderGraphImageDesc& desc = resource.imageDesc;
+            VkImageCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            createInfo.imageType = (desc.extent.depth > 1) ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D;
+            createInfo.format = desc.format;
+            createInfo.extent = desc.extent;
+            createInfo.mipLevels = desc.mipLevels;
+            createInfo.arrayLayers = desc.arrayLayers;
+            createInfo.samples = desc.samples;
+            createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            createInfo.usage = imageUsage;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if(concurrent && resource.queueMask == (1u << GRAPHICS_QUEUE | 1u << COMPUTE_QUEUE)){
+                createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                createInfo.queueFamilyIndexCount = QUEUE_COUNT;
+                createInfo.pQueueFamilyIndices = families;
+            }
+            createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if(vkCreateImage(device, &createInfo, nullptr, &resource.image) != VK_SUCCESS){
+                throw std::runtime_error("render graph: failed to create image '" + resource.name + "'!");
+            }
+            DEBUG_NAME(device, resource.image, "render graph: " + resource.name);
+            vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+        }
+        else{
+            VkBufferCreateInfo createInfo{};
+            createInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            createInfo.size = resource.bufferDesc.size;
+            createInfo.usage = bufferUsage;
+            createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            if(concurrent && resource.queueMask == (1u << GRAPHICS_QUEUE | 1u << COMPUTE_QUEUE)){
+                createInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                createInfo.queueFamilyIndexCount = QUEUE_COUNT;
+                createInfo.pQueueFamilyIndices = families;
+            }
+            if(vkCreateBuffer(device, &createInfo, nullptr, &resource.buffer) != VK_SUCCESS){
+                throw std::runtime_error("render graph: failed to create buffer '" + resource.name + "'!");
+            }
+            DEBUG_NAME(device, resource.buffer, "render graph: " + resource.name);
+            vkGetBufferMemoryRequirements(device, resource.buffer, &resource.requirements);
+        }
+    }
+}
+
+void RenderGraph::aliasMemory(){
+    //group resources that can share an allocation, images and buffers are kept apart so
+    //bufferImageGranularity never matters
+    std::vector<RenderGraphResource> order;
+    for(RenderGraphResource r = 0; r < resources.size(); r++){
+        if(!resources[r].imported && resources[r].firstPass != UINT32_MAX){
+            order.push_back(r);
+            statistics.transientBytes += resources[r].requirements.size;
+        }
+    }
+    //biggest first packs much tighter
+    std::stable_sort(order.begin(), order.end(), [this](RenderGraphResource a, RenderGraphResource b){
+        return resources[a].requirements.size > resources[b].requirements.size;
+    });
+
+    //pass order says nothing about when passes on different queues run, sharing memory across them
+    //would also make one queue wait for the other, so those never alias
+    bool asyncCompute = hasAsyncCompute();
+    auto lifetimesOverlap = [asyncCompute](const Resource& a, const Resource& b){
+        if(asyncCompute && a.queueMask != b.queueMask){
+            return true;
+        }
+        return a.firstPass <= b.lastPass && b.firstPass <= a.lastPass;
+    };
+    auto memoryOverlaps = [](const Resource& a, const Resource& b){
+        return a.memoryOffset < b.memoryOffset + b.requirements.size && b.memoryOffset < a.memoryOffset + a.requirements.size;
+    };
+
+    std::vector<std::vector<RenderGraphResource>> placedPerBlock;
+    std::vector<bool> blockHoldsImages;
+    for(RenderGraphResource r : order){
+        Resource& resource = resources[r];
+        //first block of the same kind whose memory types work for us
+        uint32_t block = UINT32_MAX;
+        for(uint32_t b = 0; b < memoryBlocks.size(); b++){
+            if(blockHoldsImages[b] == resource.isImage && (memoryBlocks[b].memoryTypeBits & resource.requirements.memoryTypeBits)){
+                block = b;
+                break;
+            }
+        }
+        if(block == UINT32_MAX){
+            block = static_cast<uint32_t>(memoryBlocks.size());
+            memoryBlocks.push_back({resource.requirements.memoryTypeBits, 0, VK_NULL_HANDLE});
+            placedPerBlock.emplace_back();
+            blockHoldsImages.push_back(resource.isImage);
+        }
+        memoryBlocks[block].memoryTypeBits &= resource.requirements.memoryTypeBits;
+
+        //ranges taken by resources alive at the same time as us, sorted by offset
+        std::vector<std::pair<VkDeviceSize, VkDeviceSize>> taken;
+        for(RenderGraphResource other : placedPerBlock[block]){
+            if(lifetimesOverlap(resource, resources[other])){
+                taken.push_back({resources[other].memoryOffset, resources[other].memoryOffset + resources[other].requirements.size});
+            }
+        }
+        std::sort(taken.begin(), taken.end());
+        //lowest aligned gap that fits
+        VkDeviceSize alignment = std::max<VkDeviceSize>(resource.requirements.alignment, 1);
+        VkDeviceSize offset = 0;
+        for(const auto& range : taken){
+            if(offset + resource.requirements.size <= range.first){
+                break;
+            }
+            offset = std::max(offset, (range.second + alignment - 1) / alignment * alignment);
+        }
+        resource.memoryBlock = block;
+        resource.memoryOffset = offset;
+        memoryBlocks[block].size = std::max(memoryBlocks[block].size, offset + resource.requirements.size);
+        placedPerBlock[block].push_back(r);
+    }
+
+    //whoever used our memory before us has to finish before our first use
+    for(const auto& placed : placedPerBlock){
+        for(RenderGraphResource r : placed){
+            for(RenderGraphResource other : placed){
+                const Resource& a = resources[r];
+                const Resource& b = resources[other];
+                if(r != other && b.lastPass < a.firstPass && memoryOverlaps(a, b)){
+                    resources[r].aliasPredecessors.push_back(other);
+                }
+            }
+        }
+    }
+
+    for(const auto& block : memoryBlocks){
+        statistics.allocatedBytes += block.size;
+    }
+    if(device == VK_NULL_HANDLE){
+        return;
+    }
+
+    //allocate, bind and create views
+    for(auto& block : memoryBlocks){
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if(allocateMemory(device, allocInfo, MemoryCategory::RenderTarget, &block.memory) != VK_SUCCESS){
+            throw std::runtime_error("render graph: failed to allocate transient memory!");
+        }
+        DEBUG_NAME(device, block.memory, "render graph: transient block " + std::to_string(&block - memoryBlocks.data()));
+    }
+    for(RenderGraphResource r : order){
+        Resource& resource = resources[r];
+        VkDeviceMemory memory = memoryBlocks[resource.memoryBlock].memory;
+        if(!resource.isImage){
+            vkBindBufferMemory(device, resource.buffer, memory, resource.memoryOffset);
+            continue;
+        }
+        vkBindImageMemory(device, resource.image, memory, resource.memoryOffset);
+
+        const RenderGraphImageDesc& desc = resource.imageDesc;
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image;
+        viewInfo.viewType = (desc.extent.depth > 1) ? VK_IMAGE_VIEW_TYPE_3D : ((desc.arrayLayers > 1) ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D);
+        viewInfo.format = desc.format;
+        viewInfo.subresourceRange = {imageAspect(desc.format), 0, desc.mipLevels, 0, desc.arrayLayers};
+        if(vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS){
+            throw std::runtime_error("render graph: failed to create image view for '" + resource.name + "'!");
+        }
+        DEBUG_NAME(device, resource.view, "render graph: " + resource.name);
+    }
+}
+
+void RenderGraph::addTransition(BarrierBatch& batch, RenderGraphResource r, TrackedState& state, const ResourceAccess& next, VkPipelineStageFlags2 semaphoreStage){
+    const Resource& resource = resources[r];
+    bool layoutChange = resource.isImage && state.layout != next.layout;
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+
+    if(next.write || layoutChange){
+        //writes and layout changes wait for the last write(RAW/WAW) and every read since(WAR)
+        srcStage = state.writeStage | state.readStages;
+        srcAccess = state.writeAccess;
+        if(srcStage == VK_PIPELINE_STAGE_2_NONE && !layoutChange){
+            //very first use, nothing to wait for
+            state.writeStage = next.write ? next.stage : VK_PIPELINE_STAGE_2_NONE;
+            state.writeAccess = next.write ? next.access : VK_ACCESS_2_NONE;
+            state.readStages = next.write ? VK_PIPELINE_STAGE_2_NONE : next.stage;
+            state.readAccess = next.write ? VK_ACCESS_2_NONE : next.access;
+            return;
+        }
+    }
+    else{
+        //read after read in the same layout is free, read after write only for stages not synchronized yet
+        bool covered = (next.stage & ~state.readStages) == 0 && (next.access & ~state.readAccess) == 0;
+        if(state.writeStage == VK_PIPELINE_STAGE_2_NONE || covered){
+            state.readStages |= next.stage;
+            state.readAccess |= next.access;
+            return;
+        }
+        srcStage = state.writeStage;
+        srcAccess = state.writeAccess;
+    }
+
+    if(layoutChange){
+        //the semaphore made the other queue's accesses visible at semaphoreStage, the transition must come after it
+        srcStage |= semaphoreStage;
+    }
+
+    if(resource.isImage){
+        const RenderGraphImageDesc& desc = resource.imageDesc;
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = srcStage;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = next.stage;
+        barrier.dstAccessMask = next.access;
+        barrier.oldLayout = state.layout;
+        barrier.newLayout = next.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = resource.image;
+        barrier.subresourceRange = {imageAspect(desc.format), 0, desc.mipLevels, 0, desc.arrayLayers};
+        batch.imageBarriers.push_back(barrier);
+    }
+    else{
+        //buffers never change layout, one global memory barrier covers all of them
+        if(!batch.hasMemoryBarrier){
+            batch.memoryBarrier = {};
+            batch.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            batch.hasMemoryBarrier = true;
+        }
+        batch.memoryBarrier.srcStageMask |= srcStage;
+        batch.memoryBarrier.srcAccessMask |= srcAccess;
+        batch.memoryBarrier.dstStageMask |= next.stage;
+        batch.memoryBarrier.dstAccessMask |= next.access;
+    }
+
+    state.layout = next.layout;
+    if(next.write){
+        state.writeStage = next.stage;
+        state.writeAccess = next.access;
+        state.readStages = VK_PIPELINE_STAGE_2_NONE;
+        state.readAccess = VK_ACCESS_2_NONE;
+    }
+    else if(layoutChange){
+        //the transition is a write that finished before next.stage, later readers chain off that
+        state.writeStage = next.stage;
+        state.writeAccess = VK_ACCESS_2_NONE;
+        state.readStages = next.stage;
+        state.readAccess = next.access;
+    }
+    else{
+        state.readStages |= next.stage;
+        state.readAccess |= next.access;
+    }
+}
+
+void RenderGraph::buildBarriers(){
+    //stages and accesses are tracked per queue, a barrier only ever orders work on its own queue
+    //the layout belongs to the resource, whichever queue changed it last
+    std::vector<std::array<TrackedState, QUEUE_COUNT>> states(resources.size());
+    std::vector<VkImageLayout> layouts(resources.size(), VK_IMAGE_LAYOUT_UNDEFINED);
+    //submission that last wrote(or transitioned) each resource and per queue the last one that read it since
+    std::vector<uint32_t> writeSubmission(resources.size(), UINT32_MAX);
+    std::vector<std::array<uint32_t, QUEUE_COUNT>> readSubmission(resources.size());
+    for(size_t r = 0; r < resources.size(); r++){
+        const ResourceAccess& initial = resources[r].initial;
+        //whoever used it before the graph did so on graphics, before the first submission
+        TrackedState& state = states[r][GRAPHICS_QUEUE];
+        layouts[r] = resources[r].imported ? initial.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        readSubmission[r].fill(UINT32_MAX);
+        if(initial.write){
+            state.writeStage = initial.stage;
+            state.writeAccess = initial.access;
+            writeSubmission[r] = resources[r].imported ? 0 : UINT32_MAX;
+        }
+        else{
+            state.readStages = initial.stage;
+            state.readAccess = initial.access;
+            readSubmission[r][GRAPHICS_QUEUE] = resources[r].imported ? 0 : UINT32_MAX;
+        }
+    }
+
+    //transient memory is the same every frame, the first use of it here comes right after the previous
+    //frame's uses(of the resource itself and of whatever is aliased with it) on the same queue, so seed the
+    //tracked state with every stage that touches that memory and the first barrier waits for all of them
+    //across queues the frame boundary is covered by submit(), the first async submission waits for the
+    //previous frame's graphics work and the last graphics submission for this frame's compute work
+    std::vector<std::array<TrackedState, QUEUE_COUNT>> frameUses(resources.size());
+    for(const Submission& submission : submissions){
+        for(uint32_t p : submission.passes){
+            for(const auto& passUse : passes[p].uses){
+                ResourceAccess access = resourceAccess(passUse.usage);
+                if(submission.queue == COMPUTE_QUEUE){
+                    access.stage &= COMPUTE_QUEUE_STAGES;
+                }
+                TrackedState& frameUse = frameUses[passUse.resource][submission.queue];
+                if(access.write){
+                    frameUse.writeStage |= access.stage;
+                    frameUse.writeAccess |= access.access;
+                }
+                else{
+                    frameUse.readStages |= access.stage;
+                    frameUse.readAccess |= access.access;
+                }
+            }
+        }
+    }
+    for(RenderGraphResource r = 0; r < resources.size(); r++){
+        const Resource& a = resources[r];
+        if(a.imported || a.memoryBlock == UINT32_MAX){
+            continue;
+        }
+        for(RenderGraphResource other = 0; other < resources.size(); other++){
+            const Resource& b = resources[other];
+            if(b.imported || b.memoryBlock != a.memoryBlock || a.memoryOffset >= b.memoryOffset + b.requirements.size || b.memoryOffset >= a.memoryOffset + a.requirements.size){
+                continue;
+            }
+            for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+                states[r][queue].writeStage |= frameUses[other][queue].writeStage;
+                states[r][queue].writeAccess |= frameUses[other][queue].writeAccess;
+                states[r][queue].readStages |= frameUses[other][queue].readStages;
+                states[r][queue].readAccess |= frameUses[other][queue].readAccess;
+            }
+        }
+    }
+
+    //makes submission wait for other if that ran on the other queue, true if it did
+    auto waitFor = [this](Submission& submission, uint32_t other, VkPipelineStageFlags2 stage){
+        if(other == UINT32_MAX || submissions[other].queue == submission.queue){
+            return false;
+        }
+        uint32_t queue = submissions[other].queue;
+        submission.waitOrdinal[queue] = std::max(submission.waitOrdinal[queue], submissions[other].ordinal);
+        submission.waitStage[queue] |= stage;
+        return true;
+    };
+    auto use = [&](BarrierBatch& batch, uint32_t s, RenderGraphResource r, ResourceAccess next, bool firstUse){
+        Submission& submission = submissions[s];
+        if(submission.queue == COMPUTE_QUEUE){
+            //drops the graphics stages of usages like UniformBuffer, a compute queue can't name them
+            next.stage &= COMPUTE_QUEUE_STAGES;
+        }
+        const Resource& resource = resources[r];
+        TrackedState& state = states[r][submission.queue];
+        state.layout = layouts[r];
+        bool layoutChange = resource.isImage && layouts[r] != next.layout;
+        bool modifies = next.write || layoutChange;
+
+        //the other queue's last write for everything(RAW, WAW), its reads since for writes(WAR)
+        bool crossed = waitFor(submission, writeSubmission[r], next.stage);
+        if(modifies){
+            for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+                crossed |= waitFor(submission, readSubmission[r][queue], next.stage);
+            }
+        }
+        if(firstUse && !resource.aliasPredecessors.empty()){
+            //memory is being reused, inherit the previous tenants' pending work on this queue as our own
+            //and wait for the other queue's
+            for(RenderGraphResource predecessor : resource.aliasPredecessors){
+                const TrackedState& previous = states[predecessor][submission.queue];
+                state.readStages |= previous.writeStage | previous.readStages;
+                state.writeAccess |= previous.writeAccess;
+                crossed |= waitFor(submission, writeSubmission[predecessor], next.stage);
+                for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+                    crossed |= waitFor(submission, readSubmission[predecessor][queue], next.stage);
+                }
+            }
+            state.writeStage |= state.readStages;
+            state.readStages = VK_PIPELINE_STAGE_2_NONE;
+        }
+
+        addTransition(batch, r, state, next, crossed ? next.stage : VK_PIPELINE_STAGE_2_NONE);
+        layouts[r] = state.layout;
+        if(modifies){
+            writeSubmission[r] = s;
+            readSubmission[r].fill(UINT32_MAX);
+        }
+        else{
+            readSubmission[r][submission.queue] = s;
+        }
+    };
+
+    passBarriers.assign(passes.size(), BarrierBatch{});
+    for(uint32_t s = 0; s < submissions.size(); s++){
+        for(uint32_t p : submissions[s].passes){
+            for(const auto& passUse : passes[p].uses){
+                use(passBarriers[p], s, passUse.resource, resourceAccess(passUse.usage), resources[passUse.resource].firstPass == p);
+            }
+        }
+    }
+
+    uint32_t last = static_cast<uint32_t>(submissions.size() - 1);
+    finalBarriers = BarrierBatch{};
+    for(RenderGraphResource r = 0; r < resources.size(); r++){
+        if(resources[r].hasFinalUsage && resources[r].firstPass != UINT32_MAX){
+            use(finalBarriers, last, r, resourceAccess(resources[r].finalUsage), false);
+        }
+    }
+    //the frame's fence and signals come after the last submission, it has to cover the compute queue too
+    for(uint32_t s = last; s-- > 0;){
+        if(submissions[s].queue == COMPUTE_QUEUE){
+            waitFor(submissions[last], s, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+            break;
+        }
+    }
+
+    for(const auto& batch : passBarriers){
+        if(!batch.empty()){
+            statistics.barrierBatches++;
+            statistics.imageBarriers += static_cast<uint32_t>(batch.imageBarriers.size());
+            statistics.memoryBarriers += batch.hasMemoryBarrier ? 1 : 0;
+        }
+    }
+    if(!finalBarriers.empty()){
+        statistics.barrierBatches++;
+        statistics.imageBarriers += static_cast<uint32_t>(finalBarriers.imageBarriers.size());
+        statistics.memoryBarriers += finalBarriers.hasMemoryBarrier ? 1 : 0;
+    }
+    for(const Submission& submission : submissions){
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+            statistics.queueWaits += submission.waitOrdinal[queue] != 0 ? 1 : 0;
+        }
+    }
+}
+
+void RenderGraph::recordBatch(VkCommandBuffer cmd, const BarrierBatch& batch) const{
+    if(batch.empty()){
+        return;
+    }
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.memoryBarrierCount = batch.hasMemoryBarrier ? 1 : 0;
+    dependencyInfo.pMemoryBarriers = &batch.memoryBarrier;
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(batch.imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = batch.imageBarriers.data();
+    cmdPipelineBarrier2(cmd, &dependencyInfo);
+}
+
+void RenderGraph::recordSubmission(VkCommandBuffer cmd, size_t submission, bool profiled) const{
+    for(uint32_t p : submissions[submission].passes){
+        //the label takes the pass's barriers along so captures show what each pass waited on
+        DEBUG_LABEL_BEGIN(cmd, passes[p].name.c_str());
+        recordBatch(cmd, passBarriers[p]);
+        //the pass's barriers stay outside its zone, waits on earlier passes would show up twice
+        if(profiled){
+            profiler->beginZone(cmd, passes[p].name);
+        }
+        passes[p].execute(cmd, *this);
+        if(profiled){
+            profiler->endZone(cmd);
+        }
+        DEBUG_LABEL_END(cmd);
+    }
+    if(submission == submissions.size() - 1){
+        recordBatch(cmd, finalBarriers);
+    }
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd) const{
+    for(size_t s = 0; s < submissions.size(); s++){
+        const Submission& submission = submissions[s];
+        if(submission.waitsOnOtherQueue()){
+            //everything before already ran on this queue, make it visible the way the semaphore would have
+            BarrierBatch wait;
+            wait.hasMemoryBarrier = true;
+            wait.memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+            wait.memoryBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            wait.memoryBarrier.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+            wait.memoryBarrier.dstStageMask = submission.waitStage[GRAPHICS_QUEUE] | submission.waitStage[COMPUTE_QUEUE];
+            wait.memoryBarrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+            recordBatch(cmd, wait);
+        }
+        recordSubmission(cmd, s, profiler != nullptr);
+    }
+}
+
+void RenderGraph::setQueues(const RenderGraphQueues& graphQueues){
+    destroyQueueObjects();
+    queues = graphQueues;
+    queues.framesInFlight = std::max(queues.framesInFlight, 1u);
+    if(device == VK_NULL_HANDLE){
+        return;
+    }
+
+    frameCommands.resize(queues.framesInFlight * QUEUE_COUNT);
+    for(uint32_t frame = 0; frame < queues.framesInFlight; frame++){
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+            if(queue == COMPUTE_QUEUE && !hasAsyncCompute()){
+                continue;
+            }
+            VkCommandPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            poolInfo.queueFamilyIndex = (queue == COMPUTE_QUEUE) ? queues.computeFamily : queues.graphicsFamily;
+            VkCommandPool& pool = frameCommands[frame * QUEUE_COUNT + queue].pool;
+            if(vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS){
+                throw std::runtime_error("render graph: failed to create command pool!");
+            }
+            DEBUG_NAME(device, pool, std::string("render graph: ") + (queue == COMPUTE_QUEUE ? "async compute" : "graphics") + " commands " + std::to_string(frame));
+        }
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+        if(queue == COMPUTE_QUEUE && !hasAsyncCompute()){
+            continue;
+        }
+        if(vkCreateSemaphore(device, &semaphoreInfo, nullptr, &timelines[queue]) != VK_SUCCESS){
+            throw std::runtime_error("render graph: failed to create timeline semaphore!");
+        }
+        DEBUG_NAME(device, timelines[queue], (queue == COMPUTE_QUEUE) ? "render graph: async compute timeline" : "render graph: graphics timeline");
+    }
+}
+
+void RenderGraph::submit(uint32_t frameIndex, const RenderGraphFrameSync& sync){
+    if(queues.graphics == VK_NULL_HANDLE || device == VK_NULL_HANDLE){
+        throw std::runtime_error("render graph: submit() without setQueues()!");
+    }
+    if(queueSubmit2 == nullptr){
+        throw std::runtime_error("render graph: device does not support vkQueueSubmit2!");
+    }
+    uint32_t frame = frameIndex % queues.framesInFlight;
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+        if(frameCommands[frame * QUEUE_COUNT + queue].pool != VK_NULL_HANDLE){
+            vkResetCommandPool(device, frameCommands[frame * QUEUE_COUNT + queue].pool, 0);
+        }
+    }
+
+    //timeline values continue from the last frame, a submission signals base + its ordinal
+    uint64_t base[QUEUE_COUNT] = {timelineValues[GRAPHICS_QUEUE], timelineValues[COMPUTE_QUEUE]};
+    uint32_t used[QUEUE_COUNT] = {};
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    for(size_t s = 0; s < submissions.size(); s++){
+        const Submission& submission = submissions[s];
+        bool first = s == 0;
+        bool last = s == submissions.size() - 1;
+
+        FrameCommands& commands = frameCommands[frame * QUEUE_COUNT + submission.queue];
+        if(used[submission.queue] == commands.buffers.size()){
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = commands.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            allocInfo.commandBufferCount = 1;
+            VkCommandBuffer buffer;
+            if(vkAllocateCommandBuffers(device, &allocInfo, &buffer) != VK_SUCCESS){
+                throw std::runtime_error("render graph: failed to allocate command buffer!");
+            }
+            commands.buffers.push_back(buffer);
+        }
+        VkCommandBuffer cmd = commands.buffers[used[submission.queue]++];
+        vkBeginCommandBuffer(cmd, &beginInfo);
+        //the profiler's queries belong to the graphics family, compute passes only get their labels
+        if(first && profiler != nullptr){
+            profiler->beginFrame(cmd, frame);
+        }
+        recordSubmission(cmd, s, profiler != nullptr && submission.queue == GRAPHICS_QUEUE);
+        if(vkEndCommandBuffer(cmd) != VK_SUCCESS){
+            throw std::runtime_error("render graph: failed to record command buffer!");
+        }
+
+        std::vector<VkSemaphoreSubmitInfo> waits;
+        if(first){
+            waits = sync.waits;
+        }
+        for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+            uint64_t value = submission.waitOrdinal[queue] != 0 ? base[queue] + submission.waitOrdinal[queue] : 0;
+            VkPipelineStageFlags2 stage = submission.waitStage[queue];
+            if(queue == GRAPHICS_QUEUE && submission.queue == COMPUTE_QUEUE && submission.ordinal == 1 && base[GRAPHICS_QUEUE] > value){
+                //transient memory is shared between frames, the previous frame must be done with it on graphics
+                value = base[GRAPHICS_QUEUE];
+                stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+            }
+            if(value == 0){
+                continue;
+            }
+            VkSemaphoreSubmitInfo wait{};
+            wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            wait.semaphore = timelines[queue];
+            wait.value = value;
+            wait.stageMask = stage;
+            waits.push_back(wait);
+        }
+        std::vector<VkSemaphoreSubmitInfo> signals;
+        VkSemaphoreSubmitInfo signal{};
+        signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signal.semaphore = timelines[submission.queue];
+        signal.value = base[submission.queue] + submission.ordinal;
+        signal.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        signals.push_back(signal);
+        if(last){
+            signals.insert(signals.end(), sync.signals.begin(), sync.signals.end());
+        }
+
+        VkCommandBufferSubmitInfo commandInfo{};
+        commandInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        commandInfo.commandBuffer = cmd;
+        VkSubmitInfo2 submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submitInfo.waitSemaphoreInfoCount = static_cast<uint32_t>(waits.size());
+        submitInfo.pWaitSemaphoreInfos = waits.data();
+        submitInfo.commandBufferInfoCount = 1;
+        submitInfo.pCommandBufferInfos = &commandInfo;
+        submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signals.size());
+        submitInfo.pSignalSemaphoreInfos = signals.data();
+        VkQueue queue = (submission.queue == COMPUTE_QUEUE) ? queues.compute : queues.graphics;
+        if(queueSubmit2(queue, 1, &submitInfo, last ? sync.fence : VK_NULL_HANDLE) != VK_SUCCESS){
+            throw std::runtime_error("render graph: failed to submit!");
+        }
+        timelineValues[submission.queue] = signal.value;
+    }
+}
+
+void RenderGraph::destroyQueueObjects(){
+    if(device != VK_NULL_HANDLE){
+        for(auto& commands : frameCommands){
+            if(commands.pool != VK_NULL_HANDLE){
+                vkDestroyCommandPool(device, commands.pool, nullptr);
+            }
+        }
+        for(VkSemaphore& timeline : timelines){
+            if(timeline != VK_NULL_HANDLE){
+                vkDestroySemaphore(device, timeline, nullptr);
+            }
+        }
+    }
+    frameCommands.clear();
+    for(uint32_t queue = 0; queue < QUEUE_COUNT; queue++){
+        timelines[queue] = VK_NULL_HANDLE;
+        timelineValues[queue] = 0;
+    }
+}
+
+void RenderGraph::destroyTransientResources(){
+    if(device != VK_NULL_HANDLE){
+        for(auto& resource : resources){
+            if(resource.imported){
+                continue;
+            }
+            if(resource.view != VK_NULL_HANDLE){
+                vkDestroyImageView(device, resource.view, nullptr);
+            }
+            if(resource.image != VK_NULL_HANDLE){
+                vkDestroyImage(device, resource.image, nullptr);
+            }
+            if(resource.buffer != VK_NULL_HANDLE){
+                vkDestroyBuffer(device, resource.buffer, nullptr);
+            }
+        }
+        for(auto& block : memoryBlocks){
+            if(block.memory != VK_NULL_HANDLE){
+                freeMemory(device, block.memory);
+            }
+        }
+    }
+    for(auto& resource : resources){
+        if(!resource.imported){
+            resource.view = VK_NULL_HANDLE;
+            resource.image = VK_NULL_HANDLE;
+            resource.buffer = VK_NULL_HANDLE;
+        }
+    }
+    memoryBlocks.clear();
+}
+
+void RenderGraph::reset(){
+    destroyTransientResources();
+    resources.clear();
+    passes.clear();
+    passBarriers.clear();
+    finalBarriers = BarrierBatch{};
+    submissions.clear();
+    statistics = {};
+}
+
+void RenderGraph::printStats() const{
+    std::cout << "Render graph: " << statistics.passes << " passes(" << statistics.culledPasses << " culled), "
+        << statistics.barrierBatches << " barrier batches, "
+        << statistics.imageBarriers << " image barriers, "
+        << statistics.memoryBarriers << " memory barriers\n";
+    if(statistics.asyncSubmissions > 0){
+        std::cout << "\tQueues: " << statistics.submissions << " submissions(" << statistics.asyncSubmissions << " async compute), "
+            << statistics.queueWaits << " cross queue waits\n";
+    }
+    std::cout << "\tTransient memory: " << statistics.allocatedBytes / 1024 << " KiB allocated for "
+        << statistics.transientBytes / 1024 << " KiB of resources\n";
+}
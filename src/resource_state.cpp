@@ -0,0 +1,291 @@
+#include <resource_state.hpp>
+
+#include <vulkan/utility/vk_format_utils.h>
+
+//source half of a barrier, pieces with equal ones can share a barrier
+struct PendingBarrier{
+    VkPipelineStageFlags2 srcStage = VK_PIPELINE_STAGE_2_NONE;
+    VkAccessFlags2 srcAccess = VK_ACCESS_2_NONE;
+    VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    uint32_t srcQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dstQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+
+    bool operator==(const PendingBarrier& other) const = default;
+};
+
+//moves state to next, returns true and fills pending if a barrier is needed first
+static bool advanceState(SubresourceState& state, const ResourceAccess& next, bool hasLayout, uint32_t queueFamily, PendingBarrier& pending){
+    bool layoutChange = hasLayout && state.layout != next.layout;
+    bool ownershipTransfer = queueFamily != VK_QUEUE_FAMILY_IGNORED && state.queueFamily != VK_QUEUE_FAMILY_IGNORED && queueFamily != state.queueFamily;
+
+    if(next.write || layoutChange || ownershipTransfer){
+        //wait for the last write(RAW/WAW) and every read since(WAR)
+        pending.srcStage = state.writeStage | state.readStages;
+        pending.srcAccess = state.writeAccess;
+        if(pending.srcStage == VK_PIPELINE_STAGE_2_NONE && !layoutChange && !ownershipTransfer){
+            //first use, nothing to wait for
+            state.writeStage = next.write ? next.stage : VK_PIPELINE_STAGE_2_NONE;
+            state.writeAccess = next.write ? next.access : VK_ACCESS_2_NONE;
+            state.readStages = next.write ? VK_PIPELINE_STAGE_2_NONE : next.stage;
+            state.readAccess = next.write ? VK_ACCESS_2_NONE : next.access;
+            if(queueFamily != VK_QUEUE_FAMILY_IGNORED){
+                state.queueFamily = queueFamily;
+            }
+            return false;
+        }
+    }
+    else{
+        //read after read is free, read after write only for stages that weren't synchronized yet
+        bool covered = (next.stage & ~state.readStages) == 0 && (next.access & ~state.readAccess) == 0;
+        if(state.writeStage == VK_PIPELINE_STAGE_2_NONE || covered){
+            state.readStages |= next.stage;
+            state.readAccess |= next.access;
+            if(queueFamily != VK_QUEUE_FAMILY_IGNORED){
+                state.queueFamily = queueFamily;
+            }
+            return false;
+        }
+        pending.srcStage = state.writeStage;
+        pending.srcAccess = state.writeAccess;
+    }
+
+    pending.oldLayout = hasLayout ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+    if(ownershipTransfer){
+        pending.srcQueueFamily = state.queueFamily;
+        pending.dstQueueFamily = queueFamily;
+    }
+
+    if(hasLayout){
+        state.layout = next.layout;
+    }
+    if(next.write){
+        state.writeStage = next.stage;
+        state.writeAccess = next.access;
+        state.readStages = VK_PIPELINE_STAGE_2_NONE;
+        state.readAccess = VK_ACCESS_2_NONE;
+    }
+    else if(layoutChange || ownershipTransfer){
+        //the transition/acquire finished before next.stage, later readers chain off that
+        state.writeStage = next.stage;
+        state.writeAccess = VK_ACCESS_2_NONE;
+        state.readStages = next.stage;
+        state.readAccess = next.access;
+    }
+    else{
+        state.readStages |= next.stage;
+        state.readAccess |= next.access;
+    }
+    if(queueFamily != VK_QUEUE_FAMILY_IGNORED){
+        state.queueFamily = queueFamily;
+    }
+    return true;
+}
+
+
+ImageStateTracker::ImageStateTracker(VkImage image, VkFormat format, uint32_t mipLevels, uint32_t arrayLayers, VkImageLayout initialLayout, uint32_t queueFamily) : image(image), format(format), mipLevels(mipLevels), arrayLayers(arrayLayers){
+    //depth/stencil formats keep the two aspects apart, they can be in different layouts
+    uint32_t planes = (vkuFormatHasDepth(format) && vkuFormatHasStencil(format)) ? 2 : std::max(1u, vkuFormatPlaneCount(format));
+    SubresourceState initial;
+    initial.layout = initialLayout;
+    initial.queueFamily = queueFamily;
+    states.insert({{0, planes * arrayLayers * mipLevels}, initial});
+}
+
+uint32_t ImageStateTracker::planeIndex(VkImageAspectFlagBits aspect) const{
+    switch(aspect){
+        case VK_IMAGE_ASPECT_STENCIL_BIT:
+            return vkuFormatHasDepth(format) ? 1 : 0;
+        case VK_IMAGE_ASPECT_PLANE_1_BIT:
+            return 1;
+        case VK_IMAGE_ASPECT_PLANE_2_BIT:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+const SubresourceState& ImageStateTracker::state(VkImageAspectFlags aspect, uint32_t mip, uint32_t layer) const{
+    //lowest set bit picks the plane
+    VkImageAspectFlagBits bit = static_cast<VkImageAspectFlagBits>(aspect & (~aspect + 1));
+    auto it = states.find(subresourceIndex(planeIndex(bit), layer, mip));
+    if(it == states.end()){
+        throw std::runtime_error("image state: subresource out of range!");
+    }
+    return it->second;
+}
+
+void ImageStateTracker::transition(const ResourceAccess& next, std::vector<VkImageMemoryBarrier2>& barriers, uint32_t queueFamily){
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    if(vkuFormatHasDepth(format) || vkuFormatHasStencil(format)){
+        aspect = (vkuFormatHasDepth(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : 0) | (vkuFormatHasStencil(format) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+    }
+    transition({aspect, 0, mipLevels, 0, arrayLayers}, next, barriers, queueFamily);
+}
+
+void ImageStateTracker::transition(const VkImageSubresourceRange& range, const ResourceAccess& next, std::vector<VkImageMemoryBarrier2>& barriers, uint32_t queueFamily){
+    //bases checked first so the REMAINING counts can't wrap, counts compared against what's left so base + count can't either
+    if(range.baseMipLevel >= mipLevels || range.baseArrayLayer >= arrayLayers){
+        throw std::runtime_error("image state: subresource range out of bounds!");
+    }
+    uint32_t levelCount = (range.levelCount == VK_REMAINING_MIP_LEVELS) ? mipLevels - range.baseMipLevel : range.levelCount;
+    uint32_t layerCount = (range.layerCount == VK_REMAINING_ARRAY_LAYERS) ? arrayLayers - range.baseArrayLayer : range.layerCount;
+    if(levelCount == 0 || layerCount == 0 || levelCount > mipLevels - range.baseMipLevel || layerCount > arrayLayers - range.baseArrayLayer){
+        throw std::runtime_error("image state: subresource range out of bounds!");
+    }
+
+    //a rectangle of subresources needing the same barrier
+    struct Piece{
+        VkImageAspectFlags aspect;
+        uint32_t mipBegin, mipEnd;
+        uint32_t layerBegin, layerEnd;
+        PendingBarrier pending;
+    };
+    std::vector<Piece> pieces;
+    std::vector<std::pair<StateMap::key_type, SubresourceState>> updates;
+
+    for(VkImageAspectFlags remaining = range.aspectMask; remaining != 0; remaining &= remaining - 1){
+        VkImageAspectFlagBits aspect = static_cast<VkImageAspectFlagBits>(remaining & (~remaining + 1));
+        uint32_t plane = planeIndex(aspect);
+        for(uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + layerCount; layer++){
+            uint32_t layerBase = subresourceIndex(plane, layer, 0);
+            StateMap::key_type key(layerBase + range.baseMipLevel, layerBase + range.baseMipLevel + levelCount);
+            for(auto it = states.lower_bound(key); it != states.end() && it->first.begin < key.end; ++it){
+                StateMap::key_type sub = it->first & key;
+                SubresourceState state = it->second;
+                PendingBarrier pending;
+                if(advanceState(state, next, true, queueFamily, pending)){
+                    uint32_t mipBegin = sub.begin - layerBase;
+                    uint32_t mipEnd = sub.end - layerBase;
+                    //grow the piece from the previous layer if it lines up
+                    bool merged = false;
+                    for(auto p = pieces.rbegin(); p != pieces.rend(); ++p){
+                        if(p->aspect == static_cast<VkImageAspectFlags>(aspect) && p->layerEnd == layer && p->mipBegin == mipBegin && p->mipEnd == mipEnd && p->pending == pending){
+                            p->layerEnd = layer + 1;
+                            merged = true;
+                            break;
+                        }
+                    }
+                    if(!merged){
+                        pieces.push_back({static_cast<VkImageAspectFlags>(aspect), mipBegin, mipEnd, layer, layer + 1, pending});
+                    }
+                }
+                updates.push_back({sub, state});
+            }
+        }
+    }
+
+    for(auto& update : updates){
+        states.overwrite_range(std::move(update));
+    }
+    vku::sparse::consolidate(states);
+
+    //depth and stencil in the same state go into one barrier
+    for(size_t i = 0; i < pieces.size(); i++){
+        for(size_t j = i + 1; j < pieces.size();){
+            const Piece& a = pieces[i];
+            const Piece& b = pieces[j];
+            if(a.mipBegin == b.mipBegin && a.mipEnd == b.mipEnd && a.layerBegin == b.layerBegin && a.layerEnd == b.layerEnd && a.pending == b.pending){
+                pieces[i].aspect |= b.aspect;
+                pieces.erase(pieces.begin() + j);
+            }
+            else{
+                j++;
+            }
+        }
+    }
+
+    for(const auto& piece : pieces){
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = piece.pending.srcStage;
+        barrier.srcAccessMask = piece.pending.srcAccess;
+        barrier.dstStageMask = next.stage;
+        barrier.dstAccessMask = next.access;
+        barrier.oldLayout = piece.pending.oldLayout;
+        barrier.newLayout = next.layout;
+        barrier.srcQueueFamilyIndex = piece.pending.srcQueueFamily;
+        barrier.dstQueueFamilyIndex = piece.pending.dstQueueFamily;
+        barrier.image = image;
+        barrier.subresourceRange = {piece.aspect, piece.mipBegin, piece.mipEnd - piece.mipBegin, piece.layerBegin, piece.layerEnd - piece.layerBegin};
+        barriers.push_back(barrier);
+    }
+}
+
+
+BufferStateTracker::BufferStateTracker(VkBuffer buffer, VkDeviceSize size, uint32_t queueFamily) : buffer(buffer), size(size){
+    SubresourceState initial;
+    initial.queueFamily = queueFamily;
+    states.insert({{0, size}, initial});
+}
+
+const SubresourceState& BufferStateTracker::state(VkDeviceSize offset) const{
+    auto it = states.find(offset);
+    if(it == states.end()){
+        throw std::runtime_error("buffer state: offset out of range!");
+    }
+    return it->second;
+}
+
+void BufferStateTracker::transition(VkDeviceSize offset, VkDeviceSize rangeSize, const ResourceAccess& next, std::vector<VkBufferMemoryBarrier2>& barriers, uint32_t queueFamily){
+    if(offset >= size){
+        throw std::runtime_error("buffer state: range out of bounds!");
+    }
+    if(rangeSize == VK_WHOLE_SIZE){
+        rangeSize = size - offset;
+    }
+    if(rangeSize == 0 || rangeSize > size - offset){
+        throw std::runtime_error("buffer state: range out of bounds!");
+    }
+    StateMap::key_type key(offset, offset + rangeSize);
+    std::vector<std::pair<StateMap::key_type, SubresourceState>> updates;
+    size_t firstNew = barriers.size();
+
+    for(auto it = states.lower_bound(key); it != states.end() && it->first.begin < key.end; ++it){
+        StateMap::key_type sub = it->first & key;
+        SubresourceState state = it->second;
+        PendingBarrier pending;
+        if(advanceState(state, next, false, queueFamily, pending)){
+            //touching ranges with the same source scope become one barrier
+            if(barriers.size() > firstNew){
+                VkBufferMemoryBarrier2& last = barriers.back();
+                if(last.offset + last.size == sub.begin && last.srcStageMask == pending.srcStage && last.srcAccessMask == pending.srcAccess && last.srcQueueFamilyIndex == pending.srcQueueFamily && last.dstQueueFamilyIndex == pending.dstQueueFamily){
+                    last.size += sub.distance();
+                    updates.push_back({sub, state});
+                    continue;
+                }
+            }
+            VkBufferMemoryBarrier2 barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+            barrier.srcStageMask = pending.srcStage;
+            barrier.srcAccessMask = pending.srcAccess;
+            barrier.dstStageMask = next.stage;
+            barrier.dstAccessMask = next.access;
+            barrier.srcQueueFamilyIndex = pending.srcQueueFamily;
+            barrier.dstQueueFamilyIndex = pending.dstQueueFamily;
+            barrier.buffer = buffer;
+            barrier.offset = sub.begin;
+            barrier.size = sub.distance();
+            barriers.push_back(barrier);
+        }
+        updates.push_back({sub, state});
+    }
+
+    for(auto& update : updates){
+        states.overwrite_range(std::move(update));
+    }
+    vku::sparse::consolidate(states);
+}
+
+
+void recordBarriers(VkCommandBuffer cmd, PFN_vkCmdPipelineBarrier2 cmdPipelineBarrier2, const std::vector<VkImageMemoryBarrier2>& imageBarriers, const std::vector<VkBufferMemoryBarrier2>& bufferBarriers){
+    if(imageBarriers.empty() && bufferBarriers.empty()){
+        return;
+    }
+    VkDependencyInfo dependencyInfo{};
+    dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+    dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+    dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+    dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+    cmdPipelineBarrier2(cmd, &dependencyInfo);
+}
@@ -0,0 +1,245 @@
+#include <scene_graph.hpp>
+#include <streaming_copy.hpp>
+
+#include <glm/simd/matrix.h>
+
+//out = parent * child, the vendored SSE product when available
+//glm::mat4 is only float aligned so the columns go through unaligned loads/stores
+static inline void multiplyMatrices(const glm::mat4& parent, const glm::mat4& child, glm::mat4& out){
+    #if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        glm_vec4 a[4], b[4], result[4];
+        for(int c = 0; c < 4; c++){
+            a[c] = _mm_loadu_ps(&parent[c][0]);
+            b[c] = _mm_loadu_ps(&child[c][0]);
+        }
+        glm_mat4_mul(a, b, result);
+        for(int c = 0; c < 4; c++){
+            _mm_storeu_ps(&out[c][0], result[c]);
+        }
+    #else
+        out = parent * child;
+    #endif
+}
+
+
+SceneGraph::NodeHandle SceneGraph::createNode(NodeHandle parent, glm::vec3 position, glm::quat rotation, glm::vec3 scale){
+    NodeHandle handle = static_cast<NodeHandle>(handleToIndex.size());
+    uint32_t index = size();
+
+    uint32_t parentIdx = UINT32_MAX;
+    uint32_t nodeDepth = 0;
+    if(parent != INVALID_NODE){
+        if(parent >= handleToIndex.size()){
+            throw std::runtime_error("scene graph: parent node does not exist!");
+        }
+        parentIdx = handleToIndex[parent];
+        nodeDepth = depth[parentIdx] + 1;
+    }
+    //appending keeps depth order only if we don't go back up a level
+    if(index > 0 && nodeDepth < depth[index - 1]){
+        needsSort = true;
+    }
+    //level offsets need rebuilding either way
+    levelOffsets.clear();
+
+    parentIndex.push_back(parentIdx);
+    depth.push_back(nodeDepth);
+    indexToHandle.push_back(handle);
+    local.resize(index + 1);
+    local.set(index, position, rotation, scale);
+    localMatrix.emplace_back(1.0f);
+    world.emplace_back(1.0f);
+    flags.push_back(LOCAL_DIRTY | WORLD_DIRTY);
+    handleToIndex.push_back(index);
+
+    return handle;
+}
+uint32_t SceneGraph::nodeIndex(NodeHandle node) const{
+    if(node >= handleToIndex.size()){
+        throw std::runtime_error("scene graph: node does not exist!");
+    }
+    return handleToIndex[node];
+}
+void SceneGraph::setLocalTransform(NodeHandle node, glm::vec3 position, glm::quat rotation, glm::vec3 scale){
+    uint32_t index = nodeIndex(node);
+    local.set(index, position, rotation, scale);
+    flags[index] |= LOCAL_DIRTY | WORLD_DIRTY;
+}
+void SceneGraph::setPosition(NodeHandle node, glm::vec3 position){
+    uint32_t index = nodeIndex(node);
+    local.positionX[index] = position.x;
+    local.positionY[index] = position.y;
+    local.positionZ[index] = position.z;
+    flags[index] |= LOCAL_DIRTY | WORLD_DIRTY;
+}
+void SceneGraph::setRotation(NodeHandle node, glm::quat rotation){
+    uint32_t index = nodeIndex(node);
+    local.rotationX[index] = rotation.x;
+    local.rotationY[index] = rotation.y;
+    local.rotationZ[index] = rotation.z;
+    local.rotationW[index] = rotation.w;
+    flags[index] |= LOCAL_DIRTY | WORLD_DIRTY;
+}
+
+void SceneGraph::sortByDepth(){
+    uint32_t count = size();
+    uint32_t levelCount = 0;
+    for(uint32_t d : depth){
+        levelCount = std::max(levelCount, d + 1);
+    }
+    //counting sort, stable so siblings keep their creation order
+    levelOffsets.assign(levelCount + 1, 0);
+    for(uint32_t d : depth){
+        levelOffsets[d + 1]++;
+    }
+    for(uint32_t level = 0; level < levelCount; level++){
+        levelOffsets[level + 1] += levelOffsets[level];
+    }
+    if(!needsSort){
+        return;
+    }
+
+    std::vector<uint32_t> newIndex(count);
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for(uint32_t i = 0; i < count; i++){
+        newIndex[i] = cursor[depth[i]]++;
+    }
+    //move every array into its new place
+    auto permute = [&](auto& array){
+        std::remove_reference_t<decltype(array)> sorted(array.size());
+        for(uint32_t i = 0; i < count; i++){
+            sorted[newIndex[i]] = array[i];
+        }
+        array.swap(sorted);
+    };
+    for(uint32_t& parent : parentIndex){
+        if(parent != UINT32_MAX){
+            parent = newIndex[parent];
+        }
+    }
+    permute(parentIndex);
+    permute(depth);
+    permute(indexToHandle);
+    permute(local.positionX);
+    permute(local.positionY);
+    permute(local.positionZ);
+    permute(local.rotationX);
+    permute(local.rotationY);
+    permute(local.rotationZ);
+    permute(local.rotationW);
+    permute(local.scaleX);
+    permute(local.scaleY);
+    permute(local.scaleZ);
+    permute(localMatrix);
+    permute(world);
+    permute(flags);
+    for(uint32_t i = 0; i < count; i++){
+        handleToIndex[indexToHandle[i]] = i;
+    }
+    needsSort = false;
+
+    //every instance moved, the whole instance buffer has to be rewritten
+    for(uint8_t& f : flags){
+        f |= WORLD_DIRTY;
+    }
+}
+
+void SceneGraph::update(const ParallelFor& parallelFor){
+    uint32_t count = size();
+    changedFirst = count;
+    changedLast = 0;
+    if(count == 0){
+        return;
+    }
+    if(levelOffsets.empty()){
+        sortByDepth();
+    }
+
+    //rebuild local matrices in contiguous runs so the batch kernel sees long streams
+    uint32_t i = 0;
+    while(i < count){
+        if(!(flags[i] & LOCAL_DIRTY)){
+            i++;
+            continue;
+        }
+        uint32_t runEnd = i + 1;
+        while(runEnd < count && (flags[runEnd] & LOCAL_DIRTY)){
+            runEnd++;
+        }
+        composeModelMatrices(local, i, runEnd - i, &localMatrix[i]);
+        i = runEnd;
+    }
+
+    //push dirtiness down the hierarchy, parents are always at lower indices
+    for(i = 0; i < count; i++){
+        uint32_t parent = parentIndex[i];
+        if(parent != UINT32_MAX && (flags[parent] & WORLD_DIRTY)){
+            flags[i] |= WORLD_DIRTY;
+        }
+        if(flags[i] & WORLD_DIRTY){
+            changedFirst = std::min(changedFirst, i);
+            changedLast = i + 1;
+        }
+    }
+    if(changedFirst >= changedLast){
+        changedFirst = changedLast = 0;
+        return;
+    }
+
+    //level by level, every node in a level only reads the finished level above it
+    RangeBody updateRange = [this](uint32_t begin, uint32_t end){
+        for(uint32_t n = begin; n < end; n++){
+            if(!(flags[n] & WORLD_DIRTY)){
+                continue;
+            }
+            uint32_t parent = parentIndex[n];
+            if(parent == UINT32_MAX){
+                world[n] = localMatrix[n];
+            }
+            else{
+                multiplyMatrices(world[parent], localMatrix[n], world[n]);
+            }
+        }
+    };
+    for(size_t level = 0; level + 1 < levelOffsets.size(); level++){
+        uint32_t begin = std::max(levelOffsets[level], changedFirst);
+        uint32_t end = std::min(levelOffsets[level + 1], changedLast);
+        if(begin >= end){
+            continue;
+        }
+        if(parallelFor && end - begin >= PARALLEL_GRAIN){
+            parallelFor(begin, end, updateRange);
+        }
+        else{
+            updateRange(begin, end);
+        }
+    }
+
+    //children already picked up the dirty bits, safe to clear now
+    for(i = changedFirst; i < changedLast; i++){
+        flags[i] = 0;
+    }
+    for(auto& [pendingFirst, pendingLast] : pendingInstances){
+        if(pendingFirst >= pendingLast){
+            pendingFirst = changedFirst;
+            pendingLast = changedLast;
+        }
+        else{
+            pendingFirst = std::min(pendingFirst, changedFirst);
+            pendingLast = std::max(pendingLast, changedLast);
+        }
+    }
+}
+
+void SceneGraph::writeInstances(void* mappedInstanceBuffer, uint32_t slot){
+    if(slot >= MAX_INSTANCE_BUFFERS){
+        throw std::runtime_error("scene graph: instance buffer slot out of range!");
+    }
+    auto& [pendingFirst, pendingLast] = pendingInstances[slot];
+    if(pendingFirst >= pendingLast){
+        return;
+    }
+    glm::mat4* dst = static_cast<glm::mat4*>(mappedInstanceBuffer);
+    streamingCopy(dst + pendingFirst, world.data() + pendingFirst, sizeof(glm::mat4) * (pendingLast - pendingFirst));
+    pendingFirst = pendingLast = 0;
+}
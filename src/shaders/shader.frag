@@ -0,0 +1,28 @@
+#version 450
+
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec4 fragTangent;
+layout(location = 2) in vec2 fragUV;
+
+layout(location = 0) out vec4 outColor;
+
+//specialization constants, set per pipeline by MeshShaderVariant in shader_variant.hpp
+//dead branches are removed when the pipeline is compiled, no runtime cost
+layout(constant_id = 0) const int SHADING_MODEL = 1; //0 unlit, 1 lambert, 2 half lambert
+layout(constant_id = 1) const bool UV_TINT = true;
+
+void main(){
+    //simple headlight shading until materials exist
+    vec3 n = normalize(fragNormal);
+    float ndotl = dot(n, normalize(vec3(0.3, 0.5, 1.0)));
+    float light = 1.0;
+    if(SHADING_MODEL == 1){
+        light = 0.1 + 0.9 * max(ndotl, 0.0);
+    }
+    else if(SHADING_MODEL == 2){
+        float wrapped = ndotl * 0.5 + 0.5;
+        light = wrapped * wrapped;
+    }
+    vec3 albedo = UV_TINT ? vec3(fragUV, 1.0) : vec3(1.0);
+    outColor = vec4(light * albedo, 1.0);
+}
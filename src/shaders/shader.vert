@@ -0,0 +1,37 @@
+#version 450
+
+//compressed vertex stream, layout matches PackedVertex in vertex_format.hpp
+//vertex fetch already expands unorm16/snorm16/half to float
+layout(location = 0) in vec4 inPosition; //xyz = position relative to mesh bounds, w = bitangent sign(0 or 1)
+layout(location = 1) in vec2 inNormal; //octahedral encoded
+layout(location = 2) in vec2 inTangent; //octahedral encoded
+layout(location = 3) in vec2 inUV;
+
+//matches MeshPushConstants in vertex_format.hpp
+layout(push_constant) uniform MeshPushConstants{
+    mat4 mvp;
+    vec4 boundsMin;
+    vec4 boundsExtent;
+} mesh;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec4 fragTangent;
+layout(location = 2) out vec2 fragUV;
+
+//inverse octahedral mapping, same as octahedralDecode() on the CPU
+vec3 octDecode(vec2 e){
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += (n.x >= 0.0) ? -t : t;
+    n.y += (n.y >= 0.0) ? -t : t;
+    return normalize(n);
+}
+
+void main(){
+    vec3 position = mesh.boundsMin.xyz + inPosition.xyz * mesh.boundsExtent.xyz;
+    gl_Position = mesh.mvp * vec4(position, 1.0);
+
+    fragNormal = octDecode(inNormal);
+    fragTangent = vec4(octDecode(inTangent), (inPosition.w > 0.5) ? 1.0 : -1.0);
+    fragUV = inUV;
+}
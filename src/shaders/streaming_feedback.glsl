@@ -0,0 +1,31 @@
+//texture streaming feedback, see TextureStreamer in texture_streaming.hpp
+//needs #extension GL_GOOGLE_include_directive, define the binding before including:
+//  #define STREAMING_FEEDBACK_SET 1
+//  #define STREAMING_FEEDBACK_BINDING 0
+//  #include "streaming_feedback.glsl"
+//fragment shaders only(derivatives), the buffer is cleared to 0xFFFFFFFF every frame
+
+#ifndef STREAMING_FEEDBACK_GLSL
+#define STREAMING_FEEDBACK_GLSL
+
+layout(set = STREAMING_FEEDBACK_SET, binding = STREAMING_FEEDBACK_BINDING) buffer StreamingFeedback{
+    uint finestMip[]; //one per streamed texture, smallest mip any pixel wanted
+} streamingFeedback;
+
+//call with the same uv the texture is sampled with, textureSize = size of mip 0
+//frame = any counter that goes up by one per frame(push constant or uniform)
+void writeStreamingFeedback(uint textureIndex, vec2 uv, vec2 textureSize, uint frame){
+    vec2 dx = dFdx(uv * textureSize);
+    vec2 dy = dFdy(uv * textureSize);
+    float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+    uint mip = uint(max(floor(lod), 0.0));
+    //one atomic per quad is plenty, lanes in a quad want nearly the same mip
+    //the writing lane moves around the 2x2 quad every frame, so a surface that only covers odd
+    //rows or columns(thin geometry, a quad's edge) still reports within 4 frames
+    uvec2 lane = uvec2(gl_FragCoord.xy) & 1u;
+    if(lane == uvec2(frame & 1u, (frame >> 1) & 1u)){
+        atomicMin(streamingFeedback.finestMip[textureIndex], mip);
+    }
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include <streaming_copy.hpp>
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define STREAMING_COPY_X86 1
+#else
+    #define STREAMING_COPY_X86 0
+#endif
+
+
+//below this the fence and the alignment prologue cost more than the stores save
+static constexpr size_t STREAMING_MIN_BYTES = 256;
+static constexpr uintptr_t CACHE_LINE = 64;
+
+#if STREAMING_COPY_X86
+//bytes up to the next cache line of dst go through memcpy so the loops only ever write whole lines
+static inline size_t copyToLineBoundary(uint8_t*& dst, const uint8_t*& src, size_t size){
+    size_t head = (CACHE_LINE - (reinterpret_cast<uintptr_t>(dst) & (CACHE_LINE - 1))) & (CACHE_LINE - 1);
+    std::memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    return size - head;
+}
+
+__attribute__((target("sse2")))
+static void streamSSE2(uint8_t* dst, const uint8_t* src, size_t size){
+    size = copyToLineBoundary(dst, src, size);
+    for(; size >= CACHE_LINE; size -= CACHE_LINE, dst += CACHE_LINE, src += CACHE_LINE){
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+        __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48));
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst), a);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 16), b);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 32), c);
+        _mm_stream_si128(reinterpret_cast<__m128i*>(dst + 48), d);
+    }
+    //the partial last line, regular stores are the lesser evil for less than a line
+    std::memcpy(dst, src, size);
+    _mm_sfence();
+}
+
+//two lines per iteration, loads first so the stores to one line issue back to back
+__attribute__((target("avx2")))
+static void streamAVX2(uint8_t* dst, const uint8_t* src, size_t size){
+    size = copyToLineBoundary(dst, src, size);
+    for(; size >= 2 * CACHE_LINE; size -= 2 * CACHE_LINE, dst += 2 * CACHE_LINE, src += 2 * CACHE_LINE){
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+        __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 64));
+        __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 96));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 64), c);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 96), d);
+    }
+    if(size >= CACHE_LINE){
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 32));
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst), a);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + 32), b);
+        size -= CACHE_LINE;
+        dst += CACHE_LINE;
+        src += CACHE_LINE;
+    }
+    std::memcpy(dst, src, size);
+    _mm_sfence();
+}
+#endif
+
+
+CopyKernel selectCopyKernel(){
+    #if STREAMING_COPY_X86 && defined(__GNUC__)
+        if(__builtin_cpu_supports("avx2")){
+            return CopyKernel::AVX2;
+        }
+        if(__builtin_cpu_supports("sse2")){
+            return CopyKernel::SSE2;
+        }
+    #endif
+    return CopyKernel::Memcpy;
+}
+const char* copyKernelName(CopyKernel kernel){
+    switch(kernel){
+        case CopyKernel::Memcpy:
+            return "memcpy";
+        case CopyKernel::SSE2:
+            return "SSE2";
+        case CopyKernel::AVX2:
+            return "AVX2";
+    }
+    return "unknown";
+}
+
+void streamingCopy(void* dst, const void* src, size_t size, CopyKernel kernel){
+    if(size < STREAMING_MIN_BYTES){
+        std::memcpy(dst, src, size);
+        return;
+    }
+    switch(kernel){
+        #if STREAMING_COPY_X86
+        case CopyKernel::AVX2:
+            streamAVX2(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), size);
+            return;
+        case CopyKernel::SSE2:
+            streamSSE2(static_cast<uint8_t*>(dst), static_cast<const uint8_t*>(src), size);
+            return;
+        #endif
+        default:
+            std::memcpy(dst, src, size);
+            return;
+    }
+}
+void streamingCopy(void* dst, const void* src, size_t size){
+    //the cpu doesn't change while running, only ask once
+    static const CopyKernel kernel = selectCopyKernel();
+    streamingCopy(dst, src, size, kernel);
+}
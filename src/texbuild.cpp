@@ -0,0 +1,149 @@
+#include <main.hpp>
+#include <ktx2.hpp>
+#include <texture_compress.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+//offline texture builder, RGBA8 netpbm image in, mipmapped(and compressed) KTX2 out
+//  texbuild input.pam output.ktx2 [--format bc1|bc5|bc7|rgba8] [--srgb] [--zstd]
+//bc7 is the default for color, bc5 for normal maps, bc1 where size matters more than quality
+//input is binary PPM(P6) or PAM(P7, RGB or RGB_ALPHA), anything converts to those(magick in.png out.pam)
+
+
+struct SourceImage{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+static SourceImage loadNetpbm(const std::string& path){
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("failed to open input image!");
+    }
+    std::string magic;
+    file >> magic;
+    uint32_t channels = 3;
+    uint32_t maxValue = 0;
+    SourceImage image;
+    if(magic == "P6"){
+        file >> image.width >> image.height >> maxValue;
+    }
+    else if(magic == "P7"){
+        std::string line;
+        std::getline(file, line);
+        while(std::getline(file, line) && line != "ENDHDR"){
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if(key == "WIDTH"){
+                fields >> image.width;
+            }
+            else if(key == "HEIGHT"){
+                fields >> image.height;
+            }
+            else if(key == "DEPTH"){
+                fields >> channels;
+            }
+            else if(key == "MAXVAL"){
+                fields >> maxValue;
+            }
+        }
+    }
+    else{
+        throw std::runtime_error("input has to be a binary PPM or PAM image!");
+    }
+    if(image.width == 0 || image.height == 0 || maxValue != 255 || (channels != 3 && channels != 4)){
+        throw std::runtime_error("input has to be 8 bit RGB or RGBA!");
+    }
+    //exactly one whitespace byte between the P6 header and the pixels
+    if(magic == "P6"){
+        file.get();
+    }
+
+    std::vector<uint8_t> pixels(static_cast<size_t>(image.width) * image.height * channels);
+    file.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+    if(!file){
+        throw std::runtime_error("input image is truncated!");
+    }
+    image.rgba.resize(static_cast<size_t>(image.width) * image.height * 4);
+    for(size_t i = 0; i < static_cast<size_t>(image.width) * image.height; i++){
+        for(uint32_t c = 0; c < 3; c++){
+            image.rgba[i * 4 + c] = pixels[i * channels + c];
+        }
+        image.rgba[i * 4 + 3] = (channels == 4) ? pixels[i * channels + 3] : 255;
+    }
+    return image;
+}
+
+static VkFormat parseFormat(const std::string& name, bool srgb){
+    if(name == "bc1"){
+        return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    }
+    if(name == "bc5"){
+        if(srgb){
+            throw std::runtime_error("bc5 has no sRGB variant!");
+        }
+        return VK_FORMAT_BC5_UNORM_BLOCK;
+    }
+    if(name == "bc7"){
+        return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+    if(name == "rgba8"){
+        return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    throw std::runtime_error("unknown format, use bc1, bc5, bc7 or rgba8!");
+}
+
+
+int main(int argc, char** argv){
+    if(argc < 3){
+        std::cerr << "usage: texbuild input.pam output.ktx2 [--format bc1|bc5|bc7|rgba8] [--srgb] [--zstd]\n";
+        return EXIT_FAILURE;
+    }
+    try{
+        std::string formatName = "bc7";
+        bool srgb = false;
+        Ktx2Supercompression supercompression = Ktx2Supercompression::None;
+        for(int i = 3; i < argc; i++){
+            std::string arg = argv[i];
+            if(arg == "--format" && i + 1 < argc){
+                formatName = argv[++i];
+            }
+            else if(arg == "--srgb"){
+                srgb = true;
+            }
+            else if(arg == "--zstd"){
+                supercompression = Ktx2Supercompression::Zstd;
+            }
+            else{
+                throw std::runtime_error("unknown argument " + arg + "!");
+            }
+        }
+
+        SourceImage image = loadNetpbm(argv[1]);
+        Ktx2Texture texture;
+        texture.format = parseFormat(formatName, srgb);
+        size_t rawBytes = 0;
+        size_t compressedBytes = 0;
+        for(const TextureMip& mip : generateMips(image.rgba.data(), image.width, image.height, srgb)){
+            TextureMip compressed;
+            compressed.width = mip.width;
+            compressed.height = mip.height;
+            compressed.data = compressMip(texture.format, mip);
+            rawBytes += mip.data.size();
+            compressedBytes += compressed.data.size();
+            texture.mips.push_back(std::move(compressed));
+        }
+        writeKtx2(argv[2], texture, supercompression);
+        std::cout << argv[2] << ": " << image.width << "x" << image.height << ", " << texture.mips.size() << " mips, "
+            << rawBytes / 1024 << " KiB RGBA8 -> " << compressedBytes / 1024 << " KiB " << formatName << "\n";
+    }
+    catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
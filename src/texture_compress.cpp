@@ -0,0 +1,478 @@
+#include <texture_compress.hpp>
+
+#include <cmath>
+
+
+//sRGB <-> linear, alpha is never touched
+static float srgbToLinear(uint8_t value){
+    float c = value / 255.0f;
+    return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+static uint8_t linearToSrgb(float value){
+    float c = (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+}
+
+std::vector<TextureMip> generateMips(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb){
+    float toLinear[256];
+    for(uint32_t i = 0; i < 256; i++){
+        toLinear[i] = srgb ? srgbToLinear(static_cast<uint8_t>(i)) : i / 255.0f;
+    }
+
+    std::vector<TextureMip> mips;
+    TextureMip base;
+    base.width = width;
+    base.height = height;
+    base.data.assign(rgba, rgba + static_cast<size_t>(width) * height * 4);
+    mips.push_back(std::move(base));
+
+    while(mips.back().width > 1 || mips.back().height > 1){
+        const TextureMip& source = mips.back();
+        TextureMip mip;
+        mip.width = std::max(source.width / 2, 1u);
+        mip.height = std::max(source.height / 2, 1u);
+        mip.data.resize(static_cast<size_t>(mip.width) * mip.height * 4);
+        for(uint32_t y = 0; y < mip.height; y++){
+            for(uint32_t x = 0; x < mip.width; x++){
+                //clamped so 1 pixel wide sources still work
+                uint32_t x0 = std::min(x * 2, source.width - 1), x1 = std::min(x * 2 + 1, source.width - 1);
+                uint32_t y0 = std::min(y * 2, source.height - 1), y1 = std::min(y * 2 + 1, source.height - 1);
+                const uint8_t* texels[4] = {
+                    &source.data[(y0 * source.width + x0) * 4], &source.data[(y0 * source.width + x1) * 4],
+                    &source.data[(y1 * source.width + x0) * 4], &source.data[(y1 * source.width + x1) * 4]
+                };
+                uint8_t* out = &mip.data[(y * mip.width + x) * 4];
+                for(uint32_t c = 0; c < 3; c++){
+                    float sum = 0.0f;
+                    for(const uint8_t* texel : texels){
+                        sum += toLinear[texel[c]];
+                    }
+                    out[c] = srgb ? linearToSrgb(sum * 0.25f) : static_cast<uint8_t>(sum * 0.25f * 255.0f + 0.5f);
+                }
+                uint32_t alpha = texels[0][3] + texels[1][3] + texels[2][3] + texels[3][3];
+                out[3] = static_cast<uint8_t>((alpha + 2) / 4);
+            }
+        }
+        mips.push_back(std::move(mip));
+    }
+    return mips;
+}
+
+
+//4x4 texels of a block, clamped at the image edges
+static void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t texels[16][4]){
+    for(uint32_t y = 0; y < 4; y++){
+        for(uint32_t x = 0; x < 4; x++){
+            uint32_t sx = std::min(blockX * 4 + x, width - 1);
+            uint32_t sy = std::min(blockY * 4 + y, height - 1);
+            std::memcpy(texels[y * 4 + x], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+        }
+    }
+}
+//only the part of the block inside the image is written
+static void storeBlock(uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, const uint8_t texels[16][4]){
+    for(uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++){
+        for(uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++){
+            std::memcpy(&rgba[(static_cast<size_t>(blockY * 4 + y) * width + blockX * 4 + x) * 4], texels[y * 4 + x], 4);
+        }
+    }
+}
+
+//runs encode(texels, blockOut) over every block of the image
+template<uint32_t BlockBytes, typename Encode>
+static std::vector<uint8_t> encodeBlocks(const uint8_t* rgba, uint32_t width, uint32_t height, Encode encode){
+    uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * BlockBytes);
+    uint8_t texels[16][4];
+    for(uint32_t by = 0; by < blocksY; by++){
+        for(uint32_t bx = 0; bx < blocksX; bx++){
+            loadBlock(rgba, width, height, bx, by, texels);
+            encode(texels, &blocks[(static_cast<size_t>(by) * blocksX + bx) * BlockBytes]);
+        }
+    }
+    return blocks;
+}
+template<uint32_t BlockBytes, typename Decode>
+static std::vector<uint8_t> decodeBlocks(const TextureMip& mip, Decode decode){
+    uint32_t blocksX = (mip.width + 3) / 4, blocksY = (mip.height + 3) / 4;
+    if(mip.data.size() < static_cast<size_t>(blocksX) * blocksY * BlockBytes){
+        throw std::runtime_error("compressed mip is too small for its extent!");
+    }
+    std::vector<uint8_t> rgba(static_cast<size_t>(mip.width) * mip.height * 4);
+    uint8_t texels[16][4];
+    for(uint32_t by = 0; by < blocksY; by++){
+        for(uint32_t bx = 0; bx < blocksX; bx++){
+            decode(&mip.data[(static_cast<size_t>(by) * blocksX + bx) * BlockBytes], texels);
+            storeBlock(rgba.data(), mip.width, mip.height, bx, by, texels);
+        }
+    }
+    return rgba;
+}
+
+
+//principal axis of the texels' first Channels channels(power iteration on the covariance matrix)
+//endpoints = the texels' extremes along it
+template<uint32_t Channels>
+static void principalEndpoints(const uint8_t texels[16][4], float low[Channels], float high[Channels]){
+    float mean[Channels] = {};
+    for(uint32_t i = 0; i < 16; i++){
+        for(uint32_t c = 0; c < Channels; c++){
+            mean[c] += texels[i][c] / 16.0f;
+        }
+    }
+    float covariance[Channels][Channels] = {};
+    for(uint32_t i = 0; i < 16; i++){
+        for(uint32_t a = 0; a < Channels; a++){
+            for(uint32_t b = 0; b < Channels; b++){
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+            }
+        }
+    }
+    //start from the channel that varies most, an all ones seed is orthogonal to the axis of e.g. a red/green checker
+    //the seed's own component of covariance*seed is that channel's variance, so only flat blocks stop the iteration early
+    uint32_t widest = 0;
+    for(uint32_t c = 1; c < Channels; c++){
+        if(covariance[c][c] > covariance[widest][widest]){
+            widest = c;
+        }
+    }
+    float axis[Channels] = {};
+    axis[widest] = 1.0f;
+    for(uint32_t iteration = 0; iteration < 8; iteration++){
+        float next[Channels] = {};
+        float length = 0.0f;
+        for(uint32_t a = 0; a < Channels; a++){
+            for(uint32_t b = 0; b < Channels; b++){
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        //flat block, any axis works
+        if(length < 1e-6f){
+            break;
+        }
+        length = std::sqrt(length);
+        for(uint32_t c = 0; c < Channels; c++){
+            axis[c] = next[c] / length;
+        }
+    }
+    float minT = std::numeric_limits<float>::max(), maxT = std::numeric_limits<float>::lowest();
+    for(uint32_t i = 0; i < 16; i++){
+        float t = 0.0f;
+        for(uint32_t c = 0; c < Channels; c++){
+            t += (texels[i][c] - mean[c]) * axis[c];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for(uint32_t c = 0; c < Channels; c++){
+        low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+        high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+    }
+}
+
+template<uint32_t Channels>
+static uint32_t distanceSquared(const uint8_t* a, const uint8_t* b){
+    uint32_t sum = 0;
+    for(uint32_t c = 0; c < Channels; c++){
+        int32_t d = static_cast<int32_t>(a[c]) - b[c];
+        sum += d * d;
+    }
+    return sum;
+}
+
+
+//BC1
+static uint16_t packRGB565(const float color[3]){
+    uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+static void unpackRGB565(uint16_t color, uint8_t out[4]){
+    uint32_t r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    out[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+    out[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+    out[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+    out[3] = 255;
+}
+static void bc1Palette(uint16_t c0, uint16_t c1, uint8_t palette[4][4]){
+    unpackRGB565(c0, palette[0]);
+    unpackRGB565(c1, palette[1]);
+    for(uint32_t c = 0; c < 3; c++){
+        if(c0 > c1){
+            palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        }
+        else{
+            palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = 255;
+}
+
+static void encodeBC1Block(const uint8_t texels[16][4], uint8_t* out){
+    float low[3], high[3];
+    principalEndpoints<3>(texels, low, high);
+    uint16_t c0 = packRGB565(high), c1 = packRGB565(low);
+    //c0 > c1 selects the 4 color mode
+    if(c0 < c1){
+        std::swap(c0, c1);
+    }
+    uint32_t indices = 0;
+    if(c0 != c1){
+        uint8_t palette[4][4];
+        bc1Palette(c0, c1, palette);
+        for(uint32_t i = 0; i < 16; i++){
+            uint32_t best = 0, bestDistance = std::numeric_limits<uint32_t>::max();
+            for(uint32_t p = 0; p < 4; p++){
+                uint32_t distance = distanceSquared<3>(texels[i], palette[p]);
+                if(distance < bestDistance){
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            indices |= best << (i * 2);
+        }
+    }
+    std::memcpy(out, &c0, 2);
+    std::memcpy(out + 2, &c1, 2);
+    std::memcpy(out + 4, &indices, 4);
+}
+static void decodeBC1Block(const uint8_t* block, uint8_t texels[16][4]){
+    uint16_t c0, c1;
+    uint32_t indices;
+    std::memcpy(&c0, block, 2);
+    std::memcpy(&c1, block + 2, 2);
+    std::memcpy(&indices, block + 4, 4);
+    uint8_t palette[4][4];
+    bc1Palette(c0, c1, palette);
+    for(uint32_t i = 0; i < 16; i++){
+        std::memcpy(texels[i], palette[(indices >> (i * 2)) & 3], 4);
+    }
+}
+
+
+//BC4, one channel of BC5
+static void bc4Palette(uint8_t r0, uint8_t r1, uint8_t palette[8]){
+    palette[0] = r0;
+    palette[1] = r1;
+    if(r0 > r1){
+        for(uint32_t i = 2; i < 8; i++){
+            palette[i] = static_cast<uint8_t>(((8 - i) * r0 + (i - 1) * r1 + 3) / 7);
+        }
+    }
+    else{
+        for(uint32_t i = 2; i < 6; i++){
+            palette[i] = static_cast<uint8_t>(((6 - i) * r0 + (i - 1) * r1 + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+static void encodeBC4Block(const uint8_t texels[16][4], uint32_t channel, uint8_t* out){
+    uint8_t low = 255, high = 0;
+    for(uint32_t i = 0; i < 16; i++){
+        low = std::min(low, texels[i][channel]);
+        high = std::max(high, texels[i][channel]);
+    }
+    uint64_t bits = static_cast<uint64_t>(high) | (static_cast<uint64_t>(low) << 8);
+    if(high != low){
+        uint8_t palette[8];
+        bc4Palette(high, low, palette);
+        for(uint32_t i = 0; i < 16; i++){
+            uint32_t best = 0, bestDistance = 256;
+            for(uint32_t p = 0; p < 8; p++){
+                uint32_t distance = std::abs(static_cast<int32_t>(texels[i][channel]) - palette[p]);
+                if(distance < bestDistance){
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            bits |= static_cast<uint64_t>(best) << (16 + i * 3);
+        }
+    }
+    std::memcpy(out, &bits, 8);
+}
+static void decodeBC4Block(const uint8_t* block, uint32_t channel, uint8_t texels[16][4]){
+    uint64_t bits;
+    std::memcpy(&bits, block, 8);
+    uint8_t palette[8];
+    bc4Palette(static_cast<uint8_t>(bits), static_cast<uint8_t>(bits >> 8), palette);
+    for(uint32_t i = 0; i < 16; i++){
+        texels[i][channel] = palette[(bits >> (16 + i * 3)) & 7];
+    }
+}
+
+
+//BC7 mode 6
+static constexpr uint32_t BC7_WEIGHTS4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+//128 bit block read/written LSB first
+struct BlockBits{
+    uint64_t words[2] = {0, 0};
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t count){
+        for(uint32_t i = 0; i < count; i++, position++){
+            words[position / 64] |= static_cast<uint64_t>((value >> i) & 1) << (position % 64);
+        }
+    }
+    uint32_t read(uint32_t count){
+        uint32_t value = 0;
+        for(uint32_t i = 0; i < count; i++, position++){
+            value |= static_cast<uint32_t>((words[position / 64] >> (position % 64)) & 1) << i;
+        }
+        return value;
+    }
+};
+
+//7 bit endpoint + shared p bit, p picked per endpoint for the lowest error over all 4 channels
+static void quantizeBC7Endpoint(const float color[4], uint8_t quantized[4], uint32_t& pBit){
+    uint32_t bestError = std::numeric_limits<uint32_t>::max();
+    for(uint32_t p = 0; p < 2; p++){
+        uint8_t candidate[4];
+        uint32_t error = 0;
+        for(uint32_t c = 0; c < 4; c++){
+            int32_t q = static_cast<int32_t>(std::lround((color[c] - p) / 2.0f));
+            candidate[c] = static_cast<uint8_t>(std::clamp(q, 0, 127));
+            int32_t d = static_cast<int32_t>(((candidate[c] << 1) | p)) - static_cast<int32_t>(color[c] + 0.5f);
+            error += d * d;
+        }
+        if(error < bestError){
+            bestError = error;
+            pBit = p;
+            std::memcpy(quantized, candidate, 4);
+        }
+    }
+}
+static void bc7Palette(const uint8_t e0[4], const uint8_t e1[4], uint32_t p0, uint32_t p1, uint8_t palette[16][4]){
+    for(uint32_t i = 0; i < 16; i++){
+        for(uint32_t c = 0; c < 4; c++){
+            uint32_t a = (e0[c] << 1) | p0, b = (e1[c] << 1) | p1;
+            palette[i][c] = static_cast<uint8_t>(((64 - BC7_WEIGHTS4[i]) * a + BC7_WEIGHTS4[i] * b + 32) >> 6);
+        }
+    }
+}
+
+static void encodeBC7Block(const uint8_t texels[16][4], uint8_t* out){
+    float low[4], high[4];
+    principalEndpoints<4>(texels, low, high);
+    uint8_t e0[4], e1[4];
+    uint32_t p0 = 0, p1 = 0;
+    quantizeBC7Endpoint(low, e0, p0);
+    quantizeBC7Endpoint(high, e1, p1);
+
+    uint8_t palette[16][4];
+    bc7Palette(e0, e1, p0, p1, palette);
+    uint32_t indices[16];
+    for(uint32_t i = 0; i < 16; i++){
+        uint32_t bestDistance = std::numeric_limits<uint32_t>::max();
+        for(uint32_t p = 0; p < 16; p++){
+            uint32_t distance = distanceSquared<4>(texels[i], palette[p]);
+            if(distance < bestDistance){
+                indices[i] = p;
+                bestDistance = distance;
+            }
+        }
+    }
+    //the first index only has 3 bits, its top bit has to be 0
+    if(indices[0] & 8){
+        std::swap(e0, e1);
+        std::swap(p0, p1);
+        for(uint32_t& index : indices){
+            index = 15 - index;
+        }
+    }
+
+    BlockBits bits;
+    bits.write(1 << 6, 7);
+    for(uint32_t c = 0; c < 4; c++){
+        bits.write(e0[c], 7);
+        bits.write(e1[c], 7);
+    }
+    bits.write(p0, 1);
+    bits.write(p1, 1);
+    bits.write(indices[0], 3);
+    for(uint32_t i = 1; i < 16; i++){
+        bits.write(indices[i], 4);
+    }
+    std::memcpy(out, bits.words, 16);
+}
+static void decodeBC7Block(const uint8_t* block, uint8_t texels[16][4]){
+    BlockBits bits;
+    std::memcpy(bits.words, block, 16);
+    if(bits.read(7) != (1 << 6)){
+        throw std::runtime_error("only BC7 mode 6 blocks can be decompressed!");
+    }
+    uint8_t e0[4], e1[4];
+    for(uint32_t c = 0; c < 4; c++){
+        e0[c] = static_cast<uint8_t>(bits.read(7));
+        e1[c] = static_cast<uint8_t>(bits.read(7));
+    }
+    uint32_t p0 = bits.read(1), p1 = bits.read(1);
+    uint8_t palette[16][4];
+    bc7Palette(e0, e1, p0, p1, palette);
+    for(uint32_t i = 0; i < 16; i++){
+        std::memcpy(texels[i], palette[bits.read(i == 0 ? 3 : 4)], 4);
+    }
+}
+
+
+std::vector<uint8_t> compressBC1(const uint8_t* rgba, uint32_t width, uint32_t height){
+    return encodeBlocks<8>(rgba, width, height, encodeBC1Block);
+}
+std::vector<uint8_t> compressBC5(const uint8_t* rgba, uint32_t width, uint32_t height){
+    return encodeBlocks<16>(rgba, width, height, [](const uint8_t texels[16][4], uint8_t* out){
+        encodeBC4Block(texels, 0, out);
+        encodeBC4Block(texels, 1, out + 8);
+    });
+}
+std::vector<uint8_t> compressBC7(const uint8_t* rgba, uint32_t width, uint32_t height){
+    return encodeBlocks<16>(rgba, width, height, encodeBC7Block);
+}
+
+std::vector<uint8_t> compressMip(VkFormat format, const TextureMip& mip){
+    switch(format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return compressBC1(mip.data.data(), mip.width, mip.height);
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return compressBC5(mip.data.data(), mip.width, mip.height);
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return compressBC7(mip.data.data(), mip.width, mip.height);
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return mip.data;
+        default:
+            throw std::runtime_error("texture format not supported by the compressor!");
+    }
+}
+
+std::vector<uint8_t> decompressMip(VkFormat format, const TextureMip& mip){
+    switch(format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            return decodeBlocks<8>(mip, decodeBC1Block);
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return decodeBlocks<16>(mip, [](const uint8_t* block, uint8_t texels[16][4]){
+                decodeBC4Block(block, 0, texels);
+                decodeBC4Block(block + 8, 1, texels);
+                for(uint32_t i = 0; i < 16; i++){
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+            });
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return decodeBlocks<16>(mip, decodeBC7Block);
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+            return mip.data;
+        default:
+            throw std::runtime_error("texture format not supported by the decompressor!");
+    }
+}
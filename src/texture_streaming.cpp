@@ -0,0 +1,275 @@
+#include <texture_streaming.hpp>
+#include <gpu_memory.hpp>
+#include <cpu_trace.hpp>
+#include <debug_names.hpp>
+
+#include <algorithm>
+
+
+static void createBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryCategory category,
+    VkBuffer& buffer, VkDeviceMemory& memory, VkMemoryPropertyFlags& memoryFlags){
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS){
+        throw std::runtime_error("failed to create streaming feedback buffer!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, buffer, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, required, preferred);
+    if(allocateMemory(device, allocInfo, category, &memory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate streaming feedback memory!");
+    }
+    vkBindBufferMemory(device, buffer, memory, 0);
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    memoryFlags = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags;
+}
+
+
+TextureStreamer::TextureStreamer(VkDevice device, VkPhysicalDevice physicalDevice, JobSystem& jobs, TextureStreamingCallbacks callbacks, uint32_t maxTextures, uint32_t framesInFlight, VkDeviceSize budgetBytes)
+    : device(device), jobs(jobs), callbacks(std::move(callbacks)), maxTextures(maxTextures), framesInFlight(framesInFlight), budget(budgetBytes), slotValid(framesInFlight, false){
+    VkDeviceSize feedbackSize = maxTextures * sizeof(uint32_t);
+    VkMemoryPropertyFlags flags;
+    createBuffer(device, physicalDevice, feedbackSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, MemoryCategory::Other, feedback, feedbackMemory, flags);
+    //cached reads are a lot faster than uncached ones, worth the invalidate
+    createBuffer(device, physicalDevice, feedbackSize * framesInFlight, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT, MemoryCategory::Readback, readback, readbackMemory, flags);
+    DEBUG_NAME(device, feedback, "streaming feedback");
+    DEBUG_NAME(device, feedbackMemory, "streaming feedback");
+    DEBUG_NAME(device, readback, "streaming feedback readback");
+    DEBUG_NAME(device, readbackMemory, "streaming feedback readback");
+    readbackCoherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    void* data;
+    if(vkMapMemory(device, readbackMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS){
+        throw std::runtime_error("failed to map streaming feedback memory!");
+    }
+    readbackData = static_cast<const uint32_t*>(data);
+    textures.reserve(maxTextures);
+}
+TextureStreamer::~TextureStreamer(){
+    //load jobs point back at this
+    jobs.wait(loadCounter);
+    vkUnmapMemory(device, readbackMemory);
+    vkDestroyBuffer(device, readback, nullptr);
+    freeMemory(device, readbackMemory);
+    vkDestroyBuffer(device, feedback, nullptr);
+    freeMemory(device, feedbackMemory);
+}
+
+
+uint32_t TextureStreamer::addTexture(const StreamedTextureDesc& desc){
+    TRACE_ZONE("TextureStreamer::addTexture");
+    if(textures.size() >= maxTextures){
+        throw std::runtime_error("too many streamed textures!");
+    }
+    if(desc.mipBytes.empty()){
+        throw std::runtime_error("streamed texture has no mips!");
+    }
+    Texture texture;
+    texture.name = desc.name;
+    texture.mipBytes = desc.mipBytes;
+    uint32_t mipCount = static_cast<uint32_t>(desc.mipBytes.size());
+    //the smallest mip is always part of the tail even if it is huge
+    texture.tailMip = mipCount - 1;
+    while(texture.tailMip > 0 && texture.mipBytes[texture.tailMip - 1] <= TAIL_BYTES){
+        texture.tailMip--;
+    }
+    texture.residentMip = texture.tailMip;
+    texture.wantedMip = texture.tailMip;
+
+    uint32_t index = static_cast<uint32_t>(textures.size());
+    callbacks.load(index, texture.tailMip, mipCount);
+    residentBytes += mipRangeBytes(texture, texture.tailMip, mipCount);
+    textures.push_back(std::move(texture));
+    return index;
+}
+
+
+void TextureStreamer::recordFeedback(VkCommandBuffer cmd, uint32_t frameIndex){
+    uint32_t slot = frameIndex % framesInFlight;
+    VkDeviceSize feedbackSize = maxTextures * sizeof(uint32_t);
+
+    //shader writes -> copy and clear
+    VkBufferMemoryBarrier toTransfer{};
+    toTransfer.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    toTransfer.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toTransfer.buffer = feedback;
+    toTransfer.offset = 0;
+    toTransfer.size = feedbackSize;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 1, &toTransfer, 0, nullptr);
+
+    if(primed){
+        VkBufferCopy copy{0, slot * feedbackSize, feedbackSize};
+        vkCmdCopyBuffer(cmd, feedback, readback, 1, &copy);
+        //fill below overwrites what the copy reads
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+        slotValid[slot] = true;
+    }
+    primed = true;
+    vkCmdFillBuffer(cmd, feedback, 0, feedbackSize, NOT_REQUESTED);
+
+    //clear -> next frame's shaders, copy -> host
+    VkBufferMemoryBarrier barriers[2]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].buffer = feedback;
+    barriers[0].offset = 0;
+    barriers[0].size = feedbackSize;
+    barriers[1] = barriers[0];
+    barriers[1].dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barriers[1].buffer = readback;
+    barriers[1].offset = slot * feedbackSize;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 2, barriers, 0, nullptr);
+}
+
+
+void TextureStreamer::update(uint32_t frameIndex){
+    TRACE_ZONE("TextureStreamer::update");
+    frameCounter++;
+
+    //finished loads first so their textures can be scheduled again
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        for(const FinishedLoad& load : finished){
+            Texture& texture = textures[load.texture];
+            texture.residentMip = load.mip;
+            texture.loading = false;
+            loadsInFlight--;
+            mipsLoaded++;
+        }
+        finished.clear();
+    }
+
+    uint32_t slot = frameIndex % framesInFlight;
+    if(slotValid[slot]){
+        VkDeviceSize feedbackSize = maxTextures * sizeof(uint32_t);
+        if(!readbackCoherent){
+            VkMappedMemoryRange range{};
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = readbackMemory;
+            range.offset = 0;
+            range.size = VK_WHOLE_SIZE;
+            vkInvalidateMappedMemoryRanges(device, 1, &range);
+        }
+        const uint32_t* values = readbackData + slot * (feedbackSize / sizeof(uint32_t));
+        for(uint32_t i = 0; i < textures.size(); i++){
+            if(values[i] != NOT_REQUESTED){
+                textures[i].wantedMip = std::min(values[i], textures[i].tailMip);
+                textures[i].lastWantedFrame = frameCounter;
+            }
+        }
+    }
+
+    //biggest gap between wanted and resident first, those look the blurriest
+    std::vector<uint32_t> candidates;
+    for(uint32_t i = 0; i < textures.size(); i++){
+        const Texture& texture = textures[i];
+        if(!texture.loading && texture.lastWantedFrame == frameCounter && texture.wantedMip < texture.residentMip){
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b){
+        uint32_t gapA = textures[a].residentMip - textures[a].wantedMip;
+        uint32_t gapB = textures[b].residentMip - textures[b].wantedMip;
+        return gapA > gapB;
+    });
+
+    for(uint32_t index : candidates){
+        if(loadsInFlight >= MAX_LOADS_IN_FLIGHT){
+            break;
+        }
+        Texture& texture = textures[index];
+        //one mip at a time, the next one gets scheduled once this one landed
+        uint32_t mip = texture.residentMip - 1;
+        VkDeviceSize bytes = texture.mipBytes[mip];
+        //only textures nobody asked for this frame get evicted to make room
+        while(residentBytes + bytes > budget && evictOne(frameCounter)){
+
+        }
+        if(residentBytes + bytes > budget){
+            break;
+        }
+        texture.loading = true;
+        residentBytes += bytes;
+        loadsInFlight++;
+        jobs.run("texture stream", [this, index, mip](){
+            callbacks.load(index, mip, mip + 1);
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            finished.push_back({index, mip});
+        }, &loadCounter, JobPriority::Low);
+    }
+
+    //budget may have shrunk
+    while(residentBytes > budget && evictOne(frameCounter + 1)){
+
+    }
+}
+
+
+VkDeviceSize TextureStreamer::mipRangeBytes(const Texture& texture, uint32_t firstMip, uint32_t endMip) const{
+    VkDeviceSize bytes = 0;
+    for(uint32_t mip = firstMip; mip < endMip; mip++){
+        bytes += texture.mipBytes[mip];
+    }
+    return bytes;
+}
+
+//drops the finest mip of the texture that was wanted longest ago(before olderThan), never the tail
+bool TextureStreamer::evictOne(uint64_t olderThan){
+    Texture* coldest = nullptr;
+    uint32_t coldestIndex = 0;
+    for(uint32_t i = 0; i < textures.size(); i++){
+        Texture& texture = textures[i];
+        if(texture.loading || texture.residentMip >= texture.tailMip || texture.lastWantedFrame >= olderThan){
+            continue;
+        }
+        if(coldest == nullptr || texture.lastWantedFrame < coldest->lastWantedFrame){
+            coldest = &texture;
+            coldestIndex = i;
+        }
+    }
+    if(coldest == nullptr){
+        return false;
+    }
+    residentBytes -= coldest->mipBytes[coldest->residentMip];
+    coldest->residentMip++;
+    mipsEvicted++;
+    callbacks.evict(coldestIndex, coldest->residentMip);
+    return true;
+}
+
+
+TextureStreamingStats TextureStreamer::stats() const{
+    TextureStreamingStats s;
+    s.textures = static_cast<uint32_t>(textures.size());
+    s.loadsInFlight = loadsInFlight;
+    s.mipsLoaded = mipsLoaded;
+    s.mipsEvicted = mipsEvicted;
+    s.residentBytes = residentBytes;
+    s.budgetBytes = budget;
+    return s;
+}
+
+void TextureStreamer::printStats() const{
+    TextureStreamingStats s = stats();
+    std::cout << "Texture streaming: " << s.textures << " textures, " << s.residentBytes / 1024 << " / " << s.budgetBytes / 1024 << " KiB resident\n";
+    std::cout << "\t" << s.mipsLoaded << " mips loaded, " << s.mipsEvicted << " evicted, " << s.loadsInFlight << " loads in flight\n";
+}
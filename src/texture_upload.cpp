@@ -0,0 +1,162 @@
+#include <texture_upload.hpp>
+#include <gpu_memory.hpp>
+#include <streaming_copy.hpp>
+#include <cpu_trace.hpp>
+#include <debug_names.hpp>
+
+#include <vulkan/utility/vk_format_utils.h>
+#include <numeric>
+
+
+bool textureFormatSupported(VkPhysicalDevice physicalDevice, VkFormat format){
+    VkFormatProperties properties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+    VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+    return (properties.optimalTilingFeatures & needed) == needed;
+}
+
+VkFormat pickTextureFormat(VkPhysicalDevice physicalDevice, VkFormat fileFormat){
+    if(textureFormatSupported(physicalDevice, fileFormat)){
+        return fileFormat;
+    }
+    //BC on mobile, decoded on the CPU at 4-8x the memory
+    //there is no ASTC decoder, ship BC7 next to ASTC for desktops instead
+    if(vkuFormatIsCompressed_BC(fileFormat)){
+        return vkuFormatIsSRGB(fileFormat) ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+    }
+    throw std::runtime_error("texture format isn't supported by the device!");
+}
+
+
+UploadedTexture uploadTexture(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandBuffer cmd, const Ktx2Texture& texture, [[maybe_unused]] const std::string& name){
+    TRACE_ZONE("uploadTexture");
+    UploadedTexture result;
+    result.format = pickTextureFormat(physicalDevice, texture.format);
+    result.mipLevels = static_cast<uint32_t>(texture.mips.size());
+    bool transcode = result.format != texture.format;
+
+    //copy offsets have to be multiples of the block size and 4
+    VkDeviceSize alignment = std::lcm<VkDeviceSize>(vkuFormatTexelBlockSize(result.format), 4);
+    std::vector<std::vector<uint8_t>> transcoded;
+    std::vector<VkBufferImageCopy> regions;
+    VkDeviceSize stagingSize = 0;
+    for(uint32_t level = 0; level < result.mipLevels; level++){
+        const TextureMip& mip = texture.mips[level];
+        if(transcode){
+            transcoded.push_back(decompressMip(texture.format, mip));
+        }
+        VkDeviceSize size = transcode ? transcoded.back().size() : mip.data.size();
+        stagingSize = (stagingSize + alignment - 1) / alignment * alignment;
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingSize;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        region.imageExtent = {mip.width, mip.height, 1};
+        regions.push_back(region);
+        stagingSize += size;
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = stagingSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if(vkCreateBuffer(device, &bufferInfo, nullptr, &result.staging) != VK_SUCCESS){
+        throw std::runtime_error("failed to create texture staging buffer!");
+    }
+    DEBUG_NAME(device, result.staging, name + " staging");
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device, result.staging, &requirements);
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    if(allocateMemory(device, allocInfo, MemoryCategory::Staging, &result.stagingMemory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate texture staging memory!");
+    }
+    DEBUG_NAME(device, result.stagingMemory, name + " staging");
+    vkBindBufferMemory(device, result.staging, result.stagingMemory, 0);
+    void* data;
+    if(vkMapMemory(device, result.stagingMemory, 0, stagingSize, 0, &data) != VK_SUCCESS){
+        throw std::runtime_error("failed to map texture staging memory!");
+    }
+    for(uint32_t level = 0; level < result.mipLevels; level++){
+        const std::vector<uint8_t>& bytes = transcode ? transcoded[level] : texture.mips[level].data;
+        //staging is write-combined on most drivers, plain memcpy runs far below bus speed there
+        streamingCopy(static_cast<uint8_t*>(data) + regions[level].bufferOffset, bytes.data(), bytes.size());
+    }
+    vkUnmapMemory(device, result.stagingMemory);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = result.format;
+    imageInfo.extent = {texture.mips[0].width, texture.mips[0].height, 1};
+    imageInfo.mipLevels = result.mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if(vkCreateImage(device, &imageInfo, nullptr, &result.image) != VK_SUCCESS){
+        throw std::runtime_error("failed to create texture image!");
+    }
+    DEBUG_NAME(device, result.image, name);
+    vkGetImageMemoryRequirements(device, result.image, &requirements);
+    allocInfo.allocationSize = requirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(allocateMemory(device, allocInfo, MemoryCategory::Texture, &result.memory) != VK_SUCCESS){
+        throw std::runtime_error("failed to allocate texture memory!");
+    }
+    DEBUG_NAME(device, result.memory, name);
+    vkBindImageMemory(device, result.image, result.memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = result.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = result.format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, result.mipLevels, 0, 1};
+    if(vkCreateImageView(device, &viewInfo, nullptr, &result.view) != VK_SUCCESS){
+        throw std::runtime_error("failed to create texture image view!");
+    }
+    DEBUG_NAME(device, result.view, name);
+
+    //every mip at once, nothing reads the image before the copies
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = result.image;
+    barrier.subresourceRange = viewInfo.subresourceRange;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+    vkCmdCopyBufferToImage(cmd, result.staging, result.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    return result;
+}
+
+void destroyStaging(VkDevice device, UploadedTexture& texture){
+    vkDestroyBuffer(device, texture.staging, nullptr);
+    freeMemory(device, texture.stagingMemory);
+    texture.staging = VK_NULL_HANDLE;
+    texture.stagingMemory = VK_NULL_HANDLE;
+}
+
+void destroyTexture(VkDevice device, UploadedTexture& texture){
+    destroyStaging(device, texture);
+    vkDestroyImageView(device, texture.view, nullptr);
+    vkDestroyImage(device, texture.image, nullptr);
+    freeMemory(device, texture.memory);
+    texture = UploadedTexture{};
+}
@@ -0,0 +1,248 @@
+#include <transform_batch.hpp>
+
+#include <glm/simd/matrix.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+    #define TRANSFORM_BATCH_X86 1
+#else
+    #define TRANSFORM_BATCH_X86 0
+#endif
+
+
+void TransformSoA::resize(size_t count){
+    positionX.resize(count, 0.0f);
+    positionY.resize(count, 0.0f);
+    positionZ.resize(count, 0.0f);
+    rotationX.resize(count, 0.0f);
+    rotationY.resize(count, 0.0f);
+    rotationZ.resize(count, 0.0f);
+    rotationW.resize(count, 1.0f);
+    scaleX.resize(count, 1.0f);
+    scaleY.resize(count, 1.0f);
+    scaleZ.resize(count, 1.0f);
+}
+void TransformSoA::set(size_t index, glm::vec3 position, glm::quat rotation, glm::vec3 scale){
+    positionX[index] = position.x;
+    positionY[index] = position.y;
+    positionZ[index] = position.z;
+    rotationX[index] = rotation.x;
+    rotationY[index] = rotation.y;
+    rotationZ[index] = rotation.z;
+    rotationW[index] = rotation.w;
+    scaleX[index] = scale.x;
+    scaleY[index] = scale.y;
+    scaleZ[index] = scale.z;
+}
+
+
+//raw stream pointers already offset to the first instance of the batch
+struct TransformStreams{
+    const float *px, *py, *pz;
+    const float *qx, *qy, *qz, *qw;
+    const float *sx, *sy, *sz;
+
+    TransformStreams(const TransformSoA& t, size_t first) :
+        px(t.positionX.data() + first), py(t.positionY.data() + first), pz(t.positionZ.data() + first),
+        qx(t.rotationX.data() + first), qy(t.rotationY.data() + first), qz(t.rotationZ.data() + first), qw(t.rotationW.data() + first),
+        sx(t.scaleX.data() + first), sy(t.scaleY.data() + first), sz(t.scaleZ.data() + first){}
+};
+
+//reference kernel, also handles the tails the SIMD kernels leave over
+static void composeScalar(const TransformStreams& s, size_t begin, size_t end, glm::mat4* models, glm::mat4* normals){
+    for(size_t i = begin; i < end; i++){
+        float x = s.qx[i], y = s.qy[i], z = s.qz[i], w = s.qw[i];
+        //rotation matrix columns from the quaternion
+        glm::vec3 r0(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y));
+        glm::vec3 r1(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x));
+        glm::vec3 r2(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y));
+
+        glm::mat4& m = models[i];
+        m[0] = glm::vec4(r0 * s.sx[i], 0.0f);
+        m[1] = glm::vec4(r1 * s.sy[i], 0.0f);
+        m[2] = glm::vec4(r2 * s.sz[i], 0.0f);
+        m[3] = glm::vec4(s.px[i], s.py[i], s.pz[i], 1.0f);
+        //(R * S)^-T = R * S^-1 since R is orthonormal
+        if(normals){
+            glm::mat4& n = normals[i];
+            n[0] = glm::vec4(r0 / s.sx[i], 0.0f);
+            n[1] = glm::vec4(r1 / s.sy[i], 0.0f);
+            n[2] = glm::vec4(r2 / s.sz[i], 0.0f);
+            n[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+//4 instances per iteration, every matrix element is computed for all 4 lanes at once
+//then each column is turned back into per instance layout with a 4x4 transpose
+static void composeSSE2(const TransformStreams& s, size_t count, glm::mat4* models, glm::mat4* normals){
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 zero = _mm_setzero_ps();
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128 x = _mm_loadu_ps(s.qx + i), y = _mm_loadu_ps(s.qy + i), z = _mm_loadu_ps(s.qz + i), w = _mm_loadu_ps(s.qw + i);
+        __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+        __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+        __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+        //rotation, r<column><row>
+        __m128 r[3][3];
+        r[0][0] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz)));
+        r[0][1] = _mm_mul_ps(two, _mm_add_ps(xy, wz));
+        r[0][2] = _mm_mul_ps(two, _mm_sub_ps(xz, wy));
+        r[1][0] = _mm_mul_ps(two, _mm_sub_ps(xy, wz));
+        r[1][1] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz)));
+        r[1][2] = _mm_mul_ps(two, _mm_add_ps(yz, wx));
+        r[2][0] = _mm_mul_ps(two, _mm_add_ps(xz, wy));
+        r[2][1] = _mm_mul_ps(two, _mm_sub_ps(yz, wx));
+        r[2][2] = _mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy)));
+
+        __m128 scale[3] = {_mm_loadu_ps(s.sx + i), _mm_loadu_ps(s.sy + i), _mm_loadu_ps(s.sz + i)};
+        for(int c = 0; c < 3; c++){
+            glm_vec4 rows[4] = {_mm_mul_ps(r[c][0], scale[c]), _mm_mul_ps(r[c][1], scale[c]), _mm_mul_ps(r[c][2], scale[c]), zero};
+            glm_vec4 columns[4];
+            glm_mat4_transpose(rows, columns);
+            for(int k = 0; k < 4; k++){
+                _mm_storeu_ps(&models[i + k][c][0], columns[k]);
+            }
+        }
+        glm_vec4 rows[4] = {_mm_loadu_ps(s.px + i), _mm_loadu_ps(s.py + i), _mm_loadu_ps(s.pz + i), one};
+        glm_vec4 columns[4];
+        glm_mat4_transpose(rows, columns);
+        for(int k = 0; k < 4; k++){
+            _mm_storeu_ps(&models[i + k][3][0], columns[k]);
+        }
+
+        if(normals){
+            const __m128 identityColumn = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+            for(int c = 0; c < 3; c++){
+                __m128 inverseScale = _mm_div_ps(one, scale[c]);
+                glm_vec4 rows[4] = {_mm_mul_ps(r[c][0], inverseScale), _mm_mul_ps(r[c][1], inverseScale), _mm_mul_ps(r[c][2], inverseScale), zero};
+                glm_vec4 columns[4];
+                glm_mat4_transpose(rows, columns);
+                for(int k = 0; k < 4; k++){
+                    _mm_storeu_ps(&normals[i + k][c][0], columns[k]);
+                }
+            }
+            for(int k = 0; k < 4; k++){
+                _mm_storeu_ps(&normals[i + k][3][0], identityColumn);
+            }
+        }
+    }
+    composeScalar(s, i, count, models, normals);
+}
+#endif
+
+#if TRANSFORM_BATCH_X86
+//transposes 4 rows of 8 lanes into 8 columns, instance k gets lane k of every row
+__attribute__((target("avx2,fma")))
+static inline void storeColumns8(__m256 a, __m256 b, __m256 c, __m256 d, glm::mat4* out, int column){
+    __m256 t0 = _mm256_unpacklo_ps(a, b); //a0 b0 a1 b1 | a4 b4 a5 b5
+    __m256 t1 = _mm256_unpackhi_ps(a, b); //a2 b2 a3 b3 | a6 b6 a7 b7
+    __m256 t2 = _mm256_unpacklo_ps(c, d);
+    __m256 t3 = _mm256_unpackhi_ps(c, d);
+    __m256 v[4] = {
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0)), //a0 b0 c0 d0 | a4 b4 c4 d4
+        _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2))
+    };
+    for(int k = 0; k < 4; k++){
+        _mm_storeu_ps(&out[k][column][0], _mm256_castps256_ps128(v[k]));
+        _mm_storeu_ps(&out[k + 4][column][0], _mm256_extractf128_ps(v[k], 1));
+    }
+}
+//8 instances per iteration, same math as composeSSE2 with FMA for the diagonal terms
+__attribute__((target("avx2,fma")))
+static void composeAVX2(const TransformStreams& s, size_t count, glm::mat4* models, glm::mat4* normals){
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 two = _mm256_set1_ps(2.0f);
+    const __m256 minusTwo = _mm256_set1_ps(-2.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256 x = _mm256_loadu_ps(s.qx + i), y = _mm256_loadu_ps(s.qy + i), z = _mm256_loadu_ps(s.qz + i), w = _mm256_loadu_ps(s.qw + i);
+        __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+        __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+        __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+        //rotation, r<column><row>
+        __m256 r[3][3];
+        r[0][0] = _mm256_fmadd_ps(minusTwo, _mm256_add_ps(yy, zz), one);
+        r[0][1] = _mm256_mul_ps(two, _mm256_add_ps(xy, wz));
+        r[0][2] = _mm256_mul_ps(two, _mm256_sub_ps(xz, wy));
+        r[1][0] = _mm256_mul_ps(two, _mm256_sub_ps(xy, wz));
+        r[1][1] = _mm256_fmadd_ps(minusTwo, _mm256_add_ps(xx, zz), one);
+        r[1][2] = _mm256_mul_ps(two, _mm256_add_ps(yz, wx));
+        r[2][0] = _mm256_mul_ps(two, _mm256_add_ps(xz, wy));
+        r[2][1] = _mm256_mul_ps(two, _mm256_sub_ps(yz, wx));
+        r[2][2] = _mm256_fmadd_ps(minusTwo, _mm256_add_ps(xx, yy), one);
+
+        __m256 scale[3] = {_mm256_loadu_ps(s.sx + i), _mm256_loadu_ps(s.sy + i), _mm256_loadu_ps(s.sz + i)};
+        for(int c = 0; c < 3; c++){
+            storeColumns8(_mm256_mul_ps(r[c][0], scale[c]), _mm256_mul_ps(r[c][1], scale[c]), _mm256_mul_ps(r[c][2], scale[c]), zero, models + i, c);
+        }
+        storeColumns8(_mm256_loadu_ps(s.px + i), _mm256_loadu_ps(s.py + i), _mm256_loadu_ps(s.pz + i), one, models + i, 3);
+
+        if(normals){
+            for(int c = 0; c < 3; c++){
+                __m256 inverseScale = _mm256_div_ps(one, scale[c]);
+                storeColumns8(_mm256_mul_ps(r[c][0], inverseScale), _mm256_mul_ps(r[c][1], inverseScale), _mm256_mul_ps(r[c][2], inverseScale), zero, normals + i, c);
+            }
+            storeColumns8(zero, zero, zero, one, normals + i, 3);
+        }
+    }
+    composeScalar(s, i, count, models, normals);
+}
+#endif
+
+
+TransformKernel selectTransformKernel(){
+    #if TRANSFORM_BATCH_X86 && defined(__GNUC__)
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+            return TransformKernel::AVX2;
+        }
+    #endif
+    #if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        return TransformKernel::SSE2;
+    #else
+        return TransformKernel::Scalar;
+    #endif
+}
+const char* transformKernelName(TransformKernel kernel){
+    switch(kernel){
+        case TransformKernel::Scalar:
+            return "scalar";
+        case TransformKernel::SSE2:
+            return "SSE2";
+        case TransformKernel::AVX2:
+            return "AVX2";
+    }
+    return "unknown";
+}
+
+void composeModelMatrices(const TransformSoA& transforms, size_t first, size_t count, glm::mat4* models, glm::mat4* normals, TransformKernel kernel){
+    TransformStreams streams(transforms, first);
+    switch(kernel){
+        #if TRANSFORM_BATCH_X86
+        case TransformKernel::AVX2:
+            composeAVX2(streams, count, models, normals);
+            return;
+        #endif
+        #if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        case TransformKernel::SSE2:
+            composeSSE2(streams, count, models, normals);
+            return;
+        #endif
+        default:
+            composeScalar(streams, 0, count, models, normals);
+            return;
+    }
+}
+void composeModelMatrices(const TransformSoA& transforms, size_t first, size_t count, glm::mat4* models, glm::mat4* normals){
+    //the cpu doesn't change while running, only ask once
+    static const TransformKernel kernel = selectTransformKernel();
+    composeModelMatrices(transforms, first, count, models, normals, kernel);
+}
@@ -0,0 +1,107 @@
+#include <validation_settings.hpp>
+
+
+static const char* VALIDATION_LAYER = "VK_LAYER_KHRONOS_validation";
+static const VkBool32 SETTING_ON = VK_TRUE;
+static const VkBool32 SETTING_OFF = VK_FALSE;
+
+ValidationPreset parseValidationPreset(const std::string& name){
+    for(ValidationPreset preset : {ValidationPreset::Off, ValidationPreset::Full, ValidationPreset::Sync, ValidationPreset::Perf, ValidationPreset::Gpu}){
+        if(name == validationPresetName(preset)){
+            return preset;
+        }
+    }
+    throw std::runtime_error("unknown validation preset " + name + "(off, full, sync, perf, gpu)!");
+}
+
+const char* validationPresetName(ValidationPreset preset){
+    switch(preset){
+        case ValidationPreset::Off:
+            return "off";
+        case ValidationPreset::Full:
+            return "full";
+        case ValidationPreset::Sync:
+            return "sync";
+        case ValidationPreset::Perf:
+            return "perf";
+        case ValidationPreset::Gpu:
+            return "gpu";
+    }
+    return "unknown";
+}
+
+
+static bool layerHasExtension(const char* extensionName){
+    uint32_t count = 0;
+    vkEnumerateInstanceExtensionProperties(VALIDATION_LAYER, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateInstanceExtensionProperties(VALIDATION_LAYER, &count, extensions.data());
+    for(const auto& extension : extensions){
+        if(strcmp(extension.extensionName, extensionName) == 0){
+            return true;
+        }
+    }
+    return false;
+}
+
+void ValidationSettings::chain(VkInstanceCreateInfo& createInfo, std::vector<const char*>& extensions){
+    if(preset == ValidationPreset::Off || preset == ValidationPreset::Full){
+        return;
+    }
+
+    //setting names from the layer's VkLayer_khronos_validation.json
+    auto set = [&](const char* name, bool on){
+        settings.push_back({VALIDATION_LAYER, name, VK_LAYER_SETTING_TYPE_BOOL32_EXT, 1, on ? &SETTING_ON : &SETTING_OFF});
+    };
+    switch(preset){
+        case ValidationPreset::Sync:
+            set("validate_sync", true);
+            enables.push_back(VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT);
+            break;
+        case ValidationPreset::Perf:
+            set("validate_best_practices", true);
+            set("validate_core", false);
+            set("validate_sync", false);
+            set("thread_safety", false);
+            set("object_lifetime", false);
+            set("stateless_param", false);
+            enables.push_back(VK_VALIDATION_FEATURE_ENABLE_BEST_PRACTICES_EXT);
+            disables.push_back(VK_VALIDATION_FEATURE_DISABLE_CORE_CHECKS_EXT);
+            disables.push_back(VK_VALIDATION_FEATURE_DISABLE_THREAD_SAFETY_EXT);
+            disables.push_back(VK_VALIDATION_FEATURE_DISABLE_OBJECT_LIFETIMES_EXT);
+            disables.push_back(VK_VALIDATION_FEATURE_DISABLE_API_PARAMETERS_EXT);
+            break;
+        case ValidationPreset::Gpu:
+            set("gpuav_enable", true);
+            //GPU-AV is slow enough already, the thread checks add a lock to every call
+            set("thread_safety", false);
+            enables.push_back(VK_VALIDATION_FEATURE_ENABLE_GPU_ASSISTED_EXT);
+            disables.push_back(VK_VALIDATION_FEATURE_DISABLE_THREAD_SAFETY_EXT);
+            break;
+        default:
+            break;
+    }
+
+    if(layerHasExtension(VK_EXT_LAYER_SETTINGS_EXTENSION_NAME)){
+        layerSettings.sType = VK_STRUCTURE_TYPE_LAYER_SETTINGS_CREATE_INFO_EXT;
+        layerSettings.pNext = createInfo.pNext;
+        layerSettings.settingCount = static_cast<uint32_t>(settings.size());
+        layerSettings.pSettings = settings.data();
+        createInfo.pNext = &layerSettings;
+        extensions.push_back(VK_EXT_LAYER_SETTINGS_EXTENSION_NAME);
+    }
+    else if(layerHasExtension(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME)){
+        features.sType = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT;
+        features.pNext = createInfo.pNext;
+        features.enabledValidationFeatureCount = static_cast<uint32_t>(enables.size());
+        features.pEnabledValidationFeatures = enables.data();
+        features.disabledValidationFeatureCount = static_cast<uint32_t>(disables.size());
+        features.pDisabledValidationFeatures = disables.data();
+        createInfo.pNext = &features;
+        extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+    }
+    else{
+        std::cerr << "validation layer supports neither VK_EXT_layer_settings nor VK_EXT_validation_features, "
+            << "preset " << validationPresetName(preset) << " falls back to the layer's defaults\n";
+    }
+}
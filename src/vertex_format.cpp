@@ -0,0 +1,118 @@
+#include <vertex_format.hpp>
+
+#include <cmath>
+#include <limits>
+
+//sign that treats 0 as positive, plain glm::sign would collapse the fold
+static glm::vec2 signNotZero(glm::vec2 v){
+    return glm::vec2((v.x >= 0.0f) ? 1.0f : -1.0f, (v.y >= 0.0f) ? 1.0f : -1.0f);
+}
+//angle between two vectors, atan2 form because acos has no precision left near 0
+static float angleBetween(glm::vec3 a, glm::vec3 b){
+    return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+}
+
+glm::vec2 octahedralEncode(glm::vec3 n){
+    float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    if(l1 == 0.0f){
+        //zero normal or tangent from a broken asset, (0, 0) decodes to +Z instead of NaN
+        return glm::vec2(0.0f);
+    }
+    //project onto the octahedron |x| + |y| + |z| = 1
+    n /= l1;
+    glm::vec2 e(n.x, n.y);
+    //fold the lower hemisphere over the diagonals
+    if(n.z < 0.0f){
+        e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero(e);
+    }
+    return e;
+}
+glm::vec3 octahedralDecode(glm::vec2 e){
+    //same branchless unfold as octDecode() in shader.vert
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += (n.x >= 0.0f) ? -t : t;
+    n.y += (n.y >= 0.0f) ? -t : t;
+    return glm::normalize(n);
+}
+
+MeshBounds computeMeshBounds(const Vertex* vertices, size_t count){
+    MeshBounds bounds;
+    if(count == 0){
+        return bounds;
+    }
+    glm::vec3 lo = vertices[0].position;
+    glm::vec3 hi = vertices[0].position;
+    for(size_t i = 1; i < count; i++){
+        lo = glm::min(lo, vertices[i].position);
+        hi = glm::max(hi, vertices[i].position);
+    }
+    bounds.min = lo;
+    bounds.extent = hi - lo;
+    return bounds;
+}
+
+PackedVertex packVertex(const Vertex& vertex, const MeshBounds& bounds){
+    //flat axes have 0 extent, everything on them quantizes to 0
+    glm::vec3 invExtent(
+        (bounds.extent.x > 0.0f) ? 1.0f / bounds.extent.x : 0.0f,
+        (bounds.extent.y > 0.0f) ? 1.0f / bounds.extent.y : 0.0f,
+        (bounds.extent.z > 0.0f) ? 1.0f / bounds.extent.z : 0.0f
+    );
+    glm::vec3 relative = (vertex.position - bounds.min) * invExtent;
+
+    PackedVertex packed;
+    packed.position = glm::packUnorm<uint16_t>(glm::vec4(relative, (vertex.tangent.w < 0.0f) ? 0.0f : 1.0f));
+    packed.normal = glm::packSnorm<int16_t>(octahedralEncode(vertex.normal));
+    packed.tangent = glm::packSnorm<int16_t>(octahedralEncode(glm::vec3(vertex.tangent)));
+    packed.uv = glm::packHalf(vertex.uv);
+    return packed;
+}
+Vertex unpackVertex(const PackedVertex& packed, const MeshBounds& bounds){
+    glm::vec4 position = glm::unpackUnorm<float>(packed.position);
+
+    Vertex vertex;
+    vertex.position = bounds.min + glm::vec3(position) * bounds.extent;
+    vertex.normal = octahedralDecode(glm::unpackSnorm<float>(packed.normal));
+    vertex.tangent = glm::vec4(octahedralDecode(glm::unpackSnorm<float>(packed.tangent)), (position.w > 0.5f) ? 1.0f : -1.0f);
+    vertex.uv = glm::unpackHalf(packed.uv);
+    return vertex;
+}
+void packVertices(const Vertex* vertices, size_t count, const MeshBounds& bounds, PackedVertex* out){
+    for(size_t i = 0; i < count; i++){
+        out[i] = packVertex(vertices[i], bounds);
+    }
+}
+std::vector<PackedVertex> packMesh(const std::vector<Vertex>& vertices, MeshBounds& bounds){
+    bounds = computeMeshBounds(vertices.data(), vertices.size());
+    std::vector<PackedVertex> packed(vertices.size());
+    packVertices(vertices.data(), vertices.size(), bounds, packed.data());
+    return packed;
+}
+
+VertexEncodingError vertexEncodingErrorBound(const MeshBounds& bounds, float maxUVMagnitude){
+    VertexEncodingError bound;
+    //half a unorm16 step on every axis, plus float rounding of min + t * extent in the decode
+    glm::vec3 rounding = (glm::abs(bounds.min) + bounds.extent) * (2.0f * std::numeric_limits<float>::epsilon());
+    bound.position = glm::length(bounds.extent * (0.5f / 65535.0f) + rounding);
+    //half a snorm16 step on both octahedral axes is ~2.2e-5, the mapping stretches it by up to ~3x
+    //near the folds, tests/vertex_format_test.cpp sees ~6.4e-5 rad over 200k random directions
+    bound.normalAngle = 8.0e-5f;
+    bound.tangentAngle = bound.normalAngle;
+    //half an ulp of a half float at the largest magnitude(10 mantissa bits)
+    float magnitude = std::max(maxUVMagnitude, 6.103515625e-5f); //smallest normal half
+    bound.uv = std::ldexp(1.0f, static_cast<int>(std::floor(std::log2(magnitude))) - 11);
+    return bound;
+}
+VertexEncodingError measureVertexEncodingError(const Vertex* vertices, const PackedVertex* packed, size_t count, const MeshBounds& bounds){
+    VertexEncodingError error;
+    for(size_t i = 0; i < count; i++){
+        Vertex decoded = unpackVertex(packed[i], bounds);
+        error.position = std::max(error.position, glm::length(decoded.position - vertices[i].position));
+        error.normalAngle = std::max(error.normalAngle, angleBetween(decoded.normal, vertices[i].normal));
+        error.tangentAngle = std::max(error.tangentAngle, angleBetween(glm::vec3(decoded.tangent), glm::vec3(vertices[i].tangent)));
+        glm::vec2 uvDelta = glm::abs(decoded.uv - vertices[i].uv);
+        error.uv = std::max(error.uv, std::max(uvDelta.x, uvDelta.y));
+    }
+    return error;
+}
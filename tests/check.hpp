@@ -0,0 +1,32 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+#include <iostream>
+
+
+//minimal assertions for the CPU side tests, a failed CHECK prints where and keeps going
+//main returns checkResult() so make tests stops on the first failing binary
+inline int& checkFailures(){
+    static int failures = 0;
+    return failures;
+}
+#define CHECK(condition) \
+    do{ \
+        if(!(condition)){ \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            checkFailures()++; \
+        } \
+    }while(0)
+inline int checkResult(const char* name){
+    if(checkFailures() != 0){
+        std::cerr << name << ": " << checkFailures() << " checks failed\n";
+        return 1;
+    }
+    std::cout << name << ": ok\n";
+    return 0;
+}
+
+
+
+
+#endif
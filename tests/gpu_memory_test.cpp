@@ -0,0 +1,90 @@
+#include <gpu_memory.hpp>
+#include "check.hpp"
+
+
+static bool sameRanges(const std::vector<MappedRange>& ranges, std::initializer_list<MappedRange> expected){
+    if(ranges.size() != expected.size()){
+        return false;
+    }
+    auto it = expected.begin();
+    for(const MappedRange& range : ranges){
+        if(range.offset != it->offset || range.size != it->size){
+            return false;
+        }
+        ++it;
+    }
+    return true;
+}
+
+static void widenedToAtoms(){
+    //unsorted, widened out to 64 byte atoms
+    CHECK(sameRanges(mergeMappedRanges({{300, 10}, {10, 5}}, 64, 1000), {{0, 64}, {256, 64}}));
+    //atom 1 is the ranges as given
+    CHECK(sameRanges(mergeMappedRanges({{3, 5}, {20, 1}}, 1, 1000), {{3, 5}, {20, 1}}));
+    //the last atom is cut at the end of the allocation
+    CHECK(sameRanges(mergeMappedRanges({{990, 5}}, 64, 1000), {{960, 40}}));
+    CHECK(sameRanges(mergeMappedRanges({{990, 100}}, 64, 1000), {{960, 40}}));
+}
+
+static void touchingRangesMerge(){
+    //[0, 64) and [64, 128) only touch after widening
+    CHECK(sameRanges(mergeMappedRanges({{10, 5}, {100, 20}}, 64, 1000), {{0, 128}}));
+    //one range inside another
+    CHECK(sameRanges(mergeMappedRanges({{0, 512}, {100, 20}}, 64, 1000), {{0, 512}}));
+    //a gap of one atom stays a gap
+    CHECK(sameRanges(mergeMappedRanges({{0, 10}, {130, 10}}, 64, 1000), {{0, 64}, {128, 64}}));
+    CHECK(sameRanges(mergeMappedRanges({{0, 10}, {130, 10}, {70, 1}}, 64, 1000), {{0, 192}}));
+}
+
+static void emptyAndWholeSize(){
+    CHECK(mergeMappedRanges({}, 64, 1000).empty());
+    CHECK(mergeMappedRanges({{100, 0}}, 64, 1000).empty());
+    CHECK(mergeMappedRanges({{2000, 10}}, 64, 1000).empty());
+    //VK_WHOLE_SIZE used to wrap offset + size around
+    CHECK(sameRanges(mergeMappedRanges({{500, VK_WHOLE_SIZE}}, 64, 1000), {{448, 552}}));
+    CHECK(sameRanges(mergeMappedRanges({{0, VK_WHOLE_SIZE}, {100, 0}}, 256, 1000), {{0, 1000}}));
+}
+
+static VkPhysicalDeviceMemoryProperties memoryTypes(std::initializer_list<VkMemoryPropertyFlags> flags){
+    VkPhysicalDeviceMemoryProperties properties{};
+    for(VkMemoryPropertyFlags typeFlags : flags){
+        properties.memoryTypes[properties.memoryTypeCount++] = {typeFlags, 0};
+    }
+    properties.memoryHeapCount = 1;
+    return properties;
+}
+
+static void preferredFlagsScored(){
+    constexpr VkMemoryPropertyFlags LOCAL = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    constexpr VkMemoryPropertyFlags VISIBLE = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    constexpr VkMemoryPropertyFlags COHERENT = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    constexpr VkMemoryPropertyFlags CACHED = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+    VkPhysicalDeviceMemoryProperties properties = memoryTypes({LOCAL, VISIBLE | CACHED, VISIBLE | COHERENT, LOCAL | VISIBLE});
+    //nobody has both preferred flags, the one with one of them beats the first visible type
+    CHECK(findMemoryType(properties, 0xF, VISIBLE, LOCAL | COHERENT) == 2);
+    CHECK(findMemoryType(properties, 0xF, VISIBLE, COHERENT) == 2);
+    //equal scores go to the driver's order
+    CHECK(findMemoryType(properties, 0xF, VISIBLE, CACHED | COHERENT) == 1);
+    CHECK(findMemoryType(properties, 0xF, VISIBLE, LOCAL) == 3);
+    CHECK(findMemoryType(properties, 0xF, VISIBLE) == 1);
+    //typeBits and required still rule
+    CHECK(findMemoryType(properties, 0x6, VISIBLE, LOCAL) == 1);
+    CHECK(findMemoryType(properties, 0x1, 0, VISIBLE) == 0);
+    bool threw = false;
+    try{
+        findMemoryType(properties, 0x1, VISIBLE);
+    }
+    catch(const std::runtime_error&){
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+
+int main(){
+    widenedToAtoms();
+    touchingRangesMerge();
+    emptyAndWholeSize();
+    preferredFlagsScored();
+    return checkResult("gpu_memory_test");
+}
@@ -0,0 +1,182 @@
+#include <image_encode.hpp>
+#include "check.hpp"
+
+#include <random>
+
+
+static RGBAImage makeImage(uint32_t width, uint32_t height){
+    RGBAImage image;
+    image.width = width;
+    image.height = height;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    return image;
+}
+
+static bool qoiRoundTrips(const RGBAImage& image){
+    RGBAImage decoded = decodeQOI(encodeQOI(image));
+    return decoded.width == image.width && decoded.height == image.height && decoded.pixels == image.pixels;
+}
+
+//one image per kind of QOI op, plus everything mixed
+static void qoiRoundTrip(){
+    std::mt19937 rng(7);
+    RGBAImage noise = makeImage(61, 37);
+    for(uint8_t& byte : noise.pixels){
+        byte = static_cast<uint8_t>(rng());
+    }
+    CHECK(qoiRoundTrips(noise));
+
+    //small steps(DIFF), medium steps(LUMA), opaque
+    RGBAImage gradient = makeImage(256, 8);
+    for(uint32_t y = 0; y < 8; y++){
+        for(uint32_t x = 0; x < 256; x++){
+            uint8_t* pixel = &gradient.pixels[(y * 256 + x) * 4];
+            pixel[0] = static_cast<uint8_t>(x);
+            pixel[1] = static_cast<uint8_t>(x * (y + 1));
+            pixel[2] = static_cast<uint8_t>(255 - x);
+            pixel[3] = 255;
+        }
+    }
+    CHECK(qoiRoundTrips(gradient));
+
+    //runs longer than 62, one ending on the last pixel, starting on the initial {0, 0, 0, 255}
+    RGBAImage flat = makeImage(100, 3);
+    for(size_t i = 0; i < flat.pixels.size(); i += 4){
+        flat.pixels[i + 3] = 255;
+        if(i / 4 >= 150){
+            flat.pixels[i] = 200;
+        }
+    }
+    CHECK(qoiRoundTrips(flat));
+
+    //a small palette keeps coming back(INDEX), alpha changes(RGBA)
+    const uint8_t palette[5][4] = {{255, 0, 0, 255}, {0, 255, 0, 128}, {0, 0, 255, 0}, {10, 20, 30, 40}, {0, 0, 0, 255}};
+    RGBAImage indexed = makeImage(33, 33);
+    for(size_t i = 0; i < indexed.pixels.size() / 4; i++){
+        std::memcpy(&indexed.pixels[i * 4], palette[(i * 7 + i / 5) % 5], 4);
+    }
+    CHECK(qoiRoundTrips(indexed));
+
+    CHECK(qoiRoundTrips(makeImage(1, 1)));
+}
+
+static void qoiRejectsTruncated(){
+    RGBAImage image = makeImage(16, 16);
+    std::mt19937 rng(3);
+    for(uint8_t& byte : image.pixels){
+        byte = static_cast<uint8_t>(rng());
+    }
+    std::vector<uint8_t> encoded = encodeQOI(image);
+    uint32_t accepted = 0;
+    for(size_t size = 0; size < encoded.size() - 8; size++){
+        try{
+            decodeQOI(std::vector<uint8_t>(encoded.begin(), encoded.begin() + size));
+            accepted++;
+        }
+        catch(const std::runtime_error&){
+        }
+    }
+    CHECK(accepted == 0);
+}
+
+
+static uint32_t bigEndian(const std::vector<uint8_t>& bytes, size_t offset){
+    return (uint32_t(bytes[offset]) << 24) | (uint32_t(bytes[offset + 1]) << 16) | (uint32_t(bytes[offset + 2]) << 8) | bytes[offset + 3];
+}
+//bit by bit, independent from the table the encoder uses
+static uint32_t referenceCrc32(const uint8_t* data, size_t size){
+    uint32_t crc = 0xFFFFFFFF;
+    for(size_t i = 0; i < size; i++){
+        crc ^= data[i];
+        for(int bit = 0; bit < 8; bit++){
+            crc = (crc >> 1) ^ (0xEDB88320 & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+//walks the chunks and the stored deflate blocks by hand, big enough for more than one 64KiB block
+static void pngStructure(){
+    const uint32_t width = 200, height = 100;
+    RGBAImage image = makeImage(width, height);
+    for(size_t i = 0; i < image.pixels.size(); i++){
+        image.pixels[i] = static_cast<uint8_t>(i * 13);
+    }
+    std::vector<uint8_t> png = encodePNG(image);
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    CHECK(png.size() > 8 && std::memcmp(png.data(), signature, 8) == 0);
+
+    std::vector<std::string> types;
+    std::vector<uint8_t> idat;
+    size_t position = 8;
+    while(position + 12 <= png.size()){
+        uint32_t length = bigEndian(png, position);
+        std::string type(png.begin() + position + 4, png.begin() + position + 8);
+        CHECK(position + 12 + length <= png.size());
+        if(position + 12 + length > png.size()){
+            return;
+        }
+        CHECK(bigEndian(png, position + 8 + length) == referenceCrc32(&png[position + 4], length + 4));
+        types.push_back(type);
+        if(type == "IHDR"){
+            CHECK(length == 13);
+            CHECK(bigEndian(png, position + 8) == width);
+            CHECK(bigEndian(png, position + 12) == height);
+            CHECK(png[position + 16] == 8 && png[position + 17] == 6);
+        }
+        if(type == "IDAT"){
+            idat.insert(idat.end(), png.begin() + position + 8, png.begin() + position + 8 + length);
+        }
+        position += 12 + length;
+    }
+    CHECK(position == png.size());
+    CHECK((types == std::vector<std::string>{"IHDR", "IDAT", "IEND"}));
+
+    //zlib header, then stored blocks until BFINAL
+    CHECK(idat.size() > 6);
+    CHECK(((idat[0] << 8) | idat[1]) % 31 == 0 && (idat[0] & 0x0F) == 8);
+    std::vector<uint8_t> inflated;
+    size_t offset = 2;
+    uint32_t blocks = 0;
+    bool final = false;
+    while(!final && offset + 5 <= idat.size()){
+        final = idat[offset] & 1;
+        CHECK((idat[offset] >> 1) == 0); //BTYPE 00, stored
+        uint32_t length = idat[offset + 1] | (idat[offset + 2] << 8);
+        uint32_t inverse = idat[offset + 3] | (idat[offset + 4] << 8);
+        CHECK(length == (~inverse & 0xFFFF));
+        offset += 5;
+        CHECK(offset + length <= idat.size());
+        if(offset + length > idat.size()){
+            return;
+        }
+        inflated.insert(inflated.end(), idat.begin() + offset, idat.begin() + offset + length);
+        offset += length;
+        blocks++;
+    }
+    CHECK(final);
+    CHECK(blocks == 2);
+    CHECK(offset + 4 == idat.size());
+
+    //filter byte 0 and the row, for every row
+    std::vector<uint8_t> expected;
+    for(uint32_t y = 0; y < height; y++){
+        expected.push_back(0);
+        expected.insert(expected.end(), image.pixels.begin() + y * width * 4, image.pixels.begin() + (y + 1) * width * 4);
+    }
+    CHECK(inflated == expected);
+    uint32_t a = 1, b = 0;
+    for(uint8_t byte : expected){
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    CHECK(offset + 4 <= idat.size() && bigEndian(idat, offset) == ((b << 16) | a));
+}
+
+
+int main(){
+    qoiRoundTrip();
+    qoiRejectsTruncated();
+    pngStructure();
+    return checkResult("image_encode_test");
+}
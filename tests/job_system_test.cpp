@@ -0,0 +1,79 @@
+#include <job_system.hpp>
+#include "check.hpp"
+
+#include <thread>
+
+
+static void parallelForCoversEveryItem(JobSystem& jobs){
+    std::vector<std::atomic<uint32_t>> hits(10000);
+    jobs.parallelFor("cover", 0, static_cast<uint32_t>(hits.size()), 16, [&](uint32_t begin, uint32_t end){
+        for(uint32_t i = begin; i < end; i++){
+            hits[i].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    for(const auto& hit : hits){
+        CHECK(hit.load() == 1);
+    }
+}
+
+static void continuationRunsAfterDependency(JobSystem& jobs){
+    JobCounter first, second;
+    std::atomic<uint32_t> finished{0};
+    std::atomic<bool> orderedCorrectly{false};
+    for(int i = 0; i < 8; i++){
+        jobs.run("first", [&](){
+            finished.fetch_add(1);
+        }, &first);
+    }
+    jobs.runAfter(first, "second", [&](){
+        orderedCorrectly.store(finished.load() == 8);
+    }, &second);
+    jobs.wait(second);
+    CHECK(orderedCorrectly.load());
+}
+
+//a long low priority job sits in a background worker's deque while the frame thread waits in parallelFor
+//the frame thread must leave it alone instead of stealing it and stalling the frame
+static void waitSkipsLowPriority(JobSystem& jobs){
+    std::thread::id frameThread = std::this_thread::get_id();
+    std::atomic<bool> stolen{false};
+    std::atomic<bool> lowStarted{false};
+    std::thread::id lowThread;
+    JobCounter lowCounter;
+
+    jobs.parallelFor("frame work", 0, 8, 1, [&](uint32_t, uint32_t){
+        if(std::this_thread::get_id() == frameThread){
+            //hold the frame thread's chunks until a background worker took one
+            while(!stolen.load()){
+                std::this_thread::yield();
+            }
+            return;
+        }
+        if(stolen.exchange(true)){
+            return;
+        }
+        //queued on this worker's own deque, so only the frame thread could steal it while we're busy here
+        jobs.run("long encode", [&](){
+            lowThread = std::this_thread::get_id();
+            lowStarted.store(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }, &lowCounter, JobPriority::Low);
+        //keep the parallelFor open long enough for the frame thread to go looking for work
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+        while(!lowStarted.load() && std::chrono::steady_clock::now() < deadline){
+            std::this_thread::yield();
+        }
+    });
+    jobs.wait(lowCounter);
+    CHECK(lowStarted.load());
+    CHECK(lowThread != frameThread);
+}
+
+
+int main(){
+    JobSystem jobs(2, false);
+    parallelForCoversEveryItem(jobs);
+    continuationRunsAfterDependency(jobs);
+    waitSkipsLowPriority(jobs);
+    return checkResult("job_system_test");
+}
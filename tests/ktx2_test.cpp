@@ -0,0 +1,98 @@
+#include <ktx2.hpp>
+#include "check.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+
+static std::string testPath(){
+    return (std::filesystem::temp_directory_path() / "ktx2_test.ktx2").string();
+}
+
+static std::vector<uint8_t> readFile(const std::string& path){
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes){
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+static bool readThrows(const std::vector<uint8_t>& bytes){
+    writeFile(testPath(), bytes);
+    try{
+        readKtx2(testPath());
+    }
+    catch(const std::runtime_error&){
+        return true;
+    }
+    return false;
+}
+
+static Ktx2Texture testTexture(VkFormat format){
+    std::vector<uint8_t> rgba(16 * 8 * 4);
+    for(size_t i = 0; i < rgba.size(); i++){
+        rgba[i] = static_cast<uint8_t>(i * 7);
+    }
+    Ktx2Texture texture;
+    texture.format = format;
+    for(const TextureMip& mip : generateMips(rgba.data(), 16, 8, false)){
+        texture.mips.push_back({mip.width, mip.height, compressMip(format, mip)});
+    }
+    return texture;
+}
+
+static void roundTrip(VkFormat format, Ktx2Supercompression supercompression){
+    Ktx2Texture texture = testTexture(format);
+    writeKtx2(testPath(), texture, supercompression);
+    Ktx2Texture read = readKtx2(testPath());
+    CHECK(read.format == texture.format);
+    CHECK(read.mips.size() == texture.mips.size());
+    for(size_t level = 0; level < std::min(read.mips.size(), texture.mips.size()); level++){
+        CHECK(read.mips[level].width == texture.mips[level].width);
+        CHECK(read.mips[level].height == texture.mips[level].height);
+        CHECK(read.mips[level].data == texture.mips[level].data);
+    }
+}
+
+//every prefix of a valid file is missing at least the full resolution level, which is stored last
+static void truncatedFilesThrow(Ktx2Supercompression supercompression){
+    writeKtx2(testPath(), testTexture(VK_FORMAT_BC7_UNORM_BLOCK), supercompression);
+    std::vector<uint8_t> file = readFile(testPath());
+    for(size_t size = 0; size < file.size(); size++){
+        CHECK(readThrows(std::vector<uint8_t>(file.begin(), file.begin() + size)));
+    }
+}
+
+static void hostileHeadersThrow(){
+    writeKtx2(testPath(), testTexture(VK_FORMAT_R8G8B8A8_UNORM), Ktx2Supercompression::None);
+    const std::vector<uint8_t> file = readFile(testPath());
+    auto patched = [&](size_t offset, auto value){
+        std::vector<uint8_t> bytes = file;
+        std::memcpy(&bytes[offset], &value, sizeof(value));
+        return bytes;
+    };
+    CHECK(!readThrows(file));
+    CHECK(readThrows(patched(12, uint32_t(0x7FFFFFF0)))); //unknown format
+    CHECK(readThrows(patched(20, uint32_t(0xFFFFFFFF)))); //width
+    CHECK(readThrows(patched(24, KTX2_MAX_EXTENT + 1))); //height
+    CHECK(readThrows(patched(40, uint32_t(40)))); //more levels than the extent has
+    CHECK(readThrows(patched(44, uint32_t(1)))); //BasisLZ
+    //first level index entry: offset, length
+    CHECK(readThrows(patched(80, uint64_t(1) << 62)));
+    CHECK(readThrows(patched(88, uint64_t(1) << 62)));
+}
+
+
+int main(){
+    roundTrip(VK_FORMAT_R8G8B8A8_UNORM, Ktx2Supercompression::None);
+    roundTrip(VK_FORMAT_BC7_UNORM_BLOCK, Ktx2Supercompression::None);
+    truncatedFilesThrow(Ktx2Supercompression::None);
+    hostileHeadersThrow();
+    if(ktx2ZstdSupported()){
+        roundTrip(VK_FORMAT_BC1_RGB_UNORM_BLOCK, Ktx2Supercompression::Zstd);
+        truncatedFilesThrow(Ktx2Supercompression::Zstd);
+    }
+    std::filesystem::remove(testPath());
+    return checkResult("ktx2_test");
+}
@@ -0,0 +1,216 @@
+#include <object_cache.hpp>
+#include "check.hpp"
+
+#include <memory>
+
+
+template<typename Function>
+static bool throws(Function function){
+    try{
+        function();
+    }
+    catch(const std::runtime_error&){
+        return true;
+    }
+    return false;
+}
+
+static VkSamplerCreateInfo samplerInfo(const void* pNext = nullptr){
+    VkSamplerCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    info.pNext = pNext;
+    info.magFilter = VK_FILTER_LINEAR;
+    info.minFilter = VK_FILTER_LINEAR;
+    info.maxLod = 8.0f;
+    return info;
+}
+
+static void samplerKeys(){
+    CHECK(createInfoKey(samplerInfo()) == createInfoKey(samplerInfo()));
+    VkSamplerCreateInfo other = samplerInfo();
+    other.maxLod = 9.0f;
+    CHECK(createInfoKey(samplerInfo()) != createInfoKey(other));
+    other = samplerInfo();
+    other.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    CHECK(createInfoKey(samplerInfo()) != createInfoKey(other));
+
+    //same chain contents in two different structs key the same, the pointers don't matter
+    VkSamplerReductionModeCreateInfo minA{VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO, nullptr, VK_SAMPLER_REDUCTION_MODE_MIN};
+    VkSamplerReductionModeCreateInfo minB = minA;
+    VkSamplerReductionModeCreateInfo max = minA;
+    max.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+    CHECK(createInfoKey(samplerInfo(&minA)) == createInfoKey(samplerInfo(&minB)));
+    CHECK(createInfoKey(samplerInfo(&minA)) != createInfoKey(samplerInfo(&max)));
+    CHECK(createInfoKey(samplerInfo(&minA)) != createInfoKey(samplerInfo()));
+
+    //nothing to key an unknown struct on but its pointer, that would hand out stale samplers
+    VkSamplerYcbcrConversionInfo unknown{VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO, nullptr, VK_NULL_HANDLE};
+    CHECK(throws([&](){ createInfoKey(samplerInfo(&unknown)); }));
+    minB.pNext = &unknown;
+    CHECK(throws([&](){ createInfoKey(samplerInfo(&minB)); }));
+}
+
+static void descriptorSetLayoutKeys(){
+    auto bindings = [](uint32_t count){
+        return std::vector<VkDescriptorSetLayoutBinding>{
+            {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, count, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+        };
+    };
+    std::vector<VkDescriptorSetLayoutBinding> a = bindings(4), b = bindings(4), c = bindings(8);
+    VkDescriptorSetLayoutCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    info.bindingCount = 2;
+    info.pBindings = a.data();
+    CreateInfoKey keyA = createInfoKey(info);
+    info.pBindings = b.data();
+    CHECK(createInfoKey(info) == keyA);
+    info.pBindings = c.data();
+    CHECK(createInfoKey(info) != keyA);
+
+    VkDescriptorBindingFlags flags[2] = {0, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlags{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO, nullptr, 2, flags};
+    info.pBindings = a.data();
+    info.pNext = &bindingFlags;
+    CreateInfoKey partiallyBound = createInfoKey(info);
+    CHECK(partiallyBound != keyA);
+    flags[1] = 0;
+    CHECK(createInfoKey(info) != partiallyBound);
+}
+
+//everything a graphics pipeline create info points to, so two copies live at different addresses
+struct GraphicsPipelineState{
+    std::string entry = "main";
+    uint32_t specializationData = 1;
+    VkSpecializationMapEntry specializationEntry{0, 0, sizeof(uint32_t)};
+    VkSpecializationInfo specialization{};
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    VkVertexInputBindingDescription binding{0, 32, VK_VERTEX_INPUT_RATE_VERTEX};
+    VkVertexInputAttributeDescription attribute{0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0};
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    VkPipelineViewportStateCreateInfo viewport{};
+    VkPipelineRasterizationStateCreateInfo rasterization{};
+    VkPipelineMultisampleStateCreateInfo multisample{};
+    VkPipelineColorBlendAttachmentState blendAttachment{};
+    VkPipelineColorBlendStateCreateInfo colorBlend{};
+    VkDynamicState dynamicStates[2] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamic{};
+    VkFormat colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    VkPipelineRenderingCreateInfo rendering{};
+    VkGraphicsPipelineCreateInfo info{};
+
+    GraphicsPipelineState(){
+        specialization = {1, &specializationEntry, sizeof(specializationData), &specializationData};
+        for(uint32_t i = 0; i < 2; i++){
+            stages[i].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stages[i].stage = (i == 0) ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+            stages[i].module = reinterpret_cast<VkShaderModule>(uintptr_t(0x100 + i));
+            stages[i].pName = entry.c_str();
+        }
+        stages[1].pSpecializationInfo = &specialization;
+        vertexInput = {VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO, nullptr, 0, 1, &binding, 1, &attribute};
+        inputAssembly = {VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO, nullptr, 0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE};
+        viewport = {VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO, nullptr, 0, 1, nullptr, 1, nullptr};
+        rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterization.lineWidth = 1.0f;
+        multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        blendAttachment.colorWriteMask = 0xF;
+        colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlend.attachmentCount = 1;
+        colorBlend.pAttachments = &blendAttachment;
+        dynamic = {VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO, nullptr, 0, 2, dynamicStates};
+        rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        rendering.colorAttachmentCount = 1;
+        rendering.pColorAttachmentFormats = &colorFormat;
+
+        info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        info.pNext = &rendering;
+        info.stageCount = 2;
+        info.pStages = stages;
+        info.pVertexInputState = &vertexInput;
+        info.pInputAssemblyState = &inputAssembly;
+        info.pViewportState = &viewport;
+        info.pRasterizationState = &rasterization;
+        info.pMultisampleState = &multisample;
+        info.pColorBlendState = &colorBlend;
+        info.pDynamicState = &dynamic;
+        info.layout = reinterpret_cast<VkPipelineLayout>(uintptr_t(0x200));
+    }
+    GraphicsPipelineState(const GraphicsPipelineState&) = delete;
+};
+
+static void graphicsPipelineKeys(){
+    auto a = std::make_unique<GraphicsPipelineState>();
+    auto b = std::make_unique<GraphicsPipelineState>();
+    CreateInfoKey key = createInfoKey(a->info);
+    CHECK(createInfoKey(b->info) == key);
+
+    //one nested field at a time, each has to change the key
+    b->blendAttachment.colorWriteMask = 0x7;
+    CHECK(createInfoKey(b->info) != key);
+    b->blendAttachment.colorWriteMask = 0xF;
+    b->rasterization.cullMode = VK_CULL_MODE_NONE;
+    CHECK(createInfoKey(b->info) != key);
+    b->rasterization.cullMode = VK_CULL_MODE_BACK_BIT;
+    b->attribute.offset = 12;
+    CHECK(createInfoKey(b->info) != key);
+    b->attribute.offset = 0;
+    b->specializationData = 2;
+    CHECK(createInfoKey(b->info) != key);
+    b->specializationData = 1;
+    b->colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    CHECK(createInfoKey(b->info) != key);
+    b->colorFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    b->entry = "main2";
+    b->stages[0].pName = b->entry.c_str();
+    b->stages[1].pName = b->entry.c_str();
+    CHECK(createInfoKey(b->info) != key);
+    b->entry = "main";
+    b->stages[0].pName = b->entry.c_str();
+    b->stages[1].pName = b->entry.c_str();
+    CHECK(createInfoKey(b->info) == key);
+
+    //a missing block isn't the same as a default one
+    b->info.pDynamicState = nullptr;
+    CHECK(createInfoKey(b->info) != key);
+    b->info.pDynamicState = &b->dynamic;
+
+    VkPipelineRasterizationStateRasterizationOrderAMD unknown{VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_RASTERIZATION_ORDER_AMD, nullptr, VK_RASTERIZATION_ORDER_RELAXED_AMD};
+    b->rasterization.pNext = &unknown;
+    CHECK(throws([&](){ createInfoKey(b->info); }));
+}
+
+static void computePipelineKeys(){
+    uint32_t data[2] = {8, 8};
+    VkSpecializationMapEntry entries[2] = {{0, 0, 4}, {1, 4, 4}};
+    VkSpecializationInfo specialization{2, entries, sizeof(data), data};
+    VkComputePipelineCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    info.stage.module = reinterpret_cast<VkShaderModule>(uintptr_t(0x300));
+    info.stage.pName = "main";
+    info.stage.pSpecializationInfo = &specialization;
+    CreateInfoKey key = createInfoKey(info);
+    //same bytes, swapped ids
+    entries[0].constantID = 1;
+    entries[1].constantID = 0;
+    CHECK(createInfoKey(info) != key);
+    entries[0].constantID = 0;
+    entries[1].constantID = 1;
+    CHECK(createInfoKey(info) == key);
+    info.stage.pSpecializationInfo = nullptr;
+    CHECK(createInfoKey(info) != key);
+}
+
+
+int main(){
+    samplerKeys();
+    descriptorSetLayoutKeys();
+    graphicsPipelineKeys();
+    computePipelineKeys();
+    return checkResult("object_cache_test");
+}
@@ -0,0 +1,208 @@
+#include <render_graph.hpp>
+#include "check.hpp"
+
+
+//compile() without a device sizes transients from their descriptions(64 KiB aligned) and allocates nothing,
+//everything below only looks at what it planned
+struct RenderGraphTest{
+    static const std::vector<VkImageMemoryBarrier2>& imageBarriers(const RenderGraph& graph, uint32_t pass){
+        return graph.passBarriers[pass].imageBarriers;
+    }
+    static const VkMemoryBarrier2* memoryBarrier(const RenderGraph& graph, uint32_t pass){
+        return graph.passBarriers[pass].hasMemoryBarrier ? &graph.passBarriers[pass].memoryBarrier : nullptr;
+    }
+    static const std::vector<VkImageMemoryBarrier2>& finalImageBarriers(const RenderGraph& graph){
+        return graph.finalBarriers.imageBarriers;
+    }
+    static VkDeviceSize memoryOffset(const RenderGraph& graph, RenderGraphResource resource){
+        return graph.resources[resource].memoryOffset;
+    }
+    static size_t submissionCount(const RenderGraph& graph){
+        return graph.submissions.size();
+    }
+    static uint32_t submissionQueue(const RenderGraph& graph, size_t submission){
+        return graph.submissions[submission].queue;
+    }
+    static uint32_t waitOrdinal(const RenderGraph& graph, size_t submission, uint32_t queue){
+        return graph.submissions[submission].waitOrdinal[queue];
+    }
+    static constexpr uint32_t GRAPHICS_QUEUE = RenderGraph::GRAPHICS_QUEUE;
+    static constexpr uint32_t COMPUTE_QUEUE = RenderGraph::COMPUTE_QUEUE;
+};
+
+static const auto NOTHING = [](VkCommandBuffer, const RenderGraph&){};
+
+static RenderGraphImageDesc colorDesc(uint32_t size){
+    RenderGraphImageDesc desc;
+    desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+    desc.extent = {size, size, 1};
+    return desc;
+}
+
+//gbuffer pass -> lighting pass -> present, with one pass nobody needs
+static void barriersAndCulling(){
+    RenderGraph graph;
+    RenderGraphResource swapchain = graph.importImage("swapchain", VK_NULL_HANDLE, VK_NULL_HANDLE, colorDesc(256), {}, ResourceUsage::Present);
+    RenderGraphResource gbuffer = graph.createImage("gbuffer", colorDesc(256));
+    RenderGraphResource unused = graph.createImage("unused", colorDesc(256));
+    graph.addPass("gbuffer", NOTHING).write(gbuffer, ResourceUsage::ColorAttachment);
+    graph.addPass("debug view", NOTHING).write(unused, ResourceUsage::ColorAttachment);
+    graph.addPass("lighting", NOTHING).read(gbuffer, ResourceUsage::SampledFragment).write(swapchain, ResourceUsage::ColorAttachment);
+    graph.compile();
+
+    const RenderGraphStats& stats = graph.stats();
+    CHECK(stats.passes == 3);
+    CHECK(stats.culledPasses == 1);
+    CHECK(RenderGraphTest::imageBarriers(graph, 1).empty());
+    CHECK(stats.barrierBatches == 3);
+    CHECK(stats.imageBarriers == 4);
+    CHECK(stats.memoryBarriers == 0);
+
+    //first use of the gbuffer, waits for the previous frame's lighting pass(WAR on the same memory)
+    const auto& first = RenderGraphTest::imageBarriers(graph, 0);
+    CHECK(first.size() == 1);
+    if(first.size() == 1){
+        CHECK(first[0].oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        CHECK(first[0].newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(first[0].srcStageMask & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        CHECK(first[0].dstStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+
+    //gbuffer written -> sampled(RAW), swapchain undefined -> color attachment
+    const auto& lighting = RenderGraphTest::imageBarriers(graph, 2);
+    CHECK(lighting.size() == 2);
+    if(lighting.size() == 2){
+        CHECK(lighting[0].srcStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+        CHECK(lighting[0].srcAccessMask == (VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT));
+        CHECK(lighting[0].dstStageMask == VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        CHECK(lighting[0].newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        CHECK(lighting[1].oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        CHECK(lighting[1].newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    }
+
+    const auto& final = RenderGraphTest::finalImageBarriers(graph);
+    CHECK(final.size() == 1);
+    if(final.size() == 1){
+        CHECK(final[0].oldLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+        CHECK(final[0].newLayout == VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        CHECK(final[0].srcStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+}
+
+//a -> b -> c -> swapchain, a and c are never alive at the same time and share memory
+static void aliasing(){
+    RenderGraph graph;
+    RenderGraphResource swapchain = graph.importImage("swapchain", VK_NULL_HANDLE, VK_NULL_HANDLE, colorDesc(256), {}, ResourceUsage::Present);
+    RenderGraphResource a = graph.createImage("a", colorDesc(256));
+    RenderGraphResource b = graph.createImage("b", colorDesc(256));
+    RenderGraphResource c = graph.createImage("c", colorDesc(256));
+    graph.addPass("write a", NOTHING).write(a, ResourceUsage::ColorAttachment);
+    graph.addPass("a to b", NOTHING).read(a, ResourceUsage::SampledFragment).write(b, ResourceUsage::ColorAttachment);
+    graph.addPass("b to c", NOTHING).read(b, ResourceUsage::SampledCompute).write(c, ResourceUsage::StorageWriteCompute);
+    graph.addPass("c to swapchain", NOTHING).read(c, ResourceUsage::SampledFragment).write(swapchain, ResourceUsage::ColorAttachment);
+    graph.compile();
+
+    const VkDeviceSize imageBytes = 256 * 256 * 4;
+    const RenderGraphStats& stats = graph.stats();
+    CHECK(stats.transientBytes == 3 * imageBytes);
+    CHECK(stats.allocatedBytes == 2 * imageBytes);
+    CHECK(RenderGraphTest::memoryOffset(graph, a) == RenderGraphTest::memoryOffset(graph, c));
+    CHECK(RenderGraphTest::memoryOffset(graph, b) != RenderGraphTest::memoryOffset(graph, a));
+
+    //c takes over a's memory, its first barrier waits for a's last reader
+    const auto& takeOver = RenderGraphTest::imageBarriers(graph, 2);
+    CHECK(takeOver.size() == 2);
+    if(takeOver.size() == 2){
+        CHECK(takeOver[1].oldLayout == VK_IMAGE_LAYOUT_UNDEFINED);
+        CHECK(takeOver[1].srcStageMask & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+    }
+    //next frame a gets the memory back, after c's storage writes and reads of this frame
+    const auto& wrapAround = RenderGraphTest::imageBarriers(graph, 0);
+    CHECK(wrapAround.size() == 1);
+    if(wrapAround.size() == 1){
+        CHECK(wrapAround[0].srcStageMask & VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        CHECK(wrapAround[0].srcStageMask & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        CHECK(wrapAround[0].srcAccessMask & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+    }
+}
+
+//a buffer written by compute and read as indirect arguments, rewritten every frame
+static void crossFrameBuffer(){
+    RenderGraph graph;
+    RenderGraphResource indirect = graph.createBuffer("indirect", {4096});
+    graph.addPass("cull", NOTHING).write(indirect, ResourceUsage::StorageWriteCompute);
+    graph.addPass("draw", NOTHING).read(indirect, ResourceUsage::IndirectBuffer).sideEffects();
+    graph.compile();
+
+    //the write has to wait for last frame's indirect reads and writes
+    const VkMemoryBarrier2* first = RenderGraphTest::memoryBarrier(graph, 0);
+    CHECK(first != nullptr);
+    if(first != nullptr){
+        CHECK(first->srcStageMask == (VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT));
+        CHECK(first->srcAccessMask == (VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT));
+        CHECK(first->dstStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    }
+    const VkMemoryBarrier2* read = RenderGraphTest::memoryBarrier(graph, 1);
+    CHECK(read != nullptr);
+    if(read != nullptr){
+        CHECK(read->srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+        CHECK(read->dstStageMask == VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+    }
+}
+
+//culling on the async queue next to a shadow pass, the draw waits for it with a semaphore instead of a barrier
+static void asyncCompute(){
+    RenderGraph graph;
+    RenderGraphQueues queues;
+    queues.graphics = reinterpret_cast<VkQueue>(1);
+    queues.compute = reinterpret_cast<VkQueue>(2);
+    queues.computeFamily = 1;
+    graph.setQueues(queues);
+    CHECK(graph.hasAsyncCompute());
+
+    RenderGraphResource swapchain = graph.importImage("swapchain", VK_NULL_HANDLE, VK_NULL_HANDLE, colorDesc(256), {}, ResourceUsage::Present);
+    RenderGraphResource shadow = graph.createImage("shadow", colorDesc(256));
+    RenderGraphResource indirect = graph.createBuffer("indirect", {4096});
+    graph.addPass("shadow", NOTHING).write(shadow, ResourceUsage::ColorAttachment);
+    graph.addPass("cull", NOTHING).write(indirect, ResourceUsage::StorageWriteCompute).asyncCompute();
+    graph.addPass("draw", NOTHING).read(indirect, ResourceUsage::IndirectBuffer).read(shadow, ResourceUsage::SampledFragment).write(swapchain, ResourceUsage::ColorAttachment);
+    graph.compile();
+
+    //empty graphics submission for the frame's waits, shadow, cull, draw
+    CHECK(RenderGraphTest::submissionCount(graph) == 4);
+    if(RenderGraphTest::submissionCount(graph) == 4){
+        CHECK(RenderGraphTest::submissionQueue(graph, 2) == RenderGraphTest::COMPUTE_QUEUE);
+        CHECK(RenderGraphTest::waitOrdinal(graph, 2, RenderGraphTest::GRAPHICS_QUEUE) == 0);
+        CHECK(RenderGraphTest::submissionQueue(graph, 3) == RenderGraphTest::GRAPHICS_QUEUE);
+        CHECK(RenderGraphTest::waitOrdinal(graph, 3, RenderGraphTest::COMPUTE_QUEUE) == 1);
+    }
+    CHECK(graph.stats().asyncSubmissions == 1);
+    CHECK(graph.stats().queueWaits == 1);
+    //the semaphore covers the indirect buffer, no barrier left on the graphics side
+    CHECK(RenderGraphTest::memoryBarrier(graph, 2) == nullptr);
+    //different queues never share memory
+    CHECK(graph.stats().allocatedBytes == graph.stats().transientBytes);
+}
+
+//the builder returned by addPass() survives many more addPass() calls
+static void passReferencesStayValid(){
+    RenderGraph graph;
+    RenderGraphPass& first = graph.addPass("first", NOTHING);
+    for(int i = 0; i < 1000; i++){
+        graph.addPass("filler", NOTHING);
+    }
+    //only the first pass has a reason to run
+    first.sideEffects();
+    graph.compile();
+    CHECK(graph.stats().culledPasses == 1000);
+}
+
+
+int main(){
+    barriersAndCulling();
+    aliasing();
+    crossFrameBuffer();
+    asyncCompute();
+    passReferencesStayValid();
+    return checkResult("render_graph_test");
+}
@@ -0,0 +1,131 @@
+#include <resource_state.hpp>
+#include "check.hpp"
+
+
+static const ResourceAccess TRANSFER_WRITE{VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+static const ResourceAccess FRAGMENT_READ{VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+static const ResourceAccess COMPUTE_READ{VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+static const ResourceAccess COMPUTE_WRITE{VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, true};
+
+template<typename Function>
+static bool throws(Function function){
+    try{
+        function();
+    }
+    catch(const std::runtime_error&){
+        return true;
+    }
+    return false;
+}
+
+
+static void overlappingImageRanges(){
+    ImageStateTracker tracker(VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM, 4, 2);
+    std::vector<VkImageMemoryBarrier2> barriers;
+    tracker.transition(TRANSFER_WRITE, barriers);
+    CHECK(barriers.size() == 1);
+    CHECK(tracker.runCount() == 1);
+
+    //mips 0-1 sampled, then mips 1-3 written again: mip 1 comes from the read layout, 2-3 from the copy
+    barriers.clear();
+    tracker.transition({VK_IMAGE_ASPECT_COLOR_BIT, 0, 2, 0, VK_REMAINING_ARRAY_LAYERS}, FRAGMENT_READ, barriers);
+    CHECK(barriers.size() == 1);
+    barriers.clear();
+    tracker.transition({VK_IMAGE_ASPECT_COLOR_BIT, 1, VK_REMAINING_MIP_LEVELS, 0, 2}, TRANSFER_WRITE, barriers);
+    CHECK(barriers.size() == 2);
+    for(const VkImageMemoryBarrier2& barrier : barriers){
+        CHECK(barrier.newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        CHECK(barrier.subresourceRange.baseArrayLayer == 0 && barrier.subresourceRange.layerCount == 2);
+        if(barrier.subresourceRange.baseMipLevel == 1){
+            CHECK(barrier.subresourceRange.levelCount == 1);
+            CHECK(barrier.oldLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            //the copy was already waited on by the transition to the read layout
+            CHECK(barrier.srcStageMask == VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+        }
+        else{
+            CHECK(barrier.subresourceRange.baseMipLevel == 2 && barrier.subresourceRange.levelCount == 2);
+            CHECK(barrier.oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            CHECK(barrier.srcStageMask == VK_PIPELINE_STAGE_2_COPY_BIT);
+        }
+    }
+    CHECK(tracker.state(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1).layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    CHECK(tracker.state(VK_IMAGE_ASPECT_COLOR_BIT, 3, 1).layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    //mip 0 on its own, mips 1-3 together, per layer
+    CHECK(tracker.runCount() == 4);
+}
+
+static void readAfterReadIsFree(){
+    ImageStateTracker image(VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM, 1, 1);
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    image.transition(TRANSFER_WRITE, imageBarriers);
+    image.transition(FRAGMENT_READ, imageBarriers);
+    CHECK(imageBarriers.size() == 2);
+    image.transition(FRAGMENT_READ, imageBarriers);
+    CHECK(imageBarriers.size() == 2);
+
+    BufferStateTracker buffer(VK_NULL_HANDLE, 256);
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    //never written, readers on different stages don't wait on each other
+    buffer.transition(0, VK_WHOLE_SIZE, FRAGMENT_READ, bufferBarriers);
+    buffer.transition(0, 128, COMPUTE_READ, bufferBarriers);
+    CHECK(bufferBarriers.empty());
+    //the write waits on both readers of [0, 128) and only the fragment one of the rest
+    buffer.transition(0, VK_WHOLE_SIZE, COMPUTE_WRITE, bufferBarriers);
+    CHECK(bufferBarriers.size() == 2);
+    //written, the first reader waits and the same reader again doesn't
+    buffer.transition(0, VK_WHOLE_SIZE, COMPUTE_READ, bufferBarriers);
+    CHECK(bufferBarriers.size() == 3);
+    buffer.transition(64, 64, COMPUTE_READ, bufferBarriers);
+    CHECK(bufferBarriers.size() == 3);
+}
+
+static void overlappingBufferRanges(){
+    BufferStateTracker buffer(VK_NULL_HANDLE, 256);
+    std::vector<VkBufferMemoryBarrier2> barriers;
+    buffer.transition(0, 64, COMPUTE_WRITE, barriers);
+    buffer.transition(64, 64, COMPUTE_WRITE, barriers);
+    CHECK(barriers.empty());
+    //only the written part [32, 128) needs the barrier, as one merged range
+    buffer.transition(32, VK_WHOLE_SIZE, FRAGMENT_READ, barriers);
+    CHECK(barriers.size() == 1);
+    if(barriers.size() == 1){
+        CHECK(barriers[0].offset == 32);
+        CHECK(barriers[0].size == 96);
+        CHECK(barriers[0].srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    }
+    CHECK(buffer.state(0).writeStage == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+    CHECK(buffer.state(200).readStages == VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+}
+
+static void rangesOutOfBoundsThrow(){
+    ImageStateTracker image(VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM, 4, 2);
+    std::vector<VkImageMemoryBarrier2> imageBarriers;
+    //base past the end with REMAINING used to wrap the count around and pass the check
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 5, VK_REMAINING_MIP_LEVELS, 0, 1}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 3, VK_REMAINING_ARRAY_LAYERS}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 1, 0xFFFFFFF0u, 0, 1}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 0, 5, 0, 1}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 4, VK_REMAINING_MIP_LEVELS, 0, 1}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 0, 1}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(!throws([&](){ image.transition({VK_IMAGE_ASPECT_COLOR_BIT, 3, VK_REMAINING_MIP_LEVELS, 1, VK_REMAINING_ARRAY_LAYERS}, FRAGMENT_READ, imageBarriers); }));
+    CHECK(imageBarriers.size() == 1);
+
+    BufferStateTracker buffer(VK_NULL_HANDLE, 256);
+    std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    CHECK(throws([&](){ buffer.transition(300, VK_WHOLE_SIZE, COMPUTE_READ, bufferBarriers); }));
+    CHECK(throws([&](){ buffer.transition(16, ~VkDeviceSize(0) - 8, COMPUTE_READ, bufferBarriers); }));
+    CHECK(throws([&](){ buffer.transition(0, 257, COMPUTE_READ, bufferBarriers); }));
+    CHECK(throws([&](){ buffer.transition(256, VK_WHOLE_SIZE, COMPUTE_READ, bufferBarriers); }));
+    CHECK(throws([&](){ buffer.transition(0, 0, COMPUTE_READ, bufferBarriers); }));
+    CHECK(!throws([&](){ buffer.transition(255, VK_WHOLE_SIZE, COMPUTE_READ, bufferBarriers); }));
+    CHECK(bufferBarriers.empty());
+}
+
+
+int main(){
+    overlappingImageRanges();
+    readAfterReadIsFree();
+    overlappingBufferRanges();
+    rangesOutOfBoundsThrow();
+    return checkResult("resource_state_test");
+}
@@ -0,0 +1,69 @@
+#include <scene_graph.hpp>
+#include "check.hpp"
+
+
+static bool sameMatrices(const std::vector<glm::mat4>& buffer, const SceneGraph& scene){
+    for(uint32_t i = 0; i < scene.size(); i++){
+        if(buffer[i] != scene.worldMatrices()[i]){
+            return false;
+        }
+    }
+    return true;
+}
+
+//two frames in flight, each with its own instance buffer, only the current one is written per frame
+//a node that changed while the other buffer wasn't current still has to reach it
+static void everyFrameInFlightCatchesUp(){
+    SceneGraph scene;
+    SceneGraph::NodeHandle root = scene.createNode();
+    std::vector<SceneGraph::NodeHandle> children;
+    for(int i = 0; i < 16; i++){
+        children.push_back(scene.createNode(root, glm::vec3(static_cast<float>(i), 0.0f, 0.0f)));
+    }
+    std::vector<glm::mat4> buffers[2] = {std::vector<glm::mat4>(scene.size()), std::vector<glm::mat4>(scene.size())};
+
+    for(uint32_t frame = 0; frame < 6; frame++){
+        //a different node moves every frame
+        scene.setPosition(children[frame * 3 % children.size()], glm::vec3(0.0f, static_cast<float>(frame), 1.0f));
+        scene.update();
+        uint32_t slot = frame % 2;
+        scene.writeInstances(buffers[slot].data(), slot);
+        CHECK(sameMatrices(buffers[slot], scene));
+    }
+    //nothing changed, both buffers only have to stay as they are
+    scene.update();
+    scene.writeInstances(buffers[0].data(), 0);
+    scene.writeInstances(buffers[1].data(), 1);
+    CHECK(sameMatrices(buffers[0], scene));
+    CHECK(sameMatrices(buffers[1], scene));
+}
+
+static void unknownNodesThrow(){
+    SceneGraph scene;
+    SceneGraph::NodeHandle node = scene.createNode();
+    scene.update();
+    CHECK(scene.instanceIndex(node) == 0);
+    bool threw = false;
+    try{
+        scene.worldMatrix(node + 1);
+    }
+    catch(const std::runtime_error&){
+        threw = true;
+    }
+    CHECK(threw);
+    threw = false;
+    try{
+        scene.instanceIndex(SceneGraph::INVALID_NODE);
+    }
+    catch(const std::runtime_error&){
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+
+int main(){
+    everyFrameInFlightCatchesUp();
+    unknownNodesThrow();
+    return checkResult("scene_graph_test");
+}
@@ -0,0 +1,77 @@
+#include <shader_variant.hpp>
+#include <object_cache.hpp>
+#include "check.hpp"
+
+#include <fstream>
+#include <regex>
+#include <set>
+
+
+//one uint32 slot per feature, in declaration order
+static_assert(MeshShaderVariant::MAP_ENTRIES[0].constantID == ShadingModelFeature::constantId);
+static_assert(MeshShaderVariant::MAP_ENTRIES[1].constantID == UVTintFeature::constantId);
+static_assert(MeshShaderVariant::MAP_ENTRIES[1].offset == sizeof(uint32_t));
+static_assert(MeshShaderVariant().set<ShadingModelFeature>(2).set<UVTintFeature>(1).get<ShadingModelFeature>() == 2);
+static_assert(MeshShaderVariant().set<ShadingModelFeature>(7).get<ShadingModelFeature>() == 3, "values are masked to the field width");
+
+//the constant_ids shader.frag declares, read from the source so renumbering one side shows up here
+static void idsMatchShader(){
+    std::ifstream file("src/shaders/shader.frag");
+    CHECK(file.is_open());
+    std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::regex declaration(R"(layout\s*\(\s*constant_id\s*=\s*(\d+)\s*\)\s*const\s+(int|uint|bool)\s+(\w+))");
+    std::set<uint32_t> shaderIds;
+    for(auto it = std::sregex_iterator(source.begin(), source.end(), declaration); it != std::sregex_iterator(); ++it){
+        shaderIds.insert(static_cast<uint32_t>(std::stoul((*it)[1])));
+    }
+    std::set<uint32_t> keyIds;
+    for(const VkSpecializationMapEntry& entry : MeshShaderVariant::MAP_ENTRIES){
+        keyIds.insert(entry.constantID);
+        //int, uint and bool constants are all 32 bit in SPIR-V
+        CHECK(entry.size == sizeof(uint32_t));
+    }
+    CHECK(!shaderIds.empty());
+    CHECK(shaderIds == keyIds);
+}
+
+//what ShaderVariantPipelines::get() hands to the compiler, for every key the features can spell
+static void everyVariantHasItsOwnCacheKey(){
+    std::set<CreateInfoKey> keys;
+    uint32_t variants = 0;
+    for(uint32_t shading = 0; shading < (1u << ShadingModelFeature::bits); shading++){
+        for(uint32_t tint = 0; tint < 2; tint++){
+            MeshShaderVariant variant;
+            variant.set<ShadingModelFeature>(shading).set<UVTintFeature>(tint);
+            std::array<uint32_t, MeshShaderVariant::FEATURE_COUNT> data = variant.constants();
+            VkSpecializationInfo specialization = MeshShaderVariant::specializationInfo(data);
+
+            VkPipelineShaderStageCreateInfo stage{};
+            stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            stage.module = reinterpret_cast<VkShaderModule>(uintptr_t(0x100));
+            stage.pName = "main";
+            stage.pSpecializationInfo = &specialization;
+            VkGraphicsPipelineCreateInfo info{};
+            info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+            info.stageCount = 1;
+            info.pStages = &stage;
+            CreateInfoKey key = createInfoKey(info);
+            keys.insert(key);
+            variants++;
+
+            //the same variant again, from fresh data, finds the same entry
+            std::array<uint32_t, MeshShaderVariant::FEATURE_COUNT> again = MeshShaderVariant::fromBits(variant.bits()).constants();
+            VkSpecializationInfo againInfo = MeshShaderVariant::specializationInfo(again);
+            stage.pSpecializationInfo = &againInfo;
+            CHECK(createInfoKey(info) == key);
+        }
+    }
+    CHECK(keys.size() == variants);
+}
+
+
+int main(){
+    idsMatchShader();
+    everyVariantHasItsOwnCacheKey();
+    return checkResult("shader_variant_test");
+}
@@ -0,0 +1,55 @@
+#include <streaming_copy.hpp>
+#include "check.hpp"
+
+
+//every dst misalignment within a cache line, a few src ones, sizes around the memcpy cutoff and the 64/128 byte loop steps
+//bytes around the destination must stay untouched
+static void matchesMemcpy(CopyKernel kernel){
+    const size_t guard = 64;
+    std::vector<size_t> sizes;
+    for(size_t base : {256u, 320u, 384u, 448u, 512u, 4096u}){
+        for(size_t size : {base - 1, base, base + 1, base + 63, base + 64, base + 65, base + 127, base + 128}){
+            sizes.push_back(size);
+        }
+    }
+    std::vector<uint8_t> source(4096 + 256 + 64);
+    for(size_t i = 0; i < source.size(); i++){
+        source[i] = static_cast<uint8_t>(i * 131 + 7);
+    }
+    //64 byte aligned storage so misalignment 0 really is line aligned
+    std::vector<uint8_t> storage(guard + 64 + source.size() + guard + 64);
+    uint8_t* aligned = reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(storage.data()) + guard + 63) & ~uintptr_t(63));
+
+    uint32_t failures = 0;
+    for(size_t size : sizes){
+        for(size_t dstOffset = 0; dstOffset < 64; dstOffset++){
+            for(size_t srcOffset : {0u, 1u, 17u, 32u}){
+                std::fill(storage.begin(), storage.end(), 0xCD);
+                std::vector<uint8_t> expected = storage;
+                uint8_t* dst = aligned + dstOffset;
+                std::memcpy(expected.data() + (dst - storage.data()), source.data() + srcOffset, size);
+                streamingCopy(dst, source.data() + srcOffset, size, kernel);
+                if(storage != expected){
+                    if(failures++ < 8){
+                        std::cerr << "\t" << copyKernelName(kernel) << " differs from memcpy: size " << size << ", dst offset " << dstOffset << ", src offset " << srcOffset << "\n";
+                    }
+                }
+            }
+        }
+    }
+    CHECK(failures == 0);
+}
+
+
+int main(){
+    CopyKernel best = selectCopyKernel();
+    std::cout << "\tbest kernel here: " << copyKernelName(best) << "\n";
+    matchesMemcpy(CopyKernel::Memcpy);
+    if(best == CopyKernel::SSE2 || best == CopyKernel::AVX2){
+        matchesMemcpy(CopyKernel::SSE2);
+    }
+    if(best == CopyKernel::AVX2){
+        matchesMemcpy(CopyKernel::AVX2);
+    }
+    return checkResult("streaming_copy_test");
+}
@@ -0,0 +1,118 @@
+#include <texture_compress.hpp>
+#include "check.hpp"
+
+#include <cmath>
+#include <random>
+
+
+struct RoundTripError{
+    uint32_t max = 0;
+    double rms = 0.0;
+};
+
+//compress and decompress rgba, error over the first `channels` channels of every texel
+static RoundTripError roundTrip(VkFormat format, const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, uint32_t channels){
+    TextureMip mip{width, height, rgba};
+    TextureMip compressed{width, height, compressMip(format, mip)};
+    std::vector<uint8_t> decoded = decompressMip(format, compressed);
+    RoundTripError error;
+    CHECK(decoded.size() == rgba.size());
+    if(decoded.size() != rgba.size()){
+        return error;
+    }
+    double sum = 0.0;
+    for(size_t i = 0; i < rgba.size(); i += 4){
+        for(uint32_t c = 0; c < channels; c++){
+            uint32_t d = std::abs(static_cast<int32_t>(decoded[i + c]) - rgba[i + c]);
+            error.max = std::max(error.max, d);
+            sum += d * d;
+        }
+    }
+    error.rms = std::sqrt(sum / (rgba.size() / 4 * channels));
+    return error;
+}
+
+//the principal axis of a red/green checker is (1,-1,0), orthogonal to an all ones power iteration seed
+static void checkerKeepsBothColors(){
+    std::vector<uint8_t> rgba(4 * 4 * 4);
+    for(uint32_t i = 0; i < 16; i++){
+        bool red = ((i % 4) + (i / 4)) % 2 == 0;
+        rgba[i * 4 + 0] = red ? 255 : 0;
+        rgba[i * 4 + 1] = red ? 0 : 255;
+        rgba[i * 4 + 2] = 0;
+        rgba[i * 4 + 3] = 255;
+    }
+    RoundTripError bc1 = roundTrip(VK_FORMAT_BC1_RGB_UNORM_BLOCK, rgba, 4, 4, 3);
+    RoundTripError bc5 = roundTrip(VK_FORMAT_BC5_UNORM_BLOCK, rgba, 4, 4, 2);
+    RoundTripError bc7 = roundTrip(VK_FORMAT_BC7_UNORM_BLOCK, rgba, 4, 4, 4);
+    std::cout << "\tchecker max error bc1 " << bc1.max << ", bc5 " << bc5.max << ", bc7 " << bc7.max << "\n";
+    CHECK(bc1.max <= 4);
+    CHECK(bc5.max == 0);
+    CHECK(bc7.max <= 2);
+}
+
+//BC4 is each half of BC5, red and green get unrelated content so a channel mixup shows
+static void bc4ChannelsAreIndependent(){
+    std::vector<uint8_t> rgba(8 * 8 * 4);
+    for(uint32_t y = 0; y < 8; y++){
+        for(uint32_t x = 0; x < 8; x++){
+            uint8_t* texel = &rgba[(y * 8 + x) * 4];
+            texel[0] = static_cast<uint8_t>(x * 30);
+            texel[1] = static_cast<uint8_t>(250 - y * 7);
+            texel[2] = 0;
+            texel[3] = 255;
+        }
+    }
+    RoundTripError bc5 = roundTrip(VK_FORMAT_BC5_UNORM_BLOCK, rgba, 8, 8, 2);
+    std::cout << "\tgradients bc4/bc5 max error " << bc5.max << "\n";
+    CHECK(bc5.max <= 8);
+}
+
+//smooth image with a bit of noise, odd extent so the edge blocks get clamped texels
+static void noisyGradientWithinBound(){
+    const uint32_t width = 37, height = 21;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int32_t> noise(-6, 6);
+    std::vector<uint8_t> rgba(width * height * 4);
+    for(uint32_t y = 0; y < height; y++){
+        for(uint32_t x = 0; x < width; x++){
+            uint8_t* texel = &rgba[(y * width + x) * 4];
+            int32_t base[4] = {
+                static_cast<int32_t>(x * 255 / width), static_cast<int32_t>(y * 255 / height),
+                static_cast<int32_t>((x + y) * 255 / (width + height)), static_cast<int32_t>(255 - x * 4)
+            };
+            for(uint32_t c = 0; c < 4; c++){
+                texel[c] = static_cast<uint8_t>(std::clamp(base[c] + noise(rng), 0, 255));
+            }
+        }
+    }
+    RoundTripError bc1 = roundTrip(VK_FORMAT_BC1_RGB_UNORM_BLOCK, rgba, width, height, 3);
+    RoundTripError bc5 = roundTrip(VK_FORMAT_BC5_UNORM_BLOCK, rgba, width, height, 2);
+    RoundTripError bc7 = roundTrip(VK_FORMAT_BC7_UNORM_BLOCK, rgba, width, height, 4);
+    std::cout << "\tnoisy gradient rms bc1 " << bc1.rms << ", bc5 " << bc5.rms << ", bc7 " << bc7.rms << "\n";
+    CHECK(bc1.rms < 8.0);
+    CHECK(bc5.rms < 3.0);
+    CHECK(bc7.rms < 7.0);
+}
+
+static void flatBlockIsExact(){
+    std::vector<uint8_t> rgba(4 * 4 * 4);
+    for(uint32_t i = 0; i < 16; i++){
+        rgba[i * 4 + 0] = 200;
+        rgba[i * 4 + 1] = 100;
+        rgba[i * 4 + 2] = 50;
+        rgba[i * 4 + 3] = 255;
+    }
+    CHECK(roundTrip(VK_FORMAT_BC1_RGB_UNORM_BLOCK, rgba, 4, 4, 3).max <= 4);
+    CHECK(roundTrip(VK_FORMAT_BC5_UNORM_BLOCK, rgba, 4, 4, 2).max == 0);
+    CHECK(roundTrip(VK_FORMAT_BC7_UNORM_BLOCK, rgba, 4, 4, 4).max <= 1);
+}
+
+
+int main(){
+    checkerKeepsBothColors();
+    bc4ChannelsAreIndependent();
+    noisyGradientWithinBound();
+    flatBlockIsExact();
+    return checkResult("texture_compress_test");
+}
@@ -0,0 +1,84 @@
+#include <vertex_format.hpp>
+#include "check.hpp"
+
+#include <cmath>
+#include <random>
+
+
+//random unit vector, uniform on the sphere
+static glm::vec3 randomDirection(std::mt19937& rng){
+    std::normal_distribution<float> gauss(0.0f, 1.0f);
+    glm::vec3 v;
+    do{
+        v = glm::vec3(gauss(rng), gauss(rng), gauss(rng));
+    }while(glm::length(v) < 1e-6f);
+    return glm::normalize(v);
+}
+
+static void roundTripStaysWithinBound(glm::vec3 lo, glm::vec3 hi, float maxUV){
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<Vertex> vertices(200000);
+    for(Vertex& vertex : vertices){
+        vertex.position = lo + (hi - lo) * glm::vec3(unit(rng), unit(rng), unit(rng));
+        vertex.normal = randomDirection(rng);
+        vertex.tangent = glm::vec4(randomDirection(rng), (unit(rng) < 0.5f) ? -1.0f : 1.0f);
+        vertex.uv = glm::vec2(unit(rng), unit(rng)) * (2.0f * maxUV) - maxUV;
+    }
+    //the axes themselves sit right on the octahedron's folds
+    for(glm::vec3 axis : {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)}){
+        vertices.push_back({lo, axis, glm::vec4(axis, 1.0f), glm::vec2(0.0f)});
+    }
+
+    MeshBounds bounds;
+    std::vector<PackedVertex> packed = packMesh(vertices, bounds);
+    VertexEncodingError error = measureVertexEncodingError(vertices.data(), packed.data(), vertices.size(), bounds);
+    VertexEncodingError bound = vertexEncodingErrorBound(bounds, maxUV);
+    std::cout << "\tpositions " << error.position << " <= " << bound.position
+        << ", normals " << error.normalAngle << " <= " << bound.normalAngle
+        << ", tangents " << error.tangentAngle << " <= " << bound.tangentAngle
+        << ", uvs " << error.uv << " <= " << bound.uv << "\n";
+    CHECK(error.position <= bound.position);
+    CHECK(error.normalAngle <= bound.normalAngle);
+    CHECK(error.tangentAngle <= bound.tangentAngle);
+    CHECK(error.uv <= bound.uv);
+    for(size_t i = 0; i < vertices.size(); i++){
+        CHECK((unpackVertex(packed[i], bounds).tangent.w > 0.0f) == (vertices[i].tangent.w > 0.0f));
+    }
+}
+
+static void zeroVectorDecodesToZ(){
+    glm::vec2 e = octahedralEncode(glm::vec3(0.0f));
+    CHECK(e == glm::vec2(0.0f));
+    CHECK(octahedralDecode(e) == glm::vec3(0.0f, 0.0f, 1.0f));
+
+    Vertex broken{glm::vec3(1.0f), glm::vec3(0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), glm::vec2(0.5f)};
+    MeshBounds bounds{glm::vec3(0.0f), glm::vec3(2.0f)};
+    Vertex decoded = unpackVertex(packVertex(broken, bounds), bounds);
+    CHECK(decoded.normal == glm::vec3(0.0f, 0.0f, 1.0f));
+    CHECK(glm::vec3(decoded.tangent) == glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+static void flatAxisQuantizesToMin(){
+    std::vector<Vertex> vertices = {
+        {glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0, 1, 0), glm::vec4(1, 0, 0, 1), glm::vec2(0.0f)},
+        {glm::vec3(1.0f, 5.0f, 1.0f), glm::vec3(0, 1, 0), glm::vec4(1, 0, 0, 1), glm::vec2(1.0f)}
+    };
+    MeshBounds bounds;
+    std::vector<PackedVertex> packed = packMesh(vertices, bounds);
+    CHECK(bounds.extent.y == 0.0f);
+    for(const PackedVertex& vertex : packed){
+        CHECK(unpackVertex(vertex, bounds).position.y == 5.0f);
+    }
+}
+
+
+int main(){
+    std::cout << "small mesh around the origin\n";
+    roundTripStaysWithinBound(glm::vec3(-1.0f), glm::vec3(1.0f), 1.0f);
+    std::cout << "large mesh far from the origin, tiled uvs\n";
+    roundTripStaysWithinBound(glm::vec3(1000.0f, -50.0f, 20000.0f), glm::vec3(1400.0f, 300.0f, 20010.0f), 16.0f);
+    zeroVectorDecodesToZ();
+    flatAxisQuantizesToMin();
+    return checkResult("vertex_format_test");
+}